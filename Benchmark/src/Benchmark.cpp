@@ -0,0 +1,378 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef BENCHMARK_LIBPNG
+#include <csetjmp>
+#include <png.h>
+#endif
+
+#include "PNG.h"
+#include "JPEG.h"
+#include "Soak.h"
+
+#include "Corpus.h"
+#include "Report.h"
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	std::vector<fs::path> suites;
+	fs::path workDirectory = "temp/Benchmark";
+	fs::path outputPath;
+	uint32_t generatedSize = 2048;
+	bool generate = true;
+	bool lowMemory = false;
+	bool statistics = false;
+	int iterations = 5;
+
+	// Compare mode
+	fs::path baselinePath, currentPath;
+	double thresholdPercent = 10.0;
+	double noiseFloorMs = 0.05;
+
+	// Soak mode
+	size_t soakLoads = 0;
+	size_t windowLoads = 100;
+};
+
+static void PrintUsage() {
+	fprintf(stderr,
+		"Usage: Benchmark [options] [<PngSuite directory>...]\n"
+		"       Benchmark --compare <baseline.json> <current.json> [--threshold <percent>] [--noise-floor <ms>]\n"
+		"       Benchmark --soak <loads> [--window <loads>] [options] [<PngSuite directory>...]\n"
+		"\n"
+		"Times each decode stage over every PNG in the given directories and generated images in every\n"
+		"colour type, bit depth and interlace method, printing the median of each and the peak memory as JSON\n"
+		"\n"
+		"Options:\n"
+		"  --size <pixels>       Width and height of generated images (default 2048)\n"
+		"  --no-generated        Only benchmark the given directories\n"
+		"  --low-memory          Decode in low memory mode\n"
+		"  --stats               Collect image statistics while decoding\n"
+		"  --iterations <count>  Decodes of each image to take the median of (default 5)\n"
+		"  --work <directory>    Where generated images are kept (default temp/Benchmark)\n"
+		"  --output <file>       Write the JSON report to a file instead of standard output\n"
+		"  --threshold <percent> Slow down reported as a regression by --compare (default 10)\n"
+		"  --noise-floor <ms>    Timings shorter than this in both runs are not compared (default 0.05)\n"
+		"  --soak <loads>        Load and free images in turn this many times, reporting latency and resources per window\n"
+		"  --window <loads>      Loads in each window of --soak (default 100)\n"
+		"\n"
+		"--compare exits with 1 if there are any regressions, --soak exits with 1 if latency, memory or open files kept growing\n");
+}
+
+static bool ParseNumber(const char* value, double& number) {
+	char* end = nullptr;
+	number = strtod(value, &end);
+	return end != value && *end == '\0' && number >= 0.0;
+}
+
+static bool ParseArguments(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		double number = 0.0;
+
+		if (argument == "--no-generated") { options.generate = false; }
+		else if (argument == "--low-memory") { options.lowMemory = true; }
+		else if (argument == "--stats") { options.statistics = true; }
+		else if (argument == "--compare") {
+			if (i + 2 >= argc) { return false; }
+			options.baselinePath = argv[++i];
+			options.currentPath = argv[++i];
+		}
+		else if (argument == "--size" || argument == "--iterations" || argument == "--threshold" || argument == "--noise-floor" || argument == "--soak" || argument == "--window") {
+			if (i + 1 >= argc || !ParseNumber(argv[++i], number)) {
+				fprintf(stderr, "Error: Invalid value for %s\n", argument.c_str());
+				return false;
+			}
+			if (argument == "--size") { options.generatedSize = (uint32_t)number; }
+			else if (argument == "--iterations") { options.iterations = std::max(1, (int)number); }
+			else if (argument == "--threshold") { options.thresholdPercent = number; }
+			else if (argument == "--soak") { options.soakLoads = std::max((size_t)1, (size_t)number); }
+			else if (argument == "--window") { options.windowLoads = std::max((size_t)1, (size_t)number); }
+			else { options.noiseFloorMs = number; }
+		}
+		else if (argument == "--work" || argument == "--output") {
+			if (i + 1 >= argc) { return false; }
+			(argument == "--work" ? options.workDirectory : options.outputPath) = argv[++i];
+		}
+		else if (argument.starts_with("--")) {
+			fprintf(stderr, "Error: Unknown option %s\n", argument.c_str());
+			return false;
+		}
+		else { options.suites.push_back(argument); }
+	}
+
+	if (options.baselinePath.empty() && !options.generate && options.suites.empty()) {
+		fprintf(stderr, "Error: Nothing to benchmark\n");
+		return false;
+	}
+	if (options.generatedSize == 0 || options.generatedSize > ImageLibrary::Utils::PNG_APP_MAX_DIMENSION) {
+		fprintf(stderr, "Error: Invalid generated image size\n");
+		return false;
+	}
+
+	return true;
+}
+
+static double Milliseconds(Clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+#ifdef BENCHMARK_LIBPNG
+static void ReadFromMemory(png_structp png, png_bytep dest, png_size_t length) {
+	auto* source = static_cast<std::span<const uint8_t>*>(png_get_io_ptr(png));
+	if (length > source->size()) { png_error(png, "Unexpected end of file"); }
+	memcpy(dest, source->data(), length);
+	*source = source->subspan(length);
+}
+
+static void IgnoreWarning(png_structp, png_const_charp) {}
+
+// Decode with libpng into the same layout as Image::GetPixelBuffer so the work done is comparable
+// Nothing with a destructor may be created after setjmp, so the buffers are owned by the caller
+static bool DecodeWithLibpng(const std::vector<uint8_t>& file, std::vector<uint8_t>& pixels, std::vector<png_bytep>& rows) {
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, IgnoreWarning);
+	png_infop info = png_create_info_struct(png);
+	std::span<const uint8_t> source(file);
+
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, nullptr);
+		return false;
+	}
+
+	png_set_read_fn(png, &source, ReadFromMemory);
+	png_read_info(png, info);
+
+	png_set_expand(png);
+	png_set_gray_to_rgb(png);
+	png_set_swap(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	size_t rowBytes = png_get_rowbytes(png, info);
+	uint32_t height = png_get_image_height(png, info);
+	pixels.resize(rowBytes * height);
+	rows.resize(height);
+	for (uint32_t y = 0; y < height; y++) { rows[y] = pixels.data() + y * rowBytes; }
+
+	png_read_image(png, rows.data());
+	png_read_end(png, nullptr);
+	png_destroy_read_struct(&png, &info, nullptr);
+	return true;
+}
+#endif
+
+static Benchmark::ImageResult BenchmarkImage(const Benchmark::CorpusFile& file, int iterations) {
+	Benchmark::ImageResult result{ .name = file.name };
+	std::error_code sizeError;
+	result.bytes = fs::file_size(file.path, sizeError);
+
+	// Every measurement for every iteration, in the order they are reported
+	const std::vector<std::string> stages = { "parseChunks", "checkCRC", "decompressData", "unfilterData", "unpackData", "deinterlaceData", "parsePixels", "pixelDataToBuffer", "other", "decode" };
+	std::vector<std::vector<double>> samples(stages.size());
+
+	for (int i = 0; i < iterations; i++) {
+		try {
+			Clock::time_point start = Clock::now();
+			ImageLibrary::PNG image(file.path.string());
+			Clock::time_point decoded = Clock::now();
+			image.GetPixelBuffer();
+			Clock::time_point end = Clock::now();
+
+			const ImageLibrary::Utils::PNG::StageTimings& timings = image.GetStageTimings();
+			std::vector<double> times = { timings.parseChunks, timings.checkCRC, timings.decompressData, timings.unfilterData, timings.unpackData, timings.deinterlaceData, timings.parsePixels };
+			for (double& time : times) { time *= 1000.0; }
+
+			// Anything not in a stage such as reading the file
+			double staged = 0.0;
+			for (double time : times) { staged += time; }
+			times.push_back(Milliseconds(end - decoded));
+			times.push_back(std::max(0.0, Milliseconds(decoded - start) - staged));
+			times.push_back(Milliseconds(end - start));
+
+			for (size_t s = 0; s < stages.size(); s++) { samples[s].push_back(times[s]); }
+			result.width = image.GetWidth();
+			result.height = image.GetHeight();
+			result.peakBytes = image.GetMemoryStats().peakBytes;
+			result.allocations = image.GetMemoryStats().allocations;
+		}
+		catch (std::exception* e) {
+			result.error = e->what();
+			delete e;
+			return result;
+		}
+		catch (const std::exception& e) {
+			result.error = std::string("Error: ") + e.what();
+			return result;
+		}
+	}
+
+#ifdef BENCHMARK_LIBPNG
+	// Reference decode including reading the file as the decoder does
+	std::vector<double> referenceSamples;
+	std::vector<uint8_t> pixels;
+	std::vector<png_bytep> rows;
+	for (int i = 0; i < iterations; i++) {
+		Clock::time_point start = Clock::now();
+		std::ifstream stream(file.path, std::ios::binary);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		if (!DecodeWithLibpng(data, pixels, rows)) { break; }
+		referenceSamples.push_back(Milliseconds(Clock::now() - start));
+	}
+#endif
+
+	// Report the median of each measurement
+	auto median = [](std::vector<double>& values) {
+		std::sort(values.begin(), values.end());
+		size_t middle = values.size() / 2;
+		return (values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0);
+	};
+	for (size_t s = 0; s < stages.size(); s++) { result.timings.emplace_back(stages[s], median(samples[s])); }
+
+#ifdef BENCHMARK_LIBPNG
+	if (!referenceSamples.empty()) { result.timings.emplace_back("libpng", median(referenceSamples)); }
+#endif
+
+	return result;
+}
+
+// Handles held by the process, which should stay level however many images are loaded and freed
+static std::vector<std::pair<std::string, int64_t>> SampleOpenHandles() {
+#ifdef _WIN32
+	DWORD handles = 0;
+	GetProcessHandleCount(GetCurrentProcess(), &handles);
+	return { { "openHandles", (int64_t)handles } };
+#else
+	std::error_code error;
+	int64_t descriptors = 0;
+	for (fs::directory_iterator entry("/proc/self/fd", error), end; !error && entry != end; entry.increment(error)) { descriptors++; }
+	return { { "openHandles", descriptors } };
+#endif
+}
+
+// Load every image in turn until the count is reached, freeing each before the next, the way a viewer flicks through a folder
+// Images that fail to decode are timed too, so leaks on the error path show up as well
+static ImageLibrary::SoakRecorder RunSoak(const std::vector<Benchmark::CorpusFile>& files, size_t loads, size_t windowLoads) {
+	ImageLibrary::SoakRecorder recorder(ImageLibrary::SoakOptions{ .windowLoads = windowLoads }, SampleOpenHandles);
+
+	for (size_t i = 0; i < loads; i++) {
+		const Benchmark::CorpusFile& file = files[i % files.size()];
+		Clock::time_point start = Clock::now();
+		try {
+			std::unique_ptr<ImageLibrary::Image> image;
+			if (ImageLibrary::Utils::GetFileFormat(file.path.string()) == ImageLibrary::Utils::FileFormat::JPEG) { image = std::make_unique<ImageLibrary::JPEG>(file.path.string()); }
+			else { image = std::make_unique<ImageLibrary::PNG>(file.path.string()); }
+			image->GetPixelBuffer();
+		}
+		catch (std::exception* e) { delete e; }
+		catch (const std::exception&) {}
+		recorder.AddLoad(Milliseconds(Clock::now() - start));
+
+		// A window closes on every multiple of its loads
+		if (recorder.GetLoadCount() % windowLoads == 0) {
+			const ImageLibrary::SoakWindow& window = recorder.GetWindows().back();
+			fprintf(stderr, "[%zu/%zu] p50 %.3f ms, p99 %.3f ms, %.1f MB resident\n", i + 1, loads, window.p50Milliseconds, window.p99Milliseconds, window.residentBytes / (1024.0 * 1024.0));
+		}
+	}
+
+	return recorder;
+}
+
+static bool ReadTextFile(const fs::path& path, std::string& text) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) { return false; }
+	text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+
+	int exitCode = 0;
+	try {
+		// Compare two previous runs
+		if (!options.baselinePath.empty()) {
+			std::string baseline, current;
+			if (!ReadTextFile(options.baselinePath, baseline) || !ReadTextFile(options.currentPath, current)) {
+				fprintf(stderr, "Error: Could not read reports\n");
+				return 2;
+			}
+			int regressions = Benchmark::CompareReports(Benchmark::ReportFromJSON(baseline), Benchmark::ReportFromJSON(current), options.thresholdPercent, options.noiseFloorMs);
+			return (regressions == 0 ? 0 : 1);
+		}
+
+		ImageLibrary::Image::SetLowMemoryMode(options.lowMemory);
+		ImageLibrary::Image::SetCollectStatistics(options.statistics);
+
+		std::vector<Benchmark::CorpusFile> files;
+		for (const fs::path& suite : options.suites) {
+			std::vector<Benchmark::CorpusFile> found = Benchmark::FindImages(suite);
+			files.insert(files.end(), found.begin(), found.end());
+		}
+		if (options.generate) {
+			std::vector<Benchmark::CorpusFile> generated = Benchmark::GenerateImages(options.workDirectory, options.generatedSize);
+			files.insert(files.end(), generated.begin(), generated.end());
+		}
+
+		// Progress goes to the error stream so the report can be redirected
+		std::string json;
+		if (options.soakLoads > 0) {
+			if (files.empty()) {
+				fprintf(stderr, "Error: No images to soak\n");
+				return 2;
+			}
+
+			ImageLibrary::SoakRecorder recorder = RunSoak(files, options.soakLoads, options.windowLoads);
+			std::vector<std::string> failures = recorder.Judge();
+			for (const std::string& failure : failures) { fprintf(stderr, "Error: %s\n", failure.c_str()); }
+			fprintf(stderr, "Soak %s after %zu loads\n", failures.empty() ? "passed" : "failed", recorder.GetLoadCount());
+			json = recorder.ToJSON();
+			exitCode = (failures.empty() ? 0 : 1);
+		}
+		else {
+			Benchmark::Report report{ .iterations = options.iterations };
+			for (size_t i = 0; i < files.size(); i++) {
+				fprintf(stderr, "[%zu/%zu] %s\n", i + 1, files.size(), files[i].name.c_str());
+				report.images.push_back(BenchmarkImage(files[i], options.iterations));
+			}
+			json = Benchmark::ReportToJSON(report);
+		}
+
+		if (options.outputPath.empty()) {
+			fputs(json.c_str(), stdout);
+			return exitCode;
+		}
+
+		std::ofstream output(options.outputPath, std::ios::binary);
+		output << json;
+		if (!output) {
+			fprintf(stderr, "Error: Could not write %s\n", options.outputPath.string().c_str());
+			return 2;
+		}
+	}
+	catch (std::exception* e) {
+		fprintf(stderr, "%s\n", e->what());
+		delete e;
+		return 2;
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "Error: %s\n", e.what());
+		return 2;
+	}
+
+	return exitCode;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "../../ImageLibrary/vendor/zlib/zlib.h"
+
+#include "Corpus.h"
+
+namespace Benchmark {
+	std::vector<CorpusFile> FindImages(const std::filesystem::path& directory) {
+		std::vector<CorpusFile> files;
+
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+			if (!entry.is_regular_file()) { continue; }
+
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+			if (extension != ".png") { continue; }
+
+			files.push_back(CorpusFile{ .name = std::filesystem::relative(entry.path(), directory).generic_string(), .path = entry.path() });
+		}
+
+		// Keep runs in the same order so their output can be compared line by line
+		std::sort(files.begin(), files.end(), [](const CorpusFile& a, const CorpusFile& b) { return a.name < b.name; });
+		return files;
+	}
+
+	static void WriteBigEndian(std::vector<uint8_t>& dest, uint32_t value) {
+		for (int i = 3; i >= 0; i--) { dest.push_back((uint8_t)(value >> (8 * i))); }
+	}
+
+	static void WriteChunk(std::vector<uint8_t>& dest, const char* type, const uint8_t* data, size_t length) {
+		WriteBigEndian(dest, (uint32_t)length);
+		size_t start = dest.size();
+		dest.insert(dest.end(), type, type + 4);
+		dest.insert(dest.end(), data, data + length);
+		WriteBigEndian(dest, (uint32_t)crc32(0, dest.data() + start, (uInt)(length + 4)));
+	}
+
+	// Filter a packed row with the given filter type, appending it to the filtered data
+	static void FilterRow(uint8_t filterType, const std::vector<uint8_t>& row, const std::vector<uint8_t>& previousRow, size_t bytesPerPixel, std::vector<uint8_t>& dest) {
+		dest.push_back(filterType);
+
+		for (size_t x = 0; x < row.size(); x++) {
+			int a = (x >= bytesPerPixel ? row[x - bytesPerPixel] : 0);
+			int b = (previousRow.empty() ? 0 : previousRow[x]);
+			int c = (x >= bytesPerPixel && !previousRow.empty() ? previousRow[x - bytesPerPixel] : 0);
+
+			int predictor = 0;
+			switch (filterType) {
+			case 1: predictor = a; break;
+			case 2: predictor = b; break;
+			case 3: predictor = (a + b) / 2; break;
+			case 4: {
+				int p = a + b - c;
+				int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+				predictor = (pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+				break;
+			}
+			}
+
+			dest.push_back((uint8_t)(row[x] - predictor));
+		}
+	}
+
+	static std::vector<uint8_t> GeneratePNG(uint32_t size, uint8_t colourType, uint8_t bitDepth, uint8_t interlaceMethod) {
+		int samplesPerPixel = (colourType == 2 ? 3 : colourType == 4 ? 2 : colourType == 6 ? 4 : 1);
+		uint32_t maxValue = (1u << bitDepth) - 1;
+		size_t bytesPerPixel = std::max<size_t>(1, samplesPerPixel * bitDepth / 8);
+
+		// Smooth gradients with a little noise from a fixed seed so every run generates the same file
+		uint32_t seed = 0x9E3779B9u ^ (colourType << 8) ^ bitDepth;
+		std::vector<uint16_t> samples((size_t)size * size * samplesPerPixel);
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				for (int c = 0; c < samplesPerPixel; c++) {
+					seed = seed * 1664525u + 1013904223u;
+					uint64_t gradient = (uint64_t)((c % 2 == 0 ? x : y) + (c + 1) * (x + y) / 4) * (maxValue + 1) / size;
+					uint32_t noise = (seed >> 24) * (maxValue / 32 + 1) / 256;
+					samples[((size_t)y * size + x) * samplesPerPixel + c] = (uint16_t)((gradient + noise) % (maxValue + 1));
+				}
+			}
+		}
+
+		// Adam7 passes as x start, y start, x step, y step with a single pass covering everything when not interlaced
+		std::vector<std::array<uint32_t, 4>> passes = { {0, 0, 1, 1} };
+		if (interlaceMethod == 1) {
+			passes = { {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2} };
+		}
+
+		// Pack and filter each row, cycling through the filter types
+		std::vector<uint8_t> filteredData;
+		uint32_t rowIndex = 0;
+		for (const auto& pass : passes) {
+			std::vector<uint8_t> previousRow;
+			for (uint32_t y = pass[1]; y < size; y += pass[3]) {
+				std::vector<uint8_t> row;
+				uint32_t bitBuffer = 0;
+				int bitCount = 0;
+
+				for (uint32_t x = pass[0]; x < size; x += pass[2]) {
+					for (int c = 0; c < samplesPerPixel; c++) {
+						uint16_t sample = samples[((size_t)y * size + x) * samplesPerPixel + c];
+						if (bitDepth == 16) {
+							row.push_back((uint8_t)(sample >> 8));
+							row.push_back((uint8_t)sample);
+							continue;
+						}
+
+						bitBuffer = (bitBuffer << bitDepth) | sample;
+						bitCount += bitDepth;
+						if (bitCount == 8) {
+							row.push_back((uint8_t)bitBuffer);
+							bitBuffer = 0;
+							bitCount = 0;
+						}
+					}
+				}
+				if (bitCount != 0) { row.push_back((uint8_t)(bitBuffer << (8 - bitCount))); }
+
+				if (row.empty()) { continue; }
+				FilterRow((uint8_t)(rowIndex++ % 5), row, previousRow, bytesPerPixel, filteredData);
+				previousRow = std::move(row);
+			}
+		}
+
+		// Compress as a zlib stream
+		uLongf compressedSize = compressBound((uLong)filteredData.size());
+		std::vector<uint8_t> compressedData(compressedSize);
+		if (compress2(compressedData.data(), &compressedSize, filteredData.data(), (uLong)filteredData.size(), 6) != Z_OK) {
+			throw new std::runtime_error("Error: Could not compress generated image");
+		}
+		compressedData.resize(compressedSize);
+
+		std::vector<uint8_t> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		std::vector<uint8_t> header;
+		WriteBigEndian(header, size);
+		WriteBigEndian(header, size);
+		header.insert(header.end(), { bitDepth, colourType, 0, 0, interlaceMethod });
+		WriteChunk(file, "IHDR", header.data(), header.size());
+
+		// Palette spread over the colour cube
+		if (colourType == 3) {
+			std::vector<uint8_t> palette;
+			for (uint32_t i = 0; i <= maxValue; i++) {
+				palette.insert(palette.end(), { (uint8_t)(i * 255 / maxValue), (uint8_t)(255 - i * 255 / maxValue), (uint8_t)(i * 97) });
+			}
+			WriteChunk(file, "PLTE", palette.data(), palette.size());
+		}
+
+		// Split the data over IDAT chunks the way most encoders do
+		constexpr size_t idatSize = 65536;
+		for (size_t offset = 0; offset < compressedData.size(); offset += idatSize) {
+			WriteChunk(file, "IDAT", compressedData.data() + offset, std::min(idatSize, compressedData.size() - offset));
+		}
+		WriteChunk(file, "IEND", nullptr, 0);
+
+		return file;
+	}
+
+	std::vector<CorpusFile> GenerateImages(const std::filesystem::path& directory, uint32_t size) {
+		// Every valid colour type and bit depth combination
+		const std::vector<std::pair<uint8_t, std::vector<uint8_t>>> combinations = {
+			{ 0, { 1, 2, 4, 8, 16 } },
+			{ 2, { 8, 16 } },
+			{ 3, { 1, 2, 4, 8 } },
+			{ 4, { 8, 16 } },
+			{ 6, { 8, 16 } }
+		};
+
+		std::filesystem::create_directories(directory);
+
+		std::vector<CorpusFile> files;
+		for (const auto& [colourType, bitDepths] : combinations) {
+			for (uint8_t bitDepth : bitDepths) {
+				for (uint8_t interlaceMethod = 0; interlaceMethod <= 1; interlaceMethod++) {
+					std::string name = "generated_" + std::to_string(size) + "_c" + std::to_string(colourType) + "_d" + std::to_string(bitDepth) + "_i" + std::to_string(interlaceMethod);
+					std::filesystem::path path = directory / (name + ".png");
+
+					// Images are only generated once for each size
+					if (!std::filesystem::exists(path)) {
+						std::vector<uint8_t> data = GeneratePNG(size, colourType, bitDepth, interlaceMethod);
+						std::ofstream file(path, std::ios::binary);
+						file.write(reinterpret_cast<const char*>(data.data()), data.size());
+						if (!file) { throw new std::runtime_error("Error: Could not write " + path.string()); }
+					}
+
+					files.push_back(CorpusFile{ .name = name, .path = path });
+				}
+			}
+		}
+
+		return files;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace Benchmark {
+	// Image to be benchmarked
+	struct CorpusFile {
+		std::string name;
+		std::filesystem::path path;
+	};
+
+	// Find every PNG in a directory such as the PngSuite, named by their path relative to it
+	std::vector<CorpusFile> FindImages(const std::filesystem::path& directory);
+
+	// Write square images covering every colour type, bit depth and interlace method to a directory
+	// Rows cycle through every filter type and contents are gradients with noise so they compress like photographs
+	std::vector<CorpusFile> GenerateImages(const std::filesystem::path& directory, uint32_t size);
+}
\ No newline at end of file
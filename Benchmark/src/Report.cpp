@@ -0,0 +1,261 @@
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Report.h"
+
+namespace Benchmark {
+	static std::string EscapeJSON(const std::string& value) {
+		std::string output;
+		for (unsigned char c : value) {
+			if (c == '"' || c == '\\') {
+				output += '\\';
+				output += c;
+			}
+			else if (c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				output += escaped;
+			}
+			else { output += c; }
+		}
+		return output;
+	}
+
+	std::string ReportToJSON(const Report& report) {
+		std::string json = "{\n  \"iterations\": " + std::to_string(report.iterations) + ",\n  \"images\": [";
+
+		char number[64];
+		for (size_t i = 0; i < report.images.size(); i++) {
+			const ImageResult& image = report.images[i];
+			json += (i == 0 ? "\n    {" : ",\n    {");
+			json += "\"name\": \"" + EscapeJSON(image.name) + "\", \"width\": " + std::to_string(image.width) + ", \"height\": " + std::to_string(image.height) + ", \"bytes\": " + std::to_string(image.bytes);
+			if (!image.error.empty()) { json += ", \"error\": \"" + EscapeJSON(image.error) + "\""; }
+
+			json += ", \"ms\": {";
+			for (size_t j = 0; j < image.timings.size(); j++) {
+				snprintf(number, sizeof(number), "%.4f", image.timings[j].second);
+				json += (j == 0 ? "\"" : ", \"") + EscapeJSON(image.timings[j].first) + "\": " + number;
+			}
+			json += "}, \"peakBytes\": " + std::to_string(image.peakBytes) + ", \"allocations\": " + std::to_string(image.allocations) + "}";
+		}
+
+		json += (report.images.empty() ? "]\n}\n" : "\n  ]\n}\n");
+		return json;
+	}
+
+	// Just enough of a JSON reader to load reports written by ReportToJSON
+	struct JSONValue {
+		enum Type { NONE, NUMBER, STRING, ARRAY, OBJECT } type = NONE;
+		double number = 0.0;
+		std::string string;
+		std::vector<JSONValue> array;
+		std::vector<std::pair<std::string, JSONValue>> object;
+
+		const JSONValue* Find(const std::string& key) const {
+			for (const auto& [name, value] : object) {
+				if (name == key) { return &value; }
+			}
+			return nullptr;
+		}
+	};
+
+	class JSONReader
+	{
+	public:
+		JSONReader(const std::string& json) : m_json(json) {};
+
+		JSONValue Read() {
+			JSONValue value = ReadValue();
+			SkipWhitespace();
+			if (m_position != m_json.size()) { Fail(); }
+			return value;
+		}
+
+	private:
+		[[noreturn]] void Fail() { throw new std::runtime_error("Error: Invalid benchmark JSON at offset " + std::to_string(m_position)); }
+
+		void SkipWhitespace() {
+			while (m_position < m_json.size() && isspace((unsigned char)m_json[m_position])) { m_position++; }
+		}
+
+		bool Consume(char c) {
+			SkipWhitespace();
+			if (m_position < m_json.size() && m_json[m_position] == c) {
+				m_position++;
+				return true;
+			}
+			return false;
+		}
+
+		JSONValue ReadValue() {
+			SkipWhitespace();
+			if (m_position >= m_json.size()) { Fail(); }
+
+			JSONValue value;
+			char c = m_json[m_position];
+			if (c == '{') {
+				value.type = JSONValue::OBJECT;
+				m_position++;
+				if (Consume('}')) { return value; }
+				do {
+					SkipWhitespace();
+					std::string key = ReadString();
+					if (!Consume(':')) { Fail(); }
+					value.object.emplace_back(key, ReadValue());
+				} while (Consume(','));
+				if (!Consume('}')) { Fail(); }
+			}
+			else if (c == '[') {
+				value.type = JSONValue::ARRAY;
+				m_position++;
+				if (Consume(']')) { return value; }
+				do { value.array.push_back(ReadValue()); } while (Consume(','));
+				if (!Consume(']')) { Fail(); }
+			}
+			else if (c == '"') {
+				value.type = JSONValue::STRING;
+				value.string = ReadString();
+			}
+			else if (m_json.compare(m_position, 4, "null") == 0 || m_json.compare(m_position, 4, "true") == 0) { m_position += 4; }
+			else if (m_json.compare(m_position, 5, "false") == 0) { m_position += 5; }
+			else {
+				const char* start = m_json.c_str() + m_position;
+				char* end = nullptr;
+				value.type = JSONValue::NUMBER;
+				value.number = strtod(start, &end);
+				if (end == start) { Fail(); }
+				m_position += end - start;
+			}
+			return value;
+		}
+
+		std::string ReadString() {
+			if (m_position >= m_json.size() || m_json[m_position] != '"') { Fail(); }
+			m_position++;
+
+			std::string output;
+			while (m_position < m_json.size() && m_json[m_position] != '"') {
+				char c = m_json[m_position++];
+				if (c != '\\') {
+					output += c;
+					continue;
+				}
+
+				if (m_position >= m_json.size()) { Fail(); }
+				char escaped = m_json[m_position++];
+				switch (escaped) {
+				case 'n': output += '\n'; break;
+				case 't': output += '\t'; break;
+				case 'r': output += '\r'; break;
+				case 'b': output += '\b'; break;
+				case 'f': output += '\f'; break;
+				case 'u':
+					// Reports only escape control characters so anything outside ASCII is not expected
+					if (m_position + 4 > m_json.size()) { Fail(); }
+					output += (char)strtol(m_json.substr(m_position, 4).c_str(), nullptr, 16);
+					m_position += 4;
+					break;
+				default: output += escaped; break;
+				}
+			}
+			if (m_position >= m_json.size()) { Fail(); }
+			m_position++;
+
+			return output;
+		}
+
+	private:
+		const std::string& m_json;
+		size_t m_position = 0;
+	};
+
+	Report ReportFromJSON(const std::string& json) {
+		JSONValue root = JSONReader(json).Read();
+		const JSONValue* iterations = root.Find("iterations");
+		const JSONValue* images = root.Find("images");
+		if (!iterations || !images || images->type != JSONValue::ARRAY) { throw new std::runtime_error("Error: Benchmark JSON is not a report"); }
+
+		Report report;
+		report.iterations = (int)iterations->number;
+		for (const JSONValue& value : images->array) {
+			ImageResult image;
+			if (const JSONValue* name = value.Find("name")) { image.name = name->string; }
+			if (const JSONValue* width = value.Find("width")) { image.width = (uint32_t)width->number; }
+			if (const JSONValue* height = value.Find("height")) { image.height = (uint32_t)height->number; }
+			if (const JSONValue* bytes = value.Find("bytes")) { image.bytes = (uint64_t)bytes->number; }
+			if (const JSONValue* error = value.Find("error")) { image.error = error->string; }
+			if (const JSONValue* peakBytes = value.Find("peakBytes")) { image.peakBytes = (int64_t)peakBytes->number; }
+			if (const JSONValue* allocations = value.Find("allocations")) { image.allocations = (uint64_t)allocations->number; }
+			if (const JSONValue* timings = value.Find("ms")) {
+				for (const auto& [stage, time] : timings->object) { image.timings.emplace_back(stage, time.number); }
+			}
+			report.images.push_back(image);
+		}
+
+		return report;
+	}
+
+	int CompareReports(const Report& baseline, const Report& current, double thresholdPercent, double noiseFloorMs) {
+		std::map<std::string, const ImageResult*> baselineImages;
+		for (const ImageResult& image : baseline.images) { baselineImages[image.name] = &image; }
+
+		int regressions = 0;
+		std::vector<std::pair<std::string, std::pair<double, double>>> totals;
+
+		for (const ImageResult& image : current.images) {
+			auto found = baselineImages.find(image.name);
+			if (found == baselineImages.end()) {
+				printf("new        %s\n", image.name.c_str());
+				continue;
+			}
+			const ImageResult& previous = *found->second;
+			baselineImages.erase(found);
+
+			// A change in whether the image decodes is always reported
+			if (image.error != previous.error) {
+				printf("%s %s: \"%s\" -> \"%s\"\n", (image.error.empty() ? "fixed     " : "REGRESSION"), image.name.c_str(), previous.error.c_str(), image.error.c_str());
+				if (!image.error.empty()) { regressions++; }
+				continue;
+			}
+
+			for (const auto& [stage, time] : image.timings) {
+				auto previousTime = std::find_if(previous.timings.begin(), previous.timings.end(), [&stage](const auto& timing) { return timing.first == stage; });
+				if (previousTime == previous.timings.end()) { continue; }
+
+				// Sum each stage over every image in both runs
+				auto total = std::find_if(totals.begin(), totals.end(), [&stage](const auto& timing) { return timing.first == stage; });
+				if (total == totals.end()) {
+					totals.push_back({ stage, { 0.0, 0.0 } });
+					total = totals.end() - 1;
+				}
+				total->second.first += previousTime->second;
+				total->second.second += time;
+
+				if (time < noiseFloorMs && previousTime->second < noiseFloorMs) { continue; }
+
+				double change = (previousTime->second > 0.0 ? (time - previousTime->second) / previousTime->second * 100.0 : 100.0);
+				if (change > thresholdPercent) {
+					printf("REGRESSION %s %s: %.4f ms -> %.4f ms (%+.1f%%)\n", image.name.c_str(), stage.c_str(), previousTime->second, time, change);
+					regressions++;
+				}
+				else if (change < -thresholdPercent) {
+					printf("improved   %s %s: %.4f ms -> %.4f ms (%+.1f%%)\n", image.name.c_str(), stage.c_str(), previousTime->second, time, change);
+				}
+			}
+		}
+
+		for (const auto& [name, image] : baselineImages) { printf("missing    %s\n", name.c_str()); }
+
+		printf("\nTotals over images in both runs:\n");
+		for (const auto& [stage, time] : totals) {
+			double change = (time.first > 0.0 ? (time.second - time.first) / time.first * 100.0 : 0.0);
+			printf("  %-18s %12.4f ms -> %12.4f ms (%+.1f%%)\n", stage.c_str(), time.first, time.second, change);
+		}
+		printf("\n%d regression%s above %.1f%%\n", regressions, (regressions == 1 ? "" : "s"), thresholdPercent);
+
+		return regressions;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace Benchmark {
+	// Median timings of one image in milliseconds keyed by stage name, in the order they were measured
+	// Memory is the peak bytes held and allocations made by a decode, which do not change between iterations
+	struct ImageResult {
+		std::string name;
+		uint32_t width = 0, height = 0;
+		uint64_t bytes = 0;
+		std::string error;
+		std::vector<std::pair<std::string, double>> timings;
+		int64_t peakBytes = 0;
+		uint64_t allocations = 0;
+	};
+
+	struct Report {
+		int iterations = 0;
+		std::vector<ImageResult> images;
+	};
+
+	std::string ReportToJSON(const Report& report);
+	Report ReportFromJSON(const std::string& json);
+
+	// Print every timing that got slower by more than the threshold between two runs, returning the number of regressions
+	// Timings below the noise floor in both runs are ignored as they are too short to measure reliably
+	int CompareReports(const Report& baseline, const Report& current, double thresholdPercent, double noiseFloorMs);
+}
\ No newline at end of file
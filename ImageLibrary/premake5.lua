@@ -0,0 +1,50 @@
+project "ImageLibrary"
+   kind "StaticLib"
+   language "C++"
+   cppdialect "C++latest"
+   staticruntime "off"
+
+   files
+   {
+      "src/**.h",
+      "src/**.cpp",
+
+      "vendor/zlib/*.h",
+      "vendor/zlib/*.c",
+   }
+
+   includedirs
+   {
+      "src",
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "files:vendor/zlib/*.c"
+      compileas "C"
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "_CRT_SECURE_NO_WARNINGS" }
+
+   filter "system:linux"
+      pic "On"
+      defines { "HAVE_UNISTD_H" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
\ No newline at end of file
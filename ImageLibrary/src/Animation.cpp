@@ -0,0 +1,219 @@
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include "Animation.h"
+
+namespace ImageLibrary {
+	// Decoded frames are kept after their first play until they take up this much memory so loops do not decode again
+	static constexpr size_t MAX_FRAME_CACHE_BYTES = 256ull * 1024 * 1024;
+
+	Animation::Animation(std::unique_ptr<PNG> image, size_t decodeAhead) : m_image(std::move(image)), m_decodeAhead(std::max<size_t>(decodeAhead, 1)) {
+		if (!m_image->IsAnimated()) { throw new std::runtime_error("Error: Image is not animated"); }
+
+		// Canvas is always composited with an alpha channel and starts fully transparent
+		m_width = m_image->GetWidth();
+		m_height = m_image->GetHeight();
+		m_pixelFormat = Utils::GetAlphaPixelFormat(m_image->GetPixelFormat());
+		m_bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		m_canvas.resize((size_t)m_width * m_height * m_bytesPerPixel, 0);
+
+		// Show the first frame straight away
+		Composite(0, m_image->DecodeFrame(0));
+
+		// Only start decoding ahead if there is anything to play
+		if (m_image->GetFrameCount() > 1 && !m_finished) {
+			m_worker = std::thread(&Animation::DecodeFrames, this);
+		}
+	}
+
+	Animation::~Animation() {
+		// Stop the worker before anything it uses is destroyed
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+		if (m_worker.joinable()) { m_worker.join(); }
+
+		delete m_error;
+	}
+
+	double Animation::GetFrameDelay() const noexcept {
+		// A zero denominator means the delay is in hundredths of a second
+		const Utils::PNG::FrameControl& control = m_image->GetFrameControl(m_frameIndex);
+		double denominator = (control.delayDenominator == 0 ? 100.0 : control.delayDenominator);
+		return control.delayNumerator / denominator;
+	}
+
+	bool Animation::Advance(Utils::Rect& dirtyRegion) {
+		if (m_finished) { return false; }
+
+		// Take the next frame if the worker has decoded it
+		DecodedFrame frame;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			// The caller owns the error once it is thrown, the animation stops on the last frame shown
+			if (m_error) {
+				m_finished = true;
+				throw std::exchange(m_error, nullptr);
+			}
+			if (m_decodedFrames.empty()) { return false; }
+
+			frame = std::move(m_decodedFrames.front());
+			m_decodedFrames.pop_front();
+		}
+		m_condition.notify_all();
+
+		// Each play starts from a transparent canvas, otherwise the previous frame is disposed of first
+		if (frame.index == 0) {
+			std::fill(m_canvas.begin(), m_canvas.end(), (uint8_t)0);
+			m_savedRegion.clear();
+			Composite(frame.index, frame.pixels);
+			dirtyRegion = Utils::Rect{ .x = 0, .y = 0, .width = m_width, .height = m_height };
+			return true;
+		}
+
+		// A frame disposed of with DISPOSE_OP_NONE leaves the canvas untouched
+		Utils::Rect disposed;
+		if (m_image->GetFrameControl(m_frameIndex).disposeOp != Utils::PNG::DISPOSE_OP_NONE) { disposed = GetFrameRect(m_frameIndex); }
+
+		DisposeFrame();
+		Utils::Rect rendered = Composite(frame.index, frame.pixels);
+		dirtyRegion = Utils::UnionRect(disposed, rendered);
+
+		return true;
+	}
+
+	void Animation::DecodeFrames() {
+		uint32_t frameCount = m_image->GetFrameCount();
+		uint32_t playCount = m_image->GetPlayCount();
+		uint64_t framesToDecode = (playCount == 0 ? UINT64_MAX : (uint64_t)frameCount * playCount - 1);
+		std::vector<Memory::Buffer> frameCache(frameCount);
+		size_t frameCacheBytes = 0;
+		uint32_t index = 1;
+
+		for (uint64_t decoded = 0; decoded < framesToDecode; decoded++) {
+			// Wait for space in the queue
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stop || m_decodedFrames.size() < m_decodeAhead; });
+				if (m_stop) { return; }
+			}
+
+			// Decode the frame unless it was kept from a previous play
+			DecodedFrame frame{ .index = index };
+			if (!frameCache[index].empty()) {
+				frame.pixels = frameCache[index];
+			}
+			else {
+				try { frame.pixels = m_image->DecodeFrame(index); }
+				catch (std::runtime_error* e) {
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_error = e;
+					return;
+				}
+
+				if (frameCacheBytes + frame.pixels.size() <= MAX_FRAME_CACHE_BYTES) {
+					frameCache[index] = frame.pixels;
+					frameCacheBytes += frame.pixels.size();
+				}
+			}
+
+			// Queue the frame for compositing
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_decodedFrames.push_back(std::move(frame));
+			}
+
+			index = (index + 1) % frameCount;
+		}
+	}
+
+	Utils::Rect Animation::Composite(uint32_t index, std::span<const uint8_t> pixels) {
+		const Utils::PNG::FrameControl& control = m_image->GetFrameControl(index);
+		Utils::Rect region = GetFrameRect(index);
+		size_t canvasStride = (size_t)m_width * m_bytesPerPixel;
+		size_t frameStride = (size_t)control.width * m_bytesPerPixel;
+
+		// Keep what is under the frame if it is to be restored when the frame is disposed of
+		if (control.disposeOp == Utils::PNG::DISPOSE_OP_PREVIOUS && index != 0) {
+			m_savedRegion.resize(frameStride * control.height);
+			for (uint32_t y = 0; y < control.height; y++) {
+				memcpy(m_savedRegion.data() + y * frameStride, m_canvas.data() + (control.yOffset + y) * canvasStride + control.xOffset * m_bytesPerPixel, frameStride);
+			}
+		}
+
+		// Render the frame onto the canvas
+		if (control.blendOp == Utils::PNG::BLEND_OP_SOURCE) {
+			for (uint32_t y = 0; y < control.height; y++) {
+				memcpy(m_canvas.data() + (control.yOffset + y) * canvasStride + control.xOffset * m_bytesPerPixel, pixels.data() + y * frameStride, frameStride);
+			}
+		}
+		else if (Utils::GetChannelByteSize(m_pixelFormat) == 2) {
+			BlendFrame<uint16_t>(control, pixels.data());
+		}
+		else {
+			BlendFrame<uint8_t>(control, pixels.data());
+		}
+
+		// Count completed plays
+		m_frameIndex = index;
+		if (index == m_image->GetFrameCount() - 1) {
+			m_playsCompleted++;
+			if (m_image->GetPlayCount() != 0 && m_playsCompleted >= m_image->GetPlayCount()) { m_finished = true; }
+		}
+
+		return region;
+	}
+
+	void Animation::DisposeFrame() {
+		const Utils::PNG::FrameControl& control = m_image->GetFrameControl(m_frameIndex);
+		size_t canvasStride = (size_t)m_width * m_bytesPerPixel;
+		size_t frameStride = (size_t)control.width * m_bytesPerPixel;
+
+		// The first frame has nothing to restore so DISPOSE_OP_PREVIOUS is treated as DISPOSE_OP_BACKGROUND
+		Utils::PNG::DisposeOp disposeOp = control.disposeOp;
+		if (disposeOp == Utils::PNG::DISPOSE_OP_PREVIOUS && m_savedRegion.size() != frameStride * control.height) { disposeOp = Utils::PNG::DISPOSE_OP_BACKGROUND; }
+
+		for (uint32_t y = 0; y < control.height && disposeOp != Utils::PNG::DISPOSE_OP_NONE; y++) {
+			uint8_t* row = m_canvas.data() + (control.yOffset + y) * canvasStride + control.xOffset * m_bytesPerPixel;
+			if (disposeOp == Utils::PNG::DISPOSE_OP_BACKGROUND) { memset(row, 0, frameStride); }
+			else { memcpy(row, m_savedRegion.data() + y * frameStride, frameStride); }
+		}
+	}
+
+	Utils::Rect Animation::GetFrameRect(uint32_t index) const {
+		const Utils::PNG::FrameControl& control = m_image->GetFrameControl(index);
+		return Utils::Rect{ .x = control.xOffset, .y = control.yOffset, .width = control.width, .height = control.height };
+	}
+
+	template <typename T>
+	void Animation::BlendFrame(const Utils::PNG::FrameControl& control, const uint8_t* pixels) {
+		// Alpha is not premultiplied so composite each channel as described in the APNG specification
+		constexpr uint64_t maxValue = std::numeric_limits<T>::max();
+
+		for (uint32_t y = 0; y < control.height; y++) {
+			const T* src = reinterpret_cast<const T*>(pixels) + (size_t)y * control.width * 4;
+			T* dest = reinterpret_cast<T*>(m_canvas.data()) + ((size_t)(control.yOffset + y) * m_width + control.xOffset) * 4;
+
+			for (uint32_t x = 0; x < control.width; x++, src += 4, dest += 4) {
+				uint64_t srcAlpha = src[3];
+				if (srcAlpha == maxValue) {
+					memcpy(dest, src, 4 * sizeof(T));
+					continue;
+				}
+				if (srcAlpha == 0) { continue; }
+
+				// Output alpha scaled by the maximum value so colours can be divided by it directly
+				uint64_t destWeight = dest[3] * (maxValue - srcAlpha);
+				uint64_t outAlpha = srcAlpha * maxValue + destWeight;
+				for (int c = 0; c < 3; c++) {
+					dest[c] = (T)((src[c] * srcAlpha * maxValue + dest[c] * destWeight) / outAlpha);
+				}
+				dest[3] = (T)(outAlpha / maxValue);
+			}
+		}
+	}
+}
\ No newline at end of file
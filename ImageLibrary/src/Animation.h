@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <span>
+
+#include "PNG.h"
+
+namespace ImageLibrary {
+	// Plays an APNG by compositing each frame's sub-rectangle onto a persistent canvas
+	// Upcoming frames are decoded ahead on a worker thread so advancing only costs the composite
+	class Animation
+	{
+	public:
+		Animation(std::unique_ptr<PNG> image, size_t decodeAhead = 4) noexcept(false);
+		~Animation() noexcept;
+
+		Animation(const Animation&) = delete;
+		Animation& operator=(const Animation&) = delete;
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+
+		// Canvas in the same layout as Image::GetPixelBuffer, always with an alpha channel
+		std::span<const uint8_t> GetCanvas() const noexcept { return m_canvas; }
+
+		// Time in seconds the frame currently on the canvas should be shown for
+		double GetFrameDelay() const noexcept;
+
+		// Whether every play of the animation has been shown
+		bool IsFinished() const noexcept { return m_finished; }
+
+		// Composite the next frame onto the canvas if it has been decoded, returning the region of the canvas that changed
+		// Throws once if a frame could not be decoded, after which the animation is finished
+		bool Advance(Utils::Rect& dirtyRegion);
+
+	private:
+		// Frame decoded by the worker waiting to be composited
+		struct DecodedFrame {
+			uint32_t index;
+			Memory::Buffer pixels;
+		};
+
+		void DecodeFrames();
+		Utils::Rect Composite(uint32_t index, std::span<const uint8_t> pixels);
+		void DisposeFrame();
+		Utils::Rect GetFrameRect(uint32_t index) const;
+
+		template <typename T>
+		void BlendFrame(const Utils::PNG::FrameControl& control, const uint8_t* pixels);
+
+	private:
+		std::unique_ptr<PNG> m_image;
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		int m_bytesPerPixel;
+
+		// Canvas state
+		std::vector<uint8_t> m_canvas;
+		std::vector<uint8_t> m_savedRegion;
+		uint32_t m_frameIndex = 0;
+		uint32_t m_playsCompleted = 0;
+		bool m_finished = false;
+
+		// Worker state
+		std::thread m_worker;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<DecodedFrame> m_decodedFrames;
+		size_t m_decodeAhead;
+		bool m_stop = false;
+		std::runtime_error* m_error = nullptr;
+	};
+}
\ No newline at end of file
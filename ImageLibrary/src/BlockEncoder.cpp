@@ -0,0 +1,926 @@
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLOCK_ENCODER_SSE2
+#endif
+
+#include "BlockEncoder.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// BC7 interpolation weights out of 64 for 2, 3 and 4 bit indices
+	static constexpr int BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+	static constexpr int BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	static constexpr int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// How far from the first endpoint to the second each BC1 index is, index 1 is the second endpoint itself
+	static constexpr float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	// Colours a block's indices choose between, laid out as channels like the pixels of a block
+	struct Palette {
+		alignas(16) float channels[4][16];
+		int size;
+	};
+
+	// Reduce a 16 bit channel to 8 bits with rounding
+	static inline uint8_t To8Bit(uint32_t value) { return (uint8_t)((value * 255 + 32895) >> 16); }
+
+	// Choose the nearest palette entry for every pixel over a range of channels, returning the total squared error
+	// The channel count is a template parameter so the per entry loop unrolls
+	template <int channelCount>
+	static float FindIndices(const float (&pixels)[4][16], const Palette& palette, int firstChannel, uint8_t indices[16]) {
+		float total = 0.0f;
+
+#ifdef BLOCK_ENCODER_SSE2
+		// Four pixels are compared against each palette entry at once
+		for (int i = 0; i < 16; i += 4) {
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int k = 0; k < palette.size; k++) {
+				__m128 error = _mm_setzero_ps();
+				for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+					__m128 difference = _mm_sub_ps(_mm_load_ps(&pixels[c][i]), _mm_set1_ps(palette.channels[c][k]));
+					error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+				}
+
+				// Only a strictly nearer entry replaces the current one so ties keep the lowest index like the scalar path
+				__m128i nearer = _mm_castps_si128(_mm_cmplt_ps(error, best));
+				best = _mm_min_ps(error, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(nearer, _mm_set1_epi32(k)), _mm_andnot_si128(nearer, bestIndex));
+			}
+
+			alignas(16) float errors[4];
+			alignas(16) int32_t chosen[4];
+			_mm_store_ps(errors, best);
+			_mm_store_si128((__m128i*)chosen, bestIndex);
+			for (int j = 0; j < 4; j++) {
+				total += errors[j];
+				indices[i + j] = (uint8_t)chosen[j];
+			}
+		}
+#else
+		for (int i = 0; i < 16; i++) {
+			float best = FLT_MAX;
+			for (int k = 0; k < palette.size; k++) {
+				float error = 0.0f;
+				for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+					float difference = pixels[c][i] - palette.channels[c][k];
+					error += difference * difference;
+				}
+				if (error < best) {
+					best = error;
+					indices[i] = (uint8_t)k;
+				}
+			}
+			total += best;
+		}
+#endif
+
+		return total;
+	}
+
+	// Place endpoints at the ends of the line through the pixels along their direction of greatest variance
+	template <int channelCount>
+	static void FitEndpoints(const float (&pixels)[4][16], float low[4], float high[4]) {
+		float mean[4] = {}, minimum[4], maximum[4];
+		for (int c = 0; c < channelCount; c++) {
+			minimum[c] = FLT_MAX;
+			maximum[c] = -FLT_MAX;
+			for (int i = 0; i < 16; i++) {
+				mean[c] += pixels[c][i];
+				minimum[c] = std::min(minimum[c], pixels[c][i]);
+				maximum[c] = std::max(maximum[c], pixels[c][i]);
+			}
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++) {
+			for (int a = 0; a < channelCount; a++) {
+				for (int b = 0; b < channelCount; b++) { covariance[a][b] += (pixels[a][i] - mean[a]) * (pixels[b][i] - mean[b]); }
+			}
+		}
+
+		// Power iteration from the range of each channel, a few steps are plenty for 16 pixels
+		float axis[4] = {};
+		for (int c = 0; c < channelCount; c++) { axis[c] = maximum[c] - minimum[c]; }
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[4] = {}, largest = 0.0f;
+			for (int a = 0; a < channelCount; a++) {
+				for (int b = 0; b < channelCount; b++) { next[a] += covariance[a][b] * axis[b]; }
+				largest = std::max(largest, std::abs(next[a]));
+			}
+			if (largest < 1e-6f) { break; }
+			for (int c = 0; c < channelCount; c++) { axis[c] = next[c] / largest; }
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < channelCount; c++) { length += axis[c] * axis[c]; }
+		if (length < 1e-12f) {
+			for (int c = 0; c < channelCount; c++) { low[c] = high[c] = mean[c]; }
+			return;
+		}
+		length = std::sqrt(length);
+		for (int c = 0; c < channelCount; c++) { axis[c] /= length; }
+
+		float lowest = FLT_MAX, highest = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (int c = 0; c < channelCount; c++) { t += (pixels[c][i] - mean[c]) * axis[c]; }
+			lowest = std::min(lowest, t);
+			highest = std::max(highest, t);
+		}
+
+		for (int c = 0; c < channelCount; c++) {
+			low[c] = std::clamp(mean[c] + axis[c] * lowest, 0.0f, 255.0f);
+			high[c] = std::clamp(mean[c] + axis[c] * highest, 0.0f, 255.0f);
+		}
+	}
+
+	// Endpoints with the least squared error for fixed indices, weights give how far towards the second endpoint each index is
+	static bool SolveEndpoints(const float (&pixels)[4][16], int firstChannel, int channelCount, const uint8_t indices[16], const float* weights, float low[4], float high[4]) {
+		float lowLow = 0.0f, highHigh = 0.0f, lowHigh = 0.0f;
+		float lowPixel[4] = {}, highPixel[4] = {};
+		for (int i = 0; i < 16; i++) {
+			float toHigh = weights[indices[i]];
+			float toLow = 1.0f - toHigh;
+			lowLow += toLow * toLow;
+			highHigh += toHigh * toHigh;
+			lowHigh += toLow * toHigh;
+			for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+				lowPixel[c] += toLow * pixels[c][i];
+				highPixel[c] += toHigh * pixels[c][i];
+			}
+		}
+
+		// Every pixel on the same index leaves the endpoints underdetermined
+		float determinant = lowLow * highHigh - lowHigh * lowHigh;
+		if (std::abs(determinant) < 1e-6f) { return false; }
+
+		for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+			low[c] = std::clamp((lowPixel[c] * highHigh - highPixel[c] * lowHigh) / determinant, 0.0f, 255.0f);
+			high[c] = std::clamp((highPixel[c] * lowLow - lowPixel[c] * lowHigh) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// Writes fields least significant bit first across a 16 byte block, as BC7 lays them out
+	class BitWriter
+	{
+	public:
+		BitWriter(uint8_t* output) noexcept : m_output(output) { memset(m_output, 0, 16); };
+
+		void Write(uint32_t value, int bitCount) noexcept {
+			for (int i = 0; i < bitCount; i++, m_position++) { m_output[m_position >> 3] |= (uint8_t)(((value >> i) & 1) << (m_position & 7)); }
+		}
+
+	private:
+		uint8_t* m_output;
+		int m_position = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* input) noexcept : m_input(input) {};
+
+		uint32_t Read(int bitCount) noexcept {
+			uint32_t value = 0;
+			for (int i = 0; i < bitCount; i++, m_position++) { value |= (uint32_t)((m_input[m_position >> 3] >> (m_position & 7)) & 1) << i; }
+			return value;
+		}
+
+	private:
+		const uint8_t* m_input;
+		int m_position = 0;
+	};
+
+	// BC1
+
+	static uint16_t PackRGB565(const float colour[4]) {
+		int r = std::clamp((int)(colour[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = std::clamp((int)(colour[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = std::clamp((int)(colour[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	static void UnpackRGB565(uint16_t packed, int colour[3]) {
+		int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+		colour[0] = (r << 3) | (r >> 2);
+		colour[1] = (g << 2) | (g >> 4);
+		colour[2] = (b << 3) | (b >> 2);
+	}
+
+	// Colours of a four colour block in index order, with the interpolated colours rounded as the reference decoder does
+	static void BC1Palette(uint16_t colour0, uint16_t colour1, int palette[4][3]) {
+		UnpackRGB565(colour0, palette[0]);
+		UnpackRGB565(colour1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+	}
+
+	// Endpoint pairs whose two thirds interpolation lands nearest each 8 bit value, so flat blocks keep their exact colour
+	struct BC1SolidTables {
+		uint8_t match5[256][2];
+		uint8_t match6[256][2];
+
+		BC1SolidTables() {
+			Build(match5, 5);
+			Build(match6, 6);
+		}
+
+		static void Build(uint8_t (&match)[256][2], int bits) {
+			int count = 1 << bits;
+			auto expand = [bits](int value) { return (value << (8 - bits)) | (value >> (2 * bits - 8)); };
+			for (int value = 0; value < 256; value++) {
+				float bestError = FLT_MAX;
+				for (int first = 0; first < count; first++) {
+					for (int second = 0; second < count; second++) {
+						int interpolated = (2 * expand(first) + expand(second) + 1) / 3;
+
+						// A small penalty on the spread of the endpoints keeps other decoders' rounding from drifting far
+						float error = (float)std::abs(interpolated - value) + 0.03f * std::abs(expand(first) - expand(second));
+						if (error < bestError) {
+							bestError = error;
+							match[value][0] = (uint8_t)first;
+							match[value][1] = (uint8_t)second;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	static const BC1SolidTables& GetBC1SolidTables() {
+		static const BC1SolidTables tables;
+		return tables;
+	}
+
+	static float EvaluateBC1(const float (&pixels)[4][16], uint16_t colour0, uint16_t colour1, uint8_t indices[16]) {
+		int colours[4][3];
+		BC1Palette(colour0, colour1, colours);
+
+		Palette palette{};
+		palette.size = 4;
+		for (int k = 0; k < 4; k++) {
+			for (int c = 0; c < 3; c++) { palette.channels[c][k] = (float)colours[k][c]; }
+		}
+		return FindIndices<3>(pixels, palette, 0, indices);
+	}
+
+	static void EncodeBC1(const float (&pixels)[4][16], BlockQuality quality, uint8_t* output) {
+		uint16_t colour0, colour1;
+		uint8_t indices[16];
+
+		bool solid = true;
+		for (int i = 1; i < 16 && solid; i++) {
+			for (int c = 0; c < 3; c++) { solid = solid && pixels[c][i] == pixels[c][0]; }
+		}
+
+		if (solid) {
+			// Every pixel uses the two thirds colour of the table endpoints
+			const BC1SolidTables& tables = GetBC1SolidTables();
+			int r = (int)pixels[0][0], g = (int)pixels[1][0], b = (int)pixels[2][0];
+			colour0 = (uint16_t)((tables.match5[r][0] << 11) | (tables.match6[g][0] << 5) | tables.match5[b][0]);
+			colour1 = (uint16_t)((tables.match5[r][1] << 11) | (tables.match6[g][1] << 5) | tables.match5[b][1]);
+			memset(indices, 2, 16);
+		}
+		else {
+			float low[4], high[4];
+			FitEndpoints<3>(pixels, low, high);
+			colour0 = PackRGB565(low);
+			colour1 = PackRGB565(high);
+			float error = EvaluateBC1(pixels, colour0, colour1, indices);
+
+			// Refit the endpoints to the chosen indices while that keeps lowering the error
+			int iterations = (quality == BlockQuality::FAST ? 0 : (quality == BlockQuality::NORMAL ? 1 : 3));
+			for (int iteration = 0; iteration < iterations && error > 0.0f; iteration++) {
+				if (!SolveEndpoints(pixels, 0, 3, indices, BC1_WEIGHTS, low, high)) { break; }
+
+				uint16_t newColour0 = PackRGB565(low), newColour1 = PackRGB565(high);
+				if (newColour0 == colour0 && newColour1 == colour1) { break; }
+
+				uint8_t newIndices[16];
+				float newError = EvaluateBC1(pixels, newColour0, newColour1, newIndices);
+				if (newError >= error) { break; }
+
+				error = newError;
+				colour0 = newColour0;
+				colour1 = newColour1;
+				memcpy(indices, newIndices, 16);
+			}
+		}
+
+		// Four colour mode needs the first endpoint to be the larger, swapping endpoints swaps indices 0 and 1 and 2 and 3
+		if (colour0 < colour1) {
+			std::swap(colour0, colour1);
+			for (int i = 0; i < 16; i++) { indices[i] ^= 1; }
+		}
+		else if (colour0 == colour1) { memset(indices, 0, 16); }
+
+		uint32_t packedIndices = 0;
+		for (int i = 0; i < 16; i++) { packedIndices |= (uint32_t)indices[i] << (2 * i); }
+
+		output[0] = (uint8_t)colour0;
+		output[1] = (uint8_t)(colour0 >> 8);
+		output[2] = (uint8_t)colour1;
+		output[3] = (uint8_t)(colour1 >> 8);
+		for (int i = 0; i < 4; i++) { output[4 + i] = (uint8_t)(packedIndices >> (8 * i)); }
+	}
+
+	// BC4
+
+	// Values of a block in index order, eight interpolated when the first endpoint is larger, otherwise six then 0 and 255
+	static void BC4Palette(int endpoint0, int endpoint1, uint8_t palette[8]) {
+		palette[0] = (uint8_t)endpoint0;
+		palette[1] = (uint8_t)endpoint1;
+		if (endpoint0 > endpoint1) {
+			for (int i = 1; i < 7; i++) { palette[i + 1] = (uint8_t)(((7 - i) * endpoint0 + i * endpoint1 + 3) / 7); }
+		}
+		else {
+			for (int i = 1; i < 5; i++) { palette[i + 1] = (uint8_t)(((5 - i) * endpoint0 + i * endpoint1 + 2) / 5); }
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	static int FindBC4Indices(const uint8_t values[16], const uint8_t palette[8], uint8_t indices[16]) {
+		uint8_t differences[16];
+
+#ifdef BLOCK_ENCODER_SSE2
+		// All 16 values fit in one register, the nearest entry by absolute difference is also the nearest by squared difference
+		__m128i value = _mm_loadu_si128((const __m128i*)values);
+		__m128i best = _mm_set1_epi8((char)255);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int k = 0; k < 8; k++) {
+			__m128i entry = _mm_set1_epi8((char)palette[k]);
+			__m128i difference = _mm_or_si128(_mm_subs_epu8(value, entry), _mm_subs_epu8(entry, value));
+			__m128i nearest = _mm_min_epu8(difference, best);
+			__m128i unchanged = _mm_cmpeq_epi8(nearest, best);
+			bestIndex = _mm_or_si128(_mm_and_si128(unchanged, bestIndex), _mm_andnot_si128(unchanged, _mm_set1_epi8((char)k)));
+			best = nearest;
+		}
+		_mm_storeu_si128((__m128i*)differences, best);
+		_mm_storeu_si128((__m128i*)indices, bestIndex);
+#else
+		for (int i = 0; i < 16; i++) {
+			differences[i] = 255;
+			indices[i] = 0;
+			for (int k = 0; k < 8; k++) {
+				uint8_t difference = (uint8_t)std::abs(values[i] - palette[k]);
+				if (difference < differences[i]) {
+					differences[i] = difference;
+					indices[i] = (uint8_t)k;
+				}
+			}
+		}
+#endif
+
+		int error = 0;
+		for (int i = 0; i < 16; i++) { error += differences[i] * differences[i]; }
+		return error;
+	}
+
+	static void EncodeBC4(const uint8_t values[16], BlockQuality quality, uint8_t* output) {
+		int minimum = 255, maximum = 0;
+		for (int i = 0; i < 16; i++) {
+			minimum = std::min<int>(minimum, values[i]);
+			maximum = std::max<int>(maximum, values[i]);
+		}
+
+		// Eight values spread across the range of the block
+		uint8_t palette[8], indices[16], bestIndices[16];
+		int bestEndpoint0 = maximum, bestEndpoint1 = minimum;
+		BC4Palette(bestEndpoint0, bestEndpoint1, palette);
+		int bestError = FindBC4Indices(values, palette, bestIndices);
+
+		auto tryEndpoints = [&](int endpoint0, int endpoint1) {
+			BC4Palette(endpoint0, endpoint1, palette);
+			int error = FindBC4Indices(values, palette, indices);
+			if (error < bestError) {
+				bestError = error;
+				bestEndpoint0 = endpoint0;
+				bestEndpoint1 = endpoint1;
+				memcpy(bestIndices, indices, 16);
+			}
+		};
+
+		// Six values between the endpoints with exact 0 and 255 suits blocks that reach the extremes as well as midtones
+		if (quality != BlockQuality::FAST && bestError > 0) {
+			int low = 255, high = 0;
+			for (int i = 0; i < 16; i++) {
+				if (values[i] == 0 || values[i] == 255) { continue; }
+				low = std::min<int>(low, values[i]);
+				high = std::max<int>(high, values[i]);
+			}
+			if (low <= high) { tryEndpoints(low, high); }
+		}
+
+		// Nudging the endpoints often lets the interpolated values land closer to the pixels
+		if (quality == BlockQuality::HIGH && bestError > 0) {
+			for (int offset0 = -2; offset0 <= 2; offset0++) {
+				for (int offset1 = -2; offset1 <= 2; offset1++) {
+					int endpoint0 = std::clamp(maximum + offset0, 0, 255), endpoint1 = std::clamp(minimum + offset1, 0, 255);
+					if (endpoint0 > endpoint1) { tryEndpoints(endpoint0, endpoint1); }
+				}
+			}
+		}
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 16; i++) { packedIndices |= (uint64_t)bestIndices[i] << (3 * i); }
+
+		output[0] = (uint8_t)bestEndpoint0;
+		output[1] = (uint8_t)bestEndpoint1;
+		for (int i = 0; i < 6; i++) { output[2 + i] = (uint8_t)(packedIndices >> (8 * i)); }
+	}
+
+	// BC7
+
+	// Mode 6 endpoint: 7 bits per channel with a shared p-bit as the lowest bit of every channel
+	struct Mode6Endpoint {
+		uint8_t values[4];
+		int pBit;
+	};
+
+	static float QuantiseMode6(const float endpoint[4], int pBit, Mode6Endpoint& quantised) {
+		float error = 0.0f;
+		quantised.pBit = pBit;
+		for (int c = 0; c < 4; c++) {
+			quantised.values[c] = (uint8_t)std::clamp((int)std::lround((endpoint[c] - pBit) / 2.0f), 0, 127);
+			float difference = (float)((quantised.values[c] << 1) | pBit) - endpoint[c];
+			error += difference * difference;
+		}
+		return error;
+	}
+
+	static float EvaluateMode6(const float (&pixels)[4][16], const Mode6Endpoint& endpoint0, const Mode6Endpoint& endpoint1, uint8_t indices[16]) {
+		Palette palette{};
+		palette.size = 16;
+		for (int c = 0; c < 4; c++) {
+			int value0 = (endpoint0.values[c] << 1) | endpoint0.pBit, value1 = (endpoint1.values[c] << 1) | endpoint1.pBit;
+			for (int k = 0; k < 16; k++) { palette.channels[c][k] = (float)(((64 - BC7_WEIGHTS4[k]) * value0 + BC7_WEIGHTS4[k] * value1 + 32) >> 6); }
+		}
+		return FindIndices<4>(pixels, palette, 0, indices);
+	}
+
+	// One subset, RGBA endpoints with p-bits and 4 bit indices, the best single mode for most blocks
+	static float EncodeBC7Mode6(const float (&pixels)[4][16], bool opaque, BlockQuality quality, uint8_t output[16]) {
+		static constexpr float WEIGHTS[16] = {
+			0.0f / 64, 4.0f / 64, 9.0f / 64, 13.0f / 64, 17.0f / 64, 21.0f / 64, 26.0f / 64, 30.0f / 64,
+			34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64, 51.0f / 64, 55.0f / 64, 60.0f / 64, 64.0f / 64
+		};
+
+		float low[4], high[4];
+		FitEndpoints<4>(pixels, low, high);
+
+		Mode6Endpoint bestEndpoint0{}, bestEndpoint1{};
+		uint8_t bestIndices[16];
+		float bestError = FLT_MAX;
+
+		int iterations = (quality == BlockQuality::FAST ? 0 : (quality == BlockQuality::NORMAL ? 1 : 2));
+		for (int iteration = 0; iteration <= iterations; iteration++) {
+			// Opaque blocks need a p-bit of 1 for alpha to reach 255, high quality tries every pair otherwise each endpoint takes its nearer one
+			Mode6Endpoint endpoint0, endpoint1;
+			uint8_t indices[16];
+			for (int pBits = 0; pBits < 4; pBits++) {
+				if (opaque && pBits != 3) { continue; }
+				if (!opaque && quality != BlockQuality::HIGH && pBits != 0) { continue; }
+
+				if (opaque || quality == BlockQuality::HIGH) {
+					QuantiseMode6(low, pBits & 1, endpoint0);
+					QuantiseMode6(high, pBits >> 1, endpoint1);
+				}
+				else {
+					Mode6Endpoint other;
+					if (QuantiseMode6(low, 0, endpoint0) > QuantiseMode6(low, 1, other)) { endpoint0 = other; }
+					if (QuantiseMode6(high, 0, endpoint1) > QuantiseMode6(high, 1, other)) { endpoint1 = other; }
+				}
+
+				float error = EvaluateMode6(pixels, endpoint0, endpoint1, indices);
+				if (error < bestError) {
+					bestError = error;
+					bestEndpoint0 = endpoint0;
+					bestEndpoint1 = endpoint1;
+					memcpy(bestIndices, indices, 16);
+				}
+			}
+
+			if (iteration == iterations || bestError == 0.0f || !SolveEndpoints(pixels, 0, 4, bestIndices, WEIGHTS, low, high)) { break; }
+		}
+
+		// The first index is stored without its top bit so it must point nearer the first endpoint
+		if (bestIndices[0] & 8) {
+			std::swap(bestEndpoint0, bestEndpoint1);
+			for (int i = 0; i < 16; i++) { bestIndices[i] = (uint8_t)(15 - bestIndices[i]); }
+		}
+
+		BitWriter writer(output);
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++) {
+			writer.Write(bestEndpoint0.values[c], 7);
+			writer.Write(bestEndpoint1.values[c], 7);
+		}
+		writer.Write(bestEndpoint0.pBit, 1);
+		writer.Write(bestEndpoint1.pBit, 1);
+		writer.Write(bestIndices[0], 3);
+		for (int i = 1; i < 16; i++) { writer.Write(bestIndices[i], 4); }
+
+		return bestError;
+	}
+
+	// One subset with 7 bit colour and 8 bit alpha indexed separately, optionally swapping a colour channel into alpha first
+	static float EncodeBC7Mode5(const float (&blockPixels)[4][16], int rotation, BlockQuality quality, uint8_t output[16]) {
+		static constexpr float WEIGHTS[4] = { 0.0f, 21.0f / 64, 43.0f / 64, 1.0f };
+
+		// The decoder swaps the channels back after interpolating
+		float pixels[4][16];
+		memcpy(pixels, blockPixels, sizeof(pixels));
+		if (rotation != 0) { std::swap(pixels[rotation - 1], pixels[3]); }
+
+		Palette palette{};
+		palette.size = 4;
+		int iterations = (quality == BlockQuality::FAST ? 0 : (quality == BlockQuality::NORMAL ? 1 : 2));
+
+		// Colour endpoints expand from 7 bits by repeating the top bit
+		float low[4], high[4];
+		FitEndpoints<3>(pixels, low, high);
+		uint8_t colour0[3], colour1[3], colourIndices[16];
+		float colourError = FLT_MAX;
+		for (int iteration = 0; iteration <= iterations; iteration++) {
+			uint8_t quantised0[3], quantised1[3], indices[16];
+			for (int c = 0; c < 3; c++) {
+				quantised0[c] = (uint8_t)std::clamp((int)std::lround(low[c] * 127.0f / 255.0f), 0, 127);
+				quantised1[c] = (uint8_t)std::clamp((int)std::lround(high[c] * 127.0f / 255.0f), 0, 127);
+				int value0 = (quantised0[c] << 1) | (quantised0[c] >> 6), value1 = (quantised1[c] << 1) | (quantised1[c] >> 6);
+				for (int k = 0; k < 4; k++) { palette.channels[c][k] = (float)(((64 - BC7_WEIGHTS2[k]) * value0 + BC7_WEIGHTS2[k] * value1 + 32) >> 6); }
+			}
+
+			float error = FindIndices<3>(pixels, palette, 0, indices);
+			if (error < colourError) {
+				colourError = error;
+				memcpy(colour0, quantised0, 3);
+				memcpy(colour1, quantised1, 3);
+				memcpy(colourIndices, indices, 16);
+			}
+			if (iteration == iterations || colourError == 0.0f || !SolveEndpoints(pixels, 0, 3, colourIndices, WEIGHTS, low, high)) { break; }
+		}
+
+		// Alpha endpoints are stored at full precision
+		low[3] = FLT_MAX;
+		high[3] = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			low[3] = std::min(low[3], pixels[3][i]);
+			high[3] = std::max(high[3], pixels[3][i]);
+		}
+		uint8_t alpha0 = 0, alpha1 = 0, alphaIndices[16];
+		float alphaError = FLT_MAX;
+		for (int iteration = 0; iteration <= iterations; iteration++) {
+			uint8_t quantised0 = (uint8_t)std::clamp((int)std::lround(low[3]), 0, 255), quantised1 = (uint8_t)std::clamp((int)std::lround(high[3]), 0, 255);
+			uint8_t indices[16];
+			for (int k = 0; k < 4; k++) { palette.channels[3][k] = (float)(((64 - BC7_WEIGHTS2[k]) * quantised0 + BC7_WEIGHTS2[k] * quantised1 + 32) >> 6); }
+
+			float error = FindIndices<1>(pixels, palette, 3, indices);
+			if (error < alphaError) {
+				alphaError = error;
+				alpha0 = quantised0;
+				alpha1 = quantised1;
+				memcpy(alphaIndices, indices, 16);
+			}
+			if (iteration == iterations || alphaError == 0.0f || !SolveEndpoints(pixels, 3, 1, alphaIndices, WEIGHTS, low, high)) { break; }
+		}
+
+		// Both first indices are stored without their top bit
+		if (colourIndices[0] & 2) {
+			for (int c = 0; c < 3; c++) { std::swap(colour0[c], colour1[c]); }
+			for (int i = 0; i < 16; i++) { colourIndices[i] = (uint8_t)(3 - colourIndices[i]); }
+		}
+		if (alphaIndices[0] & 2) {
+			std::swap(alpha0, alpha1);
+			for (int i = 0; i < 16; i++) { alphaIndices[i] = (uint8_t)(3 - alphaIndices[i]); }
+		}
+
+		BitWriter writer(output);
+		writer.Write(1 << 5, 6);
+		writer.Write(rotation, 2);
+		for (int c = 0; c < 3; c++) {
+			writer.Write(colour0[c], 7);
+			writer.Write(colour1[c], 7);
+		}
+		writer.Write(alpha0, 8);
+		writer.Write(alpha1, 8);
+		writer.Write(colourIndices[0], 1);
+		for (int i = 1; i < 16; i++) { writer.Write(colourIndices[i], 2); }
+		writer.Write(alphaIndices[0], 1);
+		for (int i = 1; i < 16; i++) { writer.Write(alphaIndices[i], 2); }
+
+		return colourError + alphaError;
+	}
+
+	static void EncodeBC7(const float (&pixels)[4][16], bool opaque, BlockQuality quality, uint8_t* output) {
+		float error = EncodeBC7Mode6(pixels, opaque, quality, output);
+		if (quality == BlockQuality::FAST || error == 0.0f) { return; }
+
+		// Mode 5 suits blocks where alpha, or after rotation one colour channel, does not follow the others
+		if (quality == BlockQuality::NORMAL && opaque) { return; }
+		int rotations = (quality == BlockQuality::HIGH ? 4 : 1);
+		for (int rotation = 0; rotation < rotations; rotation++) {
+			uint8_t candidate[16];
+			float candidateError = EncodeBC7Mode5(pixels, rotation, quality, candidate);
+			if (candidateError < error) {
+				error = candidateError;
+				memcpy(output, candidate, 16);
+			}
+		}
+	}
+
+	// Decoding
+
+	static void DecodeBC1(const uint8_t* block, uint8_t (&pixels)[16][4]) {
+		uint16_t colour0 = (uint16_t)(block[0] | (block[1] << 8)), colour1 = (uint16_t)(block[2] | (block[3] << 8));
+		int palette[4][3];
+		BC1Palette(colour0, colour1, palette);
+
+		// Three colour blocks have a midpoint and black, which is opaque as textures are created without BC1 alpha
+		if (colour0 <= colour1) {
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+
+		for (int i = 0; i < 16; i++) {
+			int index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+			for (int c = 0; c < 3; c++) { pixels[i][c] = (uint8_t)palette[index][c]; }
+			pixels[i][3] = 255;
+		}
+	}
+
+	static void DecodeBC4(const uint8_t* block, uint8_t (&pixels)[16][4]) {
+		uint8_t palette[8];
+		BC4Palette(block[0], block[1], palette);
+
+		uint64_t packedIndices = 0;
+		for (int i = 0; i < 6; i++) { packedIndices |= (uint64_t)block[2 + i] << (8 * i); }
+
+		// Greyscale textures repeat the single channel across colour
+		for (int i = 0; i < 16; i++) {
+			uint8_t value = palette[(packedIndices >> (3 * i)) & 7];
+			pixels[i][0] = pixels[i][1] = pixels[i][2] = value;
+			pixels[i][3] = 255;
+		}
+	}
+
+	static void DecodeBC7(const uint8_t* block, uint8_t (&pixels)[16][4]) {
+		BitReader reader(block);
+		int mode = 0;
+		while (mode < 8 && reader.Read(1) == 0) { mode++; }
+
+		// Blocks without a mode are reserved and decode to transparent black
+		if (mode == 8) {
+			memset(pixels, 0, sizeof(pixels));
+			return;
+		}
+		if (mode < 4 || mode == 7) { throw new std::runtime_error("Error: BC7 block uses a partitioned mode the reference decoder does not support"); }
+
+		int rotation = 0, indexSelection = 0;
+		int endpoints[2][4];
+		if (mode == 4 || mode == 5) {
+			rotation = (int)reader.Read(2);
+			if (mode == 4) { indexSelection = (int)reader.Read(1); }
+
+			int colourBits = (mode == 4 ? 5 : 7), alphaBits = (mode == 4 ? 6 : 8);
+			for (int c = 0; c < 3; c++) {
+				for (int e = 0; e < 2; e++) {
+					int value = (int)reader.Read(colourBits);
+					endpoints[e][c] = (value << (8 - colourBits)) | (value >> (2 * colourBits - 8));
+				}
+			}
+			for (int e = 0; e < 2; e++) {
+				int value = (int)reader.Read(alphaBits);
+				endpoints[e][3] = (alphaBits == 8 ? value : (value << 2) | (value >> 4));
+			}
+		}
+		else {
+			for (int c = 0; c < 4; c++) {
+				for (int e = 0; e < 2; e++) { endpoints[e][c] = (int)reader.Read(7) << 1; }
+			}
+			for (int e = 0; e < 2; e++) {
+				int pBit = (int)reader.Read(1);
+				for (int c = 0; c < 4; c++) { endpoints[e][c] |= pBit; }
+			}
+		}
+
+		// Modes 4 and 5 follow the first set of indices with a second set for alpha, in mode 4 the first has 2 bits and the second 3
+		int firstSet[16], secondSet[16];
+		int primaryBits = (mode == 6 ? 4 : 2), secondaryBits = (mode == 4 ? 3 : 2);
+		for (int i = 0; i < 16; i++) { firstSet[i] = (int)reader.Read(i == 0 ? primaryBits - 1 : primaryBits); }
+		if (mode != 6) {
+			for (int i = 0; i < 16; i++) { secondSet[i] = (int)reader.Read(i == 0 ? secondaryBits - 1 : secondaryBits); }
+		}
+
+		auto weight = [](int bitCount, int index) { return (bitCount == 2 ? BC7_WEIGHTS2[index] : (bitCount == 3 ? BC7_WEIGHTS3[index] : BC7_WEIGHTS4[index])); };
+		for (int i = 0; i < 16; i++) {
+			int colourIndex = firstSet[i], alphaIndex = firstSet[i], colourBits = primaryBits, alphaBits = primaryBits;
+			if (mode != 6) {
+				// Mode 4's index selection swaps the sets so colour uses the 3 bit one
+				if (indexSelection) {
+					colourIndex = secondSet[i];
+					colourBits = secondaryBits;
+				}
+				else {
+					alphaIndex = secondSet[i];
+					alphaBits = secondaryBits;
+				}
+			}
+
+			for (int c = 0; c < 4; c++) {
+				int w = (c < 3 ? weight(colourBits, colourIndex) : weight(alphaBits, alphaIndex));
+				pixels[i][c] = (uint8_t)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+			}
+			if (rotation != 0) { std::swap(pixels[i][rotation - 1], pixels[i][3]); }
+		}
+	}
+
+	// Encoder
+
+	BlockEncoder::BlockEncoder(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, BlockEncoderOptions options)
+		: m_width(width), m_height(height), m_pixelFormat(pixelFormat), m_pixels(pixels), m_options(options) {
+		Validate();
+		Encode();
+
+		// The pixels are only borrowed for the encode
+		m_pixels = std::span<const uint8_t>();
+	}
+
+	BlockEncoder::BlockEncoder(Image& image, BlockEncoderOptions options)
+		: m_width(image.GetWidth()), m_height(image.GetHeight()), m_pixelFormat(image.GetPixelFormat()), m_options(options) {
+		std::shared_ptr<DiskCache> diskCache = Image::GetDiskCache();
+		uint32_t flags = (image.IsColourManaged() ? DiskCache::FLAG_DISPLAY_COLOURS : 0);
+
+		// Blocks from an earlier run are used if they were made from the same pixels at no lower a quality
+		if (diskCache) {
+			m_cacheEntry = diskCache->Find(image.GetFilePath(), true);
+			if (m_cacheEntry) {
+				const DiskCache::Header& header = m_cacheEntry->GetHeader();
+				bool usable = header.width == m_width && header.height == m_height && (header.flags & DiskCache::FLAG_DISPLAY_COLOURS) == flags
+					&& header.blockQuality >= (uint32_t)m_options.quality && (!m_options.format || header.blockFormat == (uint32_t)*m_options.format);
+				if (usable) {
+					m_format = (Utils::BlockFormat)header.blockFormat;
+					return;
+				}
+				m_cacheEntry.reset();
+			}
+		}
+
+		m_pixels = image.GetPixelBuffer();
+		Validate();
+		Encode();
+		m_pixels = std::span<const uint8_t>();
+
+		if (diskCache) { diskCache->StoreBlocks(image.GetFilePath(), m_width, m_height, m_format, (uint32_t)m_options.quality, flags, m_data); }
+	}
+
+	std::span<const uint8_t> BlockEncoder::GetData() const noexcept {
+		if (m_cacheEntry) { return std::span<const uint8_t>(m_cacheEntry->GetPixels(), m_cacheEntry->GetPixelsSize()); }
+		return m_data;
+	}
+
+	Utils::BlockFormat BlockEncoder::ChooseFormat(Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, BlockQuality quality) {
+		int channelBytes = Utils::GetChannelByteSize(pixelFormat);
+		int bytesPerPixel = Utils::GetPixelFormatByteSize(pixelFormat);
+		bool alphaChannel = Utils::HasAlphaChannel(pixelFormat);
+		if (bytesPerPixel == 0) { throw new std::runtime_error("Error: Cannot encode invalid pixel format"); }
+
+		// Stop looking as soon as the image is known to be both coloured and transparent
+		bool grey = true, opaque = true;
+		for (size_t i = 0; i + bytesPerPixel <= pixels.size() && (grey || opaque); i += bytesPerPixel) {
+			auto channel = [&](int c) { return (channelBytes == 2 ? pixels[i + 2 * c] | (pixels[i + 2 * c + 1] << 8) : pixels[i + c]); };
+			grey = grey && channel(0) == channel(1) && channel(1) == channel(2);
+			opaque = opaque && (!alphaChannel || channel(3) == (channelBytes == 2 ? 0xffff : 0xff));
+		}
+
+		if (grey && opaque) { return Utils::BC4; }
+		if (opaque && quality != BlockQuality::HIGH) { return Utils::BC1; }
+		return Utils::BC7;
+	}
+
+	std::vector<uint8_t> BlockEncoder::Decode(Utils::BlockFormat format, uint32_t width, uint32_t height, std::span<const uint8_t> blocks) {
+		if (format >= Utils::INVALID_BLOCK_FORMAT) { throw new std::runtime_error("Error: Invalid block format"); }
+		if (blocks.size() < Utils::GetBlockBufferSize(format, width, height)) { throw new std::runtime_error("Error: Block buffer is too small for image"); }
+
+		std::vector<uint8_t> output((size_t)width * height * 4);
+		uint32_t blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+		size_t blockSize = Utils::GetBlockByteSize(format);
+
+		for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+				const uint8_t* block = blocks.data() + ((size_t)blockY * blocksWide + blockX) * blockSize;
+				uint8_t pixels[16][4];
+				switch (format) {
+				case Utils::BC1:
+					DecodeBC1(block, pixels);
+					break;
+				case Utils::BC4:
+					DecodeBC4(block, pixels);
+					break;
+				default:
+					DecodeBC7(block, pixels);
+					break;
+				}
+
+				// Pixels past the edge of the image are dropped
+				for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++) {
+					for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++) {
+						memcpy(&output[(((size_t)blockY * 4 + y) * width + blockX * 4 + x) * 4], pixels[y * 4 + x], 4);
+					}
+				}
+			}
+		}
+
+		return output;
+	}
+
+	void BlockEncoder::Validate() {
+		// Check input is something that can be encoded
+		if (m_pixelFormat == Utils::INVALID) { throw new std::runtime_error("Error: Cannot encode invalid pixel format"); }
+		if (m_width == 0 || m_height == 0) { throw new std::runtime_error("Error: Image dimensions invalid"); }
+		if (m_options.format && *m_options.format >= Utils::INVALID_BLOCK_FORMAT) { throw new std::runtime_error("Error: Invalid block format"); }
+		if (m_pixels.size() < (size_t)m_width * m_height * Utils::GetPixelFormatByteSize(m_pixelFormat)) { throw new std::runtime_error("Error: Pixel buffer is too small for image"); }
+	}
+
+	void BlockEncoder::Encode() {
+		IL_TRACE_SCOPE("BlockEncoder::Encode");
+
+		m_format = (m_options.format ? *m_options.format : ChooseFormat(m_pixelFormat, m_pixels, m_options.quality));
+		m_data.resize(Utils::GetBlockBufferSize(m_format, m_width, m_height));
+
+		// Rows of blocks are handed out one at a time, blocks are independent so no ordering is needed
+		uint32_t blockRows = (m_height + 3) / 4;
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		std::atomic<uint32_t> nextRow = 0;
+		auto worker = [&]() {
+			for (uint32_t row = nextRow++; row < blockRows; row = nextRow++) { EncodeRow(row); }
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, blockRows); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+
+	void BlockEncoder::EncodeRow(uint32_t blockY) {
+		uint32_t blocksWide = (m_width + 3) / 4;
+		size_t blockSize = Utils::GetBlockByteSize(m_format);
+		uint8_t* output = m_data.data() + (size_t)blockY * blocksWide * blockSize;
+
+		Block block;
+		for (uint32_t blockX = 0; blockX < blocksWide; blockX++, output += blockSize) {
+			LoadBlock(blockX, blockY, block);
+
+			switch (m_format) {
+			case Utils::BC1:
+				EncodeBC1(block.channels, m_options.quality, output);
+				break;
+			case Utils::BC4: {
+				// Luma weights summing to 256 so greyscale pixels keep their exact value
+				uint8_t values[16];
+				for (int i = 0; i < 16; i++) { values[i] = (uint8_t)(((int)block.channels[0][i] * 54 + (int)block.channels[1][i] * 183 + (int)block.channels[2][i] * 19 + 128) >> 8); }
+				EncodeBC4(values, m_options.quality, output);
+				break;
+			}
+			default:
+				EncodeBC7(block.channels, block.opaque, m_options.quality, output);
+				break;
+			}
+		}
+	}
+
+	void BlockEncoder::LoadBlock(uint32_t blockX, uint32_t blockY, Block& block) const {
+		int bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		bool sixteenBit = Utils::GetChannelByteSize(m_pixelFormat) == 2;
+		int channelCount = (Utils::HasAlphaChannel(m_pixelFormat) ? 4 : 3);
+
+		block.opaque = true;
+		for (uint32_t y = 0; y < 4; y++) {
+			// Pixels past the edge repeat the last row or column so they do not pull the endpoints away from the real pixels
+			uint32_t sourceY = std::min(blockY * 4 + y, m_height - 1);
+			for (uint32_t x = 0; x < 4; x++) {
+				uint32_t sourceX = std::min(blockX * 4 + x, m_width - 1);
+				const uint8_t* pixel = m_pixels.data() + ((size_t)sourceY * m_width + sourceX) * bytesPerPixel;
+
+				int i = y * 4 + x;
+				block.channels[3][i] = 255.0f;
+				for (int c = 0; c < channelCount; c++) { block.channels[c][i] = (float)(sixteenBit ? To8Bit(pixel[2 * c] | (pixel[2 * c + 1] << 8)) : pixel[c]); }
+				block.opaque = block.opaque && block.channels[3][i] == 255.0f;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	// Trades encode time against quality, high also uses BC7 rather than BC1 for opaque colour images
+	enum class BlockQuality {
+		FAST,
+		NORMAL,
+		HIGH
+	};
+
+	struct BlockEncoderOptions {
+		// Format to encode to, chosen from the pixels when not given: BC4 for greyscale, BC1 for opaque colour and BC7 otherwise
+		std::optional<Utils::BlockFormat> format;
+
+		BlockQuality quality = BlockQuality::NORMAL;
+
+		// Number of threads encoding rows of blocks, 0 uses every core
+		unsigned int threadCount = 0;
+	};
+
+	// Encodes a pixel buffer in the Image::GetPixelBuffer layout into BC1, BC4 or BC7 blocks ready to upload as a compressed texture
+	// 16 bit images are reduced to 8 bits, BC7 is written using its single subset modes 5 and 6
+	class BlockEncoder
+	{
+	public:
+		BlockEncoder(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, BlockEncoderOptions options = BlockEncoderOptions()) noexcept(false);
+
+		// Reuses blocks from the disk cache when an entry of at least the requested quality exists, otherwise encodes and stores them
+		BlockEncoder(Image& image, BlockEncoderOptions options = BlockEncoderOptions()) noexcept(false);
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		Utils::BlockFormat GetFormat() const noexcept { return m_format; }
+		std::span<const uint8_t> GetData() const noexcept;
+
+		// Format that would be chosen for the pixels when none is given
+		static Utils::BlockFormat ChooseFormat(Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, BlockQuality quality);
+
+		// Decode blocks back to tightly packed RGBA8 so the encoder can be checked without a GPU
+		// Only the BC7 modes without partitions are supported, which covers everything this encoder writes
+		static std::vector<uint8_t> Decode(Utils::BlockFormat format, uint32_t width, uint32_t height, std::span<const uint8_t> blocks) noexcept(false);
+
+	private:
+		// 16 pixels of a block as separate channels so four pixels can be compared at once
+		struct Block {
+			alignas(16) float channels[4][16];
+			bool opaque;
+		};
+
+		void Validate();
+		void Encode();
+		void EncodeRow(uint32_t blockY);
+		void LoadBlock(uint32_t blockX, uint32_t blockY, Block& block) const;
+
+	private:
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		std::span<const uint8_t> m_pixels;
+		BlockEncoderOptions m_options;
+		Utils::BlockFormat m_format = Utils::INVALID_BLOCK_FORMAT;
+
+		std::vector<uint8_t> m_data;
+		std::unique_ptr<DiskCache::Entry> m_cacheEntry;
+	};
+}
\ No newline at end of file
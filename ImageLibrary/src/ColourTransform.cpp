@@ -0,0 +1,449 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLOUR_TRANSFORM_SSE2
+#endif
+
+#include "ColourTransform.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	using Matrix3 = std::array<double, 9>;
+	using Vector3 = std::array<double, 3>;
+
+	static constexpr std::array<double, 8> SRGB_CHROMATICITIES = { 0.3127, 0.3290, 0.64, 0.33, 0.30, 0.60, 0.15, 0.06 };
+	static constexpr Vector3 D65_WHITE = { 0.3127 / 0.3290, 1.0, (1.0 - 0.3127 - 0.3290) / 0.3290 };
+	static constexpr Vector3 D50_WHITE = { 0.9642, 1.0, 0.8249 };
+
+	// Linear values are quantised to this many steps to index the table that encodes them for 8 bit output
+	static constexpr size_t ENCODE_TABLE_SIZE_8 = 16384;
+
+	// How far the combined matrix can be from the identity and still be treated as it
+	static constexpr double MATRIX_TOLERANCE = 0.002;
+
+	static Matrix3 Multiply(const Matrix3& a, const Matrix3& b) {
+		Matrix3 result{};
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 3; column++) {
+				for (int i = 0; i < 3; i++) { result[row * 3 + column] += a[row * 3 + i] * b[i * 3 + column]; }
+			}
+		}
+		return result;
+	}
+
+	static Vector3 Multiply(const Matrix3& m, const Vector3& v) {
+		return { m[0] * v[0] + m[1] * v[1] + m[2] * v[2], m[3] * v[0] + m[4] * v[1] + m[5] * v[2], m[6] * v[0] + m[7] * v[1] + m[8] * v[2] };
+	}
+
+	static Matrix3 Inverse(const Matrix3& m) {
+		double determinant = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+		if (determinant == 0.0) { return { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 }; }
+
+		Matrix3 result = {
+			m[4] * m[8] - m[5] * m[7], m[2] * m[7] - m[1] * m[8], m[1] * m[5] - m[2] * m[4],
+			m[5] * m[6] - m[3] * m[8], m[0] * m[8] - m[2] * m[6], m[2] * m[3] - m[0] * m[5],
+			m[3] * m[7] - m[4] * m[6], m[1] * m[6] - m[0] * m[7], m[0] * m[4] - m[1] * m[3]
+		};
+		for (double& value : result) { value /= determinant; }
+		return result;
+	}
+
+	static Vector3 ChromaticityToXYZ(double x, double y) { return { x / y, 1.0, (1.0 - x - y) / y }; }
+
+	// Matrix taking linear RGB to XYZ so that full intensity of every channel is the white point
+	static Matrix3 PrimariesToXYZ(const std::array<double, 8>& chromaticities) {
+		Vector3 red = ChromaticityToXYZ(chromaticities[2], chromaticities[3]);
+		Vector3 green = ChromaticityToXYZ(chromaticities[4], chromaticities[5]);
+		Vector3 blue = ChromaticityToXYZ(chromaticities[6], chromaticities[7]);
+		Matrix3 primaries = { red[0], green[0], blue[0], red[1], green[1], blue[1], red[2], green[2], blue[2] };
+
+		// Scale each primary so together they add up to the white point
+		Vector3 scale = Multiply(Inverse(primaries), ChromaticityToXYZ(chromaticities[0], chromaticities[1]));
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 3; column++) { primaries[row * 3 + column] *= scale[column]; }
+		}
+		return primaries;
+	}
+
+	// Bradford chromatic adaptation from one white point to another
+	static Matrix3 Adaptation(const Vector3& from, const Vector3& to) {
+		static constexpr Matrix3 bradford = { 0.8951, 0.2664, -0.1614, -0.7502, 1.7135, 0.0367, 0.0389, -0.0685, 1.0296 };
+		Vector3 fromCone = Multiply(bradford, from);
+		Vector3 toCone = Multiply(bradford, to);
+		Matrix3 scale = { toCone[0] / fromCone[0], 0.0, 0.0, 0.0, toCone[1] / fromCone[1], 0.0, 0.0, 0.0, toCone[2] / fromCone[2] };
+		return Multiply(Inverse(bradford), Multiply(scale, bradford));
+	}
+
+	static double EncodeSRGB(double linear) {
+		return (linear <= 0.0031308 ? 12.92 * linear : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055);
+	}
+
+	double ColourSpace::ToneCurve::Evaluate(double x) const {
+		if (!table.empty()) {
+			double position = std::clamp(x, 0.0, 1.0) * (table.size() - 1);
+			size_t index = (size_t)position;
+			if (index + 1 >= table.size()) { return table.back(); }
+			return table[index] + (table[index + 1] - table[index]) * (position - index);
+		}
+		return (x >= d ? std::pow(std::max(a * x + b, 0.0), g) + e : c * x + f);
+	}
+
+	ColourSpace::ToneCurve ColourSpace::Gamma(double gamma) {
+		ToneCurve curve;
+		curve.g = gamma;
+		return curve;
+	}
+
+	ColourSpace::ToneCurve ColourSpace::SRGBCurve() {
+		ToneCurve curve;
+		curve.g = 2.4;
+		curve.a = 1.0 / 1.055;
+		curve.b = 0.055 / 1.055;
+		curve.c = 1.0 / 12.92;
+		curve.d = 0.04045;
+		return curve;
+	}
+
+	ColourSpace ColourSpace::FromChromaticities(const std::array<double, 8>& chromaticities, const ToneCurve& curve) {
+		ColourSpace space;
+		space.curves = { curve, curve, curve };
+		space.toXYZ = PrimariesToXYZ(chromaticities);
+		space.white = ChromaticityToXYZ(chromaticities[0], chromaticities[1]);
+		return space;
+	}
+
+	ColourSpace ColourSpace::SRGB() { return FromChromaticities(SRGB_CHROMATICITIES, SRGBCurve()); }
+
+	// ICC profiles are big endian with signed 15.16 fixed point numbers
+	static uint32_t ReadICC32(const uint8_t* data) {
+		uint32_t value;
+		Utils::ExtractBigEndianBytes(value, data, 4);
+		return value;
+	}
+
+	static double ReadICCFixed(const uint8_t* data) { return (int32_t)ReadICC32(data) / 65536.0; }
+
+	static constexpr uint32_t ICCSignature(const char (&name)[5]) {
+		return ((uint32_t)(uint8_t)name[0] << 24) | ((uint32_t)(uint8_t)name[1] << 16) | ((uint32_t)(uint8_t)name[2] << 8) | (uint32_t)(uint8_t)name[3];
+	}
+
+	// Data of a tag from the tag table, empty if it is missing or runs past the end of the profile
+	static std::span<const uint8_t> FindICCTag(std::span<const uint8_t> profile, uint32_t signature) {
+		uint32_t tagCount = ReadICC32(profile.data() + 128);
+		for (uint32_t i = 0; i < tagCount && 132 + (size_t)(i + 1) * 12 <= profile.size(); i++) {
+			const uint8_t* entry = profile.data() + 132 + (size_t)i * 12;
+			if (ReadICC32(entry) != signature) { continue; }
+
+			uint32_t offset = ReadICC32(entry + 4);
+			uint32_t size = ReadICC32(entry + 8);
+			if ((uint64_t)offset + size > profile.size()) { return {}; }
+			return profile.subspan(offset, size);
+		}
+		return {};
+	}
+
+	static bool ReadICCCurve(std::span<const uint8_t> tag, ColourSpace::ToneCurve& curve) {
+		if (tag.size() < 12) { return false; }
+		curve = ColourSpace::ToneCurve();
+
+		if (ReadICC32(tag.data()) == ICCSignature("curv")) {
+			// No entries is the identity, one is a gamma in 8.8 fixed point, more are a table
+			uint32_t count = ReadICC32(tag.data() + 8);
+			if (tag.size() < 12 + (uint64_t)count * 2) { return false; }
+			if (count == 1) { curve.g = (tag[12] * 256 + tag[13]) / 256.0; }
+			else if (count > 1) {
+				curve.table.resize(count);
+				for (uint32_t i = 0; i < count; i++) { curve.table[i] = (tag[12 + i * 2] * 256 + tag[13 + i * 2]) / 65535.0f; }
+			}
+			return true;
+		}
+
+		if (ReadICC32(tag.data()) == ICCSignature("para")) {
+			// Each function type adds parameters to the one before, all are expressed in the general form
+			static constexpr std::array<uint32_t, 5> parameterCounts = { 1, 3, 4, 5, 7 };
+			uint16_t functionType = (uint16_t)(tag[8] * 256 + tag[9]);
+			if (functionType >= parameterCounts.size() || tag.size() < 12 + parameterCounts[functionType] * 4) { return false; }
+
+			std::array<double, 7> p{};
+			for (uint32_t i = 0; i < parameterCounts[functionType]; i++) { p[i] = ReadICCFixed(tag.data() + 12 + i * 4); }
+
+			curve.g = p[0];
+			if (functionType == 0) { return true; }
+			curve.a = p[1];
+			curve.b = p[2];
+			if (curve.a == 0.0) { return false; }
+			switch (functionType) {
+			case 1:
+				curve.d = -curve.b / curve.a;
+				break;
+			case 2:
+				curve.d = -curve.b / curve.a;
+				curve.e = p[3];
+				curve.f = p[3];
+				break;
+			case 3:
+				curve.c = p[3];
+				curve.d = p[4];
+				break;
+			case 4:
+				curve.c = p[3];
+				curve.d = p[4];
+				curve.e = p[5];
+				curve.f = p[6];
+				break;
+			}
+			return true;
+		}
+
+		return false;
+	}
+
+	static bool ReadICCXYZ(std::span<const uint8_t> tag, Vector3& xyz) {
+		if (tag.size() < 20 || ReadICC32(tag.data()) != ICCSignature("XYZ ")) { return false; }
+		xyz = { ReadICCFixed(tag.data() + 8), ReadICCFixed(tag.data() + 12), ReadICCFixed(tag.data() + 16) };
+		return true;
+	}
+
+	std::optional<ColourSpace> ColourSpace::FromICCProfile(std::span<const uint8_t> profile) {
+		if (profile.size() < 132 || ReadICC32(profile.data() + 20) != ICCSignature("XYZ ")) { return std::nullopt; }
+
+		// Colourants are already adapted to the D50 connection space
+		ColourSpace space;
+		space.white = D50_WHITE;
+
+		uint32_t dataColourSpace = ReadICC32(profile.data() + 16);
+		if (dataColourSpace == ICCSignature("GRAY")) {
+			// Equal channels of a greyscale image map to the white point
+			if (!ReadICCCurve(FindICCTag(profile, ICCSignature("kTRC")), space.curves[0])) { return std::nullopt; }
+			space.curves[1] = space.curves[0];
+			space.curves[2] = space.curves[0];
+			space.toXYZ = { D50_WHITE[0], 0.0, 0.0, 0.0, D50_WHITE[1], 0.0, 0.0, 0.0, D50_WHITE[2] };
+			return space;
+		}
+		if (dataColourSpace != ICCSignature("RGB ")) { return std::nullopt; }
+
+		Vector3 red, green, blue;
+		if (!ReadICCXYZ(FindICCTag(profile, ICCSignature("rXYZ")), red) || !ReadICCXYZ(FindICCTag(profile, ICCSignature("gXYZ")), green) || !ReadICCXYZ(FindICCTag(profile, ICCSignature("bXYZ")), blue)) {
+			return std::nullopt;
+		}
+		if (!ReadICCCurve(FindICCTag(profile, ICCSignature("rTRC")), space.curves[0]) || !ReadICCCurve(FindICCTag(profile, ICCSignature("gTRC")), space.curves[1]) || !ReadICCCurve(FindICCTag(profile, ICCSignature("bTRC")), space.curves[2])) {
+			return std::nullopt;
+		}
+
+		space.toXYZ = { red[0], green[0], blue[0], red[1], green[1], blue[1], red[2], green[2], blue[2] };
+		return space;
+	}
+
+	std::optional<ColourSpace> ColourSpace::FromCICP(uint8_t primaries, uint8_t transfer, uint8_t matrix, uint8_t fullRange) {
+		// PNG only allows RGB so there is no matrix
+		if (matrix != 0 || fullRange != 1) { return std::nullopt; }
+
+		std::array<double, 8> chromaticities;
+		switch (primaries) {
+			// BT.709 which sRGB shares
+		case 1:
+			chromaticities = SRGB_CHROMATICITIES;
+			break;
+			// BT.2020
+		case 9:
+			chromaticities = { 0.3127, 0.3290, 0.708, 0.292, 0.170, 0.797, 0.131, 0.046 };
+			break;
+			// DCI-P3
+		case 11:
+			chromaticities = { 0.314, 0.351, 0.680, 0.320, 0.265, 0.690, 0.150, 0.060 };
+			break;
+			// Display P3
+		case 12:
+			chromaticities = { 0.3127, 0.3290, 0.680, 0.320, 0.265, 0.690, 0.150, 0.060 };
+			break;
+		default:
+			return std::nullopt;
+		}
+
+		ToneCurve curve;
+		switch (transfer) {
+			// BT.709 and the BT.601 and BT.2020 curves that are the same
+		case 1:
+		case 6:
+		case 14:
+		case 15:
+			curve.g = 1.0 / 0.45;
+			curve.a = 1.0 / 1.099;
+			curve.b = 0.099 / 1.099;
+			curve.c = 1.0 / 4.5;
+			curve.d = 0.081;
+			break;
+		case 4:
+			curve = Gamma(2.2);
+			break;
+		case 5:
+			curve = Gamma(2.8);
+			break;
+			// Linear
+		case 8:
+			break;
+		case 13:
+			curve = SRGBCurve();
+			break;
+		default:
+			return std::nullopt;
+		}
+
+		return FromChromaticities(chromaticities, curve);
+	}
+
+	// Whether a curve is near enough to the sRGB curve that converting would change nothing visible
+	static bool IsNearSRGB(const ColourSpace::ToneCurve& curve) {
+		// A pure gamma of 2.2 is how sRGB was written before the sRGB chunk so is shown unchanged, the same 5% threshold as libpng
+		if (curve.table.empty() && curve.a == 1.0 && curve.b == 0.0 && curve.d == 0.0 && curve.e == 0.0 && std::abs(curve.g / 2.2 - 1.0) < 0.05) { return true; }
+
+		for (int i = 0; i <= 255; i++) {
+			if (std::abs(EncodeSRGB(std::clamp(curve.Evaluate(i / 255.0), 0.0, 1.0)) * 255.0 - i) > 1.0) { return false; }
+		}
+		return true;
+	}
+
+	// Table taking linear light quantised to its size to the output encoding, shared by every transform of the same depth
+	static const std::vector<uint16_t>& GetEncodeTable(int channelSize) {
+		auto build = [](size_t size, double maxValue) {
+			std::vector<uint16_t> table(size);
+			for (size_t i = 0; i < size; i++) { table[i] = (uint16_t)std::lround(EncodeSRGB(i / (double)(size - 1)) * maxValue); }
+			return table;
+		};
+
+		static const std::vector<uint16_t> table8 = build(ENCODE_TABLE_SIZE_8, UINT8_MAX);
+		static const std::vector<uint16_t> table16 = build(UINT16_MAX + 1, UINT16_MAX);
+		return (channelSize == 1 ? table8 : table16);
+	}
+
+	ColourTransform::ColourTransform(const ColourSpace& source, Utils::PixelFormat pixelFormat) : m_pixelFormat(pixelFormat) {
+		Matrix3 toSRGB = Inverse(PrimariesToXYZ(SRGB_CHROMATICITIES));
+		Matrix3 matrix = Multiply(toSRGB, Multiply(Adaptation(source.white, D65_WHITE), source.toXYZ));
+
+		bool matrixIdentity = true;
+		for (int i = 0; i < 9; i++) { matrixIdentity &= std::abs(matrix[i] - (i % 4 == 0 ? 1.0 : 0.0)) < MATRIX_TOLERANCE; }
+
+		m_identity = matrixIdentity && std::all_of(source.curves.begin(), source.curves.end(), IsNearSRGB);
+		if (m_identity) { return; }
+
+		// Channels usually share a curve so only build each different table once
+		size_t maxValue = (Utils::GetChannelByteSize(pixelFormat) == 1 ? UINT8_MAX : UINT16_MAX);
+		m_direct = matrixIdentity;
+		for (int channel = 0; channel < 3; channel++) {
+			const ColourSpace::ToneCurve& curve = source.curves[channel];
+			int same = (int)(std::find(source.curves.begin(), source.curves.begin() + channel, curve) - source.curves.begin());
+			if (same != channel) {
+				m_directTables[channel] = m_directTables[same];
+				m_linearTables[channel] = m_linearTables[same];
+				continue;
+			}
+
+			if (m_direct) {
+				m_directTables[channel].resize(maxValue + 1);
+				for (size_t i = 0; i <= maxValue; i++) { m_directTables[channel][i] = (uint16_t)std::lround(EncodeSRGB(std::clamp(curve.Evaluate(i / (double)maxValue), 0.0, 1.0)) * maxValue); }
+			}
+			else {
+				m_linearTables[channel].resize(maxValue + 1);
+				for (size_t i = 0; i <= maxValue; i++) { m_linearTables[channel][i] = (float)curve.Evaluate(i / (double)maxValue); }
+			}
+		}
+
+		for (int i = 0; i < 9; i++) { m_matrix[i] = (float)matrix[i]; }
+	}
+
+	// Channels are loaded and stored through memcpy as 16 bit channels are not aligned to their size within a pixel
+	template <typename T>
+	static T LoadChannel(const uint8_t* data) {
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	static void StoreChannel(uint8_t* data, T value) { memcpy(data, &value, sizeof(T)); }
+
+	template <typename T>
+	static void ApplyDirect(uint8_t* data, size_t pixelCount, size_t bytesPerPixel, const std::array<std::vector<uint16_t>, 3>& tables) {
+		for (size_t i = 0; i < pixelCount; i++, data += bytesPerPixel) {
+			for (int channel = 0; channel < 3; channel++) {
+				uint8_t* sample = data + channel * sizeof(T);
+				StoreChannel<T>(sample, (T)tables[channel][LoadChannel<T>(sample)]);
+			}
+		}
+	}
+
+	template <typename T>
+	static void ApplyMatrix(uint8_t* data, size_t pixelCount, size_t bytesPerPixel, const std::array<std::vector<float>, 3>& linearTables, const std::array<float, 9>& m, const std::vector<uint16_t>& encodeTable) {
+		float encodeScale = (float)(encodeTable.size() - 1);
+		size_t i = 0;
+
+#ifdef COLOUR_TRANSFORM_SSE2
+		// Four pixels at a time with a register per channel, the table lookups either side stay scalar as SSE2 has no gather
+		__m128 matrix[9];
+		for (int k = 0; k < 9; k++) { matrix[k] = _mm_set1_ps(m[k]); }
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 scale = _mm_set1_ps(encodeScale);
+
+		for (; i + 4 <= pixelCount; i += 4) {
+			alignas(16) std::array<std::array<float, 4>, 3> linear;
+			for (int p = 0; p < 4; p++) {
+				const uint8_t* pixel = data + (i + p) * bytesPerPixel;
+				for (int channel = 0; channel < 3; channel++) { linear[channel][p] = linearTables[channel][LoadChannel<T>(pixel + channel * sizeof(T))]; }
+			}
+
+			__m128 red = _mm_load_ps(linear[0].data());
+			__m128 green = _mm_load_ps(linear[1].data());
+			__m128 blue = _mm_load_ps(linear[2].data());
+
+			// Colours outside of sRGB are clipped to it
+			alignas(16) std::array<std::array<int32_t, 4>, 3> index;
+			for (int channel = 0; channel < 3; channel++) {
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(matrix[channel * 3], red), _mm_mul_ps(matrix[channel * 3 + 1], green)), _mm_mul_ps(matrix[channel * 3 + 2], blue));
+				value = _mm_mul_ps(_mm_min_ps(_mm_max_ps(value, zero), one), scale);
+				_mm_store_si128((__m128i*)index[channel].data(), _mm_cvtps_epi32(value));
+			}
+
+			for (int p = 0; p < 4; p++) {
+				uint8_t* pixel = data + (i + p) * bytesPerPixel;
+				for (int channel = 0; channel < 3; channel++) { StoreChannel<T>(pixel + channel * sizeof(T), (T)encodeTable[index[channel][p]]); }
+			}
+		}
+#endif
+
+		for (; i < pixelCount; i++) {
+			uint8_t* pixel = data + i * bytesPerPixel;
+			float red = linearTables[0][LoadChannel<T>(pixel)];
+			float green = linearTables[1][LoadChannel<T>(pixel + sizeof(T))];
+			float blue = linearTables[2][LoadChannel<T>(pixel + 2 * sizeof(T))];
+
+			for (int channel = 0; channel < 3; channel++) {
+				float value = std::clamp(m[channel * 3] * red + m[channel * 3 + 1] * green + m[channel * 3 + 2] * blue, 0.0f, 1.0f);
+				StoreChannel<T>(pixel + channel * sizeof(T), (T)encodeTable[(size_t)std::lround(value * encodeScale)]);
+			}
+		}
+	}
+
+	void ColourTransform::Apply(std::span<uint8_t> pixels) const {
+		if (m_identity) { return; }
+		IL_TRACE_SCOPE("ColourTransform::Apply");
+
+		// 16 bit channels are little endian which every supported platform reads natively
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		size_t pixelCount = pixels.size() / bytesPerPixel;
+		bool wideChannels = (Utils::GetChannelByteSize(m_pixelFormat) == 2);
+
+		if (m_direct) {
+			if (wideChannels) { ApplyDirect<uint16_t>(pixels.data(), pixelCount, bytesPerPixel, m_directTables); }
+			else { ApplyDirect<uint8_t>(pixels.data(), pixelCount, bytesPerPixel, m_directTables); }
+			return;
+		}
+
+		const std::vector<uint16_t>& encodeTable = GetEncodeTable(wideChannels ? 2 : 1);
+		if (wideChannels) { ApplyMatrix<uint16_t>(pixels.data(), pixelCount, bytesPerPixel, m_linearTables, m_matrix, encodeTable); }
+		else { ApplyMatrix<uint8_t>(pixels.data(), pixelCount, bytesPerPixel, m_linearTables, m_matrix, encodeTable); }
+	}
+}
\ No newline at end of file
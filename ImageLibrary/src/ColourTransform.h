@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <span>
+#include <optional>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	// Colour space stored values are in, described by the curves that take them to linear light and the matrix from there to CIE XYZ
+	struct ColourSpace {
+		// Curve in the parametric form ICC profiles use, Y = (aX + b)^g + e when X >= d otherwise Y = cX + f
+		// A table, if present, is used instead and interpolated between its evenly spaced entries
+		struct ToneCurve {
+			double g = 1.0, a = 1.0, b = 0.0, c = 0.0, d = 0.0, e = 0.0, f = 0.0;
+			std::vector<float> table;
+
+			double Evaluate(double x) const;
+			bool operator==(const ToneCurve&) const = default;
+		};
+
+		std::array<ToneCurve, 3> curves;
+
+		// Linear RGB to XYZ in row major order, and the XYZ of the white point the matrix is relative to
+		std::array<double, 9> toXYZ;
+		std::array<double, 3> white;
+
+		static ToneCurve Gamma(double gamma);
+		static ToneCurve SRGBCurve();
+
+		// Chromaticities are the x and y of the white point then the red, green and blue primaries, in the order of a cHRM chunk
+		static ColourSpace FromChromaticities(const std::array<double, 8>& chromaticities, const ToneCurve& curve);
+		static ColourSpace SRGB();
+
+		// Read the curves and colourants of an RGB or grey matrix/TRC ICC profile, profiles built from lookup tables are not supported
+		static std::optional<ColourSpace> FromICCProfile(std::span<const uint8_t> profile);
+
+		// Coding-independent code points from ITU-T H.273, HDR transfer functions and narrow range are not supported
+		static std::optional<ColourSpace> FromCICP(uint8_t primaries, uint8_t transfer, uint8_t matrix, uint8_t fullRange);
+	};
+
+	// Converts pixel buffers from a colour space to sRGB using per channel tables and a 3x3 matrix, no per pixel powers
+	// The output is ready for a UNORM texture or to be sampled through an _SRGB format
+	class ColourTransform
+	{
+	public:
+		ColourTransform(const ColourSpace& source, Utils::PixelFormat pixelFormat);
+
+		// Sources close enough to sRGB to be displayed as they are, including a gamma of 2.2 as browsers and libpng treat it
+		bool IsIdentity() const noexcept { return m_identity; }
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+
+		// Convert tightly packed pixels laid out as Image::GetPixelBuffer gives them in place, alpha is left alone
+		void Apply(std::span<uint8_t> pixels) const;
+
+	private:
+		Utils::PixelFormat m_pixelFormat;
+		bool m_identity = false;
+
+		// Straight from a stored value to the output value when the primaries already match sRGB
+		bool m_direct = false;
+		std::array<std::vector<uint16_t>, 3> m_directTables;
+
+		// Otherwise stored values go to linear light, through the matrix to linear sRGB then through a shared encoding table
+		std::array<std::vector<float>, 3> m_linearTables;
+		std::array<float, 9> m_matrix;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ImageLibrary {
+	// What stopped an image from decoding
+	enum class DecodeErrorKind {
+		FILE_UNREADABLE,
+		NOT_PNG,
+		NOT_JPEG,
+		TRUNCATED,
+		CRC_MISMATCH,
+		INVALID_CHUNK,
+		INVALID_CHUNK_ORDER,
+		UNSUPPORTED,
+		INVALID_IMAGE_DATA,
+		INVALID_TARGET
+	};
+
+	// Message is a string literal, offset is the byte in the file the problem was found at as near as the format allows
+	struct DecodeError {
+		DecodeErrorKind kind;
+		const char* message;
+		uint64_t offset;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include "DiskCache.h"
+#include "ImageHash.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+		// Open file and create a read only mapping of all of it, others may still write so a mapped thumbnail pack can be appended to
+		m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) { m_file = nullptr; throw new std::runtime_error("Error: Could not open file for mapping"); }
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) { CloseHandle(m_file); throw new std::runtime_error("Error: Could not get size of mapped file"); }
+		m_size = (size_t)size.QuadPart;
+
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) { CloseHandle(m_file); throw new std::runtime_error("Error: Could not map file"); }
+
+		m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data) { CloseHandle(m_mapping); CloseHandle(m_file); throw new std::runtime_error("Error: Could not map file"); }
+#else
+		// Open file and create a read only mapping of all of it, the mapping stays valid once the descriptor is closed
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) { throw new std::runtime_error("Error: Could not open file for mapping"); }
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) { close(fd); throw new std::runtime_error("Error: Could not get size of mapped file"); }
+		m_size = (size_t)info.st_size;
+
+		void* map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED) { throw new std::runtime_error("Error: Could not map file"); }
+
+		// The whole file will be copied out sequentially so let the kernel read ahead
+		madvise(map, m_size, MADV_SEQUENTIAL);
+		m_data = (const uint8_t*)map;
+#endif
+	}
+
+	MappedFile::~MappedFile() {
+#ifdef _WIN32
+		if (m_data) { UnmapViewOfFile(m_data); }
+		if (m_mapping) { CloseHandle(m_mapping); }
+		if (m_file) { CloseHandle(m_file); }
+#else
+		if (m_data) { munmap((void*)m_data, m_size); }
+#endif
+	}
+
+	DiskCache::DiskCache(std::filesystem::path directory, uintmax_t maxBytes) : m_directory(directory), m_maxBytes(maxBytes) {
+		std::filesystem::create_directories(m_directory);
+		ScanDirectory();
+		Trim();
+	}
+
+	std::unique_ptr<DiskCache::Entry> DiskCache::Find(const std::string& sourcePath, bool blockCompressed) {
+		IL_TRACE_SCOPE("DiskCache::Find");
+
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return nullptr; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::filesystem::path entryPath = GetEntryPath(key, blockCompressed);
+		std::string fileName = entryPath.filename().string();
+		if (!m_index.contains(fileName)) { return nullptr; }
+
+		// Map the entry, if this fails the file has been removed behind our back
+		std::unique_ptr<MappedFile> file;
+		try { file = std::make_unique<MappedFile>(entryPath); }
+		catch (std::runtime_error* e) {
+			delete e;
+			Remove(fileName);
+			return nullptr;
+		}
+
+		// Validate header, a changed source is already looked for under another name so a mismatch means the file is damaged or from another version
+		if (file->GetSize() < sizeof(Header)) { file.reset(); Remove(fileName); return nullptr; }
+		const Header* header = reinterpret_cast<const Header*>(file->GetData());
+		bool valid = header->magic == MAGIC && header->version == VERSION
+			&& header->pixelFormat < Utils::INVALID && ((header->flags & FLAG_BLOCK_COMPRESSED) != 0) == blockCompressed
+			&& file->GetSize() >= sizeof(Header) + header->dataSize;
+		if (valid && blockCompressed) {
+			valid = header->blockFormat < Utils::INVALID_BLOCK_FORMAT
+				&& header->dataSize == Utils::GetBlockBufferSize((Utils::BlockFormat)header->blockFormat, header->width, header->height);
+		}
+		else if (valid) { valid = header->dataSize == (uint64_t)header->width * header->height * Utils::GetPixelFormatByteSize((Utils::PixelFormat)header->pixelFormat); }
+		if (!valid) { file.reset(); Remove(fileName); return nullptr; }
+
+		// Mark entry as most recently used
+		std::error_code err;
+		auto now = std::filesystem::file_time_type::clock::now();
+		std::filesystem::last_write_time(entryPath, now, err);
+		m_index[fileName].lastUse = now;
+
+		return std::make_unique<Entry>(std::move(file));
+	}
+
+	void DiskCache::Store(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, uint32_t flags, std::span<const uint8_t> buffer) {
+		IL_TRACE_SCOPE("DiskCache::Store");
+
+		Header header{};
+		header.width = width;
+		header.height = height;
+		header.pixelFormat = pixelFormat;
+		header.flags = flags & ~FLAG_BLOCK_COMPRESSED;
+		Write(sourcePath, header, buffer);
+	}
+
+	void DiskCache::StoreBlocks(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::BlockFormat blockFormat, uint32_t blockQuality, uint32_t flags, std::span<const uint8_t> blocks) {
+		IL_TRACE_SCOPE("DiskCache::StoreBlocks");
+
+		// The pixel format is not used by block entries but is kept valid so every entry passes the same checks
+		Header header{};
+		header.width = width;
+		header.height = height;
+		header.pixelFormat = Utils::RGBA8;
+		header.flags = flags | FLAG_BLOCK_COMPRESSED;
+		header.blockFormat = blockFormat;
+		header.blockQuality = blockQuality;
+		Write(sourcePath, header, blocks);
+	}
+
+	void DiskCache::Write(const std::string& sourcePath, Header header, std::span<const uint8_t> data) {
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return; }
+
+		// Entries larger than the whole cache are never worth writing
+		uintmax_t entrySize = sizeof(Header) + data.size();
+		if (entrySize > m_maxBytes) { return; }
+
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.dataSize = data.size();
+		header.contentHash = HashBytes(data);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::filesystem::path entryPath = GetEntryPath(key, (header.flags & FLAG_BLOCK_COMPRESSED) != 0);
+		std::string fileName = entryPath.filename().string();
+		std::filesystem::path tempPath = entryPath;
+		tempPath += ".tmp";
+
+		// The entry being replaced goes first so it is never linked to itself
+		Remove(fileName);
+		if (Link(header, data, entryPath)) {
+			AddToIndex(fileName, IndexEntry{ .size = entrySize, .lastUse = std::filesystem::file_time_type::clock::now(), .contentHash = header.contentHash });
+			Trim();
+			return;
+		}
+
+		// Write to a temporary file and rename so a partially written entry is never visible
+		{
+			std::ofstream file(tempPath, std::ios_base::binary | std::ios_base::trunc);
+			if (!file) { return; }
+			file.write((const char*)&header, sizeof(Header));
+			file.write((const char*)data.data(), data.size());
+			if (!file) { file.close(); std::error_code err; std::filesystem::remove(tempPath, err); return; }
+		}
+
+		std::error_code err;
+		std::filesystem::rename(tempPath, entryPath, err);
+		if (err) { std::filesystem::remove(tempPath, err); return; }
+
+		AddToIndex(fileName, IndexEntry{ .size = entrySize, .lastUse = std::filesystem::file_time_type::clock::now(), .contentHash = header.contentHash });
+		Trim();
+	}
+
+	void DiskCache::Invalidate(const std::string& sourcePath, uint64_t size, int64_t time) {
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, size, time, key)) { return; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Remove(GetEntryPath(key, false).filename().string());
+		Remove(GetEntryPath(key, true).filename().string());
+	}
+
+	bool DiskCache::Link(const Header& header, std::span<const uint8_t> data, const std::filesystem::path& entryPath) {
+		auto it = m_contents.find(header.contentHash);
+		if (it == m_contents.end()) { return false; }
+
+		// Only link to a file holding exactly the same header and data, so a buffer that happens to share the hash is written as usual
+		for (const std::string& existingName : it->second) {
+			std::unique_ptr<MappedFile> existing;
+			try { existing = std::make_unique<MappedFile>(m_directory / existingName); }
+			catch (std::runtime_error* e) {
+				delete e;
+				continue;
+			}
+			if (existing->GetSize() != sizeof(Header) + data.size() || memcmp(existing->GetData(), &header, sizeof(Header)) != 0
+				|| memcmp(existing->GetData() + sizeof(Header), data.data(), data.size()) != 0) { continue; }
+
+			std::error_code err;
+			std::filesystem::create_hard_link(m_directory / existingName, entryPath, err);
+			if (!err) { return true; }
+		}
+		return false;
+	}
+
+	void DiskCache::AddToIndex(const std::string& fileName, IndexEntry entry) {
+		// A file's bytes are counted when the first entry holding it is added
+		std::vector<std::string>& names = m_contents[entry.contentHash];
+		if (names.empty()) { m_totalBytes += entry.size; }
+		names.push_back(fileName);
+		m_index[fileName] = entry;
+	}
+
+	bool DiskCache::GetSourceKey(const std::string& sourcePath, SourceKey& key) {
+		std::error_code err;
+		uint64_t size = std::filesystem::file_size(sourcePath, err);
+		if (err) { return false; }
+
+		int64_t time = std::filesystem::last_write_time(sourcePath, err).time_since_epoch().count();
+		if (err) { return false; }
+
+		return GetSourceKey(sourcePath, size, time, key);
+	}
+
+	bool DiskCache::GetSourceKey(const std::string& sourcePath, uint64_t size, int64_t time, SourceKey& key) {
+		std::error_code err;
+		std::filesystem::path path = std::filesystem::absolute(sourcePath, err);
+		if (err) { return false; }
+
+		key.size = size;
+		key.time = time;
+
+		// FNV-1a over the path, size and modification time
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		auto mix = [&hash](const uint8_t* data, size_t size) {
+			for (size_t i = 0; i < size; i++) {
+				hash ^= data[i];
+				hash *= 0x100000001b3ULL;
+			}
+		};
+
+		std::string pathString = path.generic_string();
+		mix((const uint8_t*)pathString.data(), pathString.size());
+		mix((const uint8_t*)&key.size, sizeof(key.size));
+		mix((const uint8_t*)&key.time, sizeof(key.time));
+		key.hash = hash;
+
+		return true;
+	}
+
+	std::filesystem::path DiskCache::GetEntryPath(const SourceKey& key, bool blockCompressed) {
+		char name[32];
+		snprintf(name, sizeof(name), (blockCompressed ? "%016llx.bc.pvc" : "%016llx.pvc"), (unsigned long long)key.hash);
+		return m_directory / name;
+	}
+
+	void DiskCache::ScanDirectory() {
+		std::error_code err;
+		for (const auto& file : std::filesystem::directory_iterator(m_directory, err)) {
+			if (!file.is_regular_file()) { continue; }
+
+			// Remove temporary files left behind by an interrupted store
+			if (file.path().extension() == ".tmp") {
+				std::filesystem::remove(file.path(), err);
+				continue;
+			}
+			if (file.path().extension() != ".pvc") { continue; }
+
+			// The content hash is read from the header, files from another version are removed as they could never be found
+			Header header{};
+			{
+				std::ifstream stream(file.path(), std::ios_base::binary);
+				stream.read((char*)&header, sizeof(Header));
+			}
+			if (header.magic != MAGIC || header.version != VERSION) {
+				std::filesystem::remove(file.path(), err);
+				continue;
+			}
+
+			AddToIndex(file.path().filename().string(), IndexEntry{ .size = file.file_size(err), .lastUse = file.last_write_time(err), .contentHash = header.contentHash });
+		}
+	}
+
+	void DiskCache::Trim() {
+		if (m_totalBytes <= m_maxBytes) { return; }
+
+		// Order entries from least to most recently used
+		std::vector<std::pair<std::string, IndexEntry>> entries(m_index.begin(), m_index.end());
+		std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.second.lastUse < b.second.lastUse; });
+
+		// Evict until back under the limit
+		for (const auto& entry : entries) {
+			if (m_totalBytes <= m_maxBytes) { break; }
+			Remove(entry.first);
+		}
+	}
+
+	void DiskCache::Remove(const std::string& fileName) {
+		auto it = m_index.find(fileName);
+		if (it == m_index.end()) { return; }
+
+		// Removing a mapped file is fine, existing mappings stay valid until they are released
+		std::error_code err;
+		std::filesystem::remove(m_directory / fileName, err);
+
+		// The bytes are only freed once no other entry links to the file
+		auto contents = m_contents.find(it->second.contentHash);
+		if (contents != m_contents.end()) {
+			std::erase(contents->second, fileName);
+			if (contents->second.empty()) {
+				m_totalBytes -= it->second.size;
+				m_contents.erase(contents);
+			}
+		}
+		m_index.erase(it);
+	}
+}
\ No newline at end of file
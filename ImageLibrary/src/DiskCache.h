@@ -0,0 +1,137 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	// Read only memory mapping of a whole file, unmapped on destruction
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::filesystem::path& path) noexcept(false);
+		~MappedFile() noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* GetData() const noexcept { return m_data; }
+		size_t GetSize() const noexcept { return m_size; }
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+
+	// Persistent cache of decoded, upload ready pixel buffers and the GPU blocks encoded from them
+	// Each entry is a single file made of a fixed size header followed by the raw buffer so it can be mapped and copied directly
+	// Entries are named by the source's path, size and modification time, and sources that decode the same share one file through hard links
+	class DiskCache
+	{
+	public:
+		// Header written at the start of every cache file, padded so pixel data starts on a 64 byte boundary
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pixelFormat;
+			uint32_t flags;
+			uint64_t dataSize;
+			uint64_t contentHash;
+			uint32_t blockFormat;
+			uint32_t blockQuality;
+			uint8_t padding[16];
+		};
+		static_assert(sizeof(Header) == 64, "Cache header must be 64 bytes");
+
+		static constexpr uint32_t MAGIC = 0x31435650; // "PVC1"
+		static constexpr uint32_t VERSION = 2;
+
+		// Set when the pixels were converted to sRGB by colour management, older entries without flags were not
+		static constexpr uint32_t FLAG_DISPLAY_COLOURS = 1;
+
+		// Set when the data is GPU blocks rather than pixels, block entries are kept alongside the pixels of the same source
+		static constexpr uint32_t FLAG_BLOCK_COMPRESSED = 2;
+
+		// A cache hit, keeps the file mapped for as long as it is alive
+		class Entry
+		{
+		public:
+			Entry(std::unique_ptr<MappedFile> file) noexcept : m_file(std::move(file)) {};
+
+			const Header& GetHeader() const noexcept { return *reinterpret_cast<const Header*>(m_file->GetData()); }
+			const uint8_t* GetPixels() const noexcept { return m_file->GetData() + sizeof(Header); }
+			size_t GetPixelsSize() const noexcept { return GetHeader().dataSize; }
+
+		private:
+			std::unique_ptr<MappedFile> m_file;
+		};
+
+		DiskCache(std::filesystem::path directory, uintmax_t maxBytes) noexcept(false);
+
+		// Look up the decoded buffer or encoded blocks for a source file, returns nullptr on a miss
+		std::unique_ptr<Entry> Find(const std::string& sourcePath, bool blockCompressed = false);
+
+		// Store a decoded buffer for a source file and trim the cache back under its size limit
+		void Store(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, uint32_t flags, std::span<const uint8_t> buffer);
+
+		// Store blocks encoded from a source file, quality is recorded so a lower quality entry can be encoded again
+		void StoreBlocks(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::BlockFormat blockFormat, uint32_t blockQuality, uint32_t flags, std::span<const uint8_t> blocks);
+
+		// Remove the pixels and blocks stored for a source as it was at a size and modification time, for a source known to have changed
+		// Such entries can never be found again but would otherwise only go once they were the least recently used
+		void Invalidate(const std::string& sourcePath, uint64_t size, int64_t time);
+
+		// Bytes on disk, a file shared by several entries is only counted once
+		uintmax_t GetSize() const noexcept { return m_totalBytes; }
+		uintmax_t GetMaxSize() const noexcept { return m_maxBytes; }
+
+	private:
+		struct SourceKey {
+			uint64_t hash;
+			uint64_t size;
+			int64_t time;
+		};
+
+		struct IndexEntry {
+			uintmax_t size;
+			std::filesystem::file_time_type lastUse;
+			uint64_t contentHash;
+		};
+
+		bool GetSourceKey(const std::string& sourcePath, SourceKey& key);
+		static bool GetSourceKey(const std::string& sourcePath, uint64_t size, int64_t time, SourceKey& key);
+		std::filesystem::path GetEntryPath(const SourceKey& key, bool blockCompressed);
+		void Write(const std::string& sourcePath, Header header, std::span<const uint8_t> data);
+		bool Link(const Header& header, std::span<const uint8_t> data, const std::filesystem::path& entryPath);
+		void AddToIndex(const std::string& fileName, IndexEntry entry);
+		void ScanDirectory();
+		void Trim();
+		void Remove(const std::string& fileName);
+
+	private:
+		std::filesystem::path m_directory;
+		uintmax_t m_maxBytes;
+		// Changed under the mutex but read without it
+		std::atomic<uintmax_t> m_totalBytes = 0;
+
+		// Files currently in the cache, the last write time of each file is used as its last use time so LRU order persists between runs
+		std::unordered_map<std::string, IndexEntry> m_index;
+
+		// Names of the entries holding each content hash, all links to one file unless two different buffers share a hash
+		std::unordered_map<uint64_t, std::vector<std::string>> m_contents;
+		std::mutex m_mutex;
+	};
+}
\ No newline at end of file
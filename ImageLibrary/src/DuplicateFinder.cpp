@@ -0,0 +1,240 @@
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "DuplicateFinder.h"
+#include "PNG.h"
+#include "JPEG.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Reduced decodes keep at least this many pixels along the shortest side so the 32x32 grid of the perceptual hash is not made of repeats
+	static constexpr uint32_t MIN_HASHED_SIDE = 64;
+
+	// Disjoint set of file indices merged whenever two files are similar
+	class FileSets
+	{
+	public:
+		FileSets(size_t count) : m_parents(count) { std::iota(m_parents.begin(), m_parents.end(), 0); }
+
+		size_t Find(size_t file) {
+			while (m_parents[file] != file) {
+				m_parents[file] = m_parents[m_parents[file]];
+				file = m_parents[file];
+			}
+			return file;
+		}
+
+		void Merge(size_t a, size_t b) { m_parents[Find(a)] = Find(b); }
+
+	private:
+		std::vector<size_t> m_parents;
+	};
+
+	DuplicateFinder::DuplicateFinder(std::vector<std::string> files, DuplicateFinderOptions options) : m_files(std::move(files)), m_options(options) {
+		IL_TRACE_SCOPE("DuplicateFinder::DuplicateFinder");
+
+		if (options.maxDistance < 0 || options.maxDistance > 31) { throw new std::runtime_error("Error: Perceptual hash distance must be from 0 to 31"); }
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_hashes.resize(m_files.size());
+		m_errors.resize(m_files.size());
+
+		RunParallel(m_files.size(), [this](size_t file) { HashFile(file); });
+		std::vector<std::vector<size_t>> similar = FindSimilar();
+
+		// Identical pixels need the same size and format, so only those sharing them with another similar file are decoded in full
+		if (options.exact) {
+			std::vector<size_t> candidates;
+			for (const std::vector<size_t>& group : similar) {
+				for (size_t file : group) {
+					const ImageHashes& hashes = *m_hashes[file];
+					bool matched = std::any_of(group.begin(), group.end(), [&](size_t other) {
+						return other != file && m_hashes[other]->width == hashes.width && m_hashes[other]->height == hashes.height && m_hashes[other]->pixelFormat == hashes.pixelFormat;
+					});
+					if (matched && !hashes.exact) { candidates.push_back(file); }
+				}
+			}
+			RunParallel(candidates.size(), [&](size_t i) { HashExactly(candidates[i]); });
+		}
+
+		BuildGroups(similar);
+		m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void DuplicateFinder::RunParallel(size_t count, const std::function<void(size_t)>& job) {
+		// Files are handed out one at a time so large and small files balance across threads
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		threadCount = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(count, 1));
+
+		std::atomic<size_t> next = 0;
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++) { job(i); }
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+
+	void DuplicateFinder::HashFile(size_t file) {
+		IL_TRACE_SCOPE("DuplicateFinder::HashFile");
+
+		const std::string& path = m_files[file];
+		if (m_options.index) {
+			if (std::optional<ImageHashes> stored = m_options.index->Find(path)) {
+				m_hashes[file] = stored;
+				m_indexHits++;
+				return;
+			}
+		}
+
+		// The library reports errors by throwing pointers, anything else thrown is from the standard library
+		try {
+			// Only the size and format are needed from the probe
+			bool jpeg = (Utils::GetFileFormat(path) == Utils::FileFormat::JPEG);
+			ImageHashes hashes;
+			if (jpeg) {
+				std::expected<JPEGInfo, DecodeError> info = JPEG::Probe(path);
+				if (!info) {
+					m_errors[file] = info.error().message;
+					return;
+				}
+				hashes = ImageHashes{ .width = info->width, .height = info->height, .pixelFormat = info->pixelFormat };
+			}
+			else {
+				std::expected<PNGInfo, DecodeError> info = PNG::Probe(path);
+				if (!info) {
+					m_errors[file] = info.error().message;
+					return;
+				}
+				hashes = ImageHashes{ .width = info->width, .height = info->height, .pixelFormat = info->pixelFormat };
+			}
+
+			// Reduce as far as possible while the shortest side keeps enough pixels to hash
+			uint32_t shortestSide = std::min(hashes.width, hashes.height);
+			uint32_t reduction = 1;
+			while (reduction < 8 && shortestSide / (reduction * 2) >= MIN_HASHED_SIDE) { reduction *= 2; }
+
+			std::expected<DecodedImage, DecodeError> decoded = (jpeg ? JPEG::DecodeReduced(path, reduction) : PNG::DecodeReduced(path, reduction));
+			if (!decoded) {
+				m_errors[file] = decoded.error().message;
+				return;
+			}
+
+			hashes.perceptual = ComputePerceptualHash(decoded->width, decoded->height, decoded->pixelFormat, decoded->pixels);
+			m_hashes[file] = hashes;
+			if (m_options.index) { m_options.index->Store(path, hashes); }
+		}
+		catch (std::exception* e) {
+			m_errors[file] = e->what();
+			delete e;
+		}
+		catch (const std::exception& e) {
+			m_errors[file] = std::string("Error: ") + e.what();
+		}
+	}
+
+	void DuplicateFinder::HashExactly(size_t file) {
+		IL_TRACE_SCOPE("DuplicateFinder::HashExactly");
+
+		// JPEGs have no decode into a caller's buffer so are decoded whole
+		ImageHashes& hashes = *m_hashes[file];
+		if (Utils::GetFileFormat(m_files[file]) == Utils::FileFormat::JPEG) {
+			std::expected<DecodedImage, DecodeError> decoded = JPEG::Decode(ImageSource::FromFile(m_files[file]));
+			if (!decoded || decoded->width != hashes.width || decoded->height != hashes.height || decoded->pixelFormat != hashes.pixelFormat) { return; }
+
+			hashes.exact = HashPixels(hashes.width, hashes.height, hashes.pixelFormat, decoded->pixels);
+			if (m_options.index) { m_options.index->Store(m_files[file], hashes); }
+			m_fullDecodes++;
+			return;
+		}
+
+		// Decoded into a buffer laid out as the pixel buffer would be, which streams rows without keeping the image data or using the disk cache
+		Utils::TargetFormat format;
+		switch (hashes.pixelFormat) {
+		case Utils::RGB8: format = Utils::TargetFormat::RGB8; break;
+		case Utils::RGB16: format = Utils::TargetFormat::RGB16; break;
+		case Utils::RGBA8: format = Utils::TargetFormat::RGBA8; break;
+		case Utils::RGBA16: format = Utils::TargetFormat::RGBA16; break;
+		default: return;
+		}
+
+		// A file that fails now is only left out of the identical groups, it is still similar to the others
+		std::vector<uint8_t> pixels((size_t)hashes.width * hashes.height * Utils::GetPixelFormatByteSize(hashes.pixelFormat));
+		if (!PNG::DecodeInto(m_files[file], DecodeTarget{ .pixels = pixels, .format = format })) { return; }
+
+		hashes.exact = HashPixels(hashes.width, hashes.height, hashes.pixelFormat, pixels);
+		if (m_options.index) { m_options.index->Store(m_files[file], hashes); }
+		m_fullDecodes++;
+	}
+
+	std::vector<std::vector<size_t>> DuplicateFinder::FindSimilar() const {
+		IL_TRACE_SCOPE("DuplicateFinder::FindSimilar");
+
+		// Two hashes within the distance differ in at most that many bands, so with one more band than that they agree on at least one
+		// Each band is looked up in its own table and only files sharing a band value are compared
+		int bands = m_options.maxDistance + 1;
+		FileSets sets(m_files.size());
+		for (int band = 0; band < bands; band++) {
+			int firstBit = band * 64 / bands;
+			int bitCount = (band + 1) * 64 / bands - firstBit;
+			uint64_t mask = (bitCount == 64 ? ~0ULL : (1ULL << bitCount) - 1);
+
+			std::unordered_map<uint64_t, std::vector<size_t>> table;
+			for (size_t file = 0; file < m_files.size(); file++) {
+				if (m_hashes[file]) { table[(m_hashes[file]->perceptual.pHash >> firstBit) & mask].push_back(file); }
+			}
+
+			for (const auto& [value, files] : table) {
+				for (size_t i = 0; i < files.size(); i++) {
+					for (size_t j = i + 1; j < files.size(); j++) {
+						if (HammingDistance(m_hashes[files[i]]->perceptual.pHash, m_hashes[files[j]]->perceptual.pHash) <= m_options.maxDistance) { sets.Merge(files[i], files[j]); }
+					}
+				}
+			}
+		}
+
+		// Groups of more than one file in the order of their first file
+		std::unordered_map<size_t, size_t> groupOfRoot;
+		std::vector<std::vector<size_t>> groups;
+		for (size_t file = 0; file < m_files.size(); file++) {
+			if (!m_hashes[file]) { continue; }
+			size_t root = sets.Find(file);
+			auto [it, added] = groupOfRoot.try_emplace(root, groups.size());
+			if (added) { groups.emplace_back(); }
+			groups[it->second].push_back(file);
+		}
+		std::erase_if(groups, [](const std::vector<size_t>& group) { return group.size() < 2; });
+		return groups;
+	}
+
+	void DuplicateFinder::BuildGroups(const std::vector<std::vector<size_t>>& similar) {
+		for (const std::vector<size_t>& group : similar) {
+			// The exact hash covers the size and format as well as the pixels
+			std::vector<std::vector<size_t>> identical;
+			std::unordered_map<uint64_t, size_t> identicalOfHash;
+			size_t unmatched = 0;
+			for (size_t file : group) {
+				const ImageHashes& hashes = *m_hashes[file];
+				if (!hashes.exact) {
+					unmatched++;
+					continue;
+				}
+
+				auto [it, added] = identicalOfHash.try_emplace(*hashes.exact, identical.size());
+				if (added) { identical.emplace_back(); }
+				identical[it->second].push_back(file);
+			}
+
+			// The similar group is only worth listing if it holds more than one distinct image
+			if (unmatched + identical.size() > 1) { m_groups.push_back(DuplicateGroup{ .files = group, .identical = false }); }
+			for (std::vector<size_t>& files : identical) {
+				if (files.size() > 1) { m_groups.push_back(DuplicateGroup{ .files = std::move(files), .identical = true }); }
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <atomic>
+#include <functional>
+
+#include "HashIndex.h"
+
+namespace ImageLibrary {
+	struct DuplicateFinderOptions {
+		// Most perceptual hash bits two images can differ by and still be similar, up to 31
+		int maxDistance = 6;
+
+		// Decode similar images of the same size in full and compare the exact hashes of their pixels
+		bool exact = true;
+
+		// Index hashes are read from and stored in so unchanged files are not decoded again, none hashes every file
+		std::shared_ptr<HashIndex> index;
+
+		// Number of files hashed at once, 0 uses every core
+		unsigned int threadCount = 0;
+	};
+
+	// Files that look alike, each within the distance of at least one other in the group
+	// Identical groups hold files with exactly the same pixels and are found within the similar groups
+	struct DuplicateGroup {
+		std::vector<size_t> files;
+		bool identical = false;
+	};
+
+	// Finds duplicate and near duplicate PNGs among any number of files
+	// Every file gets perceptual hashes from a reduced decode, then similar pairs are found by looking up each hash in a table per band of bits,
+	// as two hashes within the distance must agree on one of distance + 1 bands. Only images similar to another of the same size are decoded in full
+	class DuplicateFinder
+	{
+	public:
+		DuplicateFinder(std::vector<std::string> files, DuplicateFinderOptions options = DuplicateFinderOptions()) noexcept(false);
+
+		const std::vector<std::string>& GetFiles() const noexcept { return m_files; }
+		const std::vector<DuplicateGroup>& GetGroups() const noexcept { return m_groups; }
+
+		// Hashes of each file, none for a file that could not be decoded with the reason in its error
+		const std::vector<std::optional<ImageHashes>>& GetHashes() const noexcept { return m_hashes; }
+		const std::vector<std::string>& GetErrors() const noexcept { return m_errors; }
+
+		// Files whose perceptual hashes came from the index and files decoded in full for their exact hash
+		size_t GetIndexHitCount() const noexcept { return m_indexHits; }
+		size_t GetFullDecodeCount() const noexcept { return m_fullDecodes; }
+		double GetSeconds() const noexcept { return m_seconds; }
+
+	private:
+		// Run a job for every index from 0 to the count spread across the worker threads
+		void RunParallel(size_t count, const std::function<void(size_t)>& job);
+
+		void HashFile(size_t file);
+		void HashExactly(size_t file);
+		std::vector<std::vector<size_t>> FindSimilar() const;
+		void BuildGroups(const std::vector<std::vector<size_t>>& similar);
+
+	private:
+		std::vector<std::string> m_files;
+		DuplicateFinderOptions m_options;
+
+		std::vector<std::optional<ImageHashes>> m_hashes;
+		std::vector<std::string> m_errors;
+		std::vector<DuplicateGroup> m_groups;
+
+		std::atomic<size_t> m_indexHits = 0;
+		std::atomic<size_t> m_fullDecodes = 0;
+		double m_seconds = 0.0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+
+namespace ImageLibrary {
+	// Reads a file through a small window, only seeking when the bytes asked for are not already in it
+	class FileWindow
+	{
+	public:
+		FileWindow(const std::string& filePath) : m_file(filePath, std::ios_base::binary) {}
+
+		bool IsOpen() const noexcept { return m_file.is_open(); }
+
+		// Bytes at the offset that stay valid until the next read, nullptr if the file ends first
+		const uint8_t* Read(uint64_t offset, size_t size) {
+			if (offset >= m_windowOffset && offset + size <= m_windowOffset + m_window.size()) { return m_window.data() + (offset - m_windowOffset); }
+
+			m_file.clear();
+			m_file.seekg((std::streamoff)offset);
+			m_window.resize(std::max(size, WINDOW_SIZE));
+			m_file.read(reinterpret_cast<char*>(m_window.data()), (std::streamsize)m_window.size());
+			m_window.resize((size_t)m_file.gcount());
+			m_windowOffset = offset;
+
+			return (m_window.size() < size ? nullptr : m_window.data());
+		}
+
+	private:
+		// Enough for a PNG's signature, IHDR and the metadata chunks that usually follow it in one read, or a JPEG's markers before its frame header
+		static constexpr size_t WINDOW_SIZE = 4096;
+
+		std::ifstream m_file;
+		std::vector<uint8_t> m_window;
+		uint64_t m_windowOffset = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,367 @@
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+
+#include "FolderIndex.h"
+#include "PNG.h"
+#include "JPEG.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Copying a file in reports several events for it, so the watcher waits this long after the first for the rest before looking at any
+	static constexpr int SETTLE_MILLISECONDS = 50;
+
+	FolderIndex::FolderIndex(std::filesystem::path folder, std::filesystem::path indexDirectory, FolderIndexOptions options)
+		: m_indexDirectory(indexDirectory), m_options(std::move(options)), m_entries(std::make_shared<const std::vector<FolderEntry>>()) {
+		IL_TRACE_SCOPE("FolderIndex::FolderIndex");
+
+		std::error_code err;
+		m_folder = std::filesystem::absolute(folder, err);
+		if (err || !std::filesystem::is_directory(m_folder, err)) { throw new std::runtime_error("Error: " + folder.string() + " is not a folder"); }
+
+		bool loaded = Load();
+
+		// Watch before listing so nothing changed while the folder is listed is missed
+#ifdef __linux__
+		if (m_options.watch) {
+			m_notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			m_stopDescriptor = eventfd(0, EFD_CLOEXEC);
+			uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+			if (m_notifyDescriptor >= 0 && m_stopDescriptor >= 0 && inotify_add_watch(m_notifyDescriptor, m_folder.c_str(), mask) >= 0) { m_watching = true; }
+			else {
+				if (m_notifyDescriptor >= 0) { close(m_notifyDescriptor); }
+				if (m_stopDescriptor >= 0) { close(m_stopDescriptor); }
+				m_notifyDescriptor = m_stopDescriptor = -1;
+			}
+		}
+#endif
+
+		// A folder seen before is usable straight away and only checked for changes in the background
+		if (!loaded) { Refresh(); }
+		m_updating = loaded;
+		if (loaded || m_watching) { m_thread = std::thread(&FolderIndex::Watch, this); }
+	}
+
+	FolderIndex::~FolderIndex() {
+		m_stopping = true;
+#ifdef __linux__
+		if (m_stopDescriptor >= 0) {
+			uint64_t one = 1;
+			if (write(m_stopDescriptor, &one, sizeof(one)) < 0) {}
+		}
+#endif
+		if (m_thread.joinable()) { m_thread.join(); }
+#ifdef __linux__
+		if (m_notifyDescriptor >= 0) { close(m_notifyDescriptor); }
+		if (m_stopDescriptor >= 0) { close(m_stopDescriptor); }
+#endif
+
+		try { Save(); }
+		catch (std::runtime_error* e) { delete e; }
+	}
+
+	std::filesystem::path FolderIndex::GetIndexPath() const {
+		// FNV-1a over the folder's path
+		std::string folder = m_folder.generic_string();
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for (char c : folder) {
+			hash ^= (uint8_t)c;
+			hash *= 0x100000001b3ULL;
+		}
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.pvf", (unsigned long long)hash);
+		return m_indexDirectory / name;
+	}
+
+	bool FolderIndex::Load() {
+		IL_TRACE_SCOPE("FolderIndex::Load");
+
+		std::filesystem::path path = GetIndexPath();
+		std::ifstream file(path, std::ios_base::binary);
+		if (!file) { return false; }
+
+		// Anything that does not hold together is dropped and the index started again
+		Header header{};
+		file.read((char*)&header, sizeof(Header));
+		std::error_code err;
+		uintmax_t fileSize = std::filesystem::file_size(path, err);
+		if (!file || err || header.magic != MAGIC || header.version != VERSION
+			|| sizeof(Header) + header.folderLength + header.entryCount * sizeof(Entry) + header.namesSize != fileSize) { return false; }
+
+		// Two folders can share a hash, so the index must be of this one
+		std::string folder(header.folderLength, '\0');
+		file.read(folder.data(), folder.size());
+		if (!file || folder != m_folder.generic_string()) { return false; }
+
+		std::vector<Entry> entries(header.entryCount);
+		std::string names(header.namesSize, '\0');
+		file.read((char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+		file.read(names.data(), names.size());
+		if (!file) { return false; }
+
+		std::vector<FolderEntry> loaded;
+		loaded.reserve(entries.size());
+		for (const Entry& entry : entries) {
+			if ((uint64_t)entry.nameOffset + entry.nameLength > names.size() || entry.pixelFormat > Utils::INVALID || entry.format > (uint32_t)Utils::FileFormat::UNKNOWN) { return false; }
+
+			loaded.push_back(FolderEntry{ .name = names.substr(entry.nameOffset, entry.nameLength), .size = entry.size, .time = entry.time, .format = (Utils::FileFormat)entry.format,
+				.probed = (entry.flags & FLAG_PROBED) != 0, .width = entry.width, .height = entry.height, .pixelFormat = (Utils::PixelFormat)entry.pixelFormat });
+		}
+
+		// Entries are saved in name order so they are only sorted if the file was not
+		auto byName = [](const FolderEntry& a, const FolderEntry& b) { return a.name < b.name; };
+		if (!std::is_sorted(loaded.begin(), loaded.end(), byName)) { std::sort(loaded.begin(), loaded.end(), byName); }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries = std::make_shared<const std::vector<FolderEntry>>(std::move(loaded));
+		return true;
+	}
+
+	void FolderIndex::Save() {
+		IL_TRACE_SCOPE("FolderIndex::Save");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_changed) { return; }
+
+		std::string folder = m_folder.generic_string();
+		std::vector<Entry> entries;
+		std::string names;
+		entries.reserve(m_entries->size());
+		for (const FolderEntry& entry : *m_entries) {
+			entries.push_back(Entry{ .size = entry.size, .time = entry.time, .width = entry.width, .height = entry.height, .pixelFormat = (uint32_t)entry.pixelFormat,
+				.format = (uint32_t)entry.format, .flags = (entry.probed ? FLAG_PROBED : 0u), .nameOffset = (uint32_t)names.size(), .nameLength = (uint32_t)entry.name.size(), .padding = 0 });
+			names += entry.name;
+		}
+
+		std::error_code err;
+		std::filesystem::create_directories(m_indexDirectory, err);
+		std::filesystem::path path = GetIndexPath();
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+
+		// Write to a temporary file and rename so a partly written index is never read
+		{
+			std::ofstream file(tempPath, std::ios_base::binary | std::ios_base::trunc);
+			Header header{ .magic = MAGIC, .version = VERSION, .entryCount = entries.size(), .folderLength = (uint32_t)folder.size(), .namesSize = (uint32_t)names.size() };
+			file.write((const char*)&header, sizeof(Header));
+			file.write(folder.data(), folder.size());
+			file.write((const char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+			file.write(names.data(), names.size());
+			if (!file) {
+				file.close();
+				std::filesystem::remove(tempPath, err);
+				throw new std::runtime_error("Error: Could not write folder index");
+			}
+		}
+
+		std::filesystem::rename(tempPath, path, err);
+		if (err) {
+			std::filesystem::remove(tempPath, err);
+			throw new std::runtime_error("Error: Could not replace folder index");
+		}
+		m_changed = false;
+	}
+
+	std::shared_ptr<const std::vector<FolderEntry>> FolderIndex::GetEntries() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries;
+	}
+
+	const FolderEntry* FolderIndex::Find(const std::vector<FolderEntry>& entries, const std::string& name) {
+		auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const FolderEntry& entry, const std::string& name) { return entry.name < name; });
+		return (it != entries.end() && it->name == name ? &*it : nullptr);
+	}
+
+	bool FolderIndex::Refresh() {
+		IL_TRACE_SCOPE("FolderIndex::Refresh");
+
+		// Only names are read while listing, so the folder is read once and every file is then looked at across threads
+		std::vector<std::string> names;
+		std::error_code err;
+		for (auto it = std::filesystem::directory_iterator(m_folder, err); !err && it != std::filesystem::directory_iterator(); it.increment(err)) {
+			std::string name = it->path().filename().string();
+			if (Utils::GetFileFormat(name) != Utils::FileFormat::UNKNOWN) { names.push_back(std::move(name)); }
+		}
+
+		// A folder that cannot be listed keeps the entries it had rather than losing them all
+		if (err) { return false; }
+		return Reconcile(names, true);
+	}
+
+	bool FolderIndex::Reconcile(const std::vector<std::string>& names, bool complete) {
+		IL_TRACE_SCOPE("FolderIndex::Reconcile");
+		std::lock_guard<std::mutex> refreshLock(m_refreshMutex);
+
+		// Entries are only replaced while holding the refresh lock, so the list taken here stays the latest until this is done
+		std::shared_ptr<const std::vector<FolderEntry>> entries = GetEntries();
+		std::vector<std::optional<FolderEntry>> changed(names.size());
+		std::vector<uint8_t> present(names.size(), 0);
+		RunParallel(names.size(), [&](size_t i) {
+			std::filesystem::path path = m_folder / names[i];
+			std::error_code err;
+			if (!std::filesystem::is_regular_file(path, err)) { return; }
+
+			FolderEntry entry{ .name = names[i], .format = Utils::GetFileFormat(names[i]) };
+			entry.size = std::filesystem::file_size(path, err);
+			if (err) { return; }
+			entry.time = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+			if (err) { return; }
+			present[i] = 1;
+
+			const FolderEntry* previous = Find(*entries, names[i]);
+			if (previous && previous->size == entry.size && previous->time == entry.time) { return; }
+
+			ProbeFile(path, entry);
+			m_probeCount++;
+			changed[i] = std::move(entry);
+		});
+
+		// Nothing is applied from a refresh cut short, as files it did not reach would look removed
+		if (m_stopping) { return false; }
+
+		std::unordered_set<std::string> removed;
+		if (complete) {
+			std::unordered_set<std::string> listed;
+			for (size_t i = 0; i < names.size(); i++) {
+				if (present[i]) { listed.insert(names[i]); }
+			}
+			for (const FolderEntry& entry : *entries) {
+				if (!listed.contains(entry.name)) { removed.insert(entry.name); }
+			}
+		}
+		else {
+			for (size_t i = 0; i < names.size(); i++) {
+				if (!present[i] && Find(*entries, names[i])) { removed.insert(names[i]); }
+			}
+		}
+
+		bool anyChanged = !removed.empty() || std::any_of(changed.begin(), changed.end(), [](const std::optional<FolderEntry>& entry) { return entry.has_value(); });
+		if (!anyChanged) { return false; }
+
+		// Decodes cached for a file as it was before can never be found again, so they are removed rather than left to be evicted
+		std::vector<FolderEntry> updated;
+		updated.reserve(entries->size() + names.size());
+		for (const FolderEntry& entry : *entries) {
+			if (removed.contains(entry.name)) { Invalidate(entry); }
+			else { updated.push_back(entry); }
+		}
+
+		// Changed files replace their entries in place, new files are added to the end and sorted into place
+		size_t sortedCount = updated.size();
+		for (std::optional<FolderEntry>& entry : changed) {
+			if (!entry) { continue; }
+
+			auto it = std::lower_bound(updated.begin(), updated.begin() + sortedCount, entry->name, [](const FolderEntry& entry, const std::string& name) { return entry.name < name; });
+			if (it != updated.begin() + sortedCount && it->name == entry->name) {
+				Invalidate(*it);
+				*it = std::move(*entry);
+			}
+			else { updated.push_back(std::move(*entry)); }
+		}
+		if (updated.size() > sortedCount) { std::sort(updated.begin(), updated.end(), [](const FolderEntry& a, const FolderEntry& b) { return a.name < b.name; }); }
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_entries = std::make_shared<const std::vector<FolderEntry>>(std::move(updated));
+			m_changed = true;
+		}
+
+		m_generation++;
+		if (m_options.onChange) { m_options.onChange(); }
+		return true;
+	}
+
+	void FolderIndex::ProbeFile(const std::filesystem::path& path, FolderEntry& entry) {
+		// Only the header is read, a file that fails is kept so it is not probed again until it changes
+		if (entry.format == Utils::FileFormat::JPEG) {
+			std::expected<JPEGInfo, DecodeError> info = JPEG::Probe(path.string());
+			if (!info) { return; }
+			entry.width = info->width;
+			entry.height = info->height;
+			entry.pixelFormat = info->pixelFormat;
+		}
+		else {
+			std::expected<PNGInfo, DecodeError> info = PNG::Probe(path.string());
+			if (!info) { return; }
+			entry.width = info->width;
+			entry.height = info->height;
+			entry.pixelFormat = info->pixelFormat;
+		}
+		entry.probed = true;
+	}
+
+	void FolderIndex::Invalidate(const FolderEntry& entry) {
+		if (std::shared_ptr<DiskCache> diskCache = Image::GetDiskCache()) { diskCache->Invalidate((m_folder / entry.name).string(), entry.size, entry.time); }
+	}
+
+	void FolderIndex::RunParallel(size_t count, const std::function<void(size_t)>& job) {
+		// Files are handed out one at a time, on a network share each is mostly waiting on the server so many can be waited on at once
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		threadCount = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(count, 1));
+
+		std::atomic<size_t> next = 0;
+		auto worker = [&]() {
+			for (size_t i = next++; i < count && !m_stopping; i = next++) { job(i); }
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+
+	void FolderIndex::Watch() {
+		if (m_updating) {
+			Refresh();
+			m_updating = false;
+		}
+
+#ifdef __linux__
+		alignas(inotify_event) char buffer[64 * 1024];
+		pollfd descriptors[2] = { { .fd = m_notifyDescriptor, .events = POLLIN, .revents = 0 }, { .fd = m_stopDescriptor, .events = POLLIN, .revents = 0 } };
+		while (m_watching && !m_stopping) {
+			if (poll(descriptors, 2, -1) < 0) {
+				if (errno == EINTR) { continue; }
+				break;
+			}
+			if (descriptors[1].revents) { break; }
+
+			// Let a burst of events finish, then look at each name reported once
+			if (poll(&descriptors[1], 1, SETTLE_MILLISECONDS) > 0) { break; }
+
+			std::unordered_set<std::string> names;
+			bool overflowed = false;
+			ssize_t length;
+			while ((length = read(m_notifyDescriptor, buffer, sizeof(buffer))) > 0) {
+				for (const char* event = buffer; event < buffer + length;) {
+					const inotify_event* notification = reinterpret_cast<const inotify_event*>(event);
+					if (notification->mask & IN_Q_OVERFLOW) { overflowed = true; }
+
+					// The folder itself going leaves the entries as they were last seen
+					if (notification->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) { m_watching = false; }
+
+					if (notification->len > 0 && !(notification->mask & IN_ISDIR) && Utils::GetFileFormat(notification->name) != Utils::FileFormat::UNKNOWN) {
+						names.insert(notification->name);
+					}
+					event += sizeof(inotify_event) + notification->len;
+				}
+			}
+			if (!m_watching) { break; }
+
+			// Events were lost if the queue overflowed, so the whole folder is looked at again
+			if (overflowed) { Refresh(); }
+			else if (!names.empty()) { Reconcile(std::vector<std::string>(names.begin(), names.end()), false); }
+		}
+#endif
+	}
+}
\ No newline at end of file
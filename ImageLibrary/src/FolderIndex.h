@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <filesystem>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	// Image in an indexed folder as it was when last probed
+	struct FolderEntry {
+		std::string name;
+		uint64_t size = 0;
+		int64_t time = 0;
+		Utils::FileFormat format = Utils::FileFormat::UNKNOWN;
+
+		// Taken from the header, a file that could not be probed has no dimensions or pixel format and is only probed again once it changes
+		bool probed = false;
+		uint32_t width = 0, height = 0;
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+	};
+
+	struct FolderIndexOptions {
+		// Number of files looked at and probed at once, 0 uses every core
+		unsigned int threadCount = 0;
+
+		// Keep the index current on a thread of its own that waits for changes to the folder, only on Linux where inotify is used
+		bool watch = true;
+
+		// Called from the watching thread each time entries change, so a UI can wake to show them
+		std::function<void()> onChange;
+	};
+
+	// Size, modification time, dimensions and format of every PNG and JPEG directly inside a folder, kept in a file between runs
+	// A folder seen before is listed straight from its file and then brought up to date in the background, a new folder is listed and probed
+	// across threads before the constructor returns. Only files that are new or have a new size or modification time are probed, and
+	// the disk cache entries of changed and removed files are invalidated. While watched, changes are picked up as inotify reports them
+	class FolderIndex
+	{
+	public:
+		// Header at the start of the file, followed by the folder's path, every entry in name order and then the entries' names
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t entryCount;
+			uint32_t folderLength;
+			uint32_t namesSize;
+		};
+		static_assert(sizeof(Header) == 24, "Folder index header must be 24 bytes");
+
+		struct Entry {
+			uint64_t size;
+			int64_t time;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pixelFormat;
+			uint32_t format;
+			uint32_t flags;
+			uint32_t nameOffset;
+			uint32_t nameLength;
+			uint32_t padding;
+		};
+		static_assert(sizeof(Entry) == 48, "Folder index entry must be 48 bytes");
+
+		static constexpr uint32_t MAGIC = 0x31465650; // "PVF1"
+		static constexpr uint32_t VERSION = 1;
+
+		// Set when the header was read, otherwise the file could not be probed
+		static constexpr uint32_t FLAG_PROBED = 1;
+
+		// The index of each folder is kept in the directory named by the hash of the folder's path
+		// An index that cannot be read, is from another version or is of another folder is started again
+		FolderIndex(std::filesystem::path folder, std::filesystem::path indexDirectory, FolderIndexOptions options = FolderIndexOptions()) noexcept(false);
+		~FolderIndex() noexcept;
+
+		FolderIndex(const FolderIndex&) = delete;
+		FolderIndex& operator=(const FolderIndex&) = delete;
+
+		const std::filesystem::path& GetFolder() const noexcept { return m_folder; }
+
+		// Entries in name order as of the last change, safe to call from any thread
+		// Changes make a new list rather than changing this one, so it can be held for as long as needed without copying it
+		std::shared_ptr<const std::vector<FolderEntry>> GetEntries();
+
+		// Goes up by one every time entries change, so a caller can tell whether to fetch them again
+		uint64_t GetGeneration() const noexcept { return m_generation; }
+
+		// Whether the background update of an index read from its file is still running, its entries may be out of date until it finishes
+		bool IsUpdating() const noexcept { return m_updating; }
+
+		// Whether changes are being watched for, false once the folder itself is removed or renamed
+		bool IsWatching() const noexcept { return m_watching; }
+
+		// List the folder again now and probe anything new or changed, returns whether any entry changed
+		bool Refresh();
+
+		// Write the index if anything changed since it was read
+		void Save() noexcept(false);
+
+		// Files probed since the index was opened, so a caller can see how much a refresh had to do
+		size_t GetProbeCount() const noexcept { return m_probeCount; }
+
+	private:
+		// Returns false if there was no usable index, in which case the folder has to be listed and probed from scratch
+		bool Load();
+		std::filesystem::path GetIndexPath() const;
+
+		// Bring the entries of the named files up to date, looking at and probing them across threads
+		// A complete listing also removes the entries of every file not named, otherwise only named files that are gone are removed
+		bool Reconcile(const std::vector<std::string>& names, bool complete);
+		static void ProbeFile(const std::filesystem::path& path, FolderEntry& entry);
+		static const FolderEntry* Find(const std::vector<FolderEntry>& entries, const std::string& name);
+		void Invalidate(const FolderEntry& entry);
+
+		// Run a job for every index from 0 to the count spread across the threads, stopping early when the index is destroyed
+		void RunParallel(size_t count, const std::function<void(size_t)>& job);
+
+		// Finish the update of an index read from its file, then wait for and apply changes until stopped
+		void Watch();
+
+	private:
+		std::filesystem::path m_folder;
+		std::filesystem::path m_indexDirectory;
+		FolderIndexOptions m_options;
+
+		std::shared_ptr<const std::vector<FolderEntry>> m_entries;
+		bool m_changed = false;
+		std::mutex m_mutex;
+
+		// Only one refresh or update runs at a time so two never probe the same file and apply out of order
+		std::mutex m_refreshMutex;
+
+		std::atomic<uint64_t> m_generation = 0;
+		std::atomic<size_t> m_probeCount = 0;
+		std::atomic<bool> m_updating = false;
+		std::atomic<bool> m_watching = false;
+		std::atomic<bool> m_stopping = false;
+
+		// inotify descriptor and the event that wakes the watching thread to stop, both -1 when not watching
+		int m_notifyDescriptor = -1;
+		int m_stopDescriptor = -1;
+		std::thread m_thread;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <fstream>
+
+#include "HashIndex.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	HashIndex::HashIndex(std::filesystem::path path) : m_path(path) {
+		Load();
+	}
+
+	HashIndex::~HashIndex() {
+		try { Save(); }
+		catch (std::runtime_error* e) { delete e; }
+	}
+
+	void HashIndex::Load() {
+		IL_TRACE_SCOPE("HashIndex::Load");
+
+		std::ifstream file(m_path, std::ios_base::binary);
+		if (!file) { return; }
+
+		// Anything that does not hold together is dropped and the index started again
+		Header header{};
+		file.read((char*)&header, sizeof(Header));
+		std::error_code err;
+		uintmax_t fileSize = std::filesystem::file_size(m_path, err);
+		if (!file || err || header.magic != MAGIC || header.version != VERSION || sizeof(Header) + header.entryCount * sizeof(Entry) > fileSize) { return; }
+
+		std::vector<Entry> entries(header.entryCount);
+		file.read((char*)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+		if (!file) { return; }
+
+		m_entries.reserve(entries.size());
+		for (const Entry& entry : entries) { m_entries[entry.pathHash] = entry; }
+	}
+
+	bool HashIndex::GetSourceKey(const std::string& sourcePath, SourceKey& key) {
+		std::error_code err;
+		std::filesystem::path path = std::filesystem::absolute(sourcePath, err);
+		if (err) { return false; }
+
+		key.size = std::filesystem::file_size(path, err);
+		if (err) { return false; }
+
+		key.time = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+		if (err) { return false; }
+
+		// FNV-1a over the path alone so a changed file replaces its old hashes
+		std::string pathString = path.generic_string();
+		key.pathHash = 0xcbf29ce484222325ULL;
+		for (char c : pathString) {
+			key.pathHash ^= (uint8_t)c;
+			key.pathHash *= 0x100000001b3ULL;
+		}
+		return true;
+	}
+
+	std::optional<ImageHashes> HashIndex::Find(const std::string& sourcePath) {
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return std::nullopt; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key.pathHash);
+		if (it == m_entries.end()) { return std::nullopt; }
+
+		const Entry& entry = it->second;
+		if (entry.sourceSize != key.size || entry.sourceTime != key.time || entry.pixelFormat >= Utils::INVALID) { return std::nullopt; }
+
+		ImageHashes hashes{ .width = entry.width, .height = entry.height, .pixelFormat = (Utils::PixelFormat)entry.pixelFormat, .perceptual = PerceptualHash{ .dHash = entry.dHash, .pHash = entry.pHash } };
+		if (entry.flags & FLAG_EXACT) { hashes.exact = entry.exactHash; }
+		return hashes;
+	}
+
+	void HashIndex::Store(const std::string& sourcePath, const ImageHashes& hashes) {
+		// A source that cannot be found again cannot be looked up either so is not stored
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return; }
+
+		Entry entry{ .pathHash = key.pathHash, .sourceSize = key.size, .sourceTime = key.time, .width = hashes.width, .height = hashes.height, .pixelFormat = (uint32_t)hashes.pixelFormat,
+			.flags = (hashes.exact ? FLAG_EXACT : 0u), .exactHash = hashes.exact.value_or(0), .dHash = hashes.perceptual.dHash, .pHash = hashes.perceptual.pHash };
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries[key.pathHash] = entry;
+		m_changed = true;
+	}
+
+	void HashIndex::Save() {
+		IL_TRACE_SCOPE("HashIndex::Save");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_changed) { return; }
+
+		std::error_code err;
+		std::filesystem::create_directories(m_path.parent_path(), err);
+		std::filesystem::path tempPath = m_path;
+		tempPath += ".tmp";
+
+		// Write to a temporary file and rename so a partly written index is never read
+		{
+			std::ofstream file(tempPath, std::ios_base::binary | std::ios_base::trunc);
+			Header header{ .magic = MAGIC, .version = VERSION, .entryCount = m_entries.size() };
+			file.write((const char*)&header, sizeof(Header));
+			for (const auto& [hash, entry] : m_entries) { file.write((const char*)&entry, sizeof(Entry)); }
+			if (!file) {
+				file.close();
+				std::filesystem::remove(tempPath, err);
+				throw new std::runtime_error("Error: Could not write hash index");
+			}
+		}
+
+		std::filesystem::rename(tempPath, m_path, err);
+		if (err) {
+			std::filesystem::remove(tempPath, err);
+			throw new std::runtime_error("Error: Could not replace hash index");
+		}
+		m_changed = false;
+	}
+
+	size_t HashIndex::GetCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <mutex>
+#include <filesystem>
+#include <unordered_map>
+
+#include "ImageHash.h"
+
+namespace ImageLibrary {
+	// Hashes of one source file, the exact hash is only worked out for images that may have a duplicate as it needs a full decode
+	struct ImageHashes {
+		uint32_t width = 0, height = 0;
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+		PerceptualHash perceptual;
+		std::optional<uint64_t> exact;
+	};
+
+	// Hashes of any number of source files kept in a single file between runs, looked up by the hash of the source path
+	// The whole index is read into memory when opened and written again by Save, a source with a new size or modification time is hashed again
+	class HashIndex
+	{
+	public:
+		// Header at the start of the file, followed by every entry
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t entryCount;
+		};
+		static_assert(sizeof(Header) == 16, "Hash index header must be 16 bytes");
+
+		struct Entry {
+			uint64_t pathHash;
+			uint64_t sourceSize;
+			int64_t sourceTime;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pixelFormat;
+			uint32_t flags;
+			uint64_t exactHash;
+			uint64_t dHash;
+			uint64_t pHash;
+		};
+		static_assert(sizeof(Entry) == 64, "Hash index entry must be 64 bytes");
+
+		static constexpr uint32_t MAGIC = 0x31485650; // "PVH1"
+		static constexpr uint32_t VERSION = 1;
+
+		// Set when the exact hash has been worked out
+		static constexpr uint32_t FLAG_EXACT = 1;
+
+		// An index that cannot be read or is from another version is started again
+		HashIndex(std::filesystem::path path) noexcept(false);
+		~HashIndex() noexcept;
+
+		HashIndex(const HashIndex&) = delete;
+		HashIndex& operator=(const HashIndex&) = delete;
+
+		// Hashes of a source file if it has not changed since they were stored, safe to call from any thread
+		std::optional<ImageHashes> Find(const std::string& sourcePath);
+
+		// Store the hashes of a source file replacing any before, safe to call from any thread
+		void Store(const std::string& sourcePath, const ImageHashes& hashes);
+
+		// Write the index if anything was stored since it was read
+		void Save() noexcept(false);
+
+		size_t GetCount();
+
+	private:
+		struct SourceKey {
+			uint64_t pathHash;
+			uint64_t size;
+			int64_t time;
+		};
+
+		static bool GetSourceKey(const std::string& sourcePath, SourceKey& key);
+		void Load();
+
+	private:
+		std::filesystem::path m_path;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		bool m_changed = false;
+		std::mutex m_mutex;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <algorithm>
+
+#include "Image.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	void Image::ReadRawData() {
+		IL_TRACE_SCOPE("Image::ReadRawData");
+		Memory::Scope memoryScope(m_memoryStats);
+
+		// Mapped pages are backed by the file so the kernel can drop them instead of the file taking up heap memory
+		if (m_lowMemory) {
+			// An empty file cannot be mapped, leaving no data lets the child class report it
+			std::error_code error;
+			if (std::filesystem::file_size(m_filePath, error) == 0 && !error) { return; }
+
+			try { m_mappedFile = std::make_unique<MappedFile>(m_filePath); }
+			catch (std::runtime_error* e) {
+				delete e;
+				SetError(DecodeErrorKind::FILE_UNREADABLE, "Error: File could not be opened", 0);
+				return;
+			}
+			m_fileData = std::span<const uint8_t>(m_mappedFile->GetData(), m_mappedFile->GetSize());
+			return;
+		}
+
+		// Create input stream in binary mode
+		std::ifstream file;
+		file.open(m_filePath, std::ios_base::binary);
+		file.unsetf(std::ios_base::skipws);
+
+		// Get and reserve file size
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(m_filePath, error);
+		if (!file || error) {
+			SetError(DecodeErrorKind::FILE_UNREADABLE, "Error: File could not be opened", 0);
+			return;
+		}
+		m_rawData.reserve(size);
+
+		// Read file into vector
+		std::copy(std::istream_iterator<uint8_t>(file), std::istream_iterator<uint8_t>(), std::back_inserter(m_rawData));
+		m_fileData = m_rawData;
+	}
+
+	Image::Image(const ImageSource& source) : m_filePath(source.GetName()) {
+		if (source.IsFile()) {
+			if (!ReadCachedData()) { ReadRawData(); }
+			return;
+		}
+
+		m_cacheable = false;
+		ReadSourceData(source);
+	}
+
+	void Image::ReadSourceData(const ImageSource& source) {
+		IL_TRACE_SCOPE("Image::ReadSourceData");
+		Memory::Scope memoryScope(m_memoryStats);
+
+		std::expected<std::span<const uint8_t>, DecodeError> data = source.Read(m_rawData, m_sourceOwner);
+		if (!data) {
+			m_error = data.error();
+			return;
+		}
+		m_fileData = *data;
+	}
+
+	bool Image::SetError(DecodeErrorKind kind, const char* message, uint64_t offset) noexcept {
+		m_error = DecodeError{ .kind = kind, .message = message, .offset = offset };
+		return false;
+	}
+
+	void Image::ReleaseFileData() noexcept {
+		m_fileData = std::span<const uint8_t>();
+		m_rawData = Memory::Buffer();
+		m_mappedFile.reset();
+		m_sourceOwner.reset();
+	}
+
+	bool Image::ReadCachedData() {
+		if (!s_diskCache) { return false; }
+		IL_TRACE_SCOPE("Image::ReadCachedData");
+
+		// Look for a previous decode of this file
+		m_cacheEntry = s_diskCache->Find(m_filePath);
+		if (!m_cacheEntry) { return false; }
+
+		// An entry stored with colour management set differently is decoded again and replaced
+		const DiskCache::Header& header = m_cacheEntry->GetHeader();
+		if (((header.flags & DiskCache::FLAG_DISPLAY_COLOURS) != 0) != m_colourManagement) {
+			m_cacheEntry.reset();
+			return false;
+		}
+
+		// Take image information from the cache header
+		m_width = header.width;
+		m_height = header.height;
+		m_pixelFormat = (Utils::PixelFormat)header.pixelFormat;
+
+		return true;
+	}
+
+	std::span<const uint8_t> Image::GetPixelBuffer() {
+		// Use the mapped cache file directly if the image was found there
+		if (m_cacheEntry) { return std::span<const uint8_t>(m_cacheEntry->GetPixels(), m_cacheEntry->GetPixelsSize()); }
+
+		// Images decoded in low memory mode already have a buffer
+		if (m_pixelBuffer.empty()) {
+			Memory::Scope memoryScope(m_memoryStats);
+			m_pixelBuffer = PixelDataToBuffer();
+
+			// Pixel data is only needed to build the buffer
+			m_pixelData = Memory::Vector<Memory::Vector<Utils::Pixel>>();
+		}
+
+		if (!m_convertedToDisplay) {
+			ConvertToDisplay(m_pixelBuffer, m_pixelFormat);
+			m_convertedToDisplay = true;
+
+			// Statistics collected while decoding describe the values before conversion
+			if (m_colourTransform && !m_colourTransform->IsIdentity()) { m_statistics.reset(); }
+		}
+
+		// Store the buffer once so the next load can skip decoding
+		if (s_diskCache && m_cacheable) {
+			s_diskCache->Store(m_filePath, m_width, m_height, m_pixelFormat, (m_colourManagement ? DiskCache::FLAG_DISPLAY_COLOURS : 0), m_pixelBuffer);
+			m_cacheable = false;
+		}
+
+		return m_pixelBuffer;
+	}
+
+	const ImageStatistics& Image::GetStatistics() {
+		std::span<const uint8_t> pixels = GetPixelBuffer();
+		if (!m_statistics) { m_statistics = StatisticsAccumulator::Compute(m_pixelFormat, pixels); }
+		return *m_statistics;
+	}
+
+	void Image::ConvertToDisplay(std::span<uint8_t> pixels, Utils::PixelFormat pixelFormat) {
+		if (!m_colourManagement || !m_colourSpace) { return; }
+
+		// Frames gain an alpha channel so may need different tables to the default image
+		if (!m_colourTransform || m_colourTransform->GetPixelFormat() != pixelFormat) { m_colourTransform = std::make_unique<ColourTransform>(*m_colourSpace, pixelFormat); }
+		m_colourTransform->Apply(pixels);
+	}
+
+	Memory::Buffer Image::PixelDataToBuffer() {
+		IL_TRACE_SCOPE("Image::PixelDataToBuffer");
+
+		int bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		int channelDepth = Utils::GetChannelByteSize(m_pixelFormat);
+		Memory::Buffer buffer((size_t)m_width * m_height * bytesPerPixel);
+
+		for (uint32_t y = 0; y < m_height; y++) {
+			for (uint32_t x = 0; x < m_width; x++) {
+				buffer[(y * m_width + x) * bytesPerPixel] = (uint8_t)m_pixelData[y][x].R;
+				buffer[(y * m_width + x) * bytesPerPixel + channelDepth] = (uint8_t)m_pixelData[y][x].G;
+				buffer[(y * m_width + x) * bytesPerPixel + 2 * channelDepth] = (uint8_t)m_pixelData[y][x].B;
+
+				// If format has 2 bytes per channel set data for it
+				if (channelDepth == 2) {
+					buffer[(y * m_width + x) * bytesPerPixel + 1] = m_pixelData[y][x].R >> 8;
+					buffer[(y * m_width + x) * bytesPerPixel + channelDepth + 1] = m_pixelData[y][x].G >> 8;
+					buffer[(y * m_width + x) * bytesPerPixel + 2 * channelDepth + 1] = m_pixelData[y][x].B >> 8;
+				}
+
+				if (Utils::HasAlphaChannel(m_pixelFormat)) {
+					buffer[(y * m_width + x) * bytesPerPixel + 3 * channelDepth] = (uint8_t)m_pixelData[y][x].A;
+
+					// If format has 2 bytes per channel set data for it
+					if (channelDepth == 2) {
+						buffer[(y * m_width + x) * bytesPerPixel + 3 * channelDepth + 1] = (uint8_t)(m_pixelData[y][x].A >> 8);
+					}
+				}
+			}
+		}
+
+		return buffer;
+	}
+}
\ No newline at end of file
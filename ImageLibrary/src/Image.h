@@ -0,0 +1,164 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <iterator>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <expected>
+#include <new>
+
+#include "Utils.h"
+#include "DecodeError.h"
+#include "Memory.h"
+#include "ColourTransform.h"
+#include "DiskCache.h"
+#include "Statistics.h"
+#include "ImageSource.h"
+
+namespace ImageLibrary {
+	// Decoded image laid out the same as Image::GetPixelBuffer with ownership of its pixels
+	struct DecodedImage {
+		uint32_t width = 0, height = 0;
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+		Memory::Buffer pixels;
+		Memory::Stats memoryStats;
+	};
+
+	// Buffer owned by the caller that a decode writes finished rows straight into, such as shared memory or a mapped framebuffer
+	// Padding between rows is left untouched
+	struct DecodeTarget {
+		std::span<uint8_t> pixels;
+		Utils::TargetFormat format = Utils::TargetFormat::RGBA8;
+
+		// Bytes from the start of one row to the start of the next, 0 for rows packed one after another
+		size_t rowStride = 0;
+	};
+
+	class Image
+	{
+	public:
+		Image(std::string filePath) noexcept(false) : m_filePath(filePath) { if (!ReadCachedData()) { ReadRawData(); } };
+
+		// Read from a path, memory or an archive member, only a path can be found in or stored to the disk cache
+		Image(const ImageSource& source) noexcept(false);
+		virtual ~Image() noexcept = default;
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+		const std::string& GetFilePath() const noexcept { return m_filePath; }
+
+		// Get the decoded image as tightly packed rows with channels in RGB(A) order and 16 bit channels little endian
+		// The buffer is owned by the image and is ready to be copied into any graphics API's upload memory
+		std::span<const uint8_t> GetPixelBuffer();
+
+		// Peak bytes and allocations of the decode so far, including building the pixel buffer once it has been requested
+		const Memory::Stats& GetMemoryStats() const noexcept { return m_memoryStats; }
+
+		// Set the cache decoded images are read from and stored in, pass nullptr to disable caching
+		static void SetDiskCache(std::shared_ptr<DiskCache> diskCache) noexcept { s_diskCache = diskCache; }
+		static std::shared_ptr<DiskCache> GetDiskCache() noexcept { return s_diskCache; }
+
+		// Decode images created after this straight into the pixel buffer a scanline at a time with the file mapped rather than read
+		// Peak heap memory stays close to the size of the pixel buffer, while stage timings no longer separate unpacking and deinterlacing
+		static void SetLowMemoryMode(bool lowMemory) noexcept { s_lowMemory = lowMemory; }
+
+		// Colour space the pixel buffer was converted from to sRGB, none if the file did not give one and is taken to be sRGB already
+		// Not known for images found in the disk cache
+		const std::optional<ColourSpace>& GetColourSpace() const noexcept { return m_colourSpace; }
+
+		// Convert images created after this from the colour space their file gives to sRGB for display, on by default
+		static void SetColourManagement(bool colourManagement) noexcept { s_colourManagement = colourManagement; }
+
+		// Whether this image's pixel buffer is converted to sRGB, fixed when the image is created
+		bool IsColourManaged() const noexcept { return m_colourManagement; }
+
+		// Histogram and levels of the pixel buffer, collected while decoding if enabled or computed across every core when first asked for
+		// Decoded rows are counted before colour management so statistics are recomputed if the conversion changed any values
+		const ImageStatistics& GetStatistics();
+
+		// Collect statistics for images created after this while they decode, off by default
+		static void SetCollectStatistics(bool collectStatistics) noexcept { s_collectStatistics = collectStatistics; }
+
+	protected:
+		// Read the file for a decode that does not give the full size buffer the disk cache holds, so the cache is neither read nor written
+		// The file is always mapped as such decodes go straight into the pixel buffer, statistics are not collected
+		struct UncachedTag {};
+		Image(std::string filePath, UncachedTag) noexcept(false) : m_filePath(filePath), m_cacheable(false), m_lowMemory(true), m_collectStatistics(false) { ReadRawData(); };
+
+		// Function that must be implemented by child class to read and process image, returns false once an error has been set
+		virtual bool ReadFile() = 0;
+
+		// Record why the decode failed, always returns false so it can be returned straight from a failing stage
+		bool SetError(DecodeErrorKind kind, const char* message, uint64_t offset) noexcept;
+
+		// Whether the decoded image was found in the disk cache, in which case it must not be read by the child class
+		bool IsCached() const noexcept { return m_cacheEntry != nullptr; }
+
+		// Free the file once nothing more will be decoded from it
+		void ReleaseFileData() noexcept;
+
+		// Convert pixel data to a graphics API useable format
+		Memory::Buffer PixelDataToBuffer();
+
+		// Convert a buffer laid out as GetPixelBuffer gives it to sRGB if colour management is on and the image has a colour space
+		// The transform is kept so every animation frame reuses its tables
+		void ConvertToDisplay(std::span<uint8_t> pixels, Utils::PixelFormat pixelFormat);
+
+	private:
+		// Internal function to read raw file data when initialised, sets an error if the file cannot be read
+		void ReadRawData();
+
+		// Internal function to take the bytes of a source that is not a file when initialised, sets an error if they cannot be read
+		void ReadSourceData(const ImageSource& source);
+
+		// Internal function to get decoded data from the disk cache when initialised
+		bool ReadCachedData();
+
+	protected:
+		// File information
+		std::string m_filePath;
+		Memory::Buffer m_rawData;
+
+		// The whole file, either read into raw data or mapped in low memory mode so it is not held on the heap
+		// Sources other than files give memory or an archive member, either in place or inflated into raw data
+		std::span<const uint8_t> m_fileData;
+		std::unique_ptr<MappedFile> m_mappedFile;
+		std::shared_ptr<const void> m_sourceOwner;
+		std::unique_ptr<DiskCache::Entry> m_cacheEntry;
+		inline static std::shared_ptr<DiskCache> s_diskCache;
+		bool m_cacheable = true;
+		inline static bool s_lowMemory = false;
+		bool m_lowMemory = s_lowMemory;
+		inline static bool s_colourManagement = true;
+		bool m_colourManagement = s_colourManagement;
+		inline static bool s_collectStatistics = false;
+		bool m_collectStatistics = s_collectStatistics;
+
+		// Image information
+		Memory::Vector<Memory::Vector<Utils::Pixel>> m_pixelData;
+		Memory::Buffer m_pixelBuffer;
+		uint32_t m_width = 0, m_height = 0;
+		Utils::PixelFormat m_pixelFormat = Utils::INVALID;
+
+		// Set by the child class once the file has been read
+		std::optional<ColourSpace> m_colourSpace;
+		std::unique_ptr<ColourTransform> m_colourTransform;
+		bool m_convertedToDisplay = false;
+
+		// Rows are added to the accumulator by the child class as they are decoded, which then sets the statistics
+		std::unique_ptr<StatisticsAccumulator> m_statisticsAccumulator;
+		std::optional<ImageStatistics> m_statistics;
+
+		// Memory used by the decode
+		Memory::Stats m_memoryStats;
+
+		// Set by the first stage of reading or decoding to fail, nothing further is decoded once it is
+		std::optional<DecodeError> m_error;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include <cmath>
+#include <cstring>
+#include <bit>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_COMPARE_SSE2
+#endif
+
+#include "ImageCompare.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Below this many pixels a comparison is over before more threads could start
+	static constexpr uint64_t MIN_THREADED_PIXELS = 1 << 20;
+
+	// 16 bit channels are little endian as Image::GetPixelBuffer gives them
+	static uint32_t ReadChannel(const uint8_t* pixel, int channel, int channelBytes) {
+		return (channelBytes == 2 ? (uint32_t)(pixel[channel * 2] | (pixel[channel * 2 + 1] << 8)) : pixel[channel]);
+	}
+
+	// Convert a row to the format being compared in, scaling 8 bit values to 16 bits and adding an opaque alpha channel as needed
+	static void ConvertRow(const uint8_t* src, Utils::PixelFormat from, uint8_t* dest, Utils::PixelFormat to, uint32_t width) {
+		int fromBytes = Utils::GetChannelByteSize(from), toBytes = Utils::GetChannelByteSize(to);
+		int fromChannels = Utils::GetPixelFormatByteSize(from) / fromBytes, toChannels = Utils::GetPixelFormatByteSize(to) / toBytes;
+		uint32_t scale = (toBytes > fromBytes ? 257 : 1);
+		uint32_t opaque = (toBytes == 2 ? 65535 : 255);
+
+		for (uint32_t x = 0; x < width; x++, src += fromChannels * fromBytes) {
+			for (int c = 0; c < toChannels; c++) {
+				uint32_t value = (c < fromChannels ? ReadChannel(src, c, fromBytes) * scale : opaque);
+				*dest++ = (uint8_t)value;
+				if (toBytes == 2) { *dest++ = (uint8_t)(value >> 8); }
+			}
+		}
+	}
+
+	// Absolute difference of every 8 bit channel in a row, adding up their squares and keeping the largest
+	static void DiffRow8(const uint8_t* a, const uint8_t* b, uint8_t* diff, size_t count, uint64_t& squared, uint32_t& maxError) {
+		size_t i = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// Saturating subtraction both ways gives the absolute difference, squares are summed in pairs of 16 bit values then widened to 64 bits
+		__m128i zero = _mm_setzero_si128();
+		__m128i sums = zero, maxima = zero;
+		for (; i + 16 <= count; i += 16) {
+			__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+			__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+			__m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+			_mm_storeu_si128((__m128i*)(diff + i), d);
+			maxima = _mm_max_epu8(maxima, d);
+
+			__m128i low = _mm_unpacklo_epi8(d, zero), high = _mm_unpackhi_epi8(d, zero);
+			__m128i squares = _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high));
+			sums = _mm_add_epi64(sums, _mm_add_epi64(_mm_unpacklo_epi32(squares, zero), _mm_unpackhi_epi32(squares, zero)));
+		}
+
+		alignas(16) uint8_t maxBytes[16];
+		alignas(16) uint64_t sumWords[2];
+		_mm_store_si128((__m128i*)maxBytes, maxima);
+		_mm_store_si128((__m128i*)sumWords, sums);
+		squared += sumWords[0] + sumWords[1];
+		for (uint8_t value : maxBytes) { maxError = std::max<uint32_t>(maxError, value); }
+#endif
+
+		for (; i < count; i++) {
+			uint32_t d = (a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]);
+			diff[i] = (uint8_t)d;
+			squared += d * d;
+			maxError = std::max(maxError, d);
+		}
+	}
+
+	// Absolute difference of every 16 bit channel in a row, adding up their squares and keeping the largest
+	static void DiffRow16(const uint8_t* a, const uint8_t* b, uint8_t* diff, size_t count, uint64_t& squared, uint32_t& maxError) {
+		size_t i = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// SSE2 has no unsigned 16 bit maximum so it is made from a saturating subtraction, squares need all 32 bits so are multiplied as 64 bit lanes
+		__m128i zero = _mm_setzero_si128();
+		__m128i sums = zero, maxima = zero;
+		for (; i + 8 <= count; i += 8) {
+			__m128i va = _mm_loadu_si128((const __m128i*)(a + i * 2));
+			__m128i vb = _mm_loadu_si128((const __m128i*)(b + i * 2));
+			__m128i d = _mm_or_si128(_mm_subs_epu16(va, vb), _mm_subs_epu16(vb, va));
+			_mm_storeu_si128((__m128i*)(diff + i * 2), d);
+			maxima = _mm_add_epi16(_mm_subs_epu16(maxima, d), d);
+
+			__m128i low = _mm_unpacklo_epi16(d, zero), high = _mm_unpackhi_epi16(d, zero);
+			__m128i lowOdd = _mm_srli_epi64(low, 32), highOdd = _mm_srli_epi64(high, 32);
+			sums = _mm_add_epi64(sums, _mm_add_epi64(_mm_mul_epu32(low, low), _mm_mul_epu32(lowOdd, lowOdd)));
+			sums = _mm_add_epi64(sums, _mm_add_epi64(_mm_mul_epu32(high, high), _mm_mul_epu32(highOdd, highOdd)));
+		}
+
+		alignas(16) uint16_t maxWords[8];
+		alignas(16) uint64_t sumWords[2];
+		_mm_store_si128((__m128i*)maxWords, maxima);
+		_mm_store_si128((__m128i*)sumWords, sums);
+		squared += sumWords[0] + sumWords[1];
+		for (uint16_t value : maxWords) { maxError = std::max<uint32_t>(maxError, value); }
+#endif
+
+		for (; i < count; i++) {
+			uint32_t va = ReadChannel(a, (int)i, 2), vb = ReadChannel(b, (int)i, 2);
+			uint32_t d = (va > vb ? va - vb : vb - va);
+			uint16_t stored = (uint16_t)d;
+			memcpy(diff + i * 2, &stored, 2);
+			squared += (uint64_t)d * d;
+			maxError = std::max(maxError, d);
+		}
+	}
+
+	// Largest channel difference of each pixel in a row of 8 bit differences
+	static void PixelErrors8(const uint8_t* diff, uint8_t* errors, uint32_t width, int channelCount) {
+		uint32_t x = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// Four RGBA pixels at a time, folding each pixel's channels into its lowest byte with shifts then packing those bytes together
+		if (channelCount == 4) {
+			__m128i lowBytes = _mm_set1_epi32(0xFF);
+			for (; x + 4 <= width; x += 4) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(diff + x * 4));
+				__m128i m = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+				m = _mm_and_si128(_mm_max_epu8(m, _mm_srli_epi32(m, 16)), lowBytes);
+				m = _mm_packs_epi32(m, m);
+				uint32_t packed = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(m, m));
+				memcpy(errors + x, &packed, 4);
+			}
+		}
+#endif
+
+		for (; x < width; x++) {
+			const uint8_t* pixel = diff + (size_t)x * channelCount;
+			uint8_t error = std::max({ pixel[0], pixel[1], pixel[2] });
+			errors[x] = (channelCount == 4 ? std::max(error, pixel[3]) : error);
+		}
+	}
+
+	// Largest channel difference of each pixel in a row of 16 bit differences, kept in the machine's own byte order
+	static void PixelErrors16(const uint8_t* diff, uint8_t* errors, uint32_t width, int channelCount) {
+		uint32_t x = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// Two RGBA pixels at a time, folding each pixel's channels into its lowest word
+		if (channelCount == 4) {
+			for (; x + 2 <= width; x += 2) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(diff + x * 8));
+				__m128i shifted = _mm_srli_epi64(d, 16);
+				__m128i m = _mm_add_epi16(_mm_subs_epu16(d, shifted), shifted);
+				shifted = _mm_srli_epi64(m, 32);
+				m = _mm_add_epi16(_mm_subs_epu16(m, shifted), shifted);
+				uint16_t pair[2] = { (uint16_t)_mm_extract_epi16(m, 0), (uint16_t)_mm_extract_epi16(m, 4) };
+				memcpy(errors + x * 2, pair, 4);
+			}
+		}
+#endif
+
+		for (; x < width; x++) {
+			uint16_t channels[4] = {};
+			memcpy(channels, diff + (size_t)x * channelCount * 2, channelCount * 2);
+			uint16_t error = std::max({ channels[0], channels[1], channels[2], channels[3] });
+			memcpy(errors + x * 2, &error, 2);
+		}
+	}
+
+	// Call back for every run of pixels in a row that has one over the threshold, with the first pixel of the run and a bit set for each pixel over
+	template <typename Block>
+	static void FindChanged8(const uint8_t* errors, uint32_t width, uint32_t threshold, Block&& block) {
+		if (threshold >= 255) { return; }
+		uint32_t x = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// Sixteen pixels at a time, subtracting the threshold with saturation leaves only the errors over it
+		__m128i limit = _mm_set1_epi8((char)threshold), zero = _mm_setzero_si128();
+		for (; x + 16 <= width; x += 16) {
+			__m128i over = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)(errors + x)), limit);
+			uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(over, zero)) & 0xFFFF;
+			if (mask != 0) { block(x, mask); }
+		}
+#endif
+
+		for (; x < width; x++) {
+			if (errors[x] > threshold) { block(x, 1u); }
+		}
+	}
+
+	template <typename Block>
+	static void FindChanged16(const uint8_t* errors, uint32_t width, uint32_t threshold, Block&& block) {
+		if (threshold >= 65535) { return; }
+		uint32_t x = 0;
+
+#ifdef IMAGE_COMPARE_SSE2
+		// Eight pixels at a time, the comparison results are packed to bytes so each pixel has one bit of the mask
+		__m128i limit = _mm_set1_epi16((short)threshold), zero = _mm_setzero_si128();
+		for (; x + 8 <= width; x += 8) {
+			__m128i within = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_loadu_si128((const __m128i*)(errors + x * 2)), limit), zero);
+			uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(within, within)) & 0xFF;
+			if (mask != 0) { block(x, mask); }
+		}
+#endif
+
+		for (; x < width; x++) {
+			uint16_t error;
+			memcpy(&error, errors + x * 2, 2);
+			if (error > threshold) { block(x, 1u); }
+		}
+	}
+
+	ImageCompare::ImageCompare(uint32_t width, uint32_t height, Utils::PixelFormat formatA, std::span<const uint8_t> pixelsA,
+		Utils::PixelFormat formatB, std::span<const uint8_t> pixelsB, ImageCompareOptions options)
+		: m_width(width), m_height(height), m_options(options) {
+		IL_TRACE_SCOPE("ImageCompare::ImageCompare");
+
+		size_t bytesA = Utils::GetPixelFormatByteSize(formatA), bytesB = Utils::GetPixelFormatByteSize(formatB);
+		if (bytesA == 0 || bytesB == 0) { throw new std::runtime_error("Error: Cannot compare images with an invalid pixel format"); }
+		if (pixelsA.size() < (size_t)width * height * bytesA || pixelsB.size() < (size_t)width * height * bytesB) { throw new std::runtime_error("Error: Pixel buffers are smaller than the images being compared"); }
+
+		// Compare at the greater bit depth, with alpha if either has it
+		bool alpha = (formatA == Utils::RGBA8 || formatA == Utils::RGBA16 || formatB == Utils::RGBA8 || formatB == Utils::RGBA16);
+		m_channelBytes = std::max(Utils::GetChannelByteSize(formatA), Utils::GetChannelByteSize(formatB));
+		m_pixelFormat = (m_channelBytes == 2 ? (alpha ? Utils::RGBA16 : Utils::RGB16) : (alpha ? Utils::RGBA8 : Utils::RGB8));
+		int channelCount = (alpha ? 4 : 3);
+		size_t rowSamples = (size_t)width * channelCount;
+		size_t rowBytes = rowSamples * m_channelBytes;
+		m_errors.resize((size_t)width * height * m_channelBytes);
+
+		struct Band {
+			uint64_t squared = 0;
+			uint32_t maxError = 0;
+		};
+		uint32_t bandRows = GetBandRows();
+		std::vector<Band> bands((m_height + bandRows - 1) / bandRows);
+
+		RunBands(bandRows, [&](uint32_t index, uint32_t firstRow, uint32_t lastRow) {
+			Band& band = bands[index];
+
+			// Rows in another format are converted into buffers of the band's own before comparing
+			std::vector<uint8_t> rowA(formatA != m_pixelFormat ? rowBytes : 0), rowB(formatB != m_pixelFormat ? rowBytes : 0), diff(rowBytes);
+			for (uint32_t y = firstRow; y < lastRow; y++) {
+				const uint8_t* a = pixelsA.data() + (size_t)y * width * bytesA;
+				const uint8_t* b = pixelsB.data() + (size_t)y * width * bytesB;
+				if (!rowA.empty()) {
+					ConvertRow(a, formatA, rowA.data(), m_pixelFormat, width);
+					a = rowA.data();
+				}
+				if (!rowB.empty()) {
+					ConvertRow(b, formatB, rowB.data(), m_pixelFormat, width);
+					b = rowB.data();
+				}
+
+				uint8_t* errors = m_errors.data() + (size_t)y * width * m_channelBytes;
+				if (m_channelBytes == 2) {
+					DiffRow16(a, b, diff.data(), rowSamples, band.squared, band.maxError);
+					PixelErrors16(diff.data(), errors, width, channelCount);
+				}
+				else {
+					DiffRow8(a, b, diff.data(), rowSamples, band.squared, band.maxError);
+					PixelErrors8(diff.data(), errors, width, channelCount);
+				}
+			}
+		});
+
+		// Bands are added in order so the result does not depend on how threads took them
+		double squared = 0.0;
+		for (const Band& band : bands) {
+			squared += (double)band.squared;
+			m_maxError = std::max(m_maxError, band.maxError);
+		}
+		uint64_t samples = (uint64_t)width * height * channelCount;
+		m_meanSquaredError = (samples != 0 ? squared / samples : 0.0);
+	}
+
+	static Image& CheckSameSize(Image& a, Image& b) {
+		if (a.GetWidth() != b.GetWidth() || a.GetHeight() != b.GetHeight()) { throw new std::runtime_error("Error: Images to compare must be the same size"); }
+		return b;
+	}
+
+	ImageCompare::ImageCompare(Image& a, Image& b, ImageCompareOptions options)
+		: ImageCompare(a.GetWidth(), a.GetHeight(), a.GetPixelFormat(), a.GetPixelBuffer(), CheckSameSize(a, b).GetPixelFormat(), b.GetPixelBuffer(), options) {}
+
+	double ImageCompare::GetPSNR() const noexcept {
+		if (m_meanSquaredError == 0.0) { return std::numeric_limits<double>::infinity(); }
+		double peak = GetChannelMaximum();
+		return 10.0 * std::log10(peak * peak / m_meanSquaredError);
+	}
+
+	ChangedPixels ImageCompare::ApplyThreshold(uint32_t threshold, std::span<uint8_t> visualisation) const {
+		IL_TRACE_SCOPE("ImageCompare::ApplyThreshold");
+		if (!visualisation.empty() && visualisation.size() < (size_t)m_width * m_height * 4) { throw new std::runtime_error("Error: Visualisation buffer is smaller than the images being compared"); }
+
+		// The ramp only depends on the error so is made once
+		static const std::array<uint32_t, 256> ramp = BuildColourRamp();
+
+		struct Band {
+			uint64_t count = 0;
+			uint32_t left = UINT32_MAX, right = 0, top = UINT32_MAX, bottom = 0;
+		};
+		uint32_t bandRows = GetBandRows();
+		std::vector<Band> bands((m_height + bandRows - 1) / bandRows);
+
+		RunBands(bandRows, [&](uint32_t index, uint32_t firstRow, uint32_t lastRow) {
+			Band& band = bands[index];
+			for (uint32_t y = firstRow; y < lastRow; y++) {
+				const uint8_t* errors = m_errors.data() + (size_t)y * m_width * m_channelBytes;
+				uint8_t* dest = (visualisation.empty() ? nullptr : visualisation.data() + (size_t)y * m_width * 4);
+				if (dest) { memset(dest, 0, (size_t)m_width * 4); }
+
+				// Counting and the row's extent come straight from the masks, colours are only looked up for pixels over the threshold
+				uint64_t count = 0;
+				uint32_t left = UINT32_MAX, right = 0;
+				auto block = [&](uint32_t x, uint32_t mask) {
+					count += std::popcount(mask);
+					left = std::min(left, x + std::countr_zero(mask));
+					right = std::max(right, x + 31 - std::countl_zero(mask));
+					if (!dest) { return; }
+
+					for (; mask != 0; mask &= mask - 1) {
+						uint32_t pixel = x + std::countr_zero(mask);
+						uint32_t error;
+						if (m_channelBytes == 2) {
+							uint16_t word;
+							memcpy(&word, errors + pixel * 2, 2);
+							error = (word - 1u) >> 8;
+						}
+						else { error = errors[pixel] - 1u; }
+						memcpy(dest + (size_t)pixel * 4, &ramp[error], 4);
+					}
+				};
+				if (m_channelBytes == 2) { FindChanged16(errors, m_width, threshold, block); }
+				else { FindChanged8(errors, m_width, threshold, block); }
+
+				if (count == 0) { continue; }
+				band.count += count;
+				band.left = std::min(band.left, left);
+				band.right = std::max(band.right, right);
+				band.top = std::min(band.top, y);
+				band.bottom = y;
+			}
+		});
+
+		ChangedPixels changed;
+		Band total;
+		for (const Band& band : bands) {
+			if (band.count == 0) { continue; }
+			total.count += band.count;
+			total.left = std::min(total.left, band.left);
+			total.right = std::max(total.right, band.right);
+			total.top = std::min(total.top, band.top);
+			total.bottom = std::max(total.bottom, band.bottom);
+		}
+		changed.count = total.count;
+		if (total.count != 0) { changed.region = Utils::Rect{ .x = total.left, .y = total.top, .width = total.right - total.left + 1, .height = total.bottom - total.top + 1 }; }
+		return changed;
+	}
+
+	std::array<uint32_t, 256> ImageCompare::BuildColourRamp() {
+		// The square root spreads small differences out so a difference of one level is still plainly red
+		std::array<uint32_t, 256> ramp;
+		for (size_t i = 0; i < ramp.size(); i++) {
+			float level = std::sqrt((i + 1) / 256.0f);
+			uint32_t green = (uint32_t)std::lround(std::min(1.0f, level * 2.0f) * 255.0f);
+			uint32_t blue = (uint32_t)std::lround(std::max(0.0f, level * 2.0f - 1.0f) * 255.0f);
+			uint8_t colour[4] = { 255, (uint8_t)green, (uint8_t)blue, 255 };
+			memcpy(&ramp[i], colour, 4);
+		}
+		return ramp;
+	}
+
+	uint32_t ImageCompare::GetBandRows() const noexcept {
+		// Four bands a thread so threads that finish early take more, small images are one band
+		if ((uint64_t)m_width * m_height < MIN_THREADED_PIXELS) { return std::max(1u, m_height); }
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		return std::max(16u, (m_height + threadCount * 4 - 1) / (threadCount * 4));
+	}
+
+	void ImageCompare::RunBands(uint32_t bandRows, const std::function<void(uint32_t band, uint32_t firstRow, uint32_t lastRow)>& job) const {
+		uint32_t bandCount = (m_height + bandRows - 1) / bandRows;
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+
+		std::atomic<uint32_t> nextBand = 0;
+		auto worker = [&]() {
+			for (uint32_t i = nextBand++; i < bandCount; i = nextBand++) { job(i, i * bandRows, std::min(i * bandRows + bandRows, m_height)); }
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, bandCount); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+}
\ No newline at end of file
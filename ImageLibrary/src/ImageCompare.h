@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <span>
+#include <functional>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	struct ImageCompareOptions {
+		// Number of threads comparing bands of rows, 0 uses every core, small images always use one
+		unsigned int threadCount = 0;
+	};
+
+	// Pixels that differ by more than a threshold and the smallest region holding all of them, empty when there are none
+	struct ChangedPixels {
+		uint64_t count = 0;
+		Utils::Rect region;
+	};
+
+	// Compares two pixel buffers of the same size channel by channel, such as an original and a re-encoded copy of it
+	// Buffers in different formats are compared at the greater bit depth with 8 bit values scaled up and a missing alpha channel opaque
+	// Differences are taken with SSE2 across bands of rows, keeping the largest difference of each pixel so thresholds can be applied without comparing again
+	class ImageCompare
+	{
+	public:
+		ImageCompare(uint32_t width, uint32_t height, Utils::PixelFormat formatA, std::span<const uint8_t> pixelsA,
+			Utils::PixelFormat formatB, std::span<const uint8_t> pixelsB, ImageCompareOptions options = ImageCompareOptions()) noexcept(false);
+		ImageCompare(Image& a, Image& b, ImageCompareOptions options = ImageCompareOptions()) noexcept(false);
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+
+		// Format the buffers were compared in and the largest value of its channels, 255 or 65535
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+		uint32_t GetChannelMaximum() const noexcept { return m_channelBytes == 2 ? 65535 : 255; }
+
+		// Largest difference of any channel of any pixel
+		uint32_t GetMaxError() const noexcept { return m_maxError; }
+
+		// Mean of the squared difference of every channel and the peak signal to noise ratio in decibels that follows, infinite when identical
+		double GetMeanSquaredError() const noexcept { return m_meanSquaredError; }
+		double GetPSNR() const noexcept;
+
+		// Count the pixels with a channel differing by more than the threshold and find the region they cover
+		// Given a buffer of 4 bytes a pixel, also draws them as RGBA8 from red through yellow to white by how much they differ, leaving the rest transparent
+		ChangedPixels ApplyThreshold(uint32_t threshold, std::span<uint8_t> visualisation = {}) const noexcept(false);
+
+	private:
+		// Colours of the visualisation from the smallest difference to the largest, as RGBA8 in one word
+		static std::array<uint32_t, 256> BuildColourRamp();
+
+		// Run a job for every band of rows spread across the threads
+		void RunBands(uint32_t bandRows, const std::function<void(uint32_t band, uint32_t firstRow, uint32_t lastRow)>& job) const;
+		uint32_t GetBandRows() const noexcept;
+
+	private:
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		int m_channelBytes;
+		ImageCompareOptions m_options;
+
+		uint32_t m_maxError = 0;
+		double m_meanSquaredError = 0.0;
+
+		// Largest channel difference of each pixel, one byte each for 8 bit comparisons and two for 16 bit
+		std::vector<uint8_t> m_errors;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numbers>
+
+#include "ImageHash.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	static constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+	static constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+	static constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+	static constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+	static constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+	// Words are read little endian, the order pixel buffers are laid out in
+	static uint64_t Read64(const uint8_t* data) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static uint32_t Read32(const uint8_t* data) {
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	static uint64_t Round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * PRIME2;
+		return std::rotl(accumulator, 31) * PRIME1;
+	}
+
+	static uint64_t MergeRound(uint64_t accumulator, uint64_t value) {
+		accumulator ^= Round(0, value);
+		return accumulator * PRIME1 + PRIME4;
+	}
+
+	uint64_t HashBytes(std::span<const uint8_t> bytes, uint64_t seed) noexcept {
+		const uint8_t* data = bytes.data();
+		const uint8_t* end = data + bytes.size();
+		uint64_t hash;
+
+		// Four independent lanes of 8 bytes each so the multiplies overlap
+		if (bytes.size() >= 32) {
+			uint64_t lanes[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+			for (; data + 32 <= end; data += 32) {
+				lanes[0] = Round(lanes[0], Read64(data));
+				lanes[1] = Round(lanes[1], Read64(data + 8));
+				lanes[2] = Round(lanes[2], Read64(data + 16));
+				lanes[3] = Round(lanes[3], Read64(data + 24));
+			}
+
+			hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+			for (uint64_t lane : lanes) { hash = MergeRound(hash, lane); }
+		}
+		else { hash = seed + PRIME5; }
+		hash += bytes.size();
+
+		// Whatever is left after the lanes
+		for (; data + 8 <= end; data += 8) {
+			hash ^= Round(0, Read64(data));
+			hash = std::rotl(hash, 27) * PRIME1 + PRIME4;
+		}
+		if (data + 4 <= end) {
+			hash ^= Read32(data) * PRIME1;
+			hash = std::rotl(hash, 23) * PRIME2 + PRIME3;
+			data += 4;
+		}
+		for (; data < end; data++) {
+			hash ^= *data * PRIME5;
+			hash = std::rotl(hash, 11) * PRIME1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= PRIME2;
+		hash ^= hash >> 29;
+		hash *= PRIME3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	uint64_t HashPixels(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) noexcept {
+		IL_TRACE_SCOPE("HashPixels");
+
+		// The size and format seed the hash of the pixels
+		uint32_t description[3] = { width, height, (uint32_t)pixelFormat };
+		return HashBytes(pixels, HashBytes(std::span<const uint8_t>((const uint8_t*)description, sizeof(description))));
+	}
+
+	// Average luma over a grid of cells, each covering at least one pixel so images smaller than the grid repeat pixels
+	template <size_t Columns, size_t Rows>
+	static std::array<float, Columns * Rows> AverageCells(const std::vector<uint8_t>& luma, uint32_t width, uint32_t height) {
+		std::array<float, Columns * Rows> cells;
+		for (size_t row = 0; row < Rows; row++) {
+			uint32_t top = (uint32_t)(row * height / Rows);
+			uint32_t bottom = std::max(top + 1, (uint32_t)((row + 1) * height / Rows));
+			for (size_t column = 0; column < Columns; column++) {
+				uint32_t left = (uint32_t)(column * width / Columns);
+				uint32_t right = std::max(left + 1, (uint32_t)((column + 1) * width / Columns));
+
+				uint64_t sum = 0;
+				for (uint32_t y = top; y < bottom; y++) {
+					const uint8_t* pixel = luma.data() + (size_t)y * width;
+					for (uint32_t x = left; x < right; x++) { sum += pixel[x]; }
+				}
+				cells[row * Columns + column] = (float)sum / ((uint64_t)(bottom - top) * (right - left));
+			}
+		}
+		return cells;
+	}
+
+	PerceptualHash ComputePerceptualHash(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) {
+		IL_TRACE_SCOPE("ComputePerceptualHash");
+
+		size_t rowSize = (size_t)width * Utils::GetPixelFormatByteSize(pixelFormat);
+		if (width == 0 || height == 0 || pixels.size() < rowSize * height) { throw new std::runtime_error("Error: Image data is smaller than its size"); }
+
+		std::vector<uint8_t> luma((size_t)width * height);
+		for (uint32_t y = 0; y < height; y++) { Utils::ConvertPixels(pixels.data() + y * rowSize, pixelFormat, luma.data() + (size_t)y * width, 1, Utils::TargetFormat::R8, width); }
+
+		PerceptualHash hash;
+
+		// Each bit is whether a cell is darker than the one to its right
+		std::array<float, 9 * 8> gradient = AverageCells<9, 8>(luma, width, height);
+		for (int row = 0; row < 8; row++) {
+			for (int column = 0; column < 8; column++) {
+				if (gradient[row * 9 + column] < gradient[row * 9 + column + 1]) { hash.dHash |= 1ULL << (row * 8 + column); }
+			}
+		}
+
+		// Only the lowest 8 frequencies along each axis of the DCT are needed, rows are transformed then columns
+		static const std::array<float, 8 * 32> cosines = []() {
+			std::array<float, 8 * 32> table;
+			for (int frequency = 0; frequency < 8; frequency++) {
+				for (int x = 0; x < 32; x++) { table[frequency * 32 + x] = (float)std::cos((2 * x + 1) * frequency * std::numbers::pi / 64.0); }
+			}
+			return table;
+		}();
+
+		std::array<float, 32 * 32> cells = AverageCells<32, 32>(luma, width, height);
+		std::array<float, 32 * 8> rows{};
+		for (int y = 0; y < 32; y++) {
+			for (int frequency = 0; frequency < 8; frequency++) {
+				for (int x = 0; x < 32; x++) { rows[y * 8 + frequency] += cosines[frequency * 32 + x] * cells[y * 32 + x]; }
+			}
+		}
+		std::array<float, 8 * 8> frequencies{};
+		for (int vertical = 0; vertical < 8; vertical++) {
+			for (int horizontal = 0; horizontal < 8; horizontal++) {
+				for (int y = 0; y < 32; y++) { frequencies[vertical * 8 + horizontal] += cosines[vertical * 32 + y] * rows[y * 8 + horizontal]; }
+			}
+		}
+
+		// The average brightness is left out of the median as it would outweigh every other frequency
+		std::array<float, 63> sorted;
+		std::copy(frequencies.begin() + 1, frequencies.end(), sorted.begin());
+		std::nth_element(sorted.begin(), sorted.begin() + 31, sorted.end());
+		float median = sorted[31];
+		for (int i = 0; i < 64; i++) {
+			if (frequencies[i] > median) { hash.pHash |= 1ULL << i; }
+		}
+
+		return hash;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <bit>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	// 64 bit XXH64 of any bytes, fast enough to run over whole pixel buffers
+	uint64_t HashBytes(std::span<const uint8_t> bytes, uint64_t seed = 0) noexcept;
+
+	// Exact hash of decoded pixels laid out as Image::GetPixelBuffer gives them, images only match if their size and format do too
+	// Files holding the same pixels hash the same however they were compressed or interlaced
+	uint64_t HashPixels(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) noexcept;
+
+	// Hashes of the luma of an image that change little when it is resized, recompressed or slightly edited, alpha is ignored
+	// dHash compares neighbouring cells of a 9x8 grid, pHash compares the lowest 8x8 frequencies of a 32x32 DCT with their median
+	struct PerceptualHash {
+		uint64_t dHash = 0;
+		uint64_t pHash = 0;
+
+		bool operator==(const PerceptualHash&) const = default;
+	};
+
+	// Works from any size copy of the image, so a reduced decode is enough
+	PerceptualHash ComputePerceptualHash(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) noexcept(false);
+
+	// Number of bits two hashes differ by, 0 for the same image and around 32 for unrelated ones
+	inline int HammingDistance(uint64_t a, uint64_t b) noexcept { return std::popcount(a ^ b); }
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "ImageSource.h"
+
+namespace ImageLibrary {
+	ImageSource ImageSource::FromFile(std::string filePath) {
+		return ImageSource(Kind::FILE, std::move(filePath));
+	}
+
+	ImageSource ImageSource::FromMemory(std::span<const uint8_t> data, std::string name, std::shared_ptr<const void> owner) {
+		ImageSource source(Kind::MEMORY, std::move(name));
+		source.m_data = data;
+		source.m_owner = std::move(owner);
+		return source;
+	}
+
+	ImageSource ImageSource::FromArchive(std::shared_ptr<const ZipArchive> archive, size_t memberIndex) {
+		ImageSource source(Kind::ARCHIVE, (archive->GetPath() / archive->GetMembers().at(memberIndex).name).string());
+		source.m_archive = std::move(archive);
+		source.m_memberIndex = memberIndex;
+		return source;
+	}
+
+	std::expected<std::span<const uint8_t>, DecodeError> ImageSource::Read(Memory::Buffer& buffer, std::shared_ptr<const void>& owner) const {
+		switch (m_kind) {
+		case Kind::MEMORY:
+			owner = m_owner;
+			return m_data;
+		case Kind::ARCHIVE:
+			owner = m_archive;
+			return m_archive->ReadMember(m_memberIndex, buffer);
+		default:
+			return std::unexpected(DecodeError{ .kind = DecodeErrorKind::FILE_UNREADABLE, .message = "Error: Files are read by the image", .offset = 0 });
+		}
+	}
+}
\ No newline at end of file
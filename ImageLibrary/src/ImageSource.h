@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <span>
+#include <memory>
+#include <expected>
+
+#include "DecodeError.h"
+#include "ZipArchive.h"
+#include "Memory.h"
+
+namespace ImageLibrary {
+	// Where an image's file comes from, a path on disk, bytes already in memory or a member of a ZIP archive
+	// Only images from a path are matched against the disk cache as the others have no size and time to check
+	class ImageSource
+	{
+	public:
+		static ImageSource FromFile(std::string filePath);
+
+		// The bytes must stay valid until the image has been read, which the owner can make sure of, the name is only used to describe the image
+		static ImageSource FromMemory(std::span<const uint8_t> data, std::string name = "<memory>", std::shared_ptr<const void> owner = nullptr);
+
+		// Named as the archive's path followed by the member's name
+		static ImageSource FromArchive(std::shared_ptr<const ZipArchive> archive, size_t memberIndex);
+
+		bool IsFile() const noexcept { return m_kind == Kind::FILE; }
+		const std::string& GetName() const noexcept { return m_name; }
+
+		// Bytes of a source that is not a file, inflated into the buffer if the source is a compressed archive member
+		// The owner is set to whatever keeps the bytes alive besides the buffer
+		std::expected<std::span<const uint8_t>, DecodeError> Read(Memory::Buffer& buffer, std::shared_ptr<const void>& owner) const;
+
+	private:
+		enum class Kind {
+			FILE,
+			MEMORY,
+			ARCHIVE
+		};
+
+		ImageSource(Kind kind, std::string name) : m_kind(kind), m_name(std::move(name)) {}
+
+	private:
+		Kind m_kind;
+		std::string m_name;
+		std::span<const uint8_t> m_data;
+		std::shared_ptr<const void> m_owner;
+		std::shared_ptr<const ZipArchive> m_archive;
+		size_t m_memberIndex = 0;
+	};
+}
\ No newline at end of file
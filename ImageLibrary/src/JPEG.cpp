@@ -0,0 +1,1171 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JPEG_SSE2
+#endif
+
+#include "JPEG.h"
+#include "FileWindow.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Marker codes, each follows a 0xFF byte
+	static constexpr uint8_t SOF0 = 0xC0;
+	static constexpr uint8_t SOF1 = 0xC1;
+	static constexpr uint8_t SOF2 = 0xC2;
+	static constexpr uint8_t DHT = 0xC4;
+	static constexpr uint8_t RST0 = 0xD0;
+	static constexpr uint8_t RST7 = 0xD7;
+	static constexpr uint8_t SOI = 0xD8;
+	static constexpr uint8_t EOI = 0xD9;
+	static constexpr uint8_t SOS = 0xDA;
+	static constexpr uint8_t DQT = 0xDB;
+	static constexpr uint8_t DRI = 0xDD;
+	static constexpr uint8_t APP1 = 0xE1;
+	static constexpr uint8_t APP2 = 0xE2;
+	static constexpr uint8_t APP14 = 0xEE;
+	static constexpr uint8_t TEM = 0x01;
+
+	// Other frame types are lossless, hierarchical or arithmetic coded
+	static bool IsUnsupportedSOF(uint8_t marker) {
+		return marker == 0xC3 || (marker >= 0xC5 && marker <= 0xC7) || (marker >= 0xC9 && marker <= 0xCB) || (marker >= 0xCD && marker <= 0xCF);
+	}
+
+	// Natural order index of each coefficient in zigzag order
+	static constexpr std::array<uint8_t, 64> ZIGZAG = {
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+	};
+
+	// Images with fewer pixels are converted to RGB on one thread as starting more would take longer
+	static constexpr uint64_t MIN_THREADED_PIXELS = 1 << 18;
+
+	// Larger ICC profiles are ignored, real ones are rarely more than a few hundred KB
+	static constexpr size_t MAX_ICC_PROFILE_SIZE = 4 << 20;
+
+	static uint16_t ReadBigEndian16(const uint8_t* data) {
+		return (uint16_t)((data[0] << 8) | data[1]);
+	}
+
+	static uint8_t ClampToByte(int value) {
+		return (uint8_t)std::clamp(value, 0, 255);
+	}
+
+	// Reads entropy coded data through a 64 bit buffer with the next bit at the top, zeros are read once the data or a marker is reached
+	// Eight bytes at a time are added while none of them is 0xFF, found for all eight at once, so stuffed bytes only slow down their own word
+	class JPEG::BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, const uint8_t* end) : m_data(data), m_end(end) { Refill(); }
+
+		// Make sure at least 32 bits are held, enough for any code and the bits that follow it
+		void Fill() { if (m_count < 32) { Refill(); } }
+
+		uint32_t Peek(int count) const { return (uint32_t)(m_bits >> (64 - count)); }
+		void Skip(int count) { m_bits <<= count; m_count -= count; }
+		uint32_t Read(int count) {
+			uint32_t value = Peek(count);
+			Skip(count);
+			return value;
+		}
+
+		// Read a value of the given size in bits, the lower half of the values of each size are negative
+		int Receive(int size) {
+			uint32_t value = Read(size);
+			return (value < (1u << (size - 1)) ? (int)value - (1 << size) + 1 : (int)value);
+		}
+
+		// Decode the next Huffman coded symbol, -1 if no code matches
+		int Decode(const HuffmanTable& table) {
+			Fill();
+			uint32_t lookahead = Peek(HuffmanTable::LOOKAHEAD_BITS);
+			int length = table.lookaheadLength[lookahead];
+			if (length != 0) {
+				Skip(length);
+				return table.lookaheadSymbol[lookahead];
+			}
+
+			uint32_t bits = Peek(16);
+			for (length = HuffmanTable::LOOKAHEAD_BITS + 1; length <= 16; length++) {
+				int32_t code = (int32_t)(bits >> (16 - length));
+				if (code <= table.maxCode[length]) {
+					Skip(length);
+					return table.symbols[code + table.valueOffset[length]];
+				}
+			}
+			return -1;
+		}
+
+		// Whether any of the zeros added past the end of the data have been read
+		bool Overran() const { return m_count < m_paddingBits; }
+
+	private:
+		void Refill() {
+			if (m_end - m_data >= 8) {
+				uint64_t word;
+				memcpy(&word, m_data, sizeof(word));
+				if constexpr (std::endian::native == std::endian::little) { word = std::byteswap(word); }
+
+				// The bits below the whole bytes taken are the same as the next refill adds so can be left in
+				uint64_t inverted = ~word;
+				bool hasFF = ((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) != 0;
+				if (!hasFF) {
+					m_bits |= word >> m_count;
+					int bytes = (63 - m_count) >> 3;
+					m_data += bytes;
+					m_count += bytes * 8;
+					return;
+				}
+			}
+
+			while (m_count <= 56) {
+				uint64_t byte = 0;
+				if (m_data < m_end && m_data[0] != 0xFF) { byte = *m_data++; }
+				else if (m_end - m_data >= 2 && m_data[1] == 0x00) {
+					byte = 0xFF;
+					m_data += 2;
+				}
+				else { m_paddingBits += 8; }
+
+				m_bits |= byte << (56 - m_count);
+				m_count += 8;
+			}
+		}
+
+	private:
+		const uint8_t* m_data;
+		const uint8_t* m_end;
+		uint64_t m_bits = 0;
+		int m_count = 0;
+		int64_t m_paddingBits = 0;
+	};
+
+	std::expected<DecodedImage, DecodeError> JPEG::Decode(std::string filePath) {
+		return Decode(ImageSource::FromFile(filePath));
+	}
+
+	std::expected<DecodedImage, DecodeError> JPEG::Decode(const ImageSource& source) {
+		JPEG image(source, std::nothrow);
+		if (image.m_error) { return std::unexpected(*image.m_error); }
+
+		// Take the buffer rather than copying it unless it is mapped from the cache
+		std::span<const uint8_t> pixels = image.GetPixelBuffer();
+		DecodedImage decoded{ .width = image.m_width, .height = image.m_height, .pixelFormat = image.m_pixelFormat };
+		if (image.IsCached()) { decoded.pixels.assign(pixels.begin(), pixels.end()); }
+		else { decoded.pixels = std::move(image.m_pixelBuffer); }
+		decoded.memoryStats = image.m_memoryStats;
+
+		return decoded;
+	}
+
+	std::expected<DecodedImage, DecodeError> JPEG::DecodeReduced(std::string filePath, uint32_t reduction) {
+		IL_TRACE_SCOPE("JPEG::DecodeReduced");
+
+		if (reduction != 1 && reduction != 2 && reduction != 4 && reduction != 8) {
+			return std::unexpected(DecodeError{ .kind = DecodeErrorKind::UNSUPPORTED, .message = "Error: Reduction must be 1, 2, 4 or 8", .offset = 0 });
+		}
+
+		JPEG image(filePath, reduction, std::nothrow);
+		if (image.m_error) { return std::unexpected(*image.m_error); }
+
+		image.GetPixelBuffer();
+		DecodedImage decoded{ .width = image.m_width, .height = image.m_height, .pixelFormat = image.m_pixelFormat };
+		decoded.pixels = std::move(image.m_pixelBuffer);
+		decoded.memoryStats = image.m_memoryStats;
+
+		return decoded;
+	}
+
+	std::expected<JPEGInfo, DecodeError> JPEG::Probe(std::string filePath) {
+		IL_TRACE_SCOPE("JPEG::Probe");
+
+		auto fail = [](DecodeErrorKind kind, const char* message, uint64_t offset) {
+			return std::unexpected(DecodeError{ .kind = kind, .message = message, .offset = offset });
+		};
+
+		FileWindow file(filePath);
+		if (!file.IsOpen()) { return fail(DecodeErrorKind::FILE_UNREADABLE, "Error: File could not be opened", 0); }
+
+		const uint8_t* data = file.Read(0, 2);
+		if (!data || data[0] != 0xFF || data[1] != SOI) { return fail(DecodeErrorKind::NOT_JPEG, "Error: JPEG start of image marker is missing", 0); }
+
+		// Walk the markers up to the first scan, the restart interval is often given after the frame header
+		JPEGInfo info;
+		bool frameFound = false;
+		uint64_t offset = 2;
+		while ((data = file.Read(offset, 4)) != nullptr) {
+			if (data[0] != 0xFF) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: Expected a JPEG marker", offset); }
+
+			// Fill bytes and markers without a length
+			uint8_t marker = data[1];
+			if (marker == 0xFF) {
+				offset++;
+				continue;
+			}
+			if ((marker >= RST0 && marker <= RST7) || marker == TEM) {
+				offset += 2;
+				continue;
+			}
+			if (marker == SOS || marker == EOI) {
+				if (!frameFound) { return fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: JPEG frame header is missing", offset); }
+				return info;
+			}
+
+			uint16_t length = ReadBigEndian16(data + 2);
+			if (length < 2) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG marker length is invalid", offset); }
+			uint64_t dataOffset = offset + 4;
+			uint32_t size = length - 2u;
+
+			if (IsUnsupportedSOF(marker)) { return fail(DecodeErrorKind::UNSUPPORTED, "Error: Only Huffman coded baseline and progressive JPEGs are supported", offset); }
+			switch (marker) {
+			case SOF0:
+			case SOF1:
+			case SOF2:
+				if (frameFound) { return fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: JPEG has more than one frame", offset); }
+				if (size < 6 || (data = file.Read(dataOffset, 6)) == nullptr) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG frame header is invalid", offset); }
+				if (data[0] != 8) { return fail(DecodeErrorKind::UNSUPPORTED, "Error: Only 8 bit JPEGs are supported", offset); }
+				info.height = ReadBigEndian16(data + 1);
+				info.width = ReadBigEndian16(data + 3);
+				info.componentCount = data[5];
+				info.progressive = (marker == SOF2);
+				info.pixelFormat = Utils::RGB8;
+				if (info.width == 0 || info.height == 0) { return fail(DecodeErrorKind::UNSUPPORTED, "Error: Image dimensions invalid", offset); }
+				frameFound = true;
+				break;
+			case DRI:
+				if (size == 2 && (data = file.Read(dataOffset, 2)) != nullptr) { info.restartInterval = ReadBigEndian16(data); }
+				break;
+			case APP1:
+				if (size >= 6 && (data = file.Read(dataOffset, 6)) != nullptr && memcmp(data, "Exif\0\0", 6) == 0) {
+					info.exifOffset = dataOffset + 6;
+					info.exifSize = size - 6;
+				}
+				break;
+			}
+
+			offset = dataOffset + size;
+		}
+
+		// Truncation after the frame header is not an error
+		if (!frameFound) { return fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file", offset); }
+		return info;
+	}
+
+	bool JPEG::ReadFile() {
+		IL_TRACE_SCOPE("JPEG::ReadFile");
+		Memory::Scope memoryScope(m_memoryStats);
+
+		m_blockSize = 8 / m_reduction;
+		if (!ParseMarkers()) { return false; }
+		ResolveColourSpace();
+		if (!Finish()) { return false; }
+
+		ReleaseFileData();
+		return true;
+	}
+
+	bool JPEG::ParseMarkers() {
+		const uint8_t* data = m_fileData.data();
+		size_t size = m_fileData.size();
+		if (size < 2 || data[0] != 0xFF || data[1] != SOI) { return Fail(DecodeErrorKind::NOT_JPEG, "Error: JPEG start of image marker is missing"); }
+
+		m_position = 2;
+		while (true) {
+			m_markerStart = m_position;
+
+			// A file missing its end of image marker after a scan is only missing the marker
+			if (m_position >= size) {
+				if (m_scanDecoded) { break; }
+				return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file");
+			}
+			if (data[m_position] != 0xFF) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Expected a JPEG marker"); }
+
+			// Markers can be preceded by any number of fill bytes
+			while (m_position < size && data[m_position] == 0xFF) { m_position++; }
+			if (m_position >= size) { return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file"); }
+			uint8_t marker = data[m_position++];
+			if (marker == EOI) { break; }
+			if ((marker >= RST0 && marker <= RST7) || marker == TEM) { continue; }
+
+			// Every other marker gives the length of its segment
+			if (size - m_position < 2) { return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file"); }
+			uint16_t length = ReadBigEndian16(data + m_position);
+			if (length < 2) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG marker length is invalid"); }
+			if (size - m_position < length) { return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file"); }
+			std::span<const uint8_t> segment(data + m_position + 2, length - 2u);
+			m_position += length;
+
+			if (IsUnsupportedSOF(marker)) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Only Huffman coded baseline and progressive JPEGs are supported"); }
+			switch (marker) {
+			case SOF0:
+			case SOF1:
+			case SOF2:
+				if (!ParseSOF(segment, marker)) { return false; }
+				break;
+			case DHT:
+				if (!ParseDHT(segment)) { return false; }
+				break;
+			case DQT:
+				if (!ParseDQT(segment)) { return false; }
+				break;
+			case DRI:
+				if (!ParseDRI(segment)) { return false; }
+				break;
+			case SOS:
+				if (!ParseSOS(segment)) { return false; }
+				break;
+			case APP2:
+				ParseAPP2(segment);
+				break;
+			case APP14:
+				ParseAPP14(segment);
+				break;
+			}
+		}
+
+		if (!m_scanDecoded) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: JPEG has no image data"); }
+		return true;
+	}
+
+	bool JPEG::ParseSOF(std::span<const uint8_t> data, uint8_t marker) {
+		if (m_frameFound) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: JPEG has more than one frame"); }
+		if (data.size() < 6) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG frame header is invalid"); }
+		if (data[0] != 8) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Only 8 bit JPEGs are supported"); }
+
+		m_fullHeight = ReadBigEndian16(data.data() + 1);
+		m_fullWidth = ReadBigEndian16(data.data() + 3);
+		if (m_fullWidth == 0) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Image dimensions invalid"); }
+		if (m_fullHeight == 0) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Image height given after the first scan is not supported"); }
+
+		uint8_t componentCount = data[5];
+		if (componentCount != 1 && componentCount != 3 && componentCount != 4) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Only JPEGs with 1, 3 or 4 components are supported"); }
+		if (data.size() != 6 + 3 * (size_t)componentCount) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG frame header is invalid"); }
+
+		for (uint8_t i = 0; i < componentCount; i++) {
+			const uint8_t* entry = data.data() + 6 + i * 3;
+			Component component{ .id = entry[0], .horizontalSampling = (uint8_t)(entry[1] >> 4), .verticalSampling = (uint8_t)(entry[1] & 15), .quantisationTable = entry[2] };
+			bool valid = component.horizontalSampling >= 1 && component.horizontalSampling <= 4 && component.verticalSampling >= 1 && component.verticalSampling <= 4 && component.quantisationTable < 4;
+			for (const Component& other : m_components) { valid = valid && other.id != component.id; }
+			if (!valid) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG frame header is invalid"); }
+
+			m_maxHorizontalSampling = std::max(m_maxHorizontalSampling, component.horizontalSampling);
+			m_maxVerticalSampling = std::max(m_maxVerticalSampling, component.verticalSampling);
+			m_components.push_back(std::move(component));
+		}
+
+		m_width = (m_fullWidth + m_reduction - 1) / m_reduction;
+		m_height = (m_fullHeight + m_reduction - 1) / m_reduction;
+		if (m_width > Utils::PNG_APP_MAX_DIMENSION || m_height > Utils::PNG_APP_MAX_DIMENSION) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Application cannot display image"); }
+
+		m_progressive = (marker == SOF2);
+		m_mcusPerLine = (m_fullWidth + 8 * m_maxHorizontalSampling - 1) / (8 * m_maxHorizontalSampling);
+		m_mcusPerColumn = (m_fullHeight + 8 * m_maxVerticalSampling - 1) / (8 * m_maxVerticalSampling);
+
+		for (Component& component : m_components) {
+			// Upsampling only repeats each sample a whole number of times
+			if (m_maxHorizontalSampling % component.horizontalSampling != 0 || m_maxVerticalSampling % component.verticalSampling != 0) {
+				return Fail(DecodeErrorKind::UNSUPPORTED, "Error: JPEG sampling factors are not supported");
+			}
+
+			// Subsampled components of a reduced decode keep more of each block in place of being upsampled as much, up to the whole block
+			uint32_t horizontalFactor = m_maxHorizontalSampling / component.horizontalSampling, verticalFactor = m_maxVerticalSampling / component.verticalSampling;
+			uint32_t scale = std::min(horizontalFactor, verticalFactor);
+			component.blockSize = m_blockSize;
+			while (scale % 2 == 0 && component.blockSize < 8) {
+				component.blockSize *= 2;
+				scale /= 2;
+			}
+			component.horizontalFactor = horizontalFactor * m_blockSize / component.blockSize;
+			component.verticalFactor = verticalFactor * m_blockSize / component.blockSize;
+
+			uint32_t fullWidth = (m_fullWidth * component.horizontalSampling + m_maxHorizontalSampling - 1) / m_maxHorizontalSampling;
+			uint32_t fullHeight = (m_fullHeight * component.verticalSampling + m_maxVerticalSampling - 1) / m_maxVerticalSampling;
+			component.blocksPerLine = m_mcusPerLine * component.horizontalSampling;
+			component.blocksPerColumn = m_mcusPerColumn * component.verticalSampling;
+			component.scanBlocksPerLine = (fullWidth + 7) / 8;
+			component.scanBlocksPerColumn = (fullHeight + 7) / 8;
+			component.width = (fullWidth * component.blockSize + 7) / 8;
+			component.height = (fullHeight * component.blockSize + 7) / 8;
+
+			component.planeStride = (size_t)component.blocksPerLine * component.blockSize;
+			component.plane.resize(component.planeStride * component.blocksPerColumn * component.blockSize);
+			if (m_progressive) { component.coefficients.resize((size_t)component.blocksPerLine * component.blocksPerColumn * 64); }
+		}
+
+		m_pixelFormat = Utils::RGB8;
+		m_frameFound = true;
+		return true;
+	}
+
+	bool JPEG::BuildHuffmanTable(HuffmanTable& table, const uint8_t* counts, std::span<const uint8_t> symbols, bool ac) {
+		constexpr int lookaheadBits = HuffmanTable::LOOKAHEAD_BITS;
+		table.lookaheadLength.fill(0);
+		table.lookaheadValue.fill(0);
+		std::copy(symbols.begin(), symbols.end(), table.symbols.begin());
+
+		// Codes are given out in order of length, each length starting from double the code after the last one
+		int32_t code = 0;
+		int32_t index = 0;
+		for (int length = 1; length <= 16; length++) {
+			table.valueOffset[length] = index - code;
+			for (int i = 0; i < counts[length - 1]; i++, code++, index++) {
+				// More codes than fit in the length means the counts are invalid
+				if (code >= (1 << length)) { return false; }
+				if (length > lookaheadBits) { continue; }
+
+				// Every lookahead starting with the code
+				int32_t first = code << (lookaheadBits - length);
+				for (int32_t lookahead = first; lookahead < first + (1 << (lookaheadBits - length)); lookahead++) {
+					table.lookaheadLength[lookahead] = (uint8_t)length;
+					table.lookaheadSymbol[lookahead] = symbols[index];
+
+					// Nonzero AC coefficients whose value bits also fit are decoded in one step
+					int run = symbols[index] >> 4, size = symbols[index] & 15;
+					if (!ac || size == 0 || length + size > lookaheadBits) { continue; }
+					int32_t bits = (lookahead >> (lookaheadBits - length - size)) & ((1 << size) - 1);
+					int32_t value = (bits < (1 << (size - 1)) ? bits - (1 << size) + 1 : bits);
+					table.lookaheadValue[lookahead] = value * 256 + run * 16 + length + size;
+				}
+			}
+			table.maxCode[length] = (counts[length - 1] != 0 ? code - 1 : -1);
+			code <<= 1;
+		}
+
+		table.defined = true;
+		return true;
+	}
+
+	bool JPEG::ParseDHT(std::span<const uint8_t> data) {
+		while (!data.empty()) {
+			if (data.size() < 17) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG Huffman table is invalid"); }
+			uint8_t tableClass = data[0] >> 4, id = data[0] & 15;
+			size_t symbolCount = 0;
+			for (int i = 0; i < 16; i++) { symbolCount += data[1 + i]; }
+			if (tableClass > 1 || id > 3 || symbolCount > 256 || data.size() < 17 + symbolCount) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG Huffman table is invalid"); }
+
+			HuffmanTable& table = (tableClass == 0 ? m_dcTables[id] : m_acTables[id]);
+			if (!BuildHuffmanTable(table, data.data() + 1, data.subspan(17, symbolCount), tableClass == 1)) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG Huffman table is invalid"); }
+			data = data.subspan(17 + symbolCount);
+		}
+		return true;
+	}
+
+	bool JPEG::ParseDQT(std::span<const uint8_t> data) {
+		while (!data.empty()) {
+			uint8_t precision = data[0] >> 4, id = data[0] & 15;
+			if (precision > 1 || id > 3 || data.size() < 1 + 64 * (precision + 1u)) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG quantisation table is invalid"); }
+
+			// Values are stored in zigzag order
+			for (int k = 0; k < 64; k++) { m_quantisationTables[id][ZIGZAG[k]] = (precision == 0 ? data[1 + k] : ReadBigEndian16(data.data() + 1 + k * 2)); }
+			m_quantisationDefined[id] = true;
+			data = data.subspan(1 + 64 * (precision + 1u));
+		}
+		return true;
+	}
+
+	bool JPEG::ParseDRI(std::span<const uint8_t> data) {
+		if (data.size() != 2) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG restart interval is invalid"); }
+		m_restartInterval = ReadBigEndian16(data.data());
+		return true;
+	}
+
+	void JPEG::ParseAPP2(std::span<const uint8_t> data) {
+		// ICC profiles too large for one marker are split between several, numbered from 1
+		static constexpr char identifier[] = "ICC_PROFILE";
+		if (data.size() < sizeof(identifier) + 2 || memcmp(data.data(), identifier, sizeof(identifier)) != 0) { return; }
+		uint8_t sequence = data[sizeof(identifier)], count = data[sizeof(identifier) + 1];
+		if (sequence == 0 || sequence > count) { return; }
+
+		if (m_iccChunks.size() != count) { m_iccChunks.assign(count, std::vector<uint8_t>()); }
+		m_iccChunks[sequence - 1].assign(data.begin() + sizeof(identifier) + 2, data.end());
+	}
+
+	void JPEG::ParseAPP14(std::span<const uint8_t> data) {
+		// Adobe marker with its version and flags before the colour transform
+		if (data.size() < 12 || memcmp(data.data(), "Adobe", 5) != 0) { return; }
+		m_adobeTransform = data[11];
+	}
+
+	void JPEG::ResolveColourSpace() {
+		// CMYK profiles cannot be used once the image is converted to RGB
+		if (m_iccChunks.empty() || m_components.size() == 4) { return; }
+
+		std::vector<uint8_t> profile;
+		for (const std::vector<uint8_t>& chunk : m_iccChunks) {
+			if (chunk.empty() || profile.size() + chunk.size() > MAX_ICC_PROFILE_SIZE) { return; }
+			profile.insert(profile.end(), chunk.begin(), chunk.end());
+		}
+		m_colourSpace = ColourSpace::FromICCProfile(profile);
+	}
+
+	bool JPEG::ParseSOS(std::span<const uint8_t> data) {
+		if (!m_frameFound) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: JPEG scan comes before the frame header"); }
+		if (data.empty() || data[0] < 1 || data[0] > 4 || data.size() != 1 + 2 * (size_t)data[0] + 3) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan header is invalid"); }
+
+		Scan scan;
+		int blocksPerMCU = 0;
+		for (uint8_t i = 0; i < data[0]; i++) {
+			const uint8_t* entry = data.data() + 1 + i * 2;
+			auto it = std::find_if(m_components.begin(), m_components.end(), [&](const Component& component) { return component.id == entry[0]; });
+			if (it == m_components.end() || (entry[1] >> 4) > 3 || (entry[1] & 15) > 3) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan header is invalid"); }
+
+			scan.components.push_back(ScanComponent{ .component = (size_t)(it - m_components.begin()), .dcTable = (uint8_t)(entry[1] >> 4), .acTable = (uint8_t)(entry[1] & 15) });
+			blocksPerMCU += it->horizontalSampling * it->verticalSampling;
+		}
+		const uint8_t* spectral = data.data() + 1 + data[0] * 2;
+		scan.spectralStart = spectral[0];
+		scan.spectralEnd = spectral[1];
+		scan.approximationHigh = spectral[2] >> 4;
+		scan.approximationLow = spectral[2] & 15;
+
+		if (scan.components.size() > 1 && blocksPerMCU > 10) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan header is invalid"); }
+		if (m_progressive) {
+			// DC scans can be interleaved, AC scans are of one component and one band of frequencies
+			bool dcScan = (scan.spectralStart == 0);
+			bool valid = (dcScan ? scan.spectralEnd == 0 : scan.spectralEnd >= scan.spectralStart && scan.spectralEnd <= 63 && scan.components.size() == 1) && scan.approximationLow <= 13;
+			if (!valid) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan header is invalid"); }
+		}
+		else {
+			// Baseline scans always hold every frequency
+			scan.spectralStart = 0;
+			scan.spectralEnd = 63;
+			scan.approximationHigh = 0;
+			scan.approximationLow = 0;
+		}
+
+		for (const ScanComponent& scanComponent : scan.components) {
+			bool needsDC = (scan.spectralStart == 0 && scan.approximationHigh == 0);
+			bool needsAC = (scan.spectralEnd != 0);
+			if ((needsDC && !m_dcTables[scanComponent.dcTable].defined) || (needsAC && !m_acTables[scanComponent.acTable].defined)) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan uses a Huffman table that is not defined");
+			}
+
+			Component& component = m_components[scanComponent.component];
+			if (!component.multipliersSet) {
+				if (!m_quantisationDefined[component.quantisationTable]) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: JPEG scan uses a quantisation table that is not defined"); }
+				SetMultipliers(component);
+			}
+		}
+
+		if (!DecodeScan(scan)) { return false; }
+		m_scanDecoded = true;
+		return true;
+	}
+
+	// Scale of each row and column of coefficients the AAN inverse DCT leaves to be applied with dequantisation
+	static double AANScale(int k) {
+		return (k == 0 ? 1.0 : std::cos(k * 3.14159265358979323846 / 16.0) * std::sqrt(2.0));
+	}
+
+	void JPEG::SetMultipliers(Component& component) {
+		const std::array<uint16_t, 64>& table = m_quantisationTables[component.quantisationTable];
+		for (int row = 0; row < 8; row++) {
+			for (int column = 0; column < 8; column++) {
+				// Reduced transforms are written out in full so only need dequantising
+				double scale = (component.blockSize == 8 ? AANScale(row) * AANScale(column) / 8.0 : 1.0);
+				component.multipliers[row * 8 + column] = (float)(table[row * 8 + column] * scale);
+			}
+		}
+		component.multipliersSet = true;
+	}
+
+	bool JPEG::SkipScan(const Scan& scan) const {
+		// Blocks reduced to a single pixel only use their DC coefficient so every AC scan, which is always of one component, can be left out
+		// Bands of other reductions are not skipped as a later refinement scan covering some of their frequencies depends on every earlier one
+		return m_progressive && scan.spectralStart != 0 && m_components[scan.components[0].component].blockSize == 1;
+	}
+
+	bool JPEG::DecodeScan(const Scan& scan) {
+		IL_TRACE_SCOPE("JPEG::DecodeScan");
+
+		// Find where each restart interval starts and where the scan ends, at the first marker that is not a restart
+		const uint8_t* fileStart = m_fileData.data();
+		const uint8_t* fileEnd = fileStart + m_fileData.size();
+		std::vector<std::span<const uint8_t>> intervals;
+		const uint8_t* intervalStart = fileStart + m_position;
+		for (const uint8_t* p = intervalStart;;) {
+			p = static_cast<const uint8_t*>(memchr(p, 0xFF, fileEnd - p));
+			if (!p || p + 1 >= fileEnd) { return SetError(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file", m_fileData.size()); }
+
+			// Stuffed zero bytes and fill bytes before a marker
+			if (p[1] == 0x00) {
+				p += 2;
+				continue;
+			}
+			if (p[1] == 0xFF) {
+				p++;
+				continue;
+			}
+
+			intervals.push_back(std::span<const uint8_t>(intervalStart, p));
+			if (p[1] < RST0 || p[1] > RST7) {
+				m_position = p - fileStart;
+				break;
+			}
+			p += 2;
+			intervalStart = p;
+		}
+
+		if (SkipScan(scan)) { return true; }
+
+		// Only a scan of one component leaves out the blocks past the edge of the image
+		const Component& first = m_components[scan.components[0].component];
+		uint64_t mcuCount = (scan.components.size() == 1 ? (uint64_t)first.scanBlocksPerLine * first.scanBlocksPerColumn : (uint64_t)m_mcusPerLine * m_mcusPerColumn);
+		uint64_t intervalMCUs = (m_restartInterval != 0 ? m_restartInterval : mcuCount);
+		size_t intervalCount = (size_t)((mcuCount + intervalMCUs - 1) / intervalMCUs);
+		if (intervals.size() < intervalCount) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: JPEG restart markers are missing", m_position); }
+
+		// Intervals cover separate blocks so can be decoded in any order
+		std::atomic<uint64_t> failedOffset = UINT64_MAX;
+		bool decoded = ForEach(intervalCount, [&](size_t i) {
+			uint64_t firstMCU = i * intervalMCUs;
+			if (DecodeInterval(scan, firstMCU, std::min(firstMCU + intervalMCUs, mcuCount), intervals[i].data(), intervals[i].data() + intervals[i].size())) { return true; }
+			failedOffset = intervals[i].data() - fileStart;
+			return false;
+		});
+		if (!decoded) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: JPEG entropy coded data is invalid", failedOffset); }
+
+		return true;
+	}
+
+	bool JPEG::DecodeInterval(const Scan& scan, uint64_t firstMCU, uint64_t endMCU, const uint8_t* data, const uint8_t* end) {
+		// Predictors and end of band runs start again at every restart
+		BitReader reader(data, end);
+		std::array<int, 4> predictors{};
+		uint32_t endOfBandRun = 0;
+
+		for (uint64_t mcu = firstMCU; mcu < endMCU; mcu++) {
+			if (scan.components.size() == 1) {
+				const Component& component = m_components[scan.components[0].component];
+				uint32_t blockX = (uint32_t)(mcu % component.scanBlocksPerLine), blockY = (uint32_t)(mcu / component.scanBlocksPerLine);
+				if (!DecodeBlock(reader, scan, scan.components[0], predictors[0], endOfBandRun, blockX, blockY)) { return false; }
+				continue;
+			}
+
+			// Interleaved MCUs hold each component's blocks in turn
+			uint32_t mcuX = (uint32_t)(mcu % m_mcusPerLine), mcuY = (uint32_t)(mcu / m_mcusPerLine);
+			for (size_t i = 0; i < scan.components.size(); i++) {
+				const Component& component = m_components[scan.components[i].component];
+				for (uint32_t v = 0; v < component.verticalSampling; v++) {
+					for (uint32_t h = 0; h < component.horizontalSampling; h++) {
+						uint32_t blockX = mcuX * component.horizontalSampling + h, blockY = mcuY * component.verticalSampling + v;
+						if (!DecodeBlock(reader, scan, scan.components[i], predictors[i], endOfBandRun, blockX, blockY)) { return false; }
+					}
+				}
+			}
+		}
+
+		return !reader.Overran();
+	}
+
+	bool JPEG::DecodeBlock(BitReader& reader, const Scan& scan, const ScanComponent& scanComponent, int& predictor, uint32_t& endOfBandRun, uint32_t blockX, uint32_t blockY) {
+		Component& component = m_components[scanComponent.component];
+
+		// Baseline blocks are transformed as soon as they are decoded
+		if (!m_progressive) {
+			alignas(16) int16_t block[64] = {};
+			if (!DecodeBaselineBlock(reader, m_dcTables[scanComponent.dcTable], m_acTables[scanComponent.acTable], predictor, block)) { return false; }
+			TransformBlock(component, block, blockX, blockY);
+			return true;
+		}
+
+		int16_t* block = component.coefficients.data() + ((size_t)blockY * component.blocksPerLine + blockX) * 64;
+		if (scan.spectralStart == 0) {
+			if (scan.approximationHigh == 0) { return DecodeDCFirst(reader, m_dcTables[scanComponent.dcTable], predictor, block, scan.approximationLow); }
+			DecodeDCRefine(reader, block, scan.approximationLow);
+			return true;
+		}
+		if (scan.approximationHigh == 0) { return DecodeACFirst(reader, m_acTables[scanComponent.acTable], endOfBandRun, block, scan.spectralStart, scan.spectralEnd, scan.approximationLow); }
+		return DecodeACRefine(reader, m_acTables[scanComponent.acTable], endOfBandRun, block, scan.spectralStart, scan.spectralEnd, scan.approximationLow);
+	}
+
+	bool JPEG::DecodeBaselineBlock(BitReader& reader, const HuffmanTable& dcTable, const HuffmanTable& acTable, int& predictor, int16_t* block) {
+		int size = reader.Decode(dcTable);
+		if (size < 0 || size > 11) { return false; }
+		if (size != 0) { predictor += reader.Receive(size); }
+		block[0] = (int16_t)predictor;
+
+		for (int k = 1; k < 64;) {
+			// Short codes with their value bits are looked up together
+			reader.Fill();
+			int32_t lookahead = acTable.lookaheadValue[reader.Peek(HuffmanTable::LOOKAHEAD_BITS)];
+			if (lookahead != 0) {
+				k += (lookahead >> 4) & 15;
+				if (k > 63) { return false; }
+				reader.Skip(lookahead & 15);
+				block[ZIGZAG[k++]] = (int16_t)(lookahead >> 8);
+				continue;
+			}
+
+			int symbol = reader.Decode(acTable);
+			if (symbol < 0) { return false; }
+			int run = symbol >> 4;
+			size = symbol & 15;
+
+			// A run of 15 without a value skips 16 zeros, any other is the end of the block
+			if (size == 0) {
+				if (run != 15) { break; }
+				k += 16;
+				continue;
+			}
+
+			k += run;
+			if (k > 63) { return false; }
+			block[ZIGZAG[k++]] = (int16_t)reader.Receive(size);
+		}
+		return true;
+	}
+
+	bool JPEG::DecodeDCFirst(BitReader& reader, const HuffmanTable& table, int& predictor, int16_t* block, int low) {
+		int size = reader.Decode(table);
+		if (size < 0 || size > 11) { return false; }
+		if (size != 0) { predictor += reader.Receive(size); }
+		block[0] = (int16_t)(predictor * (1 << low));
+		return true;
+	}
+
+	void JPEG::DecodeDCRefine(BitReader& reader, int16_t* block, int low) {
+		reader.Fill();
+		if (reader.Read(1)) { block[0] |= (int16_t)(1 << low); }
+	}
+
+	bool JPEG::DecodeACFirst(BitReader& reader, const HuffmanTable& table, uint32_t& endOfBandRun, int16_t* block, int start, int end, int low) {
+		// Blocks in an end of band run have no more coefficients in this band
+		if (endOfBandRun > 0) {
+			endOfBandRun--;
+			return true;
+		}
+
+		for (int k = start; k <= end;) {
+			int symbol = reader.Decode(table);
+			if (symbol < 0) { return false; }
+			int run = symbol >> 4, size = symbol & 15;
+
+			if (size != 0) {
+				k += run;
+				if (k > end) { return false; }
+				block[ZIGZAG[k++]] = (int16_t)(reader.Receive(size) * (1 << low));
+			}
+			else if (run < 15) {
+				// The run counts this block as well as the ones that follow
+				endOfBandRun = (1u << run) - 1;
+				if (run != 0) { endOfBandRun += reader.Read(run); }
+				break;
+			}
+			else { k += 16; }
+		}
+		return true;
+	}
+
+	// Add the next bit of a coefficient already known to be nonzero, moving it away from zero
+	template <typename Reader>
+	static void RefineCoefficient(Reader& reader, int16_t& coefficient, int bit) {
+		reader.Fill();
+		if (reader.Read(1) && (coefficient & bit) == 0) { coefficient += (int16_t)(coefficient >= 0 ? bit : -bit); }
+	}
+
+	bool JPEG::DecodeACRefine(BitReader& reader, const HuffmanTable& table, uint32_t& endOfBandRun, int16_t* block, int start, int end, int low) {
+		int bit = 1 << low;
+		int k = start;
+
+		if (endOfBandRun == 0) {
+			for (; k <= end; k++) {
+				int symbol = reader.Decode(table);
+				if (symbol < 0) { return false; }
+				int run = symbol >> 4, size = symbol & 15;
+
+				// New coefficients are always one bit, a zero size is an end of band run unless the run is 15
+				int value = 0;
+				if (size != 0) {
+					if (size != 1) { return false; }
+					reader.Fill();
+					value = (reader.Read(1) ? bit : -bit);
+				}
+				else if (run != 15) {
+					endOfBandRun = 1u << run;
+					if (run != 0) { endOfBandRun += reader.Read(run); }
+					break;
+				}
+
+				// Pass over the run of zero coefficients, refining the nonzero ones on the way
+				for (; k <= end; k++) {
+					int16_t& coefficient = block[ZIGZAG[k]];
+					if (coefficient != 0) { RefineCoefficient(reader, coefficient, bit); }
+					else if (run-- == 0) { break; }
+				}
+
+				if (value != 0) {
+					if (k > end) { return false; }
+					block[ZIGZAG[k]] = (int16_t)value;
+				}
+			}
+		}
+
+		// Blocks in an end of band run still refine the coefficients they already have
+		if (endOfBandRun > 0) {
+			for (; k <= end; k++) {
+				int16_t& coefficient = block[ZIGZAG[k]];
+				if (coefficient != 0) { RefineCoefficient(reader, coefficient, bit); }
+			}
+			endOfBandRun--;
+		}
+		return true;
+	}
+
+#ifdef JPEG_SSE2
+	// Four floats with the operators the inverse DCT uses so it is written once for plain floats and for vectors
+	struct Float4 {
+		__m128 value;
+
+		Float4 operator+(Float4 other) const { return Float4{ _mm_add_ps(value, other.value) }; }
+		Float4 operator-(Float4 other) const { return Float4{ _mm_sub_ps(value, other.value) }; }
+		Float4 operator*(float scale) const { return Float4{ _mm_mul_ps(value, _mm_set1_ps(scale)) }; }
+	};
+
+	// Transpose an 8x8 block held as a left and right half of each row
+	static void Transpose(Float4 (&rows)[8][2]) {
+		Float4 transposed[8][2];
+		for (int blockRow = 0; blockRow < 2; blockRow++) {
+			for (int blockColumn = 0; blockColumn < 2; blockColumn++) {
+				__m128 a = rows[blockRow * 4][blockColumn].value, b = rows[blockRow * 4 + 1][blockColumn].value;
+				__m128 c = rows[blockRow * 4 + 2][blockColumn].value, d = rows[blockRow * 4 + 3][blockColumn].value;
+				_MM_TRANSPOSE4_PS(a, b, c, d);
+				transposed[blockColumn * 4][blockRow].value = a;
+				transposed[blockColumn * 4 + 1][blockRow].value = b;
+				transposed[blockColumn * 4 + 2][blockRow].value = c;
+				transposed[blockColumn * 4 + 3][blockRow].value = d;
+			}
+		}
+		std::copy(&transposed[0][0], &transposed[0][0] + 16, &rows[0][0]);
+	}
+#endif
+
+	// One dimensional inverse DCT of eight values a step apart, the AAN factorisation with its scaling folded into the multipliers
+	template <typename T>
+	static void InverseDCT(T* values, size_t step) {
+		// Even part
+		T tmp0 = values[0], tmp1 = values[2 * step], tmp2 = values[4 * step], tmp3 = values[6 * step];
+		T tmp10 = tmp0 + tmp2;
+		T tmp11 = tmp0 - tmp2;
+		T tmp13 = tmp1 + tmp3;
+		T tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+		tmp0 = tmp10 + tmp13;
+		tmp3 = tmp10 - tmp13;
+		tmp1 = tmp11 + tmp12;
+		tmp2 = tmp11 - tmp12;
+
+		// Odd part
+		T tmp4 = values[step], tmp5 = values[3 * step], tmp6 = values[5 * step], tmp7 = values[7 * step];
+		T z13 = tmp6 + tmp5;
+		T z10 = tmp6 - tmp5;
+		T z11 = tmp4 + tmp7;
+		T z12 = tmp4 - tmp7;
+		tmp7 = z11 + z13;
+		tmp11 = (z11 - z13) * 1.414213562f;
+		T z5 = (z10 + z12) * 1.847759065f;
+		tmp10 = z12 * 1.082392200f - z5;
+		tmp12 = z10 * -2.613125930f + z5;
+		tmp6 = tmp12 - tmp7;
+		tmp5 = tmp11 - tmp6;
+		tmp4 = tmp10 + tmp5;
+
+		values[0] = tmp0 + tmp7;
+		values[7 * step] = tmp0 - tmp7;
+		values[step] = tmp1 + tmp6;
+		values[6 * step] = tmp1 - tmp6;
+		values[2 * step] = tmp2 + tmp5;
+		values[5 * step] = tmp2 - tmp5;
+		values[4 * step] = tmp3 + tmp4;
+		values[3 * step] = tmp3 - tmp4;
+	}
+
+	// Dequantise and inverse transform a block to 8x8 pixels, both versions give exactly the same pixels
+	static void InverseDCT8x8(const int16_t* coefficients, const float* multipliers, uint8_t* output, size_t stride) {
+#ifdef JPEG_SSE2
+		// Blocks with only a DC coefficient are flat, which the full transform would also give
+		__m128i ac = _mm_and_si128(_mm_loadu_si128((const __m128i*)coefficients), _mm_set_epi16(-1, -1, -1, -1, -1, -1, -1, 0));
+		for (int row = 1; row < 8; row++) { ac = _mm_or_si128(ac, _mm_loadu_si128((const __m128i*)(coefficients + row * 8))); }
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(ac, _mm_setzero_si128())) == 0xFFFF) {
+			__m128i value = _mm_set1_epi8((char)ClampToByte((int)std::lrintf(coefficients[0] * multipliers[0] + 128.0f)));
+			for (int row = 0; row < 8; row++) { _mm_storel_epi64((__m128i*)(output + row * stride), value); }
+			return;
+		}
+
+		Float4 rows[8][2];
+		for (int row = 0; row < 8; row++) {
+			for (int half = 0; half < 2; half++) {
+				__m128i values = _mm_loadl_epi64((const __m128i*)(coefficients + row * 8 + half * 4));
+				__m128 dequantised = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16));
+				rows[row][half].value = _mm_mul_ps(dequantised, _mm_loadu_ps(multipliers + row * 8 + half * 4));
+			}
+		}
+
+		// Columns four at a time, then rows once transposed
+		InverseDCT(&rows[0][0], 2);
+		InverseDCT(&rows[0][1], 2);
+		Transpose(rows);
+		InverseDCT(&rows[0][0], 2);
+		InverseDCT(&rows[0][1], 2);
+		Transpose(rows);
+
+		__m128 offset = _mm_set1_ps(128.0f);
+		for (int row = 0; row < 8; row++) {
+			__m128i left = _mm_cvtps_epi32(_mm_add_ps(rows[row][0].value, offset));
+			__m128i right = _mm_cvtps_epi32(_mm_add_ps(rows[row][1].value, offset));
+			__m128i packed = _mm_packs_epi32(left, right);
+			_mm_storel_epi64((__m128i*)(output + row * stride), _mm_packus_epi16(packed, packed));
+		}
+#else
+		bool flat = std::all_of(coefficients + 1, coefficients + 64, [](int16_t coefficient) { return coefficient == 0; });
+		if (flat) {
+			uint8_t value = ClampToByte((int)std::lrintf(coefficients[0] * multipliers[0] + 128.0f));
+			for (int row = 0; row < 8; row++) { std::fill(output + row * stride, output + row * stride + 8, value); }
+			return;
+		}
+
+		float values[64];
+		for (int i = 0; i < 64; i++) { values[i] = coefficients[i] * multipliers[i]; }
+		for (int column = 0; column < 8; column++) { InverseDCT(values + column, 8); }
+		for (int row = 0; row < 8; row++) { InverseDCT(values + row * 8, 1); }
+
+		for (int row = 0; row < 8; row++) {
+			for (int column = 0; column < 8; column++) { output[row * stride + column] = ClampToByte((int)std::lrintf(values[row * 8 + column] + 128.0f)); }
+		}
+#endif
+	}
+
+	// Inverse transform only the lowest frequencies of a block to a smaller square, which averages the pixels each output pixel covers
+	static void InverseDCTReduced(const int16_t* coefficients, const float* multipliers, uint32_t size, uint8_t* output, size_t stride) {
+		if (size == 1) {
+			*output = ClampToByte((int)std::lrintf(coefficients[0] * multipliers[0] * 0.125f + 128.0f));
+			return;
+		}
+
+		// Basis of the 2 and 4 point transforms scaled the same as the 8 point one, so a flat block keeps its value
+		static const std::array<std::array<float, 16>, 2> bases = []() {
+			std::array<std::array<float, 16>, 2> bases;
+			for (int i = 0; i < 2; i++) {
+				int points = 2 << i;
+				for (int x = 0; x < points; x++) {
+					for (int u = 0; u < points; u++) {
+						double scale = (u == 0 ? std::sqrt(0.5) : 1.0) * 0.5;
+						bases[i][x * points + u] = (float)(scale * std::cos((2 * x + 1) * u * 3.14159265358979323846 / (2.0 * points)));
+					}
+				}
+			}
+			return bases;
+		}();
+		const float* basis = bases[size == 2 ? 0 : 1].data();
+
+		// Rows of coefficients to rows of pixels, then the columns
+		float rows[16];
+		for (uint32_t v = 0; v < size; v++) {
+			for (uint32_t x = 0; x < size; x++) {
+				float sum = 0.0f;
+				for (uint32_t u = 0; u < size; u++) { sum += basis[x * size + u] * (coefficients[v * 8 + u] * multipliers[v * 8 + u]); }
+				rows[v * size + x] = sum;
+			}
+		}
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				float sum = 0.0f;
+				for (uint32_t v = 0; v < size; v++) { sum += basis[y * size + v] * rows[v * size + x]; }
+				output[y * stride + x] = ClampToByte((int)std::lrintf(sum + 128.0f));
+			}
+		}
+	}
+
+	void JPEG::TransformBlock(Component& component, const int16_t* coefficients, uint32_t blockX, uint32_t blockY) const {
+		uint8_t* output = component.plane.data() + (size_t)blockY * component.blockSize * component.planeStride + (size_t)blockX * component.blockSize;
+		if (component.blockSize == 8) { InverseDCT8x8(coefficients, component.multipliers.data(), output, component.planeStride); }
+		else { InverseDCTReduced(coefficients, component.multipliers.data(), component.blockSize, output, component.planeStride); }
+	}
+
+	bool JPEG::ForEach(size_t count, const std::function<bool(size_t)>& function) const {
+		unsigned int threadCount = (m_threadCount != 0 ? m_threadCount : std::max(1u, std::thread::hardware_concurrency()));
+
+		std::atomic<size_t> next = 0;
+		std::atomic<bool> failed = false;
+		auto worker = [&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				if (function(i)) { continue; }
+				failed = true;
+				next = count;
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min<size_t>(threadCount, count); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+		return !failed;
+	}
+
+	bool JPEG::Finish() {
+		IL_TRACE_SCOPE("JPEG::Finish");
+
+		for (const Component& component : m_components) {
+			if (!component.multipliersSet) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: JPEG component has no scans", m_fileData.size()); }
+		}
+
+		// Progressive blocks are only complete once every scan has been decoded
+		if (m_progressive) {
+			for (Component& component : m_components) {
+				ForEach(component.blocksPerColumn, [&](size_t blockY) {
+					for (uint32_t blockX = 0; blockX < component.blocksPerLine; blockX++) {
+						TransformBlock(component, component.coefficients.data() + (blockY * component.blocksPerLine + blockX) * 64, blockX, (uint32_t)blockY);
+					}
+					return true;
+				});
+				component.coefficients = Memory::Vector<int16_t>();
+			}
+		}
+
+		// An Adobe marker says whether the components are transformed, otherwise RGB is taken from the component ids
+		if (m_adobeTransform >= 0) { m_transformed = (m_adobeTransform != 0); }
+		else if (m_components.size() == 3) { m_transformed = !(m_components[0].id == 'R' && m_components[1].id == 'G' && m_components[2].id == 'B'); }
+		else { m_transformed = false; }
+
+		// Bands of rows are converted on separate threads, the same as blocks they only read the planes
+		m_pixelBuffer.resize((size_t)m_width * m_height * 3);
+		unsigned int threadCount = (m_threadCount != 0 ? m_threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		if ((uint64_t)m_width * m_height < MIN_THREADED_PIXELS) { threadCount = 1; }
+		uint32_t bandRows = std::max(16u, (m_height + threadCount * 4 - 1) / (threadCount * 4));
+		ForEach((m_height + bandRows - 1) / bandRows, [&](size_t band) {
+			ConvertRows((uint32_t)band * bandRows, std::min(m_height, (uint32_t)(band + 1) * bandRows));
+			return true;
+		});
+
+		for (Component& component : m_components) { component.plane = Memory::Buffer(); }
+
+		if (m_collectStatistics) {
+			StatisticsAccumulator accumulator(m_pixelFormat);
+			accumulator.AddPixels(m_pixelBuffer);
+			m_statistics = accumulator.GetStatistics();
+		}
+		return true;
+	}
+
+	// Convert a row of YCbCr samples to RGB with 14 bit fixed point weights, both versions give exactly the same pixels
+	static void YCbCrToRGB(const uint8_t* luma, const uint8_t* blue, const uint8_t* red, uint8_t* output, uint32_t count) {
+		uint32_t x = 0;
+#ifdef JPEG_SSE2
+		__m128i zero = _mm_setzero_si128();
+		__m128i centre = _mm_set1_epi16(128);
+		__m128i round = _mm_set1_epi32(1 << 13);
+		__m128i redWeights = _mm_set_epi16(22970, 0, 22970, 0, 22970, 0, 22970, 0);
+		__m128i greenWeights = _mm_set_epi16(-11700, -5638, -11700, -5638, -11700, -5638, -11700, -5638);
+		__m128i blueWeights = _mm_set_epi16(0, 29032, 0, 29032, 0, 29032, 0, 29032);
+		alignas(16) uint8_t channels[3][16];
+
+		for (; x + 8 <= count; x += 8) {
+			__m128i y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(luma + x)), zero);
+			__m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(blue + x)), zero), centre);
+			__m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(red + x)), zero), centre);
+
+			// Pairs of blue and red differences are weighted and summed together
+			__m128i pairs[2] = { _mm_unpacklo_epi16(cb, cr), _mm_unpackhi_epi16(cb, cr) };
+			__m128i lumas[2] = { _mm_unpacklo_epi16(y, zero), _mm_unpackhi_epi16(y, zero) };
+			const __m128i* weights[3] = { &redWeights, &greenWeights, &blueWeights };
+			for (int c = 0; c < 3; c++) {
+				__m128i low = _mm_add_epi32(lumas[0], _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairs[0], *weights[c]), round), 14));
+				__m128i high = _mm_add_epi32(lumas[1], _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairs[1], *weights[c]), round), 14));
+				__m128i packed = _mm_packs_epi32(low, high);
+				_mm_storel_epi64((__m128i*)channels[c], _mm_packus_epi16(packed, packed));
+			}
+
+			for (int i = 0; i < 8; i++) {
+				output[(x + i) * 3] = channels[0][i];
+				output[(x + i) * 3 + 1] = channels[1][i];
+				output[(x + i) * 3 + 2] = channels[2][i];
+			}
+		}
+#endif
+		for (; x < count; x++) {
+			int y = luma[x], cb = blue[x] - 128, cr = red[x] - 128;
+			output[x * 3] = ClampToByte(y + ((22970 * cr + (1 << 13)) >> 14));
+			output[x * 3 + 1] = ClampToByte(y + ((-5638 * cb - 11700 * cr + (1 << 13)) >> 14));
+			output[x * 3 + 2] = ClampToByte(y + ((29032 * cb + (1 << 13)) >> 14));
+		}
+	}
+
+	void JPEG::UpsampleRow(const Component& component, uint32_t row, uint8_t* output, std::vector<uint16_t>& columnSums) const {
+		uint32_t horizontalFactor = component.horizontalFactor, verticalFactor = component.verticalFactor;
+		uint32_t lastRow = component.height - 1, width = component.width;
+
+		// Doubled rows and columns are weighted three to one between the nearest samples as libjpeg does, other factors repeat samples
+		uint32_t sourceRow = std::min(row / verticalFactor, lastRow);
+		const uint8_t* nearer = component.plane.data() + sourceRow * component.planeStride;
+		columnSums.resize(width);
+		if (verticalFactor == 2) {
+			uint32_t fartherRow = ((row & 1) ? std::min(sourceRow + 1, lastRow) : (sourceRow > 0 ? sourceRow - 1 : 0));
+			const uint8_t* farther = component.plane.data() + fartherRow * component.planeStride;
+			for (uint32_t i = 0; i < width; i++) { columnSums[i] = (uint16_t)(nearer[i] * 3 + farther[i]); }
+		}
+		else {
+			for (uint32_t i = 0; i < width; i++) { columnSums[i] = (uint16_t)(nearer[i] * 4); }
+		}
+
+		if (horizontalFactor == 2) {
+			for (uint32_t x = 0; x < m_width; x++) {
+				uint32_t i = x >> 1;
+				uint32_t neighbour = ((x & 1) ? std::min(i + 1, width - 1) : (i > 0 ? i - 1 : 0));
+				output[x] = (uint8_t)((columnSums[i] * 3 + columnSums[neighbour] + 8) >> 4);
+			}
+		}
+		else {
+			for (uint32_t x = 0; x < m_width; x++) { output[x] = (uint8_t)((columnSums[std::min(x / horizontalFactor, width - 1)] + 2) >> 2); }
+		}
+	}
+
+	void JPEG::ConvertRows(uint32_t firstRow, uint32_t endRow) {
+		std::array<std::vector<uint8_t>, 4> upsampled;
+		std::vector<uint16_t> columnSums;
+		std::array<const uint8_t*, 4> samples{};
+
+		for (uint32_t y = firstRow; y < endRow; y++) {
+			// Components at full resolution are read straight from their planes
+			for (size_t c = 0; c < m_components.size(); c++) {
+				const Component& component = m_components[c];
+				if (component.horizontalFactor == 1 && component.verticalFactor == 1) {
+					samples[c] = component.plane.data() + y * component.planeStride;
+					continue;
+				}
+				upsampled[c].resize(m_width);
+				UpsampleRow(component, y, upsampled[c].data(), columnSums);
+				samples[c] = upsampled[c].data();
+			}
+
+			uint8_t* output = m_pixelBuffer.data() + (size_t)y * m_width * 3;
+			if (m_components.size() == 1) {
+				for (uint32_t x = 0; x < m_width; x++) { output[x * 3] = output[x * 3 + 1] = output[x * 3 + 2] = samples[0][x]; }
+			}
+			else if (m_components.size() == 3 && m_transformed) { YCbCrToRGB(samples[0], samples[1], samples[2], output, m_width); }
+			else if (m_components.size() == 3) {
+				for (uint32_t x = 0; x < m_width; x++) {
+					output[x * 3] = samples[0][x];
+					output[x * 3 + 1] = samples[1][x];
+					output[x * 3 + 2] = samples[2][x];
+				}
+			}
+			else {
+				// Adobe CMYK is stored inverted, so each channel is multiplied by black, and YCCK is CMY as YCbCr
+				if (m_transformed) { YCbCrToRGB(samples[0], samples[1], samples[2], output, m_width); }
+				for (uint32_t x = 0; x < m_width; x++) {
+					for (int c = 0; c < 3; c++) {
+						int value = (m_transformed ? 255 - output[x * 3 + c] : samples[c][x]);
+						output[x * 3 + c] = (uint8_t)((value * samples[3][x] + 127) / 255);
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
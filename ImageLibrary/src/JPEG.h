@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <functional>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	// Information about a JPEG found from its markers without decoding any image data
+	struct JPEGInfo {
+		uint32_t width = 0, height = 0;
+		uint8_t componentCount = 0;
+		bool progressive = false;
+
+		// MCUs between restart markers, 0 if there are none so the image data can only be decoded on one thread
+		uint16_t restartInterval = 0;
+
+		// Format GetPixelBuffer gives for the image, greyscale and CMYK are given as RGB
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+
+		// Where the EXIF data after the APP1 identifier is in the file so it can be read if needed, a size of 0 if there is none
+		uint64_t exifOffset = 0;
+		uint32_t exifSize = 0;
+	};
+
+	// Baseline and progressive Huffman coded JPEGs of 8 bit greyscale, YCbCr, RGB, CMYK or YCCK
+	// Arithmetic coded, lossless, hierarchical and 12 bit files are not supported
+	class JPEG : public Image
+	{
+	public:
+		JPEG(std::string filePath) : JPEG(filePath, std::nothrow) { if (m_error) { throw new std::runtime_error(m_error->message); } };
+		JPEG(const ImageSource& source) : JPEG(source, std::nothrow) { if (m_error) { throw new std::runtime_error(m_error->message); } };
+
+		// Decode a whole file without exceptions, the pixels are laid out the same as GetPixelBuffer
+		static std::expected<DecodedImage, DecodeError> Decode(std::string filePath);
+		static std::expected<DecodedImage, DecodeError> Decode(const ImageSource& source);
+
+		// Decode at a half, quarter or eighth of the size along each side with partial squares at the right and bottom edges kept
+		// Each block is inverse transformed straight to 4x4, 2x2 or 1x1 pixels from its lowest frequencies, at an eighth progressive AC scans
+		// are skipped as only DC coefficients are used, the full size image is never held and the disk cache is not used
+		static std::expected<DecodedImage, DecodeError> DecodeReduced(std::string filePath, uint32_t reduction);
+
+		// Read the markers up to the frame header seeking over everything else, no image data is read
+		static std::expected<JPEGInfo, DecodeError> Probe(std::string filePath);
+
+		// Decode images created after this across this many threads, 0 for every core
+		// Restart intervals are entropy decoded in parallel, converting to RGB is always split between the threads
+		static void SetThreadCount(unsigned int threadCount) noexcept { s_threadCount = threadCount; }
+
+	private:
+		// Huffman table with a lookahead of the shortest codes, AC tables also give the value of short run and size pairs in one step
+		struct HuffmanTable {
+			static constexpr int LOOKAHEAD_BITS = 9;
+
+			// Code length and symbol of every lookahead, a length of 0 when the code is longer
+			std::array<uint8_t, 1 << LOOKAHEAD_BITS> lookaheadLength;
+			std::array<uint8_t, 1 << LOOKAHEAD_BITS> lookaheadSymbol;
+
+			// Run in bits 4 to 7, bits used in bits 0 to 3 and the value above them, 0 when the code and value do not fit the lookahead
+			std::array<int32_t, 1 << LOOKAHEAD_BITS> lookaheadValue;
+
+			// Largest code of each length, -1 if there are none, and the offset from a code to its symbol
+			std::array<int32_t, 18> maxCode;
+			std::array<int32_t, 17> valueOffset;
+			std::array<uint8_t, 256> symbols;
+			bool defined = false;
+		};
+
+		struct Component {
+			uint8_t id;
+			uint8_t horizontalSampling, verticalSampling;
+			uint8_t quantisationTable;
+
+			// Blocks covering the component padded to whole MCUs
+			uint32_t blocksPerLine, blocksPerColumn;
+
+			// Blocks a scan of only this component covers, which are not padded to whole MCUs
+			uint32_t scanBlocksPerLine, scanBlocksPerColumn;
+
+			// Pixels each block is inverse transformed to, and how many times more the plane is upsampled along each side to the image
+			uint32_t blockSize;
+			uint32_t horizontalFactor, verticalFactor;
+
+			// Pixels of the plane that are inside the image
+			uint32_t width, height;
+
+			// Dequantisation folded with the scaling the inverse transform needs, fixed at the first scan of the component
+			std::array<float, 64> multipliers;
+			bool multipliersSet = false;
+
+			// Coefficients of every block kept until the last scan of a progressive image
+			Memory::Vector<int16_t> coefficients;
+
+			// Inverse transformed blocks, each a square of the block size
+			Memory::Buffer plane;
+			size_t planeStride;
+		};
+
+		struct ScanComponent {
+			size_t component;
+			uint8_t dcTable, acTable;
+		};
+
+		struct Scan {
+			std::vector<ScanComponent> components;
+			uint8_t spectralStart, spectralEnd;
+			uint8_t approximationHigh, approximationLow;
+		};
+
+		class BitReader;
+
+		// Reads and decodes the file leaving any failure in the error rather than throwing
+		JPEG(std::string filePath, std::nothrow_t) : Image(filePath) { if (!m_error && !IsCached()) { ReadFile(); } };
+		JPEG(const ImageSource& source, std::nothrow_t) : Image(source) { if (!m_error && !IsCached()) { ReadFile(); } };
+		JPEG(std::string filePath, uint32_t reduction, std::nothrow_t) : Image(filePath, UncachedTag()), m_reduction(reduction) { if (!m_error) { ReadFile(); } };
+
+		bool ReadFile() override;
+
+		// Record an error at the start of the marker being parsed
+		bool Fail(DecodeErrorKind kind, const char* message) noexcept { return SetError(kind, message, m_markerStart); }
+
+		bool ParseMarkers();
+		bool ParseSOF(std::span<const uint8_t> data, uint8_t marker);
+		bool ParseDHT(std::span<const uint8_t> data);
+		bool ParseDQT(std::span<const uint8_t> data);
+		bool ParseDRI(std::span<const uint8_t> data);
+		bool ParseSOS(std::span<const uint8_t> data);
+		void ParseAPP2(std::span<const uint8_t> data);
+		void ParseAPP14(std::span<const uint8_t> data);
+		void ResolveColourSpace();
+
+		// Decode the entropy coded data of a scan, split at its restart markers so intervals can be decoded on different threads
+		bool DecodeScan(const Scan& scan);
+		bool DecodeInterval(const Scan& scan, uint64_t firstMCU, uint64_t endMCU, const uint8_t* data, const uint8_t* end);
+		bool DecodeBlock(BitReader& reader, const Scan& scan, const ScanComponent& scanComponent, int& predictor, uint32_t& endOfBandRun, uint32_t blockX, uint32_t blockY);
+		static bool BuildHuffmanTable(HuffmanTable& table, const uint8_t* counts, std::span<const uint8_t> symbols, bool ac);
+
+		// Entropy decoding of a single block, coefficients are left in natural order and are not dequantised
+		static bool DecodeBaselineBlock(BitReader& reader, const HuffmanTable& dcTable, const HuffmanTable& acTable, int& predictor, int16_t* block);
+		static bool DecodeDCFirst(BitReader& reader, const HuffmanTable& table, int& predictor, int16_t* block, int low);
+		static void DecodeDCRefine(BitReader& reader, int16_t* block, int low);
+		static bool DecodeACFirst(BitReader& reader, const HuffmanTable& table, uint32_t& endOfBandRun, int16_t* block, int start, int end, int low);
+		static bool DecodeACRefine(BitReader& reader, const HuffmanTable& table, uint32_t& endOfBandRun, int16_t* block, int start, int end, int low);
+		bool SkipScan(const Scan& scan) const;
+		void SetMultipliers(Component& component);
+		void TransformBlock(Component& component, const int16_t* coefficients, uint32_t blockX, uint32_t blockY) const;
+
+		// Upsample and convert the component planes to RGB in the pixel buffer
+		bool Finish();
+		void ConvertRows(uint32_t firstRow, uint32_t endRow);
+		void UpsampleRow(const Component& component, uint32_t row, uint8_t* output, std::vector<uint16_t>& columnSums) const;
+
+		// Split work between the decode's threads, each index is handed out once, returns false if any call did
+		bool ForEach(size_t count, const std::function<bool(size_t)>& function) const;
+
+	private:
+		size_t m_position = 0;
+		size_t m_markerStart = 0;
+
+		// Frame
+		bool m_frameFound = false;
+		bool m_progressive = false;
+		std::vector<Component> m_components;
+		uint8_t m_maxHorizontalSampling = 1, m_maxVerticalSampling = 1;
+		uint32_t m_mcusPerLine = 0, m_mcusPerColumn = 0;
+		uint32_t m_fullWidth = 0, m_fullHeight = 0;
+
+		// Tables
+		std::array<HuffmanTable, 4> m_dcTables;
+		std::array<HuffmanTable, 4> m_acTables;
+		std::array<std::array<uint16_t, 64>, 4> m_quantisationTables;
+		std::array<bool, 4> m_quantisationDefined{};
+		uint16_t m_restartInterval = 0;
+
+		// Colour information, the Adobe transform is -1 without an APP14 marker
+		int m_adobeTransform = -1;
+		std::vector<std::vector<uint8_t>> m_iccChunks;
+
+		// Whether three or four components are converted from YCbCr, decided from the Adobe marker and the component ids
+		bool m_transformed = true;
+		bool m_scanDecoded = false;
+
+		// Each side is decoded this many times smaller, with each block of a component at full resolution inverse transformed to 8 divided by it pixels square
+		uint32_t m_reduction = 1;
+		uint32_t m_blockSize = 8;
+
+		inline static unsigned int s_threadCount = 0;
+		unsigned int m_threadCount = s_threadCount;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+namespace ImageLibrary {
+	namespace Memory {
+		// Bytes held and allocations made by tracked containers while a scope was active, zlib's own state is not included
+		// Current bytes can go below zero if memory allocated before the scope is freed inside it
+		struct Stats {
+			int64_t currentBytes = 0;
+			int64_t peakBytes = 0;
+			uint64_t allocations = 0;
+		};
+
+		// Stats that tracked allocations on this thread are counted against, if any
+		inline thread_local Stats* t_stats = nullptr;
+
+		inline void RecordAllocation(size_t bytes) noexcept {
+			if (!t_stats) { return; }
+			t_stats->currentBytes += (int64_t)bytes;
+			t_stats->peakBytes = std::max(t_stats->peakBytes, t_stats->currentBytes);
+			t_stats->allocations++;
+		}
+
+		inline void RecordDeallocation(size_t bytes) noexcept {
+			if (t_stats) { t_stats->currentBytes -= (int64_t)bytes; }
+		}
+
+		// Counts tracked allocations made by this thread against the stats until destroyed, scopes can be nested
+		class Scope
+		{
+		public:
+			Scope(Stats& stats) noexcept : m_previous(t_stats) { t_stats = &stats; };
+			~Scope() noexcept { t_stats = m_previous; };
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			Stats* m_previous;
+		};
+
+		// Standard allocator that reports to the active scope so a decode can measure its own memory use
+		template <typename T>
+		struct Allocator {
+			using value_type = T;
+
+			Allocator() noexcept = default;
+			template <typename U>
+			Allocator(const Allocator<U>&) noexcept {}
+
+			T* allocate(size_t count) {
+				T* pointer = std::allocator<T>().allocate(count);
+				RecordAllocation(count * sizeof(T));
+				return pointer;
+			}
+
+			void deallocate(T* pointer, size_t count) noexcept {
+				RecordDeallocation(count * sizeof(T));
+				std::allocator<T>().deallocate(pointer, count);
+			}
+
+			template <typename U>
+			bool operator==(const Allocator<U>&) const noexcept { return true; }
+		};
+
+		template <typename T>
+		using Vector = std::vector<T, Allocator<T>>;
+
+		using Buffer = Vector<uint8_t>;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,1459 @@
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include "../vendor/zlib/zlib.h"
+
+#include "PNG.h"
+#include "FileWindow.h"
+#include "Utils.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	void PNG::InitCRC() {
+		// Taken directly from the specification and cleaned slightly
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = (uint32_t)n;
+			for (uint32_t k = 0; k < 8; k++) {
+				if (c & 1) {
+					c = 0xedb88320L ^ (c >> 1);
+				}
+				else {
+					c = c >> 1;
+				}
+			}
+			m_crcTable[n] = c;
+		}
+	}
+
+	// Seconds elapsed since the last call, used to time each decode stage
+	static double LapSeconds(std::chrono::steady_clock::time_point& lapStart) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(now - lapStart).count();
+		lapStart = now;
+		return seconds;
+	}
+
+	std::expected<DecodedImage, DecodeError> PNG::Decode(std::string filePath) {
+		return Decode(ImageSource::FromFile(filePath));
+	}
+
+	std::expected<DecodedImage, DecodeError> PNG::Decode(const ImageSource& source) {
+		PNG image(source, std::nothrow);
+		if (image.m_error) { return std::unexpected(*image.m_error); }
+
+		// Take the buffer rather than copying it unless it is mapped from the cache
+		std::span<const uint8_t> pixels = image.GetPixelBuffer();
+		DecodedImage decoded{ .width = image.m_width, .height = image.m_height, .pixelFormat = image.m_pixelFormat };
+		if (image.IsCached()) { decoded.pixels.assign(pixels.begin(), pixels.end()); }
+		else { decoded.pixels = std::move(image.m_pixelBuffer); }
+		decoded.memoryStats = image.m_memoryStats;
+
+		return decoded;
+	}
+
+	std::expected<DecodedImage, DecodeError> PNG::DecodeReduced(std::string filePath, uint32_t reduction) {
+		IL_TRACE_SCOPE("PNG::DecodeReduced");
+
+		if (reduction != 1 && reduction != 2 && reduction != 4 && reduction != 8) {
+			return std::unexpected(DecodeError{ .kind = DecodeErrorKind::UNSUPPORTED, .message = "Error: Reduction must be 1, 2, 4 or 8", .offset = 0 });
+		}
+
+		PNG image(filePath, reduction, std::nothrow);
+		if (image.m_error) { return std::unexpected(*image.m_error); }
+
+		image.GetPixelBuffer();
+		DecodedImage decoded{ .width = image.m_width, .height = image.m_height, .pixelFormat = image.m_pixelFormat };
+		decoded.pixels = std::move(image.m_pixelBuffer);
+		decoded.memoryStats = image.m_memoryStats;
+
+		return decoded;
+	}
+
+	std::expected<void, DecodeError> PNG::DecodeInto(std::string filePath, const DecodeTarget& target) {
+		IL_TRACE_SCOPE("PNG::DecodeInto");
+
+		PNG image(filePath, target, std::nothrow);
+		if (image.m_error) { return std::unexpected(*image.m_error); }
+		return {};
+	}
+
+	// Text chunks larger than this are skipped by a probe, as is compressed text that inflates to more
+	static constexpr uint32_t PROBE_MAX_TEXT_SIZE = 1 << 20;
+
+	// Larger ICC profiles are ignored, real ones are rarely more than a few hundred KB
+	static constexpr size_t MAX_ICC_PROFILE_SIZE = 4 << 20;
+
+	// Chunk type as the big endian integer it is stored as so types can be compared without strings
+	static constexpr uint32_t ChunkType(const char (&name)[5]) {
+		return ((uint32_t)(uint8_t)name[0] << 24) | ((uint32_t)(uint8_t)name[1] << 16) | ((uint32_t)(uint8_t)name[2] << 8) | (uint32_t)(uint8_t)name[3];
+	}
+
+	static std::string Latin1ToUTF8(std::span<const uint8_t> text) {
+		std::string output;
+		output.reserve(text.size());
+		for (uint8_t c : text) {
+			if (c < 0x80) { output += (char)c; }
+			else {
+				output += (char)(0xC0 | (c >> 6));
+				output += (char)(0x80 | (c & 0x3F));
+			}
+		}
+		return output;
+	}
+
+	// Inflate the compressed part of an ancillary chunk, returns false if it is corrupt or inflates to more than the maximum size
+	template <typename Container>
+	static bool InflateChunkData(std::span<const uint8_t> input, Container& output, size_t maxSize) {
+		z_stream infStream{};
+		if (inflateInit(&infStream) != Z_OK) { return false; }
+		infStream.next_in = const_cast<Bytef*>(input.data());
+		infStream.avail_in = (uInt)input.size();
+
+		int err;
+		std::array<char, 4096> buffer;
+		do {
+			infStream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+			infStream.avail_out = (uInt)buffer.size();
+			err = inflate(&infStream, Z_NO_FLUSH);
+			output.insert(output.end(), buffer.begin(), buffer.begin() + (buffer.size() - infStream.avail_out));
+		} while (err == Z_OK && output.size() <= maxSize);
+
+		inflateEnd(&infStream);
+		return err == Z_STREAM_END;
+	}
+
+	// Split a tEXt, zTXt or iTXt chunk into its fields, returns false if it is malformed
+	static bool ParseTextChunk(uint32_t type, std::span<const uint8_t> data, Utils::PNG::TextEntry& entry) {
+		// Every text chunk starts with a null terminated Latin-1 keyword
+		auto keywordEnd = std::find(data.begin(), data.end(), 0);
+		if (keywordEnd == data.end()) { return false; }
+		entry.keyword = Latin1ToUTF8(std::span<const uint8_t>(data.begin(), keywordEnd));
+		std::span<const uint8_t> rest(keywordEnd + 1, data.end());
+
+		if (type == ChunkType("tEXt")) {
+			entry.text = Latin1ToUTF8(rest);
+			return true;
+		}
+
+		// Compression method then the compressed Latin-1 text
+		if (type == ChunkType("zTXt")) {
+			std::string text;
+			if (rest.empty() || rest[0] != 0 || !InflateChunkData(rest.subspan(1), text, PROBE_MAX_TEXT_SIZE)) { return false; }
+			entry.text = Latin1ToUTF8(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+			return true;
+		}
+
+		// Compression flag and method then a null terminated language tag and translated keyword before the UTF-8 text
+		if (rest.size() < 2 || rest[0] > 1 || rest[1] != 0) { return false; }
+		bool compressed = (rest[0] == 1);
+		rest = rest.subspan(2);
+
+		auto languageEnd = std::find(rest.begin(), rest.end(), 0);
+		if (languageEnd == rest.end()) { return false; }
+		entry.languageTag.assign(rest.begin(), languageEnd);
+		rest = std::span<const uint8_t>(languageEnd + 1, rest.end());
+
+		auto translatedKeywordEnd = std::find(rest.begin(), rest.end(), 0);
+		if (translatedKeywordEnd == rest.end()) { return false; }
+		entry.translatedKeyword.assign(rest.begin(), translatedKeywordEnd);
+		rest = std::span<const uint8_t>(translatedKeywordEnd + 1, rest.end());
+
+		if (compressed) { return InflateChunkData(rest, entry.text, PROBE_MAX_TEXT_SIZE); }
+		entry.text.assign(rest.begin(), rest.end());
+		return true;
+	}
+
+	std::expected<PNGInfo, DecodeError> PNG::Probe(std::string filePath) {
+		IL_TRACE_SCOPE("PNG::Probe");
+
+		auto fail = [](DecodeErrorKind kind, const char* message, uint64_t offset) {
+			return std::unexpected(DecodeError{ .kind = kind, .message = message, .offset = offset });
+		};
+
+		FileWindow file(filePath);
+		if (!file.IsOpen()) { return fail(DecodeErrorKind::FILE_UNREADABLE, "Error: File could not be opened", 0); }
+
+		// Check the signature
+		static constexpr std::array<uint8_t, 8> signature = { 137, 80, 78, 71, 13, 10, 26, 10 };
+		const uint8_t* data = file.Read(0, signature.size());
+		if (!data) { return fail(DecodeErrorKind::NOT_PNG, "Error: File is too small to be a PNG", 0); }
+		if (!std::equal(signature.begin(), signature.end(), data)) { return fail(DecodeErrorKind::NOT_PNG, "Error: PNG signature is invalid", 0); }
+
+		// IHDR must come first and is always the same size
+		data = file.Read(8, 8 + 13);
+		if (!data) { return fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file", 8); }
+		uint32_t length, type;
+		Utils::ExtractBigEndianBytes(length, data, 4);
+		Utils::ExtractBigEndianBytes(type, data + 4, 4);
+		if (type != ChunkType("IHDR")) { return fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - IHDR is not first", 8); }
+		if (length != 13) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: IHDR chunk is invalid", 8); }
+
+		PNGInfo info;
+		Utils::ExtractBigEndianBytes(info.width, data + 8, 4);
+		Utils::ExtractBigEndianBytes(info.height, data + 12, 4);
+		info.bitDepth = data[16];
+		info.colourType = data[17];
+		info.interlaceMethod = data[20];
+		if (info.width > Utils::PNG_SPEC_MAX_DIMENSION || info.height > Utils::PNG_SPEC_MAX_DIMENSION || info.width == 0 || info.height == 0) {
+			return fail(DecodeErrorKind::INVALID_CHUNK, "Error: Image dimensions invalid", 8);
+		}
+
+		info.pixelFormat = GetOutputPixelFormat(info.colourType, info.bitDepth, false);
+		if (info.pixelFormat == Utils::INVALID) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type", 8); }
+
+		// Walk the chunk headers only reading the chunks wanted, stopping at IEND or wherever the file ends
+		uint64_t offset = 8 + 8 + 13 + 4;
+		while ((data = file.Read(offset, 8)) != nullptr) {
+			Utils::ExtractBigEndianBytes(length, data, 4);
+			Utils::ExtractBigEndianBytes(type, data + 4, 4);
+			uint64_t dataOffset = offset + 8;
+			offset = dataOffset + length + 4;
+
+			switch (type) {
+			case ChunkType("IEND"):
+				return info;
+			case ChunkType("acTL"):
+				if (length == 8 && (data = file.Read(dataOffset, 4)) != nullptr) { Utils::ExtractBigEndianBytes(info.frameCount, data, 4); }
+				break;
+			case ChunkType("tIME"):
+				if (length == 7 && (data = file.Read(dataOffset, 7)) != nullptr) {
+					Utils::PNG::Time time;
+					Utils::ExtractBigEndianBytes(time.year, data, 2);
+					time.month = data[2];
+					time.day = data[3];
+					time.hour = data[4];
+					time.minute = data[5];
+					time.second = data[6];
+					info.time = time;
+				}
+				break;
+			case ChunkType("pHYs"):
+				if (length == 9 && (data = file.Read(dataOffset, 9)) != nullptr) {
+					Utils::PNG::PhysicalDimensions dimensions;
+					Utils::ExtractBigEndianBytes(dimensions.pixelsPerUnitX, data, 4);
+					Utils::ExtractBigEndianBytes(dimensions.pixelsPerUnitY, data + 4, 4);
+					dimensions.unit = data[8];
+					info.physicalDimensions = dimensions;
+				}
+				break;
+			case ChunkType("eXIf"):
+				info.exifOffset = dataOffset;
+				info.exifSize = length;
+				break;
+			case ChunkType("tEXt"):
+			case ChunkType("zTXt"):
+			case ChunkType("iTXt"):
+				// Malformed text is skipped as a probe does not validate the file
+				if (length <= PROBE_MAX_TEXT_SIZE && (data = file.Read(dataOffset, length)) != nullptr) {
+					Utils::PNG::TextEntry entry;
+					if (ParseTextChunk(type, std::span<const uint8_t>(data, length), entry)) { info.text.push_back(std::move(entry)); }
+				}
+				break;
+			}
+		}
+
+		return info;
+	}
+
+	bool PNG::ReadFile() {
+		IL_TRACE_SCOPE("PNG::ReadFile");
+		Memory::Scope memoryScope(m_memoryStats);
+
+		m_stageTimings = Utils::PNG::StageTimings();
+		std::chrono::steady_clock::time_point lapStart = std::chrono::steady_clock::now();
+
+		// Get and check the PNG signature
+		if (!ParseSignature()) { return false; }
+
+		// Pase PNG chunks from the data
+		if (!ParseChunks()) { return false; }
+		ResolveColourSpace();
+		m_stageTimings.parseChunks = LapSeconds(lapStart) - m_stageTimings.checkCRC;
+
+		// If the default image is the first animation frame it needs to keep its data to decode again later
+		if (m_defaultImageIsFrame) { m_frames[0].compressedData = m_compressedData; }
+
+		// Rows of the default image are counted as they are decoded, animation frames are not
+		if (m_collectStatistics) { m_statisticsAccumulator = std::make_unique<StatisticsAccumulator>(GetOutputPixelFormat()); }
+
+		// Low memory mode skips the intermediate stages and pixel data entirely
+		if (m_lowMemory) {
+			if (!DecodeIntoBuffer()) { return false; }
+		}
+		else {
+			// Initialise pixel data
+			m_pixelData.resize(m_height);
+			if (!DecodeCompressedData()) { return false; }
+		}
+
+		if (m_statisticsAccumulator) {
+			m_statistics = m_statisticsAccumulator->GetStatistics();
+			m_statisticsAccumulator.reset();
+		}
+
+		// Animation frames are decoded from the file later
+		if (!IsAnimated()) { ReleaseFileData(); }
+		return true;
+	}
+
+	uint64_t PNG::GetImageDataOffset() const noexcept {
+		return (m_compressedData.empty() ? m_position : (uint64_t)(m_compressedData.front().data() - m_fileData.data()));
+	}
+
+	bool PNG::DecodeCompressedData() {
+		std::chrono::steady_clock::time_point lapStart = std::chrono::steady_clock::now();
+
+		// Decompress the IDAT image data
+		Memory::Buffer filteredData;
+		if (!DecompressData(filteredData)) { return false; }
+		m_stageTimings.decompressData = LapSeconds(lapStart);
+
+		// Unfilter the IDAT image data
+		Memory::Buffer interlacedData;
+		if (!UnfilterData(filteredData, interlacedData)) { return false; }
+		m_stageTimings.unfilterData = LapSeconds(lapStart);
+
+		// Unpack pixels from sub-byte data
+		Memory::Buffer unpackedData = UnpackData(interlacedData);
+		m_stageTimings.unpackData = LapSeconds(lapStart);
+
+		// Deinterlace IDAT image data if interlacing was used
+		Memory::Buffer pixelData = DeinterlaceData(unpackedData);
+		m_stageTimings.deinterlaceData = LapSeconds(lapStart);
+
+		// Parse pixels
+		if (!ParsePixels(pixelData)) { return false; }
+		m_stageTimings.parsePixels = LapSeconds(lapStart);
+
+		m_compressedData.clear();
+		return true;
+	}
+
+	// Point the stream at the next chunk of compressed data once the current one has been used, returns false if there are none left
+	static bool NextCompressedChunk(z_stream& stream, const std::vector<std::span<const uint8_t>>& chunks, size_t& nextChunk) {
+		while (stream.avail_in == 0) {
+			if (nextChunk == chunks.size()) { return false; }
+			stream.next_in = const_cast<Bytef*>(chunks[nextChunk].data());
+			stream.avail_in = (uInt)chunks[nextChunk].size();
+			nextChunk++;
+		}
+		return true;
+	}
+
+	static uint8_t Paeth(uint8_t aByte, uint8_t bByte, uint8_t cByte) {
+		int p = aByte + bByte - cByte;
+		int paethA = std::abs(p - aByte);
+		int paethB = std::abs(p - bByte);
+		int paethC = std::abs(p - cByte);
+
+		if (paethA <= paethB && paethA <= paethC) { return aByte; }
+		else if (paethB <= paethC) { return bByte; }
+		return cByte;
+	}
+
+	// Reconstruct a scanline in place from the already reconstructed scanline above it, which is all zero for the first of a pass
+	// Returns false if the filter type is invalid
+	static bool UnfilterRow(uint8_t* row, const uint8_t* previousRow, size_t size, int bytesPerPixel, uint8_t filterType) {
+		size_t first = std::min<size_t>(bytesPerPixel, size);
+		switch (filterType) {
+			// None
+		case 0:
+			break;
+			// Sub
+		case 1:
+			for (size_t x = bytesPerPixel; x < size; x++) { row[x] += row[x - bytesPerPixel]; }
+			break;
+			// Up
+		case 2:
+			for (size_t x = 0; x < size; x++) { row[x] += previousRow[x]; }
+			break;
+			// Average
+		case 3:
+			for (size_t x = 0; x < first; x++) { row[x] += previousRow[x] / 2; }
+			for (size_t x = first; x < size; x++) { row[x] += (uint8_t)((row[x - bytesPerPixel] + previousRow[x]) / 2); }
+			break;
+			// Paeth
+		case 4:
+			for (size_t x = 0; x < first; x++) { row[x] += previousRow[x]; }
+			for (size_t x = first; x < size; x++) { row[x] += Paeth(row[x - bytesPerPixel], previousRow[x], previousRow[x - bytesPerPixel]); }
+			break;
+			// Invalid filter type type
+		default:
+			return false;
+		}
+		return true;
+	}
+
+	// Add an unpacked row to the sums of the squares it crosses
+	static void AddToSquares(std::vector<uint32_t>& sums, const uint8_t* row, uint32_t width, int channelCount, int channelSize, uint32_t reduction) {
+		for (uint32_t x = 0; x < width; x++) {
+			uint32_t* square = sums.data() + (size_t)(x / reduction) * channelCount;
+			for (int c = 0; c < channelCount; c++, row += channelSize) { square[c] += (channelSize == 2 ? row[0] | (row[1] << 8) : row[0]); }
+		}
+	}
+
+	// Write the rounded averages of a row of squares and clear their sums, squares at the right edge can be narrower
+	static void WriteSquares(uint8_t* output, std::vector<uint32_t>& sums, uint32_t width, uint32_t rows, int channelCount, int channelSize, uint32_t reduction) {
+		uint32_t squareCount = (width + reduction - 1) / reduction;
+		for (uint32_t i = 0; i < squareCount; i++) {
+			uint32_t count = std::min(reduction, width - i * reduction) * rows;
+			for (int c = 0; c < channelCount; c++, output += channelSize) {
+				uint32_t& sum = sums[(size_t)i * channelCount + c];
+				uint32_t value = (sum + count / 2) / count;
+				output[0] = (uint8_t)value;
+				if (channelSize == 2) { output[1] = (uint8_t)(value >> 8); }
+				sum = 0;
+			}
+		}
+	}
+
+	bool PNG::DecodeIntoBuffer() {
+		IL_TRACE_SCOPE("PNG::DecodeIntoBuffer");
+
+		std::chrono::steady_clock::time_point lapStart = std::chrono::steady_clock::now();
+
+		// The output buffer is the only allocation the size of the image, a reduced decode keeps one pixel for each square
+		m_pixelFormat = GetOutputPixelFormat();
+		int outputBytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		int channelSize = Utils::GetChannelByteSize(m_pixelFormat);
+		uint32_t reduction = m_reduction;
+		uint32_t outputWidth = (m_width + reduction - 1) / reduction;
+		uint32_t outputHeight = (m_height + reduction - 1) / reduction;
+
+		// A caller's buffer must hold every row at its stride, the last row needs no padding after it
+		size_t targetBytesPerPixel = 0, targetStride = 0;
+		if (m_target) {
+			targetBytesPerPixel = Utils::GetTargetFormatByteSize(m_target->format);
+			size_t targetRowSize = (size_t)outputWidth * targetBytesPerPixel;
+			targetStride = (m_target->rowStride == 0 ? targetRowSize : m_target->rowStride);
+			if (targetStride < targetRowSize) { return SetError(DecodeErrorKind::INVALID_TARGET, "Error: Target row stride is smaller than a row of the image", 0); }
+			if (m_target->pixels.size() < targetStride * (outputHeight - 1) + targetRowSize) { return SetError(DecodeErrorKind::INVALID_TARGET, "Error: Target buffer is too small for the image", 0); }
+		}
+		else { m_pixelBuffer.resize((size_t)outputWidth * outputHeight * outputBytesPerPixel); }
+
+		// Copy a big endian channel to a little endian one
+		auto copyChannel = [channelSize](uint8_t* dest, const uint8_t* src) {
+			dest[0] = src[channelSize - 1];
+			if (channelSize == 2) { dest[1] = src[0]; }
+		};
+
+		// Scale sub-byte greyscale to the full 8 bits, the maximum value always divides 255
+		uint8_t mask = (uint8_t)((1 << std::min<int>(m_bitDepth, 8)) - 1);
+		uint8_t greyScale = (uint8_t)(UINT8_MAX / mask);
+
+		// Information about where pixels are on each pass, an image without interlacing is a single pass over every pixel
+		static constexpr std::array<std::array<uint32_t, 4>, 7> interlacedPasses = {{
+			{0, 0, 8, 8},
+			{4, 0, 8, 8},
+			{0, 4, 4, 8},
+			{2, 0, 4, 4},
+			{0, 2, 2, 4},
+			{1, 0, 2, 2},
+			{0, 1, 1, 2}
+		}};
+		static constexpr std::array<std::array<uint32_t, 4>, 1> singlePass = {{ {0, 0, 1, 1} }};
+		std::span<const std::array<uint32_t, 4>> passes = (m_interlaceMethod == 1 ? std::span<const std::array<uint32_t, 4>>(interlacedPasses) : std::span<const std::array<uint32_t, 4>>(singlePass));
+
+		// The first pass holds every eighth pixel, the first three every fourth and the first five every other, so later passes are never inflated
+		// Without interlacing every row is needed to unfilter the next, rows are unpacked into a row buffer and averaged into squares instead
+		bool stopsEarly = (m_interlaceMethod == 1 && reduction > 1);
+		bool averaging = (m_interlaceMethod == 0 && reduction > 1);
+		if (stopsEarly) { passes = passes.first(reduction == 8 ? 1 : (reduction == 4 ? 3 : 5)); }
+		// Rows for a caller's buffer are unpacked the same way then colour managed and converted into place
+		Memory::Buffer unpackedRow(averaging || m_target ? (size_t)m_width * outputBytesPerPixel : 0);
+		std::vector<uint32_t> squareSums(averaging ? (size_t)outputWidth * (outputBytesPerPixel / channelSize) : 0);
+
+		// Inflate one scanline at a time straight from the compressed data
+		int err;
+		z_stream infStream{};
+		infStream.zalloc = Z_NULL;
+		infStream.zfree = Z_NULL;
+		infStream.opaque = Z_NULL;
+		size_t nextChunk = 0;
+
+		err = inflateInit(&infStream);
+		if (err != Z_OK) {
+			return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed", GetImageDataOffset());
+		}
+
+		// Errors in the image data are reported at how far the compressed data had been read
+		auto fail = [this, &infStream](DecodeErrorKind kind, const char* message) {
+			uint64_t offset = (infStream.next_in ? (uint64_t)(infStream.next_in - m_fileData.data()) : GetImageDataOffset());
+			inflateEnd(&infStream);
+			return SetError(kind, message, offset);
+		};
+
+		// Scanlines including their filter type byte, the previous one is needed to unfilter the next
+		Memory::Buffer scanline, previousScanline;
+		bool streamEnded = false;
+		for (const std::array<uint32_t, 4>& pass : passes) {
+			uint32_t xStart = pass[0];
+			uint32_t yStart = pass[1];
+			uint32_t xStep = pass[2];
+			uint32_t yStep = pass[3];
+
+			if (xStart >= m_width || yStart >= m_height) { continue; }
+
+			uint32_t pixelsPerRow = (m_width - xStart + xStep - 1) / xStep;
+			size_t rowSize = (m_bitDepth < 8 ? ((size_t)pixelsPerRow * m_bitDepth + 7) / 8 : (size_t)pixelsPerRow * m_bytesPerPixel);
+			scanline.assign(rowSize + 1, 0);
+			previousScanline.assign(rowSize + 1, 0);
+
+			for (uint32_t y = yStart; y < m_height; y += yStep) {
+				// Decompress the scanline
+				infStream.next_out = scanline.data();
+				infStream.avail_out = (uInt)scanline.size();
+				while (infStream.avail_out != 0) {
+					if (streamEnded) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Image data does not match image dimensions"); }
+
+					NextCompressedChunk(infStream, m_compressedData, nextChunk);
+					err = inflate(&infStream, Z_SYNC_FLUSH);
+					if (err == Z_STREAM_END) { streamEnded = true; }
+					else if (err != Z_OK) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed"); }
+					else if (infStream.avail_out != 0 && !NextCompressedChunk(infStream, m_compressedData, nextChunk)) { return fail(DecodeErrorKind::TRUNCATED, "Error: Image data is truncated"); }
+				}
+				m_stageTimings.decompressData += LapSeconds(lapStart);
+
+				if (!UnfilterRow(scanline.data() + 1, previousScanline.data() + 1, rowSize, m_bytesPerPixel, scanline[0])) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Invalid filter type"); }
+				m_stageTimings.unfilterData += LapSeconds(lapStart);
+
+				// Unpack each pixel of the scanline into its place in the image
+				// Passes kept by a reduced decode start on and step by whole squares
+				const uint8_t* row = scanline.data() + 1;
+				bool unpackToRow = (averaging || m_target);
+				uint8_t* output = (unpackToRow ? unpackedRow.data() : m_pixelBuffer.data() + ((size_t)(y / reduction) * outputWidth + xStart / reduction) * outputBytesPerPixel);
+				size_t outputStep = (size_t)(unpackToRow ? 1 : xStep / reduction) * outputBytesPerPixel;
+				for (uint32_t i = 0; i < pixelsPerRow; i++, output += outputStep) {
+					const uint8_t* sample = row + (size_t)i * m_bytesPerPixel;
+					uint8_t value = 0;
+					if (m_bitDepth < 8) {
+						uint32_t bit = i * m_bitDepth;
+						value = (row[bit / 8] >> (8 - m_bitDepth - bit % 8)) & mask;
+					}
+
+					switch (m_colourType) {
+						// Greyscale
+					case 0:
+						if (m_bitDepth < 8) {
+							output[0] = output[1] = output[2] = value * greyScale;
+							break;
+						}
+						copyChannel(output, sample);
+						copyChannel(output + channelSize, sample);
+						copyChannel(output + 2 * channelSize, sample);
+						break;
+						// Truecolour
+					case 2:
+						[[fallthrough]];
+						// Truecolour with alpha
+					case 6:
+						for (int c = 0; c < outputBytesPerPixel / channelSize; c++) { copyChannel(output + c * channelSize, sample + c * channelSize); }
+						break;
+						// Indexed colour
+					case 3: {
+						uint8_t index = (m_bitDepth < 8 ? value : sample[0]);
+						if (index >= m_PLTEData.size()) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Palette index out of range"); }
+						const Utils::Pixel& pixel = m_PLTEData[index];
+						output[0] = (uint8_t)pixel.R;
+						output[1] = (uint8_t)pixel.G;
+						output[2] = (uint8_t)pixel.B;
+						if (Utils::HasAlphaChannel(m_pixelFormat)) { output[3] = (uint8_t)pixel.A; }
+						break;
+					}
+						// Greyscale with alpha
+					case 4:
+						copyChannel(output, sample);
+						copyChannel(output + channelSize, sample);
+						copyChannel(output + 2 * channelSize, sample);
+						copyChannel(output + 3 * channelSize, sample + channelSize);
+						break;
+					}
+				}
+
+				if (m_target) {
+					ConvertToDisplay(std::span<uint8_t>(unpackedRow.data(), (size_t)pixelsPerRow * outputBytesPerPixel), m_pixelFormat);
+					uint8_t* targetRow = m_target->pixels.data() + (size_t)y * targetStride + (size_t)xStart * targetBytesPerPixel;
+					Utils::ConvertPixels(unpackedRow.data(), m_pixelFormat, targetRow, (size_t)xStep * targetBytesPerPixel, m_target->format, pixelsPerRow);
+				}
+				else if (averaging) {
+					AddToSquares(squareSums, unpackedRow.data(), m_width, outputBytesPerPixel / channelSize, channelSize, reduction);
+					if ((y + 1) % reduction == 0 || y + 1 == m_height) {
+						WriteSquares(m_pixelBuffer.data() + (size_t)(y / reduction) * outputWidth * outputBytesPerPixel, squareSums, m_width, y % reduction + 1, outputBytesPerPixel / channelSize, channelSize, reduction);
+					}
+				}
+
+				// Every pixel is written by exactly one pass so each pass's rows can be counted as they are
+				if (m_statisticsAccumulator) { m_statisticsAccumulator->AddPixels(m_pixelBuffer.data() + ((size_t)y * m_width + xStart) * outputBytesPerPixel, pixelsPerRow, outputStep); }
+				m_stageTimings.parsePixels += LapSeconds(lapStart);
+
+				std::swap(scanline, previousScanline);
+			}
+		}
+
+		// The stream must end exactly where the image does, unless the passes left were never needed
+		while (!streamEnded && !stopsEarly) {
+			uint8_t extra;
+			infStream.next_out = &extra;
+			infStream.avail_out = 1;
+
+			bool inputLeft = NextCompressedChunk(infStream, m_compressedData, nextChunk);
+			err = inflate(&infStream, Z_SYNC_FLUSH);
+			if (infStream.avail_out == 0) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Image data is larger than the image"); }
+			if (err == Z_STREAM_END) { streamEnded = true; }
+			else if ((err == Z_OK || err == Z_BUF_ERROR) && !inputLeft) { return fail(DecodeErrorKind::TRUNCATED, "Error: Image data is truncated"); }
+			else if (err != Z_OK) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed"); }
+		}
+		m_stageTimings.decompressData += LapSeconds(lapStart);
+
+		inflateEnd(&infStream);
+		m_compressedData.clear();
+		m_width = outputWidth;
+		m_height = outputHeight;
+		return true;
+	}
+
+	bool PNG::ParseSignature() {
+		if (GetRemainingSize() < 8) { return Fail(DecodeErrorKind::NOT_PNG, "Error: File is too small to be a PNG"); }
+
+		// Check signature is correct
+		// XOR and consume the first 8 values
+		uint8_t check = 0;
+		for (int i = 0; i < 8; i++) {
+			uint8_t temp = GetFileData()[0];
+			check ^= temp;
+			m_position++;
+		}
+
+		// Check header is valid
+		if (check != Utils::PNG_SIGNATURE) {
+			return Fail(DecodeErrorKind::NOT_PNG, "Error: PNG signature is invalid");
+		}
+
+		return true;
+	}
+
+	bool PNG::ParseChunks() {
+		IL_TRACE_SCOPE("PNG::ParseChunks");
+
+		std::vector<Utils::PNG::Chunk> encounteredChunks;
+		bool encounteredIDAT = false;
+		int chunksIndex = 0;
+
+		do {
+			// Errors are reported at the start of the chunk they were found in
+			m_chunkStart = m_position;
+
+			// Every chunk has at least a length, type and CRC
+			if (GetRemainingSize() < 12) { return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file"); }
+
+			// Consume chunk length remembering it is big endian
+			uint32_t length;
+			Utils::ExtractBigEndianBytes(length, GetFileData(), 4);
+			m_position += 4;
+
+			// Check length is within standard
+			if (length > (INT_MAX - 1)) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid chunk length"); }
+			if (GetRemainingSize() - 8 < length) { return Fail(DecodeErrorKind::TRUNCATED, "Error: Unexpected end of file"); }
+
+			// Check CRC matches data
+			if (!CheckCRC(length)) { return false; }
+
+			// Copy and consume chunk specifier
+			std::string chunkSpecifier((const char*)GetFileData(), 4);
+			m_position += 4;
+
+			Utils::PNG::ChunkIdentifier chunkSpecifierE = Utils::PNG::StringToFormat(chunkSpecifier);
+
+			// If chunk is unknown skip the chunk
+			if (chunkSpecifierE == Utils::PNG::UNKOWN) {
+				m_position += length + 4;
+				continue;
+			}
+
+			// If chunk is invalid exit
+			if (chunkSpecifierE == Utils::PNG::INVALID) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Encountered chunk is invalid"); }
+
+			// Ensure the correct chunk is encountered first
+			if (chunksIndex == 0 && chunkSpecifierE != Utils::PNG::IHDR) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - IHDR is not first"); }
+
+			// Check IDAT chunks are consecutive
+			if (encounteredIDAT && chunkSpecifierE == Utils::PNG::IDAT) {
+				if (encounteredChunks.back().identifier != Utils::PNG::IDAT) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - IDAT are not consecutive"); }
+			}
+
+			// TODO: Clean
+			switch (chunkSpecifierE) {
+			case Utils::PNG::IHDR:
+				CheckChunkOccurence(encounteredChunks, Utils::PNG::IHDR, 0);
+				if (length != 13) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: IHDR chunk is invalid"); }
+				if (!ParseIHDR()) { return false; }
+				break;
+			case Utils::PNG::PLTE:
+				if (m_colourType == 0 || m_colourType == 4) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: PLTE chunk must not appear for his colour type"); }
+				CheckChunkOccurence(encounteredChunks, Utils::PNG::PLTE, 0);
+				if (!ParsePLTE(length)) { return false; }
+				break;
+			case Utils::PNG::IDAT:
+				if (m_colourType == 3 && !CheckChunkOccurence(encounteredChunks, Utils::PNG::PLTE, 1)) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - PLTE required before IDAT"); }
+				// Consume IDAT data into compressed data
+				encounteredIDAT = true;
+				m_compressedData.push_back(std::span<const uint8_t>(GetFileData(), length));
+				m_position += length + 4;
+				break;
+			case Utils::PNG::gAMA:
+				ParsegAMA(length, encounteredIDAT);
+				break;
+			case Utils::PNG::cHRM:
+				ParsecHRM(length, encounteredIDAT);
+				break;
+			case Utils::PNG::sRGB:
+				ParsesRGB(length, encounteredIDAT);
+				break;
+			case Utils::PNG::iCCP:
+				ParseiCCP(length, encounteredIDAT);
+				break;
+			case Utils::PNG::cICP:
+				ParsecICP(length, encounteredIDAT);
+				break;
+			case Utils::PNG::acTL:
+				if (encounteredIDAT) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - acTL must appear before IDAT"); }
+				if (!CheckChunkOccurence(encounteredChunks, Utils::PNG::acTL, 0)) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Multiple acTL chunks"); }
+				if (!ParseacTL(length)) { return false; }
+				break;
+			case Utils::PNG::fcTL:
+				if (!CheckChunkOccurence(encounteredChunks, Utils::PNG::acTL, 1)) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - acTL required before fcTL"); }
+				if (!ParsefcTL(length, encounteredIDAT)) { return false; }
+				break;
+			case Utils::PNG::fdAT:
+				if (!encounteredIDAT || m_frames.empty()) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - fdAT must follow IDAT and fcTL"); }
+				if (!ParsefdAT(length)) { return false; }
+				break;
+			case Utils::PNG::IEND:
+				// Ensure every frame announced was present
+				if (m_numFrames != m_frames.size()) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: APNG frame count does not match acTL"); }
+				// Consume CRC
+				m_position += 4;
+				// Ensure IEND is last data
+				if (GetRemainingSize() > 0) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Data is present after IEND chunk"); }
+				break;
+			}
+
+			// Add encountered chunk to list
+			encounteredChunks.push_back(Utils::PNG::Chunk{ .identifier = chunkSpecifierE, .position = chunksIndex });
+			chunksIndex++;
+		} while (encounteredChunks.back().identifier != Utils::PNG::IEND);
+
+		return true;
+	}
+
+	bool PNG::CheckChunkOccurence(const std::vector<Utils::PNG::Chunk>& encounteredChunks, Utils::PNG::ChunkIdentifier chunk, int number) {
+		int count = std::count_if(encounteredChunks.begin(), encounteredChunks.end(), [chunk](Utils::PNG::Chunk val) { return val.identifier == chunk; });
+		return (count == number ? true : false);
+	}
+
+	bool PNG::CheckCRC(uint32_t length) {
+		IL_TRACE_SCOPE("PNG::CheckCRC");
+
+		// Taken directly from specification and cleaned slightly
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		// Get the CRC in the chunk remembering it is big endian
+		uint32_t chunkCRC;
+		Utils::ExtractBigEndianBytes(chunkCRC, GetFileData() + 4 + length, 4);
+
+		// Calculate the expected CRC
+		uint32_t c = 0xffffffffL;
+
+		for (uint32_t n = 0; n < length + 4; n++) {
+			c = m_crcTable[(c ^ GetFileData()[n]) & 0xff] ^ (c >> 8);
+		}
+
+		uint32_t calculatedCRC = c ^ 0xffffffffL;
+		m_stageTimings.checkCRC += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Compare calculated and stored CRC
+		if (chunkCRC != calculatedCRC) {
+			return Fail(DecodeErrorKind::CRC_MISMATCH, "Error: Chunk CRC mismatch");
+		}
+
+		return true;
+	}
+
+	bool PNG::ParseIHDR() {
+		// Consume width remembering it is big endian
+		Utils::ExtractBigEndianBytes(m_width, GetFileData(), 4);
+		m_position += 4;
+
+		// Consume height remembering it is big endian
+		Utils::ExtractBigEndianBytes(m_height, GetFileData(), 4);
+		m_position += 4;
+
+		// Perform checks on dimensions
+		if (m_width > Utils::PNG_SPEC_MAX_DIMENSION || m_height > Utils::PNG_SPEC_MAX_DIMENSION || m_width == 0 || m_height == 0) {
+			return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Image dimensions invalid");
+		}
+
+		if (m_width > Utils::PNG_APP_MAX_DIMENSION || m_height > Utils::PNG_APP_MAX_DIMENSION) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Application cannot display image"); }
+
+		// Get more image info
+		m_bitDepth = GetFileData()[0];
+		m_colourType = GetFileData()[1];
+		m_compressionMethod = GetFileData()[2];
+		m_filterMethod = GetFileData()[3];
+		m_interlaceMethod = GetFileData()[4];
+
+		// Consume additional information and CRC
+		m_position += 9;
+
+		// Check image info and set number of bytes per pixel
+		switch (m_colourType) {
+		// Greyscale
+		case 0:
+			if (m_bitDepth != 1 && m_bitDepth != 2 && m_bitDepth != 4 && m_bitDepth != 8 && m_bitDepth != 16) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type and bit depth combination");
+			}
+			m_bytesPerPixel = (m_bitDepth == 16 ? 2 : 1);
+			break;
+		// True colour
+		case 2:
+			if (m_bitDepth != 8 && m_bitDepth != 16) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type and bit depth combination");
+			}
+			m_bytesPerPixel = 3 * (m_bitDepth / 8);
+			break;
+		// Indexed Colour
+		case 3:
+			if (m_bitDepth != 1 && m_bitDepth != 2 && m_bitDepth != 4 && m_bitDepth != 8) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type and bit depth combination");
+			}
+			m_bytesPerPixel = 1;
+			break;
+		// Greyscale alpha
+		case 4:
+			if (m_bitDepth != 8 && m_bitDepth != 16) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type and bit depth combination");
+			}
+			m_bytesPerPixel = 2 * (m_bitDepth / 8);
+			break;
+		// True colour alpha
+		case 6:
+			if (m_bitDepth != 8 && m_bitDepth != 16) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type and bit depth combination");
+			}
+			m_bytesPerPixel = 4 * (m_bitDepth / 8);
+			break;
+		// Invalid colour type
+		default:
+			return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: Invalid colour type");
+		}
+
+		// Do not process images with private compression methods
+		if (m_compressionMethod != 0) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Incompatible compression method"); }
+
+		// Do not process images with private filter methods
+		if (m_filterMethod != 0) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Incompatible filter method"); }
+
+		// Do not process images with private interlace methods
+		if (m_interlaceMethod != 0 && m_interlaceMethod != 1) { return Fail(DecodeErrorKind::UNSUPPORTED, "Error: Incompatible interlace method"); }
+
+		return true;
+	}
+
+	bool PNG::ParsePLTE(uint32_t length) {
+		// Do some checking that this chunk is valid and should be present
+		if (m_colourType == 3 && length % 3 != 0) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: PLTE chunk is invalid"); }
+		else if (length % 3 != 0) {
+			// Palette is only a suggestion for this colour type so ignore it
+			m_position += length + 4;
+			return true;
+		}
+
+		if ((length / 3) > std::pow(2, m_bitDepth)) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: PLTE chunk is invalid"); }
+
+		// Copy pixel data
+		for (int i = 0; i < (length / 3); i++) {
+			Utils::Pixel pixel;
+
+			pixel.R = GetFileData()[i * 3];
+			pixel.G = GetFileData()[(i * 3) + 1];
+			pixel.B = GetFileData()[(i * 3) + 2];
+
+			m_PLTEData.push_back(pixel);
+		}
+
+		// Erase rest of chunk
+		m_position += length + 4;
+
+		return true;
+	}
+
+	// Colour chunks are ancillary so one that is malformed or after the image data is ignored rather than failing the decode
+	void PNG::ParsegAMA(uint32_t length, bool encounteredIDAT) {
+		if (length == 4 && !encounteredIDAT) {
+			uint32_t gamma;
+			Utils::ExtractBigEndianBytes(gamma, GetFileData(), 4);
+			if (gamma != 0) { m_colourChunks.gamma = gamma; }
+		}
+		m_position += length + 4;
+	}
+
+	void PNG::ParsecHRM(uint32_t length, bool encounteredIDAT) {
+		if (length == 32 && !encounteredIDAT) {
+			std::array<uint32_t, 8> chromaticities;
+			for (int i = 0; i < 8; i++) { Utils::ExtractBigEndianBytes(chromaticities[i], GetFileData() + i * 4, 4); }
+			m_colourChunks.chromaticities = chromaticities;
+		}
+		m_position += length + 4;
+	}
+
+	void PNG::ParsesRGB(uint32_t length, bool encounteredIDAT) {
+		if (length == 1 && !encounteredIDAT) { m_colourChunks.sRGB = true; }
+		m_position += length + 4;
+	}
+
+	void PNG::ParseiCCP(uint32_t length, bool encounteredIDAT) {
+		// Profile name, compression method then the compressed profile
+		std::span<const uint8_t> data(GetFileData(), length);
+		auto nameEnd = std::find(data.begin(), data.end(), 0);
+		if (!encounteredIDAT && nameEnd != data.end() && nameEnd + 1 != data.end() && nameEnd[1] == 0) {
+			std::vector<uint8_t> profile;
+			if (InflateChunkData(std::span<const uint8_t>(nameEnd + 2, data.end()), profile, MAX_ICC_PROFILE_SIZE)) { m_colourChunks.iccProfile = std::move(profile); }
+		}
+		m_position += length + 4;
+	}
+
+	void PNG::ParsecICP(uint32_t length, bool encounteredIDAT) {
+		if (length == 4 && !encounteredIDAT) { m_colourChunks.cicp = std::array<uint8_t, 4>{ GetFileData()[0], GetFileData()[1], GetFileData()[2], GetFileData()[3] }; }
+		m_position += length + 4;
+	}
+
+	void PNG::ResolveColourSpace() {
+		// Chunks are used in the order of precedence the specification gives, falling back to the next if one cannot be used
+		const Utils::PNG::ColourChunks& chunks = m_colourChunks;
+		if (chunks.cicp) {
+			m_colourSpace = ColourSpace::FromCICP((*chunks.cicp)[0], (*chunks.cicp)[1], (*chunks.cicp)[2], (*chunks.cicp)[3]);
+			if (m_colourSpace) { return; }
+		}
+		if (!chunks.iccProfile.empty()) {
+			m_colourSpace = ColourSpace::FromICCProfile(chunks.iccProfile);
+			if (m_colourSpace) { return; }
+		}
+
+		// The sRGB chunk needs no conversion, nor does a file with no colour chunks
+		if (chunks.sRGB || (!chunks.gamma && !chunks.chromaticities)) { return; }
+
+		// Whichever of gamma and chromaticities is missing is taken from sRGB
+		ColourSpace::ToneCurve curve = (chunks.gamma ? ColourSpace::Gamma(100000.0 / *chunks.gamma) : ColourSpace::SRGBCurve());
+		if (chunks.chromaticities) {
+			std::array<double, 8> chromaticities;
+			for (int i = 0; i < 8; i++) { chromaticities[i] = (*chunks.chromaticities)[i] / 100000.0; }
+			m_colourSpace = ColourSpace::FromChromaticities(chromaticities, curve);
+		}
+		else {
+			m_colourSpace = ColourSpace::SRGB();
+			m_colourSpace->curves = { curve, curve, curve };
+		}
+	}
+
+	bool PNG::ParseacTL(uint32_t length) {
+		if (length != 8) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: acTL chunk is invalid"); }
+
+		// Consume number of frames and plays remembering they are big endian
+		Utils::ExtractBigEndianBytes(m_numFrames, GetFileData(), 4);
+		Utils::ExtractBigEndianBytes(m_numPlays, GetFileData() + 4, 4);
+		if (m_numFrames == 0) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: acTL chunk is invalid"); }
+
+		// Images in the cache have no frames so animations must always be decoded
+		m_cacheable = false;
+
+		// Consume chunk and CRC
+		m_position += length + 4;
+
+		return true;
+	}
+
+	bool PNG::ParsefcTL(uint32_t length, bool encounteredIDAT) {
+		if (length != 26) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: fcTL chunk is invalid"); }
+
+		Utils::PNG::FrameControl control;
+		if (!ConsumeSequenceNumber(control.sequenceNumber)) { return false; }
+
+		// Consume frame region and timing remembering they are big endian
+		Utils::ExtractBigEndianBytes(control.width, GetFileData(), 4);
+		Utils::ExtractBigEndianBytes(control.height, GetFileData() + 4, 4);
+		Utils::ExtractBigEndianBytes(control.xOffset, GetFileData() + 8, 4);
+		Utils::ExtractBigEndianBytes(control.yOffset, GetFileData() + 12, 4);
+		Utils::ExtractBigEndianBytes(control.delayNumerator, GetFileData() + 16, 2);
+		Utils::ExtractBigEndianBytes(control.delayDenominator, GetFileData() + 18, 2);
+		uint8_t disposeOp = GetFileData()[20];
+		uint8_t blendOp = GetFileData()[21];
+
+		// Check the frame is within the canvas and uses known operations
+		if (control.width == 0 || control.height == 0 || (uint64_t)control.xOffset + control.width > m_width || (uint64_t)control.yOffset + control.height > m_height) {
+			return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: fcTL frame region is outside of the image");
+		}
+		if (disposeOp > Utils::PNG::DISPOSE_OP_PREVIOUS || blendOp > Utils::PNG::BLEND_OP_OVER) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: fcTL chunk is invalid"); }
+		control.disposeOp = (Utils::PNG::DisposeOp)disposeOp;
+		control.blendOp = (Utils::PNG::BlendOp)blendOp;
+
+		// A frame control before IDAT makes the default image the first frame and it must cover the whole image
+		if (!encounteredIDAT) {
+			if (control.xOffset != 0 || control.yOffset != 0 || control.width != m_width || control.height != m_height) {
+				return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: First fcTL frame region must match IHDR");
+			}
+			m_defaultImageIsFrame = true;
+		}
+
+		if (m_frames.size() >= m_numFrames) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: APNG frame count does not match acTL"); }
+		m_frames.push_back(Frame{ .control = control });
+
+		// Consume rest of chunk and CRC
+		m_position += length;
+
+		return true;
+	}
+
+	bool PNG::ParsefdAT(uint32_t length) {
+		if (length < 4) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: fdAT chunk is invalid"); }
+		uint32_t sequenceNumber;
+		if (!ConsumeSequenceNumber(sequenceNumber)) { return false; }
+
+		// The default image has no fdAT chunks so these can only belong to a later frame
+		if (m_defaultImageIsFrame && m_frames.size() == 1) { return Fail(DecodeErrorKind::INVALID_CHUNK_ORDER, "Error: Chunk order is invalid - fdAT requires fcTL"); }
+
+		// Consume frame data into the current frame
+		Frame& frame = m_frames.back();
+		frame.compressedData.push_back(std::span<const uint8_t>(GetFileData(), length - 4));
+		m_position += length;
+
+		return true;
+	}
+
+	bool PNG::ConsumeSequenceNumber(uint32_t& sequenceNumber) {
+		// Frame chunks share a sequence that must have no gaps
+		Utils::ExtractBigEndianBytes(sequenceNumber, GetFileData(), 4);
+		m_position += 4;
+
+		if (sequenceNumber != m_nextSequenceNumber) { return Fail(DecodeErrorKind::INVALID_CHUNK, "Error: APNG sequence number out of order"); }
+		m_nextSequenceNumber++;
+
+		return true;
+	}
+
+	Memory::Buffer PNG::DecodeFrame(uint32_t index) {
+		IL_TRACE_SCOPE("PNG::DecodeFrame");
+		m_memoryStats = Memory::Stats();
+		Memory::Scope memoryScope(m_memoryStats);
+
+		const Frame& frame = m_frames.at(index);
+		if (frame.compressedData.empty()) { throw new std::runtime_error("Error: APNG frame has no image data"); }
+
+		// The decode stages work on the image dimensions and data so point them at the frame, keeping the default image aside
+		uint32_t width = m_width;
+		uint32_t height = m_height;
+		Utils::PixelFormat pixelFormat = m_pixelFormat;
+		Memory::Vector<Memory::Vector<Utils::Pixel>> pixelData(frame.control.height);
+		std::swap(m_pixelData, pixelData);
+		m_width = frame.control.width;
+		m_height = frame.control.height;
+		m_compressedData = frame.compressedData;
+
+		Memory::Buffer output;
+		m_stageTimings = Utils::PNG::StageTimings();
+		bool decoded = DecodeCompressedData();
+		if (decoded) {
+			// Frames are composited so they always need an alpha channel
+			if (!Utils::HasAlphaChannel(m_pixelFormat)) {
+				for (auto& row : m_pixelData) {
+					std::for_each(row.begin(), row.end(), [](Utils::Pixel& val) { val.A = UINT16_MAX; });
+				}
+				m_pixelFormat = Utils::GetAlphaPixelFormat(m_pixelFormat);
+			}
+
+			output = PixelDataToBuffer();
+			ConvertToDisplay(output, m_pixelFormat);
+		}
+
+		// Restore the default image
+		std::swap(m_pixelData, pixelData);
+		m_width = width;
+		m_height = height;
+		m_pixelFormat = pixelFormat;
+
+		// A bad frame does not make the default image any less valid so the error is not kept
+		if (!decoded) {
+			const char* message = m_error->message;
+			m_error.reset();
+			throw new std::runtime_error(message);
+		}
+
+		return output;
+	}
+
+	bool PNG::DecompressData(Memory::Buffer& output) {
+		IL_TRACE_SCOPE("PNG::DecompressData");
+
+		// Decompress IDAT data
+		int err;
+		z_stream infStream{};
+		infStream.zalloc = Z_NULL;
+		infStream.zfree = Z_NULL;
+		infStream.opaque = Z_NULL;
+		size_t nextChunk = 0;
+
+		// Initialise the infaltion
+		err = inflateInit(&infStream);
+		if (err != Z_OK) {
+			return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed", GetImageDataOffset());
+		}
+
+		// Errors in the image data are reported at how far the compressed data had been read
+		auto fail = [this, &infStream](DecodeErrorKind kind, const char* message) {
+			uint64_t offset = (infStream.next_in ? (uint64_t)(infStream.next_in - m_fileData.data()) : GetImageDataOffset());
+			inflateEnd(&infStream);
+			return SetError(kind, message, offset);
+		};
+
+		// Inflated data larger than the image needs is corrupt so stop before it takes up memory
+		size_t expectedSize = GetFilteredDataSize();
+		output.reserve(expectedSize);
+
+		// Arbitrary size to process
+		Memory::Buffer tempOutput(65536);
+
+		// Run inflate until all data has been decompressed
+		do {
+			infStream.next_out = tempOutput.data();
+			infStream.avail_out = (uInt)tempOutput.size();
+
+			// Perform decompression, moving on to the next chunk once the current one is used
+			NextCompressedChunk(infStream, m_compressedData, nextChunk);
+			err = inflate(&infStream, Z_SYNC_FLUSH);
+			if (!(err == Z_OK || err == Z_STREAM_END)) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed"); }
+
+			// Copy decompressed data chunk
+			std::copy(tempOutput.begin(), tempOutput.begin() + (tempOutput.size() - infStream.avail_out), std::back_inserter(output));
+			if (output.size() > expectedSize) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Image data is larger than the image"); }
+
+			// Input running out before the end of the stream means the data is truncated
+			if (err == Z_OK && !NextCompressedChunk(infStream, m_compressedData, nextChunk) && infStream.avail_out != 0) { return fail(DecodeErrorKind::TRUNCATED, "Error: Image data is truncated"); }
+		} while (err != Z_STREAM_END);
+
+		inflateEnd(&infStream);
+
+		if (output.size() != expectedSize) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Image data does not match image dimensions", GetImageDataOffset()); }
+
+		return true;
+	}
+
+	size_t PNG::GetFilteredDataSize() const {
+		// Each scanline is a filter type byte followed by its packed pixels, interlaced images have a set of scanlines per pass
+		auto scanlineSize = [this](uint64_t pixels) -> size_t { return 1 + (size_t)(m_bitDepth < 8 ? (pixels * m_bitDepth + 7) / 8 : pixels * m_bytesPerPixel); };
+
+		if (m_interlaceMethod == 0) { return m_height * scanlineSize(m_width); }
+
+		static constexpr std::array<std::array<uint32_t, 4>, 7> passes = {{
+			{0, 0, 8, 8},
+			{4, 0, 8, 8},
+			{0, 4, 4, 8},
+			{2, 0, 4, 4},
+			{0, 2, 2, 4},
+			{1, 0, 2, 2},
+			{0, 1, 1, 2}
+		}};
+
+		size_t size = 0;
+		for (const auto& pass : passes) {
+			if (pass[0] >= m_width || pass[1] >= m_height) { continue; }
+			uint64_t pixelsPerRow = (m_width - pass[0] + pass[2] - 1) / pass[2];
+			uint64_t rows = (m_height - pass[1] + pass[3] - 1) / pass[3];
+			size += rows * scanlineSize(pixelsPerRow);
+		}
+		return size;
+	}
+
+	bool PNG::UnfilterData(Memory::Buffer& input, Memory::Buffer& output) {
+		IL_TRACE_SCOPE("PNG::UnfilterData");
+
+		// Information about where pixels are on each pass, images that are not interlaced are a single pass of every pixel
+		static constexpr std::array<std::array<uint32_t, 4>, 7> passes = {{
+			{0, 0, 8, 8},
+			{4, 0, 8, 8},
+			{0, 4, 4, 8},
+			{2, 0, 4, 4},
+			{0, 2, 2, 4},
+			{1, 0, 2, 2},
+			{0, 1, 1, 2}
+		}};
+		static constexpr std::array<std::array<uint32_t, 4>, 1> noInterlacing = {{ {0, 0, 1, 1} }};
+		std::span<const std::array<uint32_t, 4>> passList = (m_interlaceMethod == 0 ? std::span<const std::array<uint32_t, 4>>(noInterlacing) : std::span<const std::array<uint32_t, 4>>(passes));
+
+		// Scanlines are read by offset rather than consumed so the data is only walked once
+		// The first scanline of each pass is unfiltered against a row of zeros
+		output.resize(input.size());
+		Memory::Buffer zeroRow;
+		size_t inputOffset = 0;
+		size_t outputOffset = 0;
+		for (const auto& pass : passList) {
+			uint32_t xStart = pass[0];
+			uint32_t yStart = pass[1];
+			uint32_t xStep = pass[2];
+			uint32_t yStep = pass[3];
+
+			if (xStart >= m_width || yStart >= m_height) { continue; }
+
+			uint32_t pixelsPerRow = (m_width - xStart + xStep - 1) / xStep;
+			size_t rowSize = (m_bitDepth < 8 ? ((size_t)pixelsPerRow * m_bitDepth + 7) / 8 : (size_t)pixelsPerRow * m_bytesPerPixel);
+			if (zeroRow.size() < rowSize) { zeroRow.assign(rowSize, 0); }
+			const uint8_t* previousRow = zeroRow.data();
+
+			for (uint32_t y = yStart; y < m_height; y += yStep) {
+				uint8_t filterType = input[inputOffset];
+				if (filterType > 4) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Invalid filter type", GetImageDataOffset()); }
+
+				uint8_t* row = output.data() + outputOffset;
+				std::copy(input.begin() + inputOffset + 1, input.begin() + inputOffset + 1 + rowSize, row);
+				UnfilterRow(row, previousRow, rowSize, m_bytesPerPixel, filterType);
+
+				previousRow = row;
+				inputOffset += rowSize + 1;
+				outputOffset += rowSize;
+			}
+		}
+		output.resize(outputOffset);
+
+		// Input has been fully consumed
+		input.clear();
+		input.shrink_to_fit();
+
+		return true;
+	}
+
+	Memory::Buffer PNG::UnpackData(Memory::Buffer& input) {
+		IL_TRACE_SCOPE("PNG::UnpackData");
+
+		if (m_bitDepth >= 8) { return std::move(input); }
+
+		Memory::Buffer output;
+		output.reserve((size_t)m_width * m_height);
+
+		// Create functor for extracting a row of values, each scanline starts on a byte boundary
+		uint8_t mask = (uint8_t)((1 << m_bitDepth) - 1);
+		size_t offset = 0;
+		auto extractRow = [bitDepth = m_bitDepth, mask, &offset, &input, &output](uint32_t pixelsPerRow) -> void {
+			for (uint32_t x = 0; x < pixelsPerRow; x++) {
+				uint32_t bit = x * bitDepth;
+				output.push_back((input[offset + bit / 8] >> (8 - bitDepth - bit % 8)) & mask);
+			}
+
+			// Move to the next scanline skipping any padding bits
+			offset += (pixelsPerRow * bitDepth + 7) / 8;
+		};
+
+		// The data is not perfectly packed into bytes due to how scanlines are filtered
+		// Information about where pixels are on each pass
+		std::array<std::array<int, 4>, 7> passes = { {
+			{0, 0, 8, 8},
+			{4, 0, 8, 8},
+			{0, 4, 4, 8},
+			{2, 0, 4, 4},
+			{0, 2, 2, 4},
+			{1, 0, 2, 2},
+			{0, 1, 1, 2}
+		} };
+
+		if (m_interlaceMethod == 1) {
+			// Iterate over the image for each pass and unpack scanlines appropriately
+			for (int i = 0; i < 7; i++) {
+				// Initialise pass data
+				std::array<int, 4> pass = passes[i];
+				uint32_t xStart = pass[0];
+				uint32_t yStart = pass[1];
+				uint32_t xStep = pass[2];
+				uint32_t yStep = pass[3];
+
+				if (xStart >= m_width || yStart >= m_height) { continue; }
+
+				uint32_t pixelsPerRow = (m_width - xStart + xStep - 1) / xStep;
+				uint32_t rowsPerPass = (m_height - yStart + yStep - 1) / yStep;
+
+				for (uint32_t j = 0; j < rowsPerPass; j++) { extractRow(pixelsPerRow); }
+			}
+		}
+		else {
+			for (uint32_t y = 0; y < m_height; y++) { extractRow(m_width); }
+		}
+
+		// Input has been fully consumed
+		input.clear();
+		input.shrink_to_fit();
+
+		return output;
+	}
+
+	Memory::Buffer PNG::DeinterlaceData(Memory::Buffer& input) {
+		IL_TRACE_SCOPE("PNG::DeinterlaceData");
+
+		// If no interlacing has been done, simply return data
+		if (m_interlaceMethod == 0) { return std::move(input); }
+
+		// Initialise output data and pass information
+		Memory::Buffer output((size_t)m_width * m_height * m_bytesPerPixel);
+		std::array<std::array<int, 4>, 7> passes = {{
+			{0, 0, 8, 8},
+			{4, 0, 8, 8},
+			{0, 4, 4, 8},
+			{2, 0, 4, 4},
+			{0, 2, 2, 4},
+			{1, 0, 2, 2},
+			{0, 1, 1, 2}
+		}};
+
+		// Iterate over the image for each pass and deinterlace scanlines appropriately
+		size_t inputOffset = 0;
+		for (int i = 0; i < 7; i++) {
+			// Initialise pass data
+			std::array<int, 4> pass = passes[i];
+			int xStart = pass[0];
+			int yStart = pass[1];
+			int xStep = pass[2];
+			int yStep = pass[3];
+
+			if (xStart >= m_width) { continue; }
+
+			int pixelsPerRow = std::ceil((m_width - xStart) / (double)xStep);
+
+			// Iterate over each scanline in the pass
+			for (int y = yStart; y < m_height; y += yStep) {
+				// Calculate where in the output image this pixel will appear
+				size_t rowOffset = (size_t)y * m_width * m_bytesPerPixel + (size_t)xStart * m_bytesPerPixel;
+				size_t skip = (size_t)m_bytesPerPixel * xStep;
+
+				// Iterate over pixels in scanline and copy them into the output image
+				for (int j = 0; j < pixelsPerRow; j++) {
+					std::copy(input.begin() + inputOffset, input.begin() + inputOffset + m_bytesPerPixel, output.begin() + rowOffset + j * skip);
+					inputOffset += m_bytesPerPixel;
+				}
+			}
+		}
+
+		// Input has been fully consumed
+		input.clear();
+		input.shrink_to_fit();
+
+		return output;
+	}
+
+	Utils::PixelFormat PNG::GetOutputPixelFormat(uint8_t colourType, uint8_t bitDepth, bool indexedAlpha) {
+		switch (colourType) {
+			// Greyscale
+		case 0:
+			return (bitDepth <= 8 ? Utils::RGB8 : Utils::RGB16);
+			// True colour
+		case 2:
+			return (bitDepth == 8 ? Utils::RGB8 : Utils::RGB16);
+			// Indexed colour
+		case 3:
+			// Check for alpha channel
+			return (indexedAlpha ? Utils::RGBA8 : Utils::RGB8);
+			// Greyscale with alpha
+		case 4:
+			[[fallthrough]];
+			// True colour with alpha
+		case 6:
+			return (bitDepth == 8 ? Utils::RGBA8 : Utils::RGBA16);
+		}
+		return Utils::INVALID;
+	}
+
+	bool PNG::ParsePixels(Memory::Buffer& input) {
+		IL_TRACE_SCOPE("PNG::ParsePixels");
+
+		// Select pixel format
+		m_pixelFormat = GetOutputPixelFormat();
+
+		// Reserve every row up front rather than growing them a pixel at a time
+		for (auto& row : m_pixelData) { row.reserve(m_width); }
+
+		// Get number of bytes per channel so data can be copied correctly
+		// Pixels are read by offset rather than consumed so the data is only walked once
+		int channelSize = Utils::GetChannelByteSize(m_pixelFormat);
+		int greyMaximum = (1 << m_bitDepth) - 1;
+		const uint8_t* data = input.data();
+		for (uint32_t i = 0; i < m_width * m_height; i++) {
+			Utils::Pixel pixel;
+			switch (m_colourType) {
+				// Truecolour
+			case 2:
+				[[fallthrough]];
+				// Truecolour with alpha
+			case 6:
+				// Create pixel and copy data in
+				Utils::ExtractBigEndianBytes(pixel.R, data, channelSize);
+				data += channelSize;
+				Utils::ExtractBigEndianBytes(pixel.G, data, channelSize);
+				data += channelSize;
+				Utils::ExtractBigEndianBytes(pixel.B, data, channelSize);
+				data += channelSize;
+
+				// If alpha channel is present copy data
+				if (Utils::HasAlphaChannel(m_pixelFormat)) {
+					Utils::ExtractBigEndianBytes(pixel.A, data, channelSize);
+					data += channelSize;
+				}
+				break;
+				// Indexed colour
+			case 3: {
+				// Select pixel from index
+				if (data[0] >= m_PLTEData.size()) { return SetError(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Palette index out of range", GetImageDataOffset()); }
+				pixel = m_PLTEData[data[0]];
+				data++;
+				break;
+			}
+				// Greyscale
+			case 0:
+				if (m_bitDepth < 8) {
+					// Normalise value
+					uint8_t value = (uint8_t)std::round(((double)data[0] / greyMaximum) * UINT8_MAX);
+
+					// Assign components
+					pixel.R = value;
+					pixel.G = value;
+					pixel.B = value;
+					data++;
+					break;
+				}
+				else { [[fallthrough]]; }
+				// Greyscale with alpha
+			case 4:
+				// Create pixel and copy data in
+				Utils::ExtractBigEndianBytes(pixel.R, data, channelSize);
+				data += channelSize;
+				pixel.G = pixel.R;
+				pixel.B = pixel.R;
+
+				// If alpha channel is present copy data
+				if (Utils::HasAlphaChannel(m_pixelFormat)) {
+					Utils::ExtractBigEndianBytes(pixel.A, data, channelSize);
+					data += channelSize;
+				}
+				break;
+			}
+
+			// Add pixel to data
+			m_pixelData[i / m_width].push_back(pixel);
+			if (m_statisticsAccumulator && (i + 1) % m_width == 0) { m_statisticsAccumulator->AddPixels(m_pixelData[i / m_width]); }
+		}
+
+		input.clear();
+
+		// Shrink input to 0
+		input.shrink_to_fit();
+
+		return true;
+	}
+}
\ No newline at end of file
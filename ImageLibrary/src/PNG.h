@@ -0,0 +1,156 @@
+#pragma once
+
+#include <iterator>
+#include <ctype.h>
+#include <array>
+#include <optional>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	// Information about a PNG found from its chunks without decompressing any image data
+	struct PNGInfo {
+		uint32_t width = 0, height = 0;
+		uint8_t bitDepth = 0;
+		uint8_t colourType = 0;
+		uint8_t interlaceMethod = 0;
+
+		// Format GetPixelBuffer gives for the image
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+
+		// Frames announced by acTL, 0 if the image is not animated
+		uint32_t frameCount = 0;
+
+		std::vector<Utils::PNG::TextEntry> text;
+		std::optional<Utils::PNG::Time> time;
+		std::optional<Utils::PNG::PhysicalDimensions> physicalDimensions;
+
+		// Where the eXIf data is in the file so it can be read if needed, a size of 0 if there is none
+		uint64_t exifOffset = 0;
+		uint32_t exifSize = 0;
+	};
+
+	class PNG : public Image
+	{
+	public:
+		PNG(std::string filePath) : PNG(filePath, std::nothrow) { if (m_error) { throw new std::runtime_error(m_error->message); } };
+		PNG(const ImageSource& source) : PNG(source, std::nothrow) { if (m_error) { throw new std::runtime_error(m_error->message); } };
+
+		// Decode a whole file without exceptions, the pixels are laid out the same as GetPixelBuffer
+		static std::expected<DecodedImage, DecodeError> Decode(std::string filePath);
+		static std::expected<DecodedImage, DecodeError> Decode(const ImageSource& source);
+
+		// Decode at a half, quarter or eighth of the size along each side, with partial squares at the right and bottom edges kept
+		// Interlaced images only inflate the passes holding the kept pixels, others inflate every row but average each square as it is unpacked
+		// so the full size image is never held, the disk cache is not used
+		static std::expected<DecodedImage, DecodeError> DecodeReduced(std::string filePath, uint32_t reduction);
+
+		// Decode into a buffer the caller owns, which Probe gives the size for, converting each row to the target format as it is finished
+		// Rows are written once whether or not the image is interlaced, nothing the size of the image is allocated and the disk cache is not used
+		// A target too small for the image fails before any image data is inflated, a failure later on leaves the rows decoded so far
+		static std::expected<void, DecodeError> DecodeInto(std::string filePath, const DecodeTarget& target);
+
+		// Read the header and metadata chunks seeking over everything else, no CRCs are checked and no image data is read
+		// Truncation after IHDR is not an error, the information from before it is returned
+		static std::expected<PNGInfo, DecodeError> Probe(std::string filePath);
+
+		// APNG information, an image without an acTL chunk has no frames
+		bool IsAnimated() const noexcept { return !m_frames.empty(); }
+		uint32_t GetFrameCount() const noexcept { return (uint32_t)m_frames.size(); }
+		uint32_t GetPlayCount() const noexcept { return m_numPlays; }
+		const Utils::PNG::FrameControl& GetFrameControl(uint32_t index) const { return m_frames.at(index).control; }
+
+		// Decode the sub-rectangle of a single APNG frame into the upload format with an alpha channel added
+		// Frames can be decoded in any order but not at the same time as any other use of the image
+		// Memory stats are reset so they only cover the frame
+		Memory::Buffer DecodeFrame(uint32_t index);
+
+		// Breakdown of where the time went in the last ReadFile or DecodeFrame, parsing chunks does not include checking CRCs
+		// In low memory mode unpacking and deinterlacing are part of parsing pixels
+		const Utils::PNG::StageTimings& GetStageTimings() const noexcept { return m_stageTimings; }
+
+	private:
+		// APNG frame with the compressed image data of each of its chunks in the file
+		struct Frame {
+			Utils::PNG::FrameControl control;
+			std::vector<std::span<const uint8_t>> compressedData;
+		};
+
+		// Reads and decodes the file leaving any failure in the error rather than throwing
+		PNG(std::string filePath, std::nothrow_t) : Image(filePath) { if (!m_error && !IsCached()) { InitCRC(); ReadFile(); } };
+		PNG(const ImageSource& source, std::nothrow_t) : Image(source) { if (!m_error && !IsCached()) { InitCRC(); ReadFile(); } };
+		PNG(std::string filePath, uint32_t reduction, std::nothrow_t) : Image(filePath, UncachedTag()), m_reduction(reduction) { if (!m_error) { InitCRC(); ReadFile(); } };
+		PNG(std::string filePath, const DecodeTarget& target, std::nothrow_t) : Image(filePath, UncachedTag()), m_target(&target) { if (!m_error) { InitCRC(); ReadFile(); } };
+
+		void InitCRC();
+		bool ReadFile() override;
+
+		// Record an error at the start of the chunk being parsed
+		bool Fail(DecodeErrorKind kind, const char* message) noexcept { return SetError(kind, message, m_chunkStart); }
+
+		// Offset of the image data being decoded, or of where parsing stopped if there is none
+		uint64_t GetImageDataOffset() const noexcept;
+
+		// Data in the file that has not been parsed yet
+		const uint8_t* GetFileData() const noexcept { return m_fileData.data() + m_position; }
+		size_t GetRemainingSize() const noexcept { return m_fileData.size() - m_position; }
+
+		bool ParseSignature();
+		bool ParseChunks();
+		bool CheckChunkOccurence(const std::vector<Utils::PNG::Chunk>& encounteredChunks, Utils::PNG::ChunkIdentifier chunk, int number);
+		bool CheckCRC(uint32_t length);
+		bool ParseIHDR();
+		bool ParsePLTE(uint32_t length);
+		void ParsegAMA(uint32_t length, bool encounteredIDAT);
+		void ParsecHRM(uint32_t length, bool encounteredIDAT);
+		void ParsesRGB(uint32_t length, bool encounteredIDAT);
+		void ParseiCCP(uint32_t length, bool encounteredIDAT);
+		void ParsecICP(uint32_t length, bool encounteredIDAT);
+		void ResolveColourSpace();
+		bool ParseacTL(uint32_t length);
+		bool ParsefcTL(uint32_t length, bool encounteredIDAT);
+		bool ParsefdAT(uint32_t length);
+		bool ConsumeSequenceNumber(uint32_t& sequenceNumber);
+		bool DecodeCompressedData();
+		bool DecodeIntoBuffer();
+		bool DecompressData(Memory::Buffer& output);
+		size_t GetFilteredDataSize() const;
+		bool UnfilterData(Memory::Buffer& input, Memory::Buffer& output);
+		Memory::Buffer UnpackData(Memory::Buffer& input);
+		Memory::Buffer DeinterlaceData(Memory::Buffer& input);
+		Utils::PixelFormat GetOutputPixelFormat() const { return GetOutputPixelFormat(m_colourType, m_bitDepth, m_indexedAlpha); }
+		static Utils::PixelFormat GetOutputPixelFormat(uint8_t colourType, uint8_t bitDepth, bool indexedAlpha);
+		bool ParsePixels(Memory::Buffer& input);
+
+	private:
+		std::array<uint32_t, 256> m_crcTable;
+		uint8_t m_bitDepth;
+		uint8_t m_colourType;
+		uint8_t m_compressionMethod;
+		uint8_t m_filterMethod;
+		uint8_t m_interlaceMethod;
+		size_t m_position = 0;
+		size_t m_chunkStart = 0;
+		std::vector<std::span<const uint8_t>> m_compressedData;
+		std::vector<Utils::Pixel> m_PLTEData;
+		bool m_indexedAlpha = false;
+		int m_bytesPerPixel;
+		Utils::PNG::ColourChunks m_colourChunks;
+
+		// Each side of the default image is decoded this many times smaller, only in DecodeIntoBuffer
+		uint32_t m_reduction = 1;
+
+		// Caller's buffer that rows go into instead of the pixel buffer, only in DecodeIntoBuffer
+		const DecodeTarget* m_target = nullptr;
+
+		// APNG information
+		std::vector<Frame> m_frames;
+		uint32_t m_numFrames = 0;
+		uint32_t m_numPlays = 0;
+		uint32_t m_nextSequenceNumber = 0;
+		bool m_defaultImageIsFrame = false;
+
+		// Decode performance information
+		Utils::PNG::StageTimings m_stageTimings;
+	};
+}
\ No newline at end of file
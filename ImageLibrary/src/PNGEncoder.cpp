@@ -0,0 +1,306 @@
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PNG_ENCODER_SSE2
+#endif
+
+#include "../vendor/zlib/zlib.h"
+
+#include "PNGEncoder.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Bands smaller than this compress noticeably worse than one large stream
+	static constexpr size_t MIN_BAND_BYTES = 256 * 1024;
+
+	// Sum of the filtered bytes treated as signed values, the usual heuristic for choosing a filter
+	static uint64_t SumAbsSigned(const uint8_t* data, size_t size) {
+		uint64_t sum = 0;
+		size_t i = 0;
+
+#ifdef PNG_ENCODER_SSE2
+		__m128i zero = _mm_setzero_si128();
+		__m128i total = zero;
+		for (; i + 16 <= size; i += 16) {
+			__m128i value = _mm_loadu_si128((const __m128i*)(data + i));
+
+			// The absolute value of a signed byte is the smaller of x and -x as unsigned bytes
+			__m128i absolute = _mm_min_epu8(value, _mm_sub_epi8(zero, value));
+			total = _mm_add_epi64(total, _mm_sad_epu8(absolute, zero));
+		}
+		sum = (uint64_t)_mm_cvtsi128_si64(total) + (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+#endif
+
+		for (; i < size; i++) {
+			sum += std::min<uint8_t>(data[i], (uint8_t)(0 - data[i]));
+		}
+
+		return sum;
+	}
+
+	PNGEncoder::PNGEncoder(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, PNGEncoderOptions options)
+		: m_width(width), m_height(height), m_pixelFormat(pixelFormat), m_pixels(pixels), m_options(options) {
+		// Check input is something that can be encoded
+		if (m_pixelFormat == Utils::INVALID) { throw new std::runtime_error("Error: Cannot encode invalid pixel format"); }
+		if (m_width == 0 || m_height == 0 || m_width > Utils::PNG_SPEC_MAX_DIMENSION || m_height > Utils::PNG_SPEC_MAX_DIMENSION) { throw new std::runtime_error("Error: Image dimensions invalid"); }
+		if (m_options.compressionLevel < 0 || m_options.compressionLevel > 9) { throw new std::runtime_error("Error: Invalid compression level"); }
+
+		m_bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		m_rowSize = m_bytesPerPixel * m_width;
+		if (m_pixels.size() < m_rowSize * m_height) { throw new std::runtime_error("Error: Pixel buffer is too small for image"); }
+
+		Encode();
+
+		// The pixels are only borrowed for the encode
+		m_pixels = std::span<const uint8_t>();
+	}
+
+	void PNGEncoder::WriteFile(const std::string& filePath) const {
+		std::ofstream file(filePath, std::ios_base::binary | std::ios_base::trunc);
+		file.write((const char*)m_data.data(), m_data.size());
+		if (!file) { throw new std::runtime_error("Error: Could not write file"); }
+	}
+
+	void PNGEncoder::Encode() {
+		IL_TRACE_SCOPE("PNGEncoder::Encode");
+
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+
+		// Split rows into bands, several per thread to balance load but large enough to compress well on their own
+		uint32_t minRows = (uint32_t)std::max<size_t>(1, MIN_BAND_BYTES / (m_rowSize + 1));
+		uint32_t bandRows = std::max(minRows, (m_height + threadCount * 4 - 1) / (threadCount * 4));
+		std::vector<Band> bands;
+		for (uint32_t y = 0; y < m_height; y += bandRows) {
+			bands.push_back(Band{ .firstRow = y, .rowCount = std::min(bandRows, m_height - y) });
+		}
+
+		// Compress bands in parallel
+		std::atomic<size_t> nextBand = 0;
+		std::runtime_error* error = nullptr;
+		std::mutex errorMutex;
+		auto worker = [&]() {
+			for (size_t i = nextBand++; i < bands.size(); i = nextBand++) {
+				try { CompressBand(bands[i], i == 0, i == bands.size() - 1); }
+				catch (std::runtime_error* e) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (error) { delete e; }
+					else { error = e; }
+					nextBand = bands.size();
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min<size_t>(threadCount, bands.size()); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+		if (error) { throw error; }
+
+		// Signature
+		const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		m_data.insert(m_data.end(), signature, signature + 8);
+
+		// IHDR
+		std::vector<uint8_t> chunk;
+		WriteBigEndian(chunk, m_width, 4);
+		WriteBigEndian(chunk, m_height, 4);
+		chunk.push_back((uint8_t)(Utils::GetChannelByteSize(m_pixelFormat) * 8));
+		chunk.push_back(Utils::HasAlphaChannel(m_pixelFormat) ? 6 : 2);
+		chunk.push_back(0);
+		chunk.push_back(0);
+		chunk.push_back(0);
+		WriteChunk("IHDR", chunk.data(), chunk.size());
+
+		// Restart points give the first row and offset into the zlib stream of each band's deflate data
+		if (m_options.recordRestartPoints) {
+			chunk.clear();
+			WriteBigEndian(chunk, bands.size(), 4);
+			uint64_t offset = 2;
+			for (const Band& band : bands) {
+				WriteBigEndian(chunk, band.firstRow, 4);
+				WriteBigEndian(chunk, offset, 8);
+				offset += band.compressedData.size() - (band.firstRow == 0 ? 2 : 0);
+			}
+			WriteChunk("pvRS", chunk.data(), chunk.size());
+		}
+
+		// One IDAT per band using the CRC calculated while compressing, then the checksum of the whole stream
+		uint32_t adler = adler32(0, Z_NULL, 0);
+		for (Band& band : bands) {
+			WriteChunk("IDAT", band.compressedData.data(), band.compressedData.size(), band.crc);
+			adler = adler32_combine(adler, band.adler, band.uncompressedSize);
+			band.compressedData = std::vector<uint8_t>();
+		}
+
+		chunk.clear();
+		WriteBigEndian(chunk, adler, 4);
+		WriteChunk("IDAT", chunk.data(), chunk.size());
+
+		// IEND
+		WriteChunk("IEND", nullptr, 0);
+	}
+
+	void PNGEncoder::CompressBand(Band& band, bool first, bool last) {
+		IL_TRACE_SCOPE("PNGEncoder::CompressBand");
+
+		// Each band is a raw deflate segment, the zlib header and checksum are added around the joined bands
+		z_stream defStream{};
+		defStream.zalloc = Z_NULL;
+		defStream.zfree = Z_NULL;
+		defStream.opaque = Z_NULL;
+		int err = deflateInit2(&defStream, m_options.compressionLevel, Z_DEFLATED, -15, 8, Z_FILTERED);
+		if (err != Z_OK) { throw new std::runtime_error("Error: Compression of data failed"); }
+
+		size_t filteredRowSize = m_rowSize + 1;
+		band.uncompressedSize = filteredRowSize * band.rowCount;
+		band.compressedData.resize(deflateBound(&defStream, (uLong)band.uncompressedSize) + 16);
+		size_t outputSize = 0;
+
+		// The first band starts the zlib stream with a header matching the compression level
+		if (first) {
+			uint8_t levelFlag = (m_options.compressionLevel < 2 ? 0 : m_options.compressionLevel < 6 ? 1 : m_options.compressionLevel == 6 ? 2 : 3);
+			uint16_t header = 0x7800 | (levelFlag << 6);
+			header += 31 - (header % 31);
+			band.compressedData[0] = header >> 8;
+			band.compressedData[1] = header & 0xff;
+			outputSize = 2;
+		}
+
+		// Rows are filtered against the row before the band so bands start independently
+		std::vector<uint8_t> previousRow(m_rowSize, 0);
+		std::vector<uint8_t> currentRow(m_rowSize);
+		std::vector<uint8_t> filteredRow(filteredRowSize);
+		std::array<std::vector<uint8_t>, 5> candidates;
+		for (auto& candidate : candidates) { candidate.resize(m_rowSize); }
+		if (band.firstRow > 0) { ConvertRow(band.firstRow - 1, previousRow.data()); }
+
+		band.adler = adler32(0, Z_NULL, 0);
+		for (uint32_t y = band.firstRow; y < band.firstRow + band.rowCount; y++) {
+			// Filter row, when recording restart points the first row of a band cannot depend on the band before it
+			ConvertRow(y, currentRow.data());
+			bool allowPreviousRow = (y != 0) && !(m_options.recordRestartPoints && y == band.firstRow);
+			filteredRow[0] = FilterRow(currentRow.data(), previousRow.data(), allowPreviousRow, filteredRow.data() + 1, candidates);
+			band.adler = adler32(band.adler, filteredRow.data(), (uInt)filteredRowSize);
+			std::swap(previousRow, currentRow);
+
+			// Compress row, ending the band on a byte boundary with an empty dictionary so it can be joined to the next
+			bool lastRow = (y == band.firstRow + band.rowCount - 1);
+			int flush = (!lastRow ? Z_NO_FLUSH : last ? Z_FINISH : Z_FULL_FLUSH);
+			defStream.next_in = filteredRow.data();
+			defStream.avail_in = (uInt)filteredRowSize;
+
+			for (;;) {
+				if (outputSize == band.compressedData.size()) { band.compressedData.resize(band.compressedData.size() * 2); }
+				defStream.next_out = band.compressedData.data() + outputSize;
+				defStream.avail_out = (uInt)std::min<size_t>(band.compressedData.size() - outputSize, UINT32_MAX);
+				err = deflate(&defStream, flush);
+				outputSize = defStream.next_out - band.compressedData.data();
+
+				if (err == Z_STREAM_ERROR) {
+					deflateEnd(&defStream);
+					throw new std::runtime_error("Error: Compression of data failed");
+				}
+
+				if (flush == Z_FINISH) {
+					if (err == Z_STREAM_END) { break; }
+				}
+				else if (defStream.avail_in == 0 && defStream.avail_out != 0) { break; }
+			}
+		}
+
+		deflateEnd(&defStream);
+		band.compressedData.resize(outputSize);
+		band.compressedData.shrink_to_fit();
+
+		// Checksum the compressed data here so it is done in parallel
+		band.crc = crc32(0, band.compressedData.data(), (uInt)band.compressedData.size());
+	}
+
+	void PNGEncoder::ConvertRow(uint32_t y, uint8_t* dest) {
+		const uint8_t* src = m_pixels.data() + (size_t)y * m_rowSize;
+
+		// Buffer holds 16 bit channels little endian but PNG stores them big endian
+		if (Utils::GetChannelByteSize(m_pixelFormat) == 2) {
+			for (size_t i = 0; i < m_rowSize; i += 2) {
+				dest[i] = src[i + 1];
+				dest[i + 1] = src[i];
+			}
+		}
+		else {
+			memcpy(dest, src, m_rowSize);
+		}
+	}
+
+	uint8_t PNGEncoder::FilterRow(const uint8_t* row, const uint8_t* previousRow, bool allowPreviousRow, uint8_t* dest, std::array<std::vector<uint8_t>, 5>& candidates) {
+		size_t bpp = m_bytesPerPixel;
+
+		// Define paeth functor for use
+		auto paeth = [](int a, int b, int c) -> uint8_t {
+			int p = a + b - c;
+			int paethA = std::abs(p - a);
+			int paethB = std::abs(p - b);
+			int paethC = std::abs(p - c);
+
+			if (paethA <= paethB && paethA <= paethC) { return (uint8_t)a; }
+			else if (paethB <= paethC) { return (uint8_t)b; }
+			return (uint8_t)c;
+		};
+
+		// None and Sub only use the current row
+		memcpy(candidates[0].data(), row, m_rowSize);
+		for (size_t x = 0; x < bpp; x++) { candidates[1][x] = row[x]; }
+		for (size_t x = bpp; x < m_rowSize; x++) { candidates[1][x] = row[x] - row[x - bpp]; }
+		int filterCount = 2;
+
+		// Up, Average and Paeth need the previous row
+		if (allowPreviousRow) {
+			for (size_t x = 0; x < m_rowSize; x++) { candidates[2][x] = row[x] - previousRow[x]; }
+			for (size_t x = 0; x < bpp; x++) { candidates[3][x] = row[x] - (previousRow[x] >> 1); }
+			for (size_t x = bpp; x < m_rowSize; x++) { candidates[3][x] = row[x] - (uint8_t)((row[x - bpp] + previousRow[x]) >> 1); }
+			for (size_t x = 0; x < bpp; x++) { candidates[4][x] = row[x] - previousRow[x]; }
+			for (size_t x = bpp; x < m_rowSize; x++) { candidates[4][x] = row[x] - paeth(row[x - bpp], previousRow[x], previousRow[x - bpp]); }
+			filterCount = 5;
+		}
+
+		// Pick the filter whose output is closest to zero
+		uint8_t bestFilter = 0;
+		uint64_t bestSum = UINT64_MAX;
+		for (int filter = 0; filter < filterCount; filter++) {
+			uint64_t sum = SumAbsSigned(candidates[filter].data(), m_rowSize);
+			if (sum < bestSum) {
+				bestSum = sum;
+				bestFilter = (uint8_t)filter;
+			}
+		}
+
+		memcpy(dest, candidates[bestFilter].data(), m_rowSize);
+		return bestFilter;
+	}
+
+	void PNGEncoder::WriteChunk(const char* type, const uint8_t* data, size_t length) {
+		WriteChunk(type, data, length, crc32(0, data, (uInt)length));
+	}
+
+	void PNGEncoder::WriteChunk(const char* type, const uint8_t* data, size_t length, uint32_t dataCRC) {
+		if (length > INT32_MAX) { throw new std::runtime_error("Error: Chunk is too large"); }
+
+		// The chunk CRC covers the type and data so combine the type's CRC with the precalculated data CRC
+		uint32_t crc = crc32_combine(crc32(0, (const uint8_t*)type, 4), dataCRC, (z_off_t)length);
+
+		WriteBigEndian(m_data, length, 4);
+		m_data.insert(m_data.end(), type, type + 4);
+		if (length > 0) { m_data.insert(m_data.end(), data, data + length); }
+		WriteBigEndian(m_data, crc, 4);
+	}
+
+	void PNGEncoder::WriteBigEndian(std::vector<uint8_t>& dest, uint64_t value, int number) {
+		for (int i = number - 1; i >= 0; i--) {
+			dest.push_back((uint8_t)(value >> (8 * i)));
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <span>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	struct PNGEncoderOptions {
+		// zlib compression level from 0 to 9
+		int compressionLevel = 6;
+
+		// Number of threads compressing row bands, 0 uses every core
+		unsigned int threadCount = 0;
+
+		// Write a pvRS chunk listing where each independently compressed band starts so the file can be decoded in parallel
+		bool recordRestartPoints = false;
+	};
+
+	// Encodes a pixel buffer in the Image::GetPixelBuffer layout as a non-interlaced PNG
+	// Rows are split into bands that are filtered and compressed in parallel as independent deflate segments joined with full flushes
+	class PNGEncoder
+	{
+	public:
+		PNGEncoder(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, PNGEncoderOptions options = PNGEncoderOptions()) noexcept(false);
+		PNGEncoder(Image& image, PNGEncoderOptions options = PNGEncoderOptions()) noexcept(false)
+			: PNGEncoder(image.GetWidth(), image.GetHeight(), image.GetPixelFormat(), image.GetPixelBuffer(), options) {};
+
+		const std::vector<uint8_t>& GetData() const noexcept { return m_data; }
+		void WriteFile(const std::string& filePath) const;
+
+	private:
+		// Compressed rows of a band along with checksums so bands can be joined without reading them again
+		struct Band {
+			uint32_t firstRow;
+			uint32_t rowCount;
+			std::vector<uint8_t> compressedData;
+			uint32_t adler;
+			uint32_t crc;
+			size_t uncompressedSize;
+		};
+
+		void Encode();
+		void CompressBand(Band& band, bool first, bool last);
+		void ConvertRow(uint32_t y, uint8_t* dest);
+		uint8_t FilterRow(const uint8_t* row, const uint8_t* previousRow, bool allowPreviousRow, uint8_t* dest, std::array<std::vector<uint8_t>, 5>& candidates);
+		void WriteChunk(const char* type, const uint8_t* data, size_t length);
+		void WriteChunk(const char* type, const uint8_t* data, size_t length, uint32_t dataCRC);
+		void WriteBigEndian(std::vector<uint8_t>& dest, uint64_t value, int number);
+
+	private:
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		std::span<const uint8_t> m_pixels;
+		PNGEncoderOptions m_options;
+		size_t m_bytesPerPixel;
+		size_t m_rowSize;
+
+		std::vector<uint8_t> m_data;
+	};
+}
\ No newline at end of file
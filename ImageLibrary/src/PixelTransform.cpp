@@ -0,0 +1,195 @@
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXEL_TRANSFORM_SSE2
+#endif
+
+#include "PixelTransform.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Pixels along each side of the tiles transposes work in, a tile of the largest pixels and its output fit in L1 together
+	static constexpr uint32_t TILE_SIZE = 32;
+
+	// Images smaller than this are moved on the calling thread as starting threads would take longer
+	static constexpr uint64_t MIN_THREADED_PIXELS = 1 << 20;
+
+	// Copy a row of pixels in reverse order
+	template <size_t bytesPerPixel>
+	static void ReverseRow(uint8_t* dest, const uint8_t* source, uint32_t width) {
+		uint32_t x = 0;
+#ifdef PIXEL_TRANSFORM_SSE2
+		if constexpr (bytesPerPixel == 4) {
+			for (; x + 4 <= width; x += 4) {
+				__m128i pixels = _mm_loadu_si128((const __m128i*)(source + (size_t)(width - 4 - x) * 4));
+				_mm_storeu_si128((__m128i*)(dest + (size_t)x * 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3)));
+			}
+		}
+		else if constexpr (bytesPerPixel == 8) {
+			for (; x + 2 <= width; x += 2) {
+				__m128i pixels = _mm_loadu_si128((const __m128i*)(source + (size_t)(width - 2 - x) * 8));
+				_mm_storeu_si128((__m128i*)(dest + (size_t)x * 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 3, 2)));
+			}
+		}
+#endif
+		for (; x < width; x++) { memcpy(dest + (size_t)x * bytesPerPixel, source + (size_t)(width - 1 - x) * bytesPerPixel, bytesPerPixel); }
+	}
+
+#ifdef PIXEL_TRANSFORM_SSE2
+	// Transpose a square of 4 byte pixels, each source row becomes a column of the destination rows
+	static inline void Transpose4x4(const uint8_t* const (&rows)[4], uint8_t* const (&destRows)[4]) {
+		__m128i row0 = _mm_loadu_si128((const __m128i*)rows[0]);
+		__m128i row1 = _mm_loadu_si128((const __m128i*)rows[1]);
+		__m128i row2 = _mm_loadu_si128((const __m128i*)rows[2]);
+		__m128i row3 = _mm_loadu_si128((const __m128i*)rows[3]);
+
+		__m128i low01 = _mm_unpacklo_epi32(row0, row1);
+		__m128i low23 = _mm_unpacklo_epi32(row2, row3);
+		__m128i high01 = _mm_unpackhi_epi32(row0, row1);
+		__m128i high23 = _mm_unpackhi_epi32(row2, row3);
+
+		_mm_storeu_si128((__m128i*)destRows[0], _mm_unpacklo_epi64(low01, low23));
+		_mm_storeu_si128((__m128i*)destRows[1], _mm_unpackhi_epi64(low01, low23));
+		_mm_storeu_si128((__m128i*)destRows[2], _mm_unpacklo_epi64(high01, high23));
+		_mm_storeu_si128((__m128i*)destRows[3], _mm_unpackhi_epi64(high01, high23));
+	}
+
+	static inline void Transpose2x2(const uint8_t* const (&rows)[2], uint8_t* const (&destRows)[2]) {
+		__m128i row0 = _mm_loadu_si128((const __m128i*)rows[0]);
+		__m128i row1 = _mm_loadu_si128((const __m128i*)rows[1]);
+
+		_mm_storeu_si128((__m128i*)destRows[0], _mm_unpacklo_epi64(row0, row1));
+		_mm_storeu_si128((__m128i*)destRows[1], _mm_unpackhi_epi64(row0, row1));
+	}
+#endif
+
+	PixelTransform::PixelTransform(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, PixelTransformOptions options)
+		: m_pixelFormat(pixelFormat), m_options(options) {
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(pixelFormat);
+		if (bytesPerPixel == 0) { throw new std::runtime_error("Error: Cannot transform invalid pixel format"); }
+		if (pixels.size() < (size_t)width * height * bytesPerPixel) { throw new std::runtime_error("Error: Pixel buffer is too small for image"); }
+
+		m_crop = options.crop.value_or(Utils::Rect{ .width = width, .height = height });
+		if (m_crop.IsEmpty() || (uint64_t)m_crop.x + m_crop.width > width || (uint64_t)m_crop.y + m_crop.height > height) {
+			throw new std::runtime_error("Error: Crop region is outside of the image");
+		}
+
+		m_mapping = options.orientation.GetSourceMapping();
+		m_width = (m_mapping.swapAxes ? m_crop.height : m_crop.width);
+		m_height = (m_mapping.swapAxes ? m_crop.width : m_crop.height);
+
+		Transform(pixels, width);
+	}
+
+	void PixelTransform::Transform(std::span<const uint8_t> pixels, uint32_t sourceWidth) {
+		IL_TRACE_SCOPE("PixelTransform::Transform");
+
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		size_t sourceStride = (size_t)sourceWidth * bytesPerPixel;
+		const uint8_t* source = pixels.data() + m_crop.y * sourceStride + m_crop.x * bytesPerPixel;
+		m_data.resize((size_t)m_width * m_height * bytesPerPixel);
+
+		// Bands are whole tiles high so no tile is split between threads
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		if ((uint64_t)m_width * m_height < MIN_THREADED_PIXELS) { threadCount = 1; }
+		uint32_t bandRows = std::max(TILE_SIZE, (m_height + threadCount * 4 - 1) / (threadCount * 4) / TILE_SIZE * TILE_SIZE);
+		uint32_t bandCount = (m_height + bandRows - 1) / bandRows;
+
+		std::atomic<uint32_t> nextBand = 0;
+		auto worker = [&]() {
+			for (uint32_t i = nextBand++; i < bandCount; i = nextBand++) {
+				uint32_t firstRow = i * bandRows;
+				uint32_t lastRow = std::min(firstRow + bandRows, m_height);
+				switch (bytesPerPixel) {
+				case 3:
+					TransformRows<3>(source, sourceStride, firstRow, lastRow);
+					break;
+				case 4:
+					TransformRows<4>(source, sourceStride, firstRow, lastRow);
+					break;
+				case 6:
+					TransformRows<6>(source, sourceStride, firstRow, lastRow);
+					break;
+				default:
+					TransformRows<8>(source, sourceStride, firstRow, lastRow);
+					break;
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, bandCount); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+
+	template <size_t bytesPerPixel>
+	void PixelTransform::TransformRows(const uint8_t* source, size_t sourceStride, uint32_t firstRow, uint32_t lastRow) {
+		size_t destStride = (size_t)m_width * bytesPerPixel;
+		uint32_t sourceWidth = m_crop.width;
+		uint32_t sourceHeight = m_crop.height;
+
+		// Without swapping axes every output row is a whole source row, either copied or reversed
+		if (!m_mapping.swapAxes) {
+			for (uint32_t y = firstRow; y < lastRow; y++) {
+				const uint8_t* sourceRow = source + (size_t)(m_mapping.reverseY ? sourceHeight - 1 - y : y) * sourceStride;
+				uint8_t* dest = m_data.data() + y * destStride;
+				if (m_mapping.reverseX) { ReverseRow<bytesPerPixel>(dest, sourceRow, sourceWidth); }
+				else { memcpy(dest, sourceRow, destStride); }
+			}
+			return;
+		}
+
+		// Output rows read down a source column and output columns come from source rows
+		bool reverseX = m_mapping.reverseX;
+		bool reverseY = m_mapping.reverseY;
+		auto sourceColumn = [=](uint32_t y) { return (reverseX ? sourceWidth - 1 - y : y); };
+		auto sourceRow = [=](uint32_t x) { return (reverseY ? sourceHeight - 1 - x : x); };
+
+		for (uint32_t tileY = firstRow; tileY < lastRow; tileY += TILE_SIZE) {
+			uint32_t tileYEnd = std::min(tileY + TILE_SIZE, lastRow);
+			for (uint32_t tileX = 0; tileX < m_width; tileX += TILE_SIZE) {
+				uint32_t tileXEnd = std::min(tileX + TILE_SIZE, m_width);
+				uint32_t y = tileY;
+
+#ifdef PIXEL_TRANSFORM_SSE2
+				// Squares as wide as a register, the source columns of a square are always neighbours so are read from the lowest
+				constexpr uint32_t squareSize = (bytesPerPixel == 4 ? 4 : (bytesPerPixel == 8 ? 2 : 1));
+				if constexpr (squareSize > 1) {
+					for (; y + squareSize <= tileYEnd; y += squareSize) {
+						uint32_t column = sourceColumn(reverseX ? y + squareSize - 1 : y);
+						uint8_t* destRows[squareSize];
+						for (uint32_t i = 0; i < squareSize; i++) { destRows[i] = m_data.data() + (size_t)(reverseX ? y + squareSize - 1 - i : y + i) * destStride; }
+
+						uint32_t x = tileX;
+						for (; x + squareSize <= tileXEnd; x += squareSize) {
+							const uint8_t* rows[squareSize];
+							uint8_t* dests[squareSize];
+							for (uint32_t i = 0; i < squareSize; i++) {
+								rows[i] = source + (size_t)sourceRow(x + i) * sourceStride + (size_t)column * bytesPerPixel;
+								dests[i] = destRows[i] + (size_t)x * bytesPerPixel;
+							}
+							if constexpr (squareSize == 4) { Transpose4x4(rows, dests); }
+							else { Transpose2x2(rows, dests); }
+						}
+						for (; x < tileXEnd; x++) {
+							const uint8_t* sourcePixel = source + (size_t)sourceRow(x) * sourceStride + (size_t)column * bytesPerPixel;
+							for (uint32_t i = 0; i < squareSize; i++) { memcpy(destRows[i] + (size_t)x * bytesPerPixel, sourcePixel + i * bytesPerPixel, bytesPerPixel); }
+						}
+					}
+				}
+#endif
+
+				for (; y < tileYEnd; y++) {
+					uint8_t* dest = m_data.data() + y * destStride;
+					const uint8_t* column = source + (size_t)sourceColumn(y) * bytesPerPixel;
+					for (uint32_t x = tileX; x < tileXEnd; x++) { memcpy(dest + (size_t)x * bytesPerPixel, column + (size_t)sourceRow(x) * sourceStride, bytesPerPixel); }
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
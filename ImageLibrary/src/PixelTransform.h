@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <optional>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	struct PixelTransformOptions {
+		// Applied to the cropped region
+		Utils::Orientation orientation;
+
+		// Region of the image to keep, the whole image when not given
+		std::optional<Utils::Rect> crop;
+
+		// Number of threads moving bands of rows, 0 uses every core, small images always use one
+		unsigned int threadCount = 0;
+	};
+
+	// Crops, turns and mirrors a pixel buffer in the Image::GetPixelBuffer layout without decoding the image again
+	// Turns that swap the axes are done as transposes in cache sized tiles, with SSE2 for 4 and 8 byte pixels
+	class PixelTransform
+	{
+	public:
+		PixelTransform(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, PixelTransformOptions options = PixelTransformOptions()) noexcept(false);
+		PixelTransform(Image& image, PixelTransformOptions options = PixelTransformOptions()) noexcept(false)
+			: PixelTransform(image.GetWidth(), image.GetHeight(), image.GetPixelFormat(), image.GetPixelBuffer(), options) {};
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+		const std::vector<uint8_t>& GetData() const noexcept { return m_data; }
+
+	private:
+		void Transform(std::span<const uint8_t> pixels, uint32_t sourceWidth);
+
+		template <size_t bytesPerPixel>
+		void TransformRows(const uint8_t* source, size_t sourceStride, uint32_t firstRow, uint32_t lastRow);
+
+	private:
+		// Dimensions of the output
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		PixelTransformOptions m_options;
+		Utils::Rect m_crop;
+		Utils::Orientation::SourceMapping m_mapping;
+
+		std::vector<uint8_t> m_data;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <numbers>
+#include <thread>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#endif
+
+#include "Resampler.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Output rows in the smallest band a thread takes, each band filters a few source rows again so they should not be too short
+	static constexpr uint32_t MIN_BAND_ROWS = 16;
+
+	// Images smaller than this are resampled on the calling thread as starting threads would take longer
+	static constexpr uint64_t MIN_THREADED_PIXELS = 1 << 20;
+
+	// Distance from the centre of an output pixel where the filter reaches zero, in source pixels when enlarging
+	static double FilterSupport(ResampleFilter filter) {
+		switch (filter) {
+		case ResampleFilter::BOX:
+			return 0.5;
+		case ResampleFilter::MITCHELL:
+			return 2.0;
+		default:
+			return 3.0;
+		}
+	}
+
+	static double FilterWeight(ResampleFilter filter, double x) {
+		x = std::abs(x);
+		switch (filter) {
+		case ResampleFilter::BOX:
+			return (x < 0.5 ? 1.0 : 0.0);
+		case ResampleFilter::MITCHELL: {
+			// Mitchell-Netravali with B = C = 1/3
+			constexpr double B = 1.0 / 3.0, C = 1.0 / 3.0;
+			if (x < 1.0) { return ((12.0 - 9.0 * B - 6.0 * C) * x * x * x + (-18.0 + 12.0 * B + 6.0 * C) * x * x + (6.0 - 2.0 * B)) / 6.0; }
+			if (x < 2.0) { return ((-B - 6.0 * C) * x * x * x + (6.0 * B + 30.0 * C) * x * x + (-12.0 * B - 48.0 * C) * x + (8.0 * B + 24.0 * C)) / 6.0; }
+			return 0.0;
+		}
+		default:
+			if (x < 1e-8) { return 1.0; }
+			if (x >= 3.0) { return 0.0; }
+			return 3.0 * std::sin(std::numbers::pi * x) * std::sin(std::numbers::pi * x / 3.0) / (std::numbers::pi * std::numbers::pi * x * x);
+		}
+	}
+
+	// Convert a row to four floats per pixel with the colour multiplied by alpha, the alpha of opaque formats is left at zero
+	template <int channelCount, int channelBytes>
+	static void LoadRow(float* dest, const uint8_t* source, uint32_t width) {
+		constexpr float maxValue = (channelBytes == 2 ? 65535.0f : 255.0f);
+		uint32_t x = 0;
+#ifdef RESAMPLER_SSE2
+		// Four RGBA8 pixels are widened to floats from one load, alpha is spread to every lane and the alpha lane itself multiplied by one
+		if constexpr (channelCount == 4 && channelBytes == 1) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 inverseMax = _mm_set1_ps(1.0f / maxValue);
+			for (; x + 4 <= width; x += 4, source += 16, dest += 16) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)source);
+				__m128i low = _mm_unpacklo_epi8(bytes, zero);
+				__m128i high = _mm_unpackhi_epi8(bytes, zero);
+				__m128 pixels[4] = {
+					_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)),
+					_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero))
+				};
+				for (int i = 0; i < 4; i++) {
+					__m128 alpha = _mm_mul_ps(_mm_shuffle_ps(pixels[i], pixels[i], _MM_SHUFFLE(3, 3, 3, 3)), inverseMax);
+					alpha = _mm_or_ps(_mm_andnot_ps(alphaLane, alpha), _mm_and_ps(alphaLane, one));
+					_mm_storeu_ps(dest + i * 4, _mm_mul_ps(pixels[i], alpha));
+				}
+			}
+		}
+#endif
+		for (; x < width; x++, source += channelCount * channelBytes, dest += 4) {
+			float values[4] = {};
+			for (int c = 0; c < channelCount; c++) {
+				if constexpr (channelBytes == 2) { values[c] = (float)(source[c * 2] | (source[c * 2 + 1] << 8)); }
+				else { values[c] = (float)source[c]; }
+			}
+			if constexpr (channelCount == 4) {
+				float alpha = values[3] / maxValue;
+				for (int c = 0; c < 3; c++) { values[c] *= alpha; }
+			}
+			memcpy(dest, values, sizeof(values));
+		}
+	}
+
+	// Undo the alpha multiplication and round back to the pixel format, filters with negative lobes can overshoot so values are clamped
+	template <int channelCount, int channelBytes>
+	static void StoreRow(uint8_t* dest, const float* source, uint32_t width) {
+		constexpr float maxValue = (channelBytes == 2 ? 65535.0f : 255.0f);
+		for (uint32_t x = 0; x < width; x++, source += 4, dest += channelCount * channelBytes) {
+			float values[4];
+			memcpy(values, source, sizeof(values));
+			if constexpr (channelCount == 4) {
+				values[3] = std::clamp(values[3], 0.0f, maxValue);
+				float scale = (values[3] > 0.0f ? maxValue / values[3] : 0.0f);
+				for (int c = 0; c < 3; c++) { values[c] *= scale; }
+			}
+			for (int c = 0; c < channelCount; c++) {
+				uint32_t value = (uint32_t)(std::clamp(values[c], 0.0f, maxValue) + 0.5f);
+				if constexpr (channelBytes == 2) {
+					dest[c * 2] = (uint8_t)value;
+					dest[c * 2 + 1] = (uint8_t)(value >> 8);
+				}
+				else { dest[c] = (uint8_t)value; }
+			}
+		}
+	}
+
+	// Filter a loaded row horizontally, every pixel is one register so all four channels are weighted at once
+	static void FilterRow(float* dest, const float* source, const uint32_t* first, const uint32_t* count, const float* weights, uint32_t maxCount, uint32_t width) {
+		for (uint32_t x = 0; x < width; x++, weights += maxCount) {
+			const float* pixel = source + (size_t)first[x] * 4;
+			uint32_t k = 0;
+#ifdef RESAMPLER_SSE2
+			// Two sums so each addition does not wait on the one before
+			__m128 sum0 = _mm_setzero_ps();
+			__m128 sum1 = _mm_setzero_ps();
+			for (; k + 2 <= count[x]; k += 2) {
+				sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixel + k * 4)));
+				sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_set1_ps(weights[k + 1]), _mm_loadu_ps(pixel + k * 4 + 4)));
+			}
+			if (k < count[x]) { sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixel + k * 4))); }
+			_mm_storeu_ps(dest + (size_t)x * 4, _mm_add_ps(sum0, sum1));
+#else
+			float sum[4] = {};
+			for (; k < count[x]; k++) {
+				for (int c = 0; c < 4; c++) { sum[c] += weights[k] * pixel[k * 4 + c]; }
+			}
+			memcpy(dest + (size_t)x * 4, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	// Add a horizontally filtered row times its vertical weight to the output row being built
+	static void AccumulateRow(float* dest, const float* source, float weight, size_t count) {
+		size_t i = 0;
+#ifdef RESAMPLER_SSE2
+		__m128 weights = _mm_set1_ps(weight);
+		for (; i + 8 <= count; i += 8) {
+			_mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(weights, _mm_loadu_ps(source + i))));
+			_mm_storeu_ps(dest + i + 4, _mm_add_ps(_mm_loadu_ps(dest + i + 4), _mm_mul_ps(weights, _mm_loadu_ps(source + i + 4))));
+		}
+#endif
+		for (; i < count; i++) { dest[i] += weight * source[i]; }
+	}
+
+	Resampler::Resampler(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, uint32_t destWidth, uint32_t destHeight, ResamplerOptions options)
+		: m_width(destWidth), m_height(destHeight), m_pixelFormat(pixelFormat), m_options(options) {
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(pixelFormat);
+		if (bytesPerPixel == 0) { throw new std::runtime_error("Error: Cannot resample invalid pixel format"); }
+		if (width == 0 || height == 0 || destWidth == 0 || destHeight == 0) { throw new std::runtime_error("Error: Cannot resample an empty image"); }
+		if (pixels.size() < (size_t)width * height * bytesPerPixel) { throw new std::runtime_error("Error: Pixel buffer is too small for image"); }
+
+		// Nothing to filter at the same size
+		if (width == destWidth && height == destHeight) {
+			m_data.assign(pixels.begin(), pixels.begin() + (size_t)width * height * bytesPerPixel);
+			return;
+		}
+
+		m_horizontal = ComputeContributions(width, destWidth, options.filter);
+		m_vertical = ComputeContributions(height, destHeight, options.filter);
+		Resample(pixels, width, height);
+	}
+
+	Resampler::Contributions Resampler::ComputeContributions(uint32_t sourceSize, uint32_t destSize, ResampleFilter filter) {
+		// When shrinking the filter is stretched to cover every source pixel that falls in an output pixel
+		double scale = (double)sourceSize / destSize;
+		double filterScale = std::max(1.0, scale);
+		double support = FilterSupport(filter) * filterScale;
+
+		Contributions contributions;
+		contributions.maxCount = (uint32_t)std::ceil(support * 2.0) + 2;
+		contributions.first.resize(destSize);
+		contributions.count.resize(destSize);
+		contributions.weights.assign((size_t)destSize * contributions.maxCount, 0.0f);
+
+		for (uint32_t i = 0; i < destSize; i++) {
+			// Pixel j covers j to j + 1 so its centre is at j + 0.5
+			double centre = (i + 0.5) * scale;
+			int64_t begin = std::max<int64_t>(0, (int64_t)std::floor(centre - support));
+			int64_t end = std::min<int64_t>(sourceSize, (int64_t)std::ceil(centre + support));
+
+			// Pixels past the edges are dropped and the rest weighted up to make up for them
+			float* weights = contributions.weights.data() + (size_t)i * contributions.maxCount;
+			double total = 0.0;
+			for (int64_t j = begin; j < end; j++) {
+				double weight = FilterWeight(filter, (j + 0.5 - centre) / filterScale);
+				weights[j - begin] = (float)weight;
+				total += weight;
+			}
+
+			// A box narrower than a pixel can fall between centres, the nearest pixel is used then
+			if (total == 0.0) {
+				int64_t nearest = std::clamp<int64_t>((int64_t)centre, begin, end - 1);
+				weights[nearest - begin] = 1.0f;
+				total = 1.0;
+			}
+			for (int64_t j = begin; j < end; j++) { weights[j - begin] = (float)(weights[j - begin] / total); }
+
+			contributions.first[i] = (uint32_t)begin;
+			contributions.count[i] = (uint32_t)(end - begin);
+		}
+
+		return contributions;
+	}
+
+	void Resampler::Resample(std::span<const uint8_t> pixels, uint32_t sourceWidth, uint32_t sourceHeight) {
+		IL_TRACE_SCOPE("Resampler::Resample");
+
+		m_data.resize((size_t)m_width * m_height * Utils::GetPixelFormatByteSize(m_pixelFormat));
+
+		unsigned int threadCount = (m_options.threadCount != 0 ? m_options.threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		if ((uint64_t)sourceWidth * sourceHeight + (uint64_t)m_width * m_height < MIN_THREADED_PIXELS) { threadCount = 1; }
+		uint32_t bandRows = std::max(MIN_BAND_ROWS, (m_height + threadCount * 4 - 1) / (threadCount * 4));
+		uint32_t bandCount = (m_height + bandRows - 1) / bandRows;
+
+		std::atomic<uint32_t> nextBand = 0;
+		auto worker = [&]() {
+			for (uint32_t i = nextBand++; i < bandCount; i = nextBand++) {
+				uint32_t firstRow = i * bandRows;
+				ResampleRows(pixels.data(), sourceWidth, firstRow, std::min(firstRow + bandRows, m_height));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::min(threadCount, bandCount); i++) { threads.emplace_back(worker); }
+		worker();
+		for (auto& thread : threads) { thread.join(); }
+	}
+
+	void Resampler::ResampleRows(const uint8_t* pixels, uint32_t sourceWidth, uint32_t firstRow, uint32_t lastRow) {
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		size_t sourceStride = (size_t)sourceWidth * bytesPerPixel;
+		size_t destStride = (size_t)m_width * bytesPerPixel;
+		size_t rowFloats = (size_t)m_width * 4;
+
+		// Horizontally filtered rows are kept in a ring just large enough for one output row, so each is filtered once per band
+		uint32_t ringRows = m_vertical.maxCount;
+		std::vector<float> loaded((size_t)sourceWidth * 4);
+		std::vector<float> ring(ringRows * rowFloats);
+		std::vector<float> sum(rowFloats);
+
+		auto loadRow = [&](const uint8_t* source) {
+			switch (m_pixelFormat) {
+			case Utils::RGB8:
+				LoadRow<3, 1>(loaded.data(), source, sourceWidth);
+				break;
+			case Utils::RGBA8:
+				LoadRow<4, 1>(loaded.data(), source, sourceWidth);
+				break;
+			case Utils::RGB16:
+				LoadRow<3, 2>(loaded.data(), source, sourceWidth);
+				break;
+			default:
+				LoadRow<4, 2>(loaded.data(), source, sourceWidth);
+				break;
+			}
+		};
+		auto storeRow = [&](uint8_t* dest) {
+			switch (m_pixelFormat) {
+			case Utils::RGB8:
+				StoreRow<3, 1>(dest, sum.data(), m_width);
+				break;
+			case Utils::RGBA8:
+				StoreRow<4, 1>(dest, sum.data(), m_width);
+				break;
+			case Utils::RGB16:
+				StoreRow<3, 2>(dest, sum.data(), m_width);
+				break;
+			default:
+				StoreRow<4, 2>(dest, sum.data(), m_width);
+				break;
+			}
+		};
+
+		// The first contributing row only moves forward so rows behind it can be overwritten
+		uint32_t filteredEnd = m_vertical.first[firstRow];
+		for (uint32_t y = firstRow; y < lastRow; y++) {
+			uint32_t first = m_vertical.first[y];
+			uint32_t count = m_vertical.count[y];
+			for (filteredEnd = std::max(filteredEnd, first); filteredEnd < first + count; filteredEnd++) {
+				loadRow(pixels + filteredEnd * sourceStride);
+				FilterRow(ring.data() + (filteredEnd % ringRows) * rowFloats, loaded.data(), m_horizontal.first.data(), m_horizontal.count.data(), m_horizontal.weights.data(), m_horizontal.maxCount, m_width);
+			}
+
+			std::fill(sum.begin(), sum.end(), 0.0f);
+			const float* weights = m_vertical.weights.data() + (size_t)y * m_vertical.maxCount;
+			for (uint32_t k = 0; k < count; k++) {
+				if (weights[k] != 0.0f) { AccumulateRow(sum.data(), ring.data() + ((first + k) % ringRows) * rowFloats, weights[k], rowFloats); }
+			}
+			storeRow(m_data.data() + y * destStride);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <span>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	// Filters from softest to sharpest, box averages the pixels each output pixel covers and is nearest neighbour when enlarging
+	enum class ResampleFilter {
+		BOX,
+		MITCHELL,
+		LANCZOS3
+	};
+
+	struct ResamplerOptions {
+		ResampleFilter filter = ResampleFilter::LANCZOS3;
+
+		// Number of threads resampling bands of rows, 0 uses every core, small images always use one
+		unsigned int threadCount = 0;
+	};
+
+	// Resizes a pixel buffer in the Image::GetPixelBuffer layout to any size, filtering rows then columns with weights worked out once
+	// Alpha is premultiplied while filtering so the colour of transparent pixels does not bleed into their neighbours
+	class Resampler
+	{
+	public:
+		Resampler(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, uint32_t destWidth, uint32_t destHeight, ResamplerOptions options = ResamplerOptions()) noexcept(false);
+		Resampler(Image& image, uint32_t destWidth, uint32_t destHeight, ResamplerOptions options = ResamplerOptions()) noexcept(false)
+			: Resampler(image.GetWidth(), image.GetHeight(), image.GetPixelFormat(), image.GetPixelBuffer(), destWidth, destHeight, options) {};
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		Utils::PixelFormat GetPixelFormat() const noexcept { return m_pixelFormat; }
+		const std::vector<uint8_t>& GetData() const noexcept { return m_data; }
+
+	private:
+		// Source pixels contributing to each output pixel along one axis, weights are padded to the same count for every output pixel
+		struct Contributions {
+			std::vector<uint32_t> first;
+			std::vector<uint32_t> count;
+			std::vector<float> weights;
+			uint32_t maxCount = 0;
+		};
+
+		static Contributions ComputeContributions(uint32_t sourceSize, uint32_t destSize, ResampleFilter filter);
+		void Resample(std::span<const uint8_t> pixels, uint32_t sourceWidth, uint32_t sourceHeight);
+		void ResampleRows(const uint8_t* pixels, uint32_t sourceWidth, uint32_t firstRow, uint32_t lastRow);
+
+	private:
+		// Dimensions of the output
+		uint32_t m_width, m_height;
+		Utils::PixelFormat m_pixelFormat;
+		ResamplerOptions m_options;
+		Contributions m_horizontal;
+		Contributions m_vertical;
+
+		std::vector<uint8_t> m_data;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Soak.h"
+
+namespace ImageLibrary {
+	SoakRecorder::SoakRecorder(SoakOptions options, CounterSampler sampleCounters) : m_options(options), m_sampleCounters(std::move(sampleCounters)), m_start(std::chrono::steady_clock::now()) {
+		if (m_options.windowLoads == 0) { m_options.windowLoads = 1; }
+		m_latencies.reserve(m_options.windowLoads);
+	}
+
+	void SoakRecorder::AddLoad(double milliseconds) {
+		m_latencies.push_back(milliseconds);
+		m_loadCount++;
+		if (m_latencies.size() < m_options.windowLoads) { return; }
+
+		// Close the window, nearest rank percentiles are enough at a hundred or so loads
+		std::sort(m_latencies.begin(), m_latencies.end());
+		auto percentile = [&](double fraction) { return m_latencies[std::min(m_latencies.size() - 1, (size_t)(fraction * m_latencies.size()))]; };
+
+		auto now = std::chrono::steady_clock::now();
+		SoakWindow window;
+		window.loads = m_latencies.size();
+		window.seconds = std::chrono::duration<double>(now - m_start).count();
+		window.p50Milliseconds = percentile(0.50);
+		window.p99Milliseconds = percentile(0.99);
+		window.maxMilliseconds = m_latencies.back();
+		window.residentBytes = GetResidentBytes();
+		if (m_sampleCounters) { window.counters = m_sampleCounters(); }
+		m_windows.push_back(std::move(window));
+
+		m_start = now;
+		m_latencies.clear();
+	}
+
+	static double Median(std::vector<double> values) {
+		std::sort(values.begin(), values.end());
+		return values.empty() ? 0.0 : values[values.size() / 2];
+	}
+
+	std::vector<std::string> SoakRecorder::Judge() const {
+		std::vector<std::string> failures;
+		char message[256];
+
+		size_t warmup = std::min(m_options.warmupWindows, m_windows.size());
+		size_t judged = m_windows.size() - warmup;
+		if (judged < 4) {
+			snprintf(message, sizeof(message), "Too few windows to judge, %zu after warming up where at least 4 are needed", judged);
+			failures.push_back(message);
+			return failures;
+		}
+
+		// Medians over the first and last quarters so one slow window at either end does not decide it
+		size_t quarter = judged / 4;
+		auto first = m_windows.begin() + warmup;
+		auto last = m_windows.end() - quarter;
+		auto quarterMedian = [&](std::vector<SoakWindow>::const_iterator begin, auto value) {
+			std::vector<double> values;
+			for (auto window = begin; window != begin + quarter; window++) { values.push_back((double)value(*window)); }
+			return Median(std::move(values));
+		};
+
+		auto checkLatency = [&](const char* name, auto value) {
+			double before = quarterMedian(first, value), after = quarterMedian(last, value);
+			double drift = before > 0.0 ? (after - before) / before * 100.0 : 0.0;
+			if (drift > m_options.maxLatencyDriftPercent) {
+				snprintf(message, sizeof(message), "%s latency rose %.1f%% from %.3f ms to %.3f ms, more than %.1f%%", name, drift, before, after, m_options.maxLatencyDriftPercent);
+				failures.push_back(message);
+			}
+		};
+		checkLatency("Median", [](const SoakWindow& window) { return window.p50Milliseconds; });
+		checkLatency("99th percentile", [](const SoakWindow& window) { return window.p99Milliseconds; });
+
+		double residentBefore = quarterMedian(first, [](const SoakWindow& window) { return window.residentBytes; });
+		double residentAfter = quarterMedian(last, [](const SoakWindow& window) { return window.residentBytes; });
+		double growthMB = (residentAfter - residentBefore) / (1024.0 * 1024.0);
+		if (growthMB > m_options.maxMemoryGrowthMB) {
+			snprintf(message, sizeof(message), "Resident memory grew %.1f MB from %.1f MB to %.1f MB, more than %.1f MB", growthMB, residentBefore / (1024.0 * 1024.0), residentAfter / (1024.0 * 1024.0), m_options.maxMemoryGrowthMB);
+			failures.push_back(message);
+		}
+
+		// A counter that ends above everything it reached early on is leaking, counters are matched by name in case a sampler skips one
+		for (const auto& [name, finalValue] : m_windows.back().counters) {
+			bool found = false;
+			int64_t highest = 0;
+			for (auto window = first; window != first + quarter; window++) {
+				for (const auto& [counterName, value] : window->counters) {
+					if (counterName != name) { continue; }
+					highest = found ? std::max(highest, value) : value;
+					found = true;
+				}
+			}
+			if (!found) { continue; }
+
+			std::vector<double> values;
+			for (auto window = last; window != m_windows.end(); window++) {
+				for (const auto& [counterName, value] : window->counters) {
+					if (counterName == name) { values.push_back((double)value); }
+				}
+			}
+			int64_t after = (int64_t)Median(std::move(values));
+			if (after - highest > m_options.maxCounterGrowth) {
+				snprintf(message, sizeof(message), "%s grew from at most %lld to %lld", name.c_str(), (long long)highest, (long long)after);
+				failures.push_back(message);
+			}
+		}
+
+		return failures;
+	}
+
+	static std::string EscapeJSON(const std::string& value) {
+		std::string output;
+		for (unsigned char c : value) {
+			if (c == '"' || c == '\\') {
+				output += '\\';
+				output += c;
+			}
+			else if (c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				output += escaped;
+			}
+			else { output += c; }
+		}
+		return output;
+	}
+
+	std::string SoakRecorder::ToJSON() const {
+		std::vector<std::string> failures = Judge();
+		char number[256];
+
+		std::string json = "{\n  \"loads\": " + std::to_string(m_loadCount) + ",\n  \"windowLoads\": " + std::to_string(m_options.windowLoads) + ",\n  \"warmupWindows\": " + std::to_string(m_options.warmupWindows) + ",\n  \"windows\": [";
+		for (size_t i = 0; i < m_windows.size(); i++) {
+			const SoakWindow& window = m_windows[i];
+			snprintf(number, sizeof(number), "{\"loads\": %zu, \"seconds\": %.4f, \"p50Ms\": %.4f, \"p99Ms\": %.4f, \"maxMs\": %.4f, \"residentBytes\": %llu", window.loads, window.seconds, window.p50Milliseconds, window.p99Milliseconds, window.maxMilliseconds, (unsigned long long)window.residentBytes);
+			json += (i == 0 ? "\n    " : ",\n    ");
+			json += number;
+
+			json += ", \"counters\": {";
+			for (size_t j = 0; j < window.counters.size(); j++) {
+				json += (j == 0 ? "\"" : ", \"") + EscapeJSON(window.counters[j].first) + "\": " + std::to_string(window.counters[j].second);
+			}
+			json += "}}";
+		}
+		json += (m_windows.empty() ? "],\n" : "\n  ],\n");
+
+		json += std::string("  \"passed\": ") + (failures.empty() ? "true" : "false") + ",\n  \"failures\": [";
+		for (size_t i = 0; i < failures.size(); i++) {
+			json += (i == 0 ? "\"" : ", \"") + EscapeJSON(failures[i]) + "\"";
+		}
+		json += "]\n}\n";
+		return json;
+	}
+
+	uint64_t SoakRecorder::GetResidentBytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+		return counters.WorkingSetSize;
+#else
+		// The second field of statm is the resident set in pages
+		FILE* file = fopen("/proc/self/statm", "r");
+		if (file == nullptr) { return 0; }
+		unsigned long long size = 0, resident = 0;
+		int read = fscanf(file, "%llu %llu", &size, &resident);
+		fclose(file);
+		return read == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <chrono>
+
+namespace ImageLibrary {
+	struct SoakOptions {
+		// Loads in each window that latency percentiles, resident memory and counters are reported for
+		size_t windowLoads = 100;
+
+		// Windows at the start left out of the verdict while caches fill and allocators settle
+		size_t warmupWindows = 2;
+
+		// How much the median and 99th percentile latency of the last quarter of windows may rise over the first quarter
+		double maxLatencyDriftPercent = 25.0;
+
+		// How much resident memory may grow from the first quarter of windows to the last
+		double maxMemoryGrowthMB = 32.0;
+
+		// How far a counter may end above the highest it reached in the first quarter of windows
+		int64_t maxCounterGrowth = 0;
+	};
+
+	// Load latency and resources at the end of one window of loads
+	struct SoakWindow {
+		size_t loads = 0;
+		double seconds = 0.0;
+		double p50Milliseconds = 0.0, p99Milliseconds = 0.0, maxMilliseconds = 0.0;
+		uint64_t residentBytes = 0;
+		std::vector<std::pair<std::string, int64_t>> counters;
+	};
+
+	// Records load latency and resource use over a long loop of loading and unloading images, then judges whether either kept growing
+	// Judging compares the first and last quarters of the windows after warming up, so short bursts and steady noise do not fail it
+	class SoakRecorder
+	{
+	public:
+		// Counters are sampled at the end of every window, such as live GPU objects or frees waiting on a frame, and should stay level
+		using CounterSampler = std::function<std::vector<std::pair<std::string, int64_t>>()>;
+
+		SoakRecorder(SoakOptions options = SoakOptions(), CounterSampler sampleCounters = nullptr);
+
+		// Record how long one load took, closing the window once it has enough loads
+		void AddLoad(double milliseconds);
+
+		size_t GetLoadCount() const noexcept { return m_loadCount; }
+		const std::vector<SoakWindow>& GetWindows() const noexcept { return m_windows; }
+
+		// Why the soak failed, empty if it passed, a soak too short to have a window in each quarter after warming up fails
+		std::vector<std::string> Judge() const;
+
+		// Every window and the verdict as JSON
+		std::string ToJSON() const;
+
+		// Resident set size of this process, 0 where it cannot be read
+		static uint64_t GetResidentBytes();
+
+	private:
+		SoakOptions m_options;
+		CounterSampler m_sampleCounters;
+		std::chrono::steady_clock::time_point m_start;
+		size_t m_loadCount = 0;
+		std::vector<double> m_latencies;
+		std::vector<SoakWindow> m_windows;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STATISTICS_SSE2
+#endif
+
+#include "Statistics.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Pixels each thread takes at a time when computing statistics for a whole buffer
+	static constexpr size_t COMPUTE_CHUNK_PIXELS = 1 << 16;
+
+	StatisticsAccumulator::StatisticsAccumulator(Utils::PixelFormat pixelFormat)
+		: m_pixelFormat(pixelFormat), m_channelBytes(Utils::GetChannelByteSize(pixelFormat)), m_bytesPerPixel(Utils::GetPixelFormatByteSize(pixelFormat)) {
+		if (m_bytesPerPixel == 0) { throw new std::runtime_error("Error: Cannot compute statistics for invalid pixel format"); }
+
+		// A 16 bit histogram is already too large for a second copy to stay in cache
+		m_channelCount = m_bytesPerPixel / m_channelBytes;
+		m_binCount = (m_channelBytes == 2 ? 65536 : 256);
+		m_copyCount = (m_channelBytes == 2 ? 1 : 2);
+		m_bins.assign(m_copyCount * m_channelCount * m_binCount, 0);
+	}
+
+#ifdef STATISTICS_SSE2
+	// Whether a pixel is the same as the next, reads a byte past the next RGB8 pixel so needs a third pixel after it
+	template <int channelCount>
+	static bool NeighboursMatch(const uint8_t* pixel) {
+		constexpr uint32_t mask = (channelCount == 4 ? 0xFFFFFFFFu : 0x00FFFFFFu);
+		uint32_t current, next;
+		memcpy(&current, pixel, 4);
+		memcpy(&next, pixel + channelCount, 4);
+		return ((current ^ next) & mask) == 0;
+	}
+#endif
+
+	// Count 8 bit pixels into alternating copies of the histograms, channels are a template parameter so the inner loop unrolls
+	// Bins are passed in rather than read through the accumulator as the counts could otherwise alias its members
+	template <int channelCount>
+	static void AddPixels8(uint32_t* bins, const uint8_t* pixels, size_t count, size_t pixelStride) {
+		constexpr size_t copyStride = channelCount * 256;
+		for (size_t i = 0; i < count; i++) {
+			const uint8_t* pixel = pixels + i * pixelStride;
+
+#ifdef STATISTICS_SSE2
+			// Flat areas are counted 48 bytes at a time once two neighbouring pixels match, 48 being a whole number of RGB8 and RGBA8 pixels
+			// The pixels are compared as one masked word so the check is a single well predicted branch
+			if (pixelStride == channelCount && i + 2 < count && NeighboursMatch<channelCount>(pixel)) {
+				alignas(16) uint8_t repeated[48];
+				for (int b = 0; b < 48; b++) { repeated[b] = pixel[b % channelCount]; }
+				__m128i pattern0 = _mm_load_si128((const __m128i*)repeated);
+				__m128i pattern1 = _mm_load_si128((const __m128i*)(repeated + 16));
+				__m128i pattern2 = _mm_load_si128((const __m128i*)(repeated + 32));
+
+				constexpr size_t vectorPixels = 48 / channelCount;
+				size_t run = 1;
+				while (i + run + vectorPixels <= count) {
+					const uint8_t* next = pixel + run * channelCount;
+					__m128i equal = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)next), pattern0), _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(next + 16)), pattern1));
+					equal = _mm_and_si128(equal, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(next + 32)), pattern2));
+					if (_mm_movemask_epi8(equal) != 0xFFFF) { break; }
+					run += vectorPixels;
+				}
+
+				uint32_t* copy = bins + (i & 1) * copyStride;
+				for (int c = 0; c < channelCount; c++) { copy[c * 256 + pixel[c]] += (uint32_t)run; }
+				i += run - 1;
+				continue;
+			}
+#endif
+
+			uint32_t* copy = bins + (i & 1) * copyStride;
+			for (int c = 0; c < channelCount; c++) { copy[c * 256 + pixel[c]]++; }
+		}
+	}
+
+	void StatisticsAccumulator::AddPixels(const uint8_t* pixels, size_t count, size_t pixelStride) {
+		if (m_channelBytes == 1) {
+			if (m_channelCount == 4) { AddPixels8<4>(m_bins.data(), pixels, count, pixelStride); }
+			else { AddPixels8<3>(m_bins.data(), pixels, count, pixelStride); }
+			return;
+		}
+
+		uint32_t* bins = m_bins.data();
+		int channelCount = m_channelCount;
+		for (size_t i = 0; i < count; i++, pixels += pixelStride) {
+			for (int c = 0; c < channelCount; c++) { bins[c * 65536 + (pixels[c * 2] | (pixels[c * 2 + 1] << 8))]++; }
+		}
+	}
+
+	void StatisticsAccumulator::AddPixels(std::span<const Utils::Pixel> pixels) {
+		size_t copyStride = m_channelCount * m_binCount;
+		for (size_t i = 0; i < pixels.size(); i++) {
+			const Utils::Pixel& pixel = pixels[i];
+			uint32_t* bins = m_bins.data() + (i % m_copyCount) * copyStride;
+			bins[pixel.R]++;
+			bins[m_binCount + pixel.G]++;
+			bins[2 * m_binCount + pixel.B]++;
+			if (m_channelCount == 4) { bins[3 * m_binCount + pixel.A]++; }
+		}
+	}
+
+	void StatisticsAccumulator::Merge(const StatisticsAccumulator& other) {
+		if (other.m_pixelFormat != m_pixelFormat) { throw new std::runtime_error("Error: Cannot merge statistics of different pixel formats"); }
+		for (size_t i = 0; i < m_bins.size(); i++) { m_bins[i] += other.m_bins[i]; }
+	}
+
+	ImageStatistics StatisticsAccumulator::GetStatistics() const {
+		ImageStatistics statistics;
+		statistics.pixelFormat = m_pixelFormat;
+		statistics.channelCount = m_channelCount;
+
+		size_t copyStride = m_channelCount * m_binCount;
+		for (int c = 0; c < m_channelCount; c++) {
+			// Combine the copies of the histogram
+			std::vector<uint64_t>& histogram = statistics.histograms[c];
+			histogram.assign(m_binCount, 0);
+			for (int copy = 0; copy < m_copyCount; copy++) {
+				const uint32_t* bins = m_bins.data() + copy * copyStride + c * m_binCount;
+				for (size_t value = 0; value < m_binCount; value++) { histogram[value] += bins[value]; }
+			}
+
+			// Levels follow exactly from the histogram
+			uint64_t count = 0;
+			double sum = 0.0;
+			bool found = false;
+			for (size_t value = 0; value < m_binCount; value++) {
+				if (histogram[value] == 0) { continue; }
+				if (!found) { statistics.minimum[c] = (uint16_t)value; }
+				statistics.maximum[c] = (uint16_t)value;
+				found = true;
+				count += histogram[value];
+				sum += (double)value * histogram[value];
+			}
+			statistics.pixelCount = count;
+			statistics.mean[c] = (count != 0 ? sum / count : 0.0);
+		}
+
+		return statistics;
+	}
+
+	ImageStatistics StatisticsAccumulator::Compute(Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, unsigned int threadCount) {
+		IL_TRACE_SCOPE("StatisticsAccumulator::Compute");
+
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(pixelFormat);
+		if (bytesPerPixel == 0) { throw new std::runtime_error("Error: Cannot compute statistics for invalid pixel format"); }
+		size_t pixelCount = pixels.size() / bytesPerPixel;
+		size_t chunkCount = (pixelCount + COMPUTE_CHUNK_PIXELS - 1) / COMPUTE_CHUNK_PIXELS;
+
+		// Threads take chunks until none are left so each accumulator ends up with a similar share
+		threadCount = (threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency()));
+		threadCount = (unsigned int)std::max<size_t>(1, std::min<size_t>(threadCount, chunkCount));
+		std::vector<StatisticsAccumulator> accumulators(threadCount, StatisticsAccumulator(pixelFormat));
+
+		std::atomic<size_t> nextChunk = 0;
+		auto worker = [&](StatisticsAccumulator& accumulator) {
+			for (size_t i = nextChunk++; i < chunkCount; i = nextChunk++) {
+				size_t first = i * COMPUTE_CHUNK_PIXELS;
+				accumulator.AddPixels(pixels.data() + first * bytesPerPixel, std::min(COMPUTE_CHUNK_PIXELS, pixelCount - first), bytesPerPixel);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++) { threads.emplace_back(worker, std::ref(accumulators[i])); }
+		worker(accumulators[0]);
+		for (auto& thread : threads) { thread.join(); }
+
+		for (unsigned int i = 1; i < threadCount; i++) { accumulators[0].Merge(accumulators[i]); }
+		return accumulators[0].GetStatistics();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <span>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	// Histogram and levels of each channel of a pixel buffer, channels are in RGB(A) order with greyscale repeated in R, G and B
+	struct ImageStatistics {
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+		uint64_t pixelCount = 0;
+		int channelCount = 0;
+
+		// One bin per value, 256 for 8 bit images and 65536 for 16 bit
+		std::array<std::vector<uint64_t>, 4> histograms;
+		std::array<uint16_t, 4> minimum{};
+		std::array<uint16_t, 4> maximum{};
+		std::array<double, 4> mean{};
+	};
+
+	// Builds statistics from pixels handed to it in any order, so rows can be added as soon as they are decoded
+	class StatisticsAccumulator
+	{
+	public:
+		StatisticsAccumulator(Utils::PixelFormat pixelFormat) noexcept(false);
+
+		// Pixels laid out as Image::GetPixelBuffer gives them, the stride allows adding every other pixel of an interlaced pass
+		void AddPixels(const uint8_t* pixels, size_t count, size_t pixelStride);
+		void AddPixels(std::span<const uint8_t> pixels) { AddPixels(pixels.data(), pixels.size() / m_bytesPerPixel, m_bytesPerPixel); }
+		void AddPixels(std::span<const Utils::Pixel> pixels);
+
+		// Add the counts of an accumulator for the same pixel format
+		void Merge(const StatisticsAccumulator& other);
+
+		ImageStatistics GetStatistics() const;
+
+		// Split a whole buffer between threads, each with its own accumulator, merged once they are all finished
+		// A thread count of 0 uses every core
+		static ImageStatistics Compute(Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, unsigned int threadCount = 0) noexcept(false);
+
+	private:
+		Utils::PixelFormat m_pixelFormat;
+		int m_channelCount;
+		int m_channelBytes;
+		int m_bytesPerPixel;
+		size_t m_binCount;
+
+		// 8 bit images keep two copies of every histogram used by alternate pixels so neighbouring equal values do not wait on each other
+		// Counts are per copy, channel then value and cannot overflow as an image has fewer than 2^32 pixels
+		int m_copyCount;
+		std::vector<uint32_t> m_bins;
+	};
+}
\ No newline at end of file
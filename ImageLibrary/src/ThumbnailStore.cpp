@@ -0,0 +1,305 @@
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+#include "ThumbnailStore.h"
+#include "PNG.h"
+#include "JPEG.h"
+#include "Resampler.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Thumbnail pixels and the index start on this boundary so index entries can be read in place
+	static constexpr uint64_t PACK_ALIGNMENT = 16;
+
+	static uint64_t AlignPackOffset(uint64_t offset) {
+		return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+	}
+
+	static uint64_t GetThumbnailDataSize(const ThumbnailStore::IndexEntry& entry) {
+		return (uint64_t)entry.width * entry.height * Utils::GetPixelFormatByteSize((Utils::PixelFormat)entry.pixelFormat);
+	}
+
+	// Write zeros up to the next aligned offset
+	static void PadPack(std::ostream& file, uint64_t& offset) {
+		static constexpr char zeros[PACK_ALIGNMENT] = {};
+		uint64_t aligned = AlignPackOffset(offset);
+		file.write(zeros, (std::streamsize)(aligned - offset));
+		offset = aligned;
+	}
+
+	ThumbnailStore::ThumbnailStore(std::filesystem::path packPath, uint32_t thumbnailSize) : m_packPath(packPath), m_thumbnailSize(thumbnailSize) {
+		if (thumbnailSize == 0) { throw new std::runtime_error("Error: Thumbnail size must not be 0"); }
+		Open();
+	}
+
+	ThumbnailStore::~ThumbnailStore() {
+		try { Flush(); }
+		catch (std::runtime_error* e) { delete e; }
+	}
+
+	void ThumbnailStore::Open() {
+		IL_TRACE_SCOPE("ThumbnailStore::Open");
+
+		// Map an existing pack, anything from another version or thumbnail size or that does not hold together is started again
+		std::error_code err;
+		if (std::filesystem::exists(m_packPath, err)) {
+			try {
+				m_pack = std::make_shared<MappedFile>(m_packPath);
+				const Header* header = reinterpret_cast<const Header*>(m_pack->GetData());
+				bool valid = m_pack->GetSize() >= sizeof(Header) && header->magic == MAGIC && header->version == VERSION && header->thumbnailSize == m_thumbnailSize
+					&& header->indexOffset % PACK_ALIGNMENT == 0 && header->indexOffset + (uint64_t)header->entryCount * sizeof(IndexEntry) <= m_pack->GetSize();
+				if (valid) { return; }
+			}
+			catch (std::runtime_error* e) { delete e; }
+			m_pack.reset();
+		}
+
+		std::filesystem::create_directories(m_packPath.parent_path(), err);
+		{
+			Header header{ .magic = MAGIC, .version = VERSION, .thumbnailSize = m_thumbnailSize, .entryCount = 0, .indexOffset = sizeof(Header), .unusedBytes = 0 };
+			std::ofstream file(m_packPath, std::ios_base::binary | std::ios_base::trunc);
+			file.write((const char*)&header, sizeof(Header));
+			if (!file) { throw new std::runtime_error("Error: Could not create thumbnail pack"); }
+		}
+		m_pack = std::make_shared<MappedFile>(m_packPath);
+	}
+
+	std::span<const ThumbnailStore::IndexEntry> ThumbnailStore::GetIndex() const noexcept {
+		const Header* header = reinterpret_cast<const Header*>(m_pack->GetData());
+		return std::span<const IndexEntry>(reinterpret_cast<const IndexEntry*>(m_pack->GetData() + header->indexOffset), header->entryCount);
+	}
+
+	const ThumbnailStore::IndexEntry* ThumbnailStore::FindIndexEntry(uint64_t pathHash) const noexcept {
+		std::span<const IndexEntry> index = GetIndex();
+		auto it = std::lower_bound(index.begin(), index.end(), pathHash, [](const IndexEntry& entry, uint64_t hash) { return entry.pathHash < hash; });
+		return (it != index.end() && it->pathHash == pathHash ? &*it : nullptr);
+	}
+
+	bool ThumbnailStore::GetSourceKey(const std::string& sourcePath, SourceKey& key) {
+		std::error_code err;
+		std::filesystem::path path = std::filesystem::absolute(sourcePath, err);
+		if (err) { return false; }
+
+		key.size = std::filesystem::file_size(path, err);
+		if (err) { return false; }
+
+		key.time = std::filesystem::last_write_time(path, err).time_since_epoch().count();
+		if (err) { return false; }
+
+		// FNV-1a over the path alone so a changed file replaces its old thumbnail
+		std::string pathString = path.generic_string();
+		key.pathHash = 0xcbf29ce484222325ULL;
+		for (char c : pathString) {
+			key.pathHash ^= (uint8_t)c;
+			key.pathHash *= 0x100000001b3ULL;
+		}
+		return true;
+	}
+
+	std::optional<Thumbnail> ThumbnailStore::Find(const std::string& sourcePath) {
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return std::nullopt; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_pending.find(key.pathHash);
+		if (it != m_pending.end()) {
+			const Pending& pending = it->second;
+			if (pending.entry.sourceSize != key.size || pending.entry.sourceTime != key.time) { return std::nullopt; }
+			return Thumbnail{ .width = pending.entry.width, .height = pending.entry.height, .pixelFormat = (Utils::PixelFormat)pending.entry.pixelFormat, .pixels = *pending.pixels, .owner = pending.pixels };
+		}
+
+		const IndexEntry* entry = FindIndexEntry(key.pathHash);
+		if (!entry || entry->sourceSize != key.size || entry->sourceTime != key.time) { return std::nullopt; }
+
+		// An entry pointing outside the thumbnails is treated as missing and replaced when made again
+		const Header* header = reinterpret_cast<const Header*>(m_pack->GetData());
+		bool valid = (entry->pixelFormat == Utils::RGB8 || entry->pixelFormat == Utils::RGBA8) && entry->dataOffset + GetThumbnailDataSize(*entry) <= header->indexOffset;
+		if (!valid) { return std::nullopt; }
+
+		return Thumbnail{ .width = entry->width, .height = entry->height, .pixelFormat = (Utils::PixelFormat)entry->pixelFormat,
+			.pixels = std::span<const uint8_t>(m_pack->GetData() + entry->dataOffset, GetThumbnailDataSize(*entry)), .owner = m_pack };
+	}
+
+	std::expected<Thumbnail, DecodeError> ThumbnailStore::Create(const std::string& sourcePath) {
+		IL_TRACE_SCOPE("ThumbnailStore::Create");
+
+		// Only the size is needed from the probe
+		bool jpeg = (Utils::GetFileFormat(sourcePath) == Utils::FileFormat::JPEG);
+		uint32_t width, height;
+		if (jpeg) {
+			std::expected<JPEGInfo, DecodeError> info = JPEG::Probe(sourcePath);
+			if (!info) { return std::unexpected(info.error()); }
+			width = info->width;
+			height = info->height;
+		}
+		else {
+			std::expected<PNGInfo, DecodeError> info = PNG::Probe(sourcePath);
+			if (!info) { return std::unexpected(info.error()); }
+			width = info->width;
+			height = info->height;
+		}
+
+		// Reduce as far as possible while the longest side stays at least the thumbnail size so the last step only shrinks
+		uint32_t longestSide = std::max(width, height);
+		uint32_t reduction = 1;
+		while (reduction < 8 && longestSide / (reduction * 2) >= m_thumbnailSize) { reduction *= 2; }
+
+		std::expected<DecodedImage, DecodeError> decoded = (jpeg ? JPEG::DecodeReduced(sourcePath, reduction) : PNG::DecodeReduced(sourcePath, reduction));
+		if (!decoded) { return std::unexpected(decoded.error()); }
+
+		return Add(sourcePath, decoded->width, decoded->height, decoded->pixelFormat, decoded->pixels);
+	}
+
+	Thumbnail ThumbnailStore::Add(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) {
+		// Fit inside a square of the thumbnail size keeping the aspect ratio
+		double scale = std::min(1.0, (double)m_thumbnailSize / std::max(width, height));
+		uint32_t thumbnailWidth = std::max(1u, (uint32_t)std::lround(width * scale));
+		uint32_t thumbnailHeight = std::max(1u, (uint32_t)std::lround(height * scale));
+
+		ResamplerOptions options;
+		options.filter = ResampleFilter::MITCHELL;
+		options.threadCount = 1;
+		Resampler resampler(width, height, pixelFormat, pixels, thumbnailWidth, thumbnailHeight, options);
+
+		// Thumbnails are always 8 bit
+		Utils::PixelFormat thumbnailFormat = (Utils::HasAlphaChannel(pixelFormat) ? Utils::RGBA8 : Utils::RGB8);
+		auto thumbnailPixels = std::make_shared<std::vector<uint8_t>>();
+		if (Utils::GetChannelByteSize(pixelFormat) == 2) {
+			const std::vector<uint8_t>& wide = resampler.GetData();
+			thumbnailPixels->resize(wide.size() / 2);
+			for (size_t i = 0; i < thumbnailPixels->size(); i++) { (*thumbnailPixels)[i] = (uint8_t)(((wide[i * 2] | (wide[i * 2 + 1] << 8)) * 255 + 32767) / 65535); }
+		}
+		else { *thumbnailPixels = resampler.GetData(); }
+
+		Thumbnail thumbnail{ .width = thumbnailWidth, .height = thumbnailHeight, .pixelFormat = thumbnailFormat, .pixels = *thumbnailPixels, .owner = thumbnailPixels };
+
+		// A source that cannot be found again cannot be looked up either so is not stored
+		SourceKey key;
+		if (!GetSourceKey(sourcePath, key)) { return thumbnail; }
+
+		Pending pending;
+		pending.entry = IndexEntry{ .pathHash = key.pathHash, .sourceSize = key.size, .sourceTime = key.time, .dataOffset = 0, .width = thumbnailWidth, .height = thumbnailHeight, .pixelFormat = thumbnailFormat, .padding = 0 };
+		pending.pixels = thumbnailPixels;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending[key.pathHash] = std::move(pending);
+		return thumbnail;
+	}
+
+	size_t ThumbnailStore::GetCount() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t count = GetIndex().size();
+		for (const auto& [hash, pending] : m_pending) {
+			if (!FindIndexEntry(hash)) { count++; }
+		}
+		return count;
+	}
+
+	void ThumbnailStore::Flush() {
+		IL_TRACE_SCOPE("ThumbnailStore::Flush");
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_pending.empty()) { return; }
+
+		// The old index and every replaced thumbnail are left unused in the file
+		Header header = *reinterpret_cast<const Header*>(m_pack->GetData());
+		uint64_t unusedBytes = header.unusedBytes + (uint64_t)header.entryCount * sizeof(IndexEntry);
+		for (const auto& [hash, pending] : m_pending) {
+			if (const IndexEntry* replaced = FindIndexEntry(hash)) { unusedBytes += GetThumbnailDataSize(*replaced); }
+		}
+		if (unusedBytes > m_pack->GetSize() / 2) {
+			Rewrite();
+			return;
+		}
+
+		// Merge the kept entries with the new ones, both sorted by path hash
+		std::vector<IndexEntry> index;
+		index.reserve(header.entryCount + m_pending.size());
+		for (const IndexEntry& entry : GetIndex()) {
+			if (!m_pending.contains(entry.pathHash)) { index.push_back(entry); }
+		}
+
+		// New thumbnails and the index go after everything already in the file, the header is only updated once they are written
+		std::fstream file(m_packPath, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+		file.seekp(0, std::ios_base::end);
+		uint64_t offset = (uint64_t)file.tellp();
+		for (auto& [hash, pending] : m_pending) {
+			PadPack(file, offset);
+			pending.entry.dataOffset = offset;
+			file.write((const char*)pending.pixels->data(), (std::streamsize)pending.pixels->size());
+			offset += pending.pixels->size();
+			index.push_back(pending.entry);
+		}
+		std::sort(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.pathHash < b.pathHash; });
+
+		PadPack(file, offset);
+		header.indexOffset = offset;
+		header.entryCount = (uint32_t)index.size();
+		header.unusedBytes = unusedBytes;
+		file.write((const char*)index.data(), (std::streamsize)(index.size() * sizeof(IndexEntry)));
+		file.flush();
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(Header));
+		file.close();
+		if (!file) { throw new std::runtime_error("Error: Could not write thumbnail pack"); }
+
+		// Thumbnails already handed out keep the old mapping alive
+		m_pending.clear();
+		m_pack = std::make_shared<MappedFile>(m_packPath);
+	}
+
+	void ThumbnailStore::Rewrite() {
+		IL_TRACE_SCOPE("ThumbnailStore::Rewrite");
+
+		std::filesystem::path tempPath = m_packPath;
+		tempPath += ".tmp";
+
+		// Copy every current thumbnail into a new pack and rename it over the old one
+		std::vector<IndexEntry> index;
+		{
+			std::ofstream file(tempPath, std::ios_base::binary | std::ios_base::trunc);
+			Header header{ .magic = MAGIC, .version = VERSION, .thumbnailSize = m_thumbnailSize };
+			file.write((const char*)&header, sizeof(Header));
+			uint64_t offset = sizeof(Header);
+
+			auto write = [&](IndexEntry entry, const uint8_t* pixels) {
+				PadPack(file, offset);
+				entry.dataOffset = offset;
+				file.write((const char*)pixels, (std::streamsize)GetThumbnailDataSize(entry));
+				offset += GetThumbnailDataSize(entry);
+				index.push_back(entry);
+			};
+			for (const IndexEntry& entry : GetIndex()) {
+				if (!m_pending.contains(entry.pathHash) && entry.dataOffset + GetThumbnailDataSize(entry) <= reinterpret_cast<const Header*>(m_pack->GetData())->indexOffset) {
+					write(entry, m_pack->GetData() + entry.dataOffset);
+				}
+			}
+			for (const auto& [hash, pending] : m_pending) { write(pending.entry, pending.pixels->data()); }
+			std::sort(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.pathHash < b.pathHash; });
+
+			PadPack(file, offset);
+			header.indexOffset = offset;
+			header.entryCount = (uint32_t)index.size();
+			file.write((const char*)index.data(), (std::streamsize)(index.size() * sizeof(IndexEntry)));
+			file.seekp(0);
+			file.write((const char*)&header, sizeof(Header));
+			if (!file) {
+				file.close();
+				std::error_code err;
+				std::filesystem::remove(tempPath, err);
+				throw new std::runtime_error("Error: Could not write thumbnail pack");
+			}
+		}
+
+		std::error_code err;
+		std::filesystem::rename(tempPath, m_packPath, err);
+		if (err) {
+			std::filesystem::remove(tempPath, err);
+			throw new std::runtime_error("Error: Could not replace thumbnail pack");
+		}
+
+		m_pending.clear();
+		m_pack = std::make_shared<MappedFile>(m_packPath);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <mutex>
+#include <expected>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Image.h"
+
+namespace ImageLibrary {
+	// Small copy of an image, 8 bit RGB or RGBA with its longest side no larger than the store's thumbnail size
+	struct Thumbnail {
+		uint32_t width = 0, height = 0;
+		Utils::PixelFormat pixelFormat = Utils::INVALID;
+		std::span<const uint8_t> pixels;
+
+		// Keeps the pack mapping or the newly made pixels the span points into alive
+		std::shared_ptr<const void> owner;
+	};
+
+	// Persistent thumbnails of any number of images kept in a single pack file that is mapped rather than read
+	// The pack is the pixels of every thumbnail followed by an index sorted by the hash of the source path, so opening it only maps the file
+	// and a lookup is a binary search of the mapped index. Thumbnails added since the last flush are held in memory until Flush appends them
+	// with a new index and only then rewrites the header, so a pack is never left pointing at a partly written index
+	class ThumbnailStore
+	{
+	public:
+		// Header at the start of the pack
+		struct Header {
+			uint32_t magic;
+			uint32_t version;
+			uint32_t thumbnailSize;
+			uint32_t entryCount;
+			uint64_t indexOffset;
+			uint64_t unusedBytes;
+		};
+		static_assert(sizeof(Header) == 32, "Thumbnail pack header must be 32 bytes");
+
+		// Index entry for one thumbnail, the source size and time tell whether the thumbnail is still current
+		struct IndexEntry {
+			uint64_t pathHash;
+			uint64_t sourceSize;
+			int64_t sourceTime;
+			uint64_t dataOffset;
+			uint32_t width;
+			uint32_t height;
+			uint32_t pixelFormat;
+			uint32_t padding;
+		};
+		static_assert(sizeof(IndexEntry) == 48, "Thumbnail index entry must be 48 bytes");
+
+		static constexpr uint32_t MAGIC = 0x31545650; // "PVT1"
+		static constexpr uint32_t VERSION = 1;
+
+		// A pack made with a different thumbnail size is started again
+		ThumbnailStore(std::filesystem::path packPath, uint32_t thumbnailSize = 256) noexcept(false);
+		~ThumbnailStore() noexcept;
+
+		ThumbnailStore(const ThumbnailStore&) = delete;
+		ThumbnailStore& operator=(const ThumbnailStore&) = delete;
+
+		// Thumbnail for a source file if one is stored and the file has not changed since, safe to call from any thread
+		std::optional<Thumbnail> Find(const std::string& sourcePath);
+
+		// Decode a reduced size copy of a PNG, scale it to fit the thumbnail size and add it, safe to call from any thread
+		std::expected<Thumbnail, DecodeError> Create(const std::string& sourcePath);
+
+		// Add a thumbnail made elsewhere, it is scaled to fit the thumbnail size and reduced to 8 bits if needed
+		Thumbnail Add(const std::string& sourcePath, uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) noexcept(false);
+
+		// Write thumbnails added since the last flush to the pack, rewriting it without replaced thumbnails once they are most of it
+		void Flush() noexcept(false);
+
+		uint32_t GetThumbnailSize() const noexcept { return m_thumbnailSize; }
+		size_t GetCount();
+
+	private:
+		struct SourceKey {
+			uint64_t pathHash;
+			uint64_t size;
+			int64_t time;
+		};
+
+		// Thumbnail made since the last flush
+		struct Pending {
+			IndexEntry entry;
+			std::shared_ptr<std::vector<uint8_t>> pixels;
+		};
+
+		static bool GetSourceKey(const std::string& sourcePath, SourceKey& key);
+		void Open();
+		std::span<const IndexEntry> GetIndex() const noexcept;
+		const IndexEntry* FindIndexEntry(uint64_t pathHash) const noexcept;
+		void Rewrite();
+
+	private:
+		std::filesystem::path m_packPath;
+		uint32_t m_thumbnailSize;
+
+		// Mapping of the pack as of the last flush, shared with every thumbnail found in it
+		std::shared_ptr<MappedFile> m_pack;
+		std::unordered_map<uint64_t, Pending> m_pending;
+		std::mutex m_mutex;
+	};
+}
\ No newline at end of file
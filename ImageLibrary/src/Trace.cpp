@@ -0,0 +1,154 @@
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+#include "Trace.h"
+
+namespace ImageLibrary {
+	namespace Trace {
+		// Event fields are atomic so a reader copying a slot being overwritten is not a data race, torn copies are discarded instead
+		struct Slot {
+			std::atomic<const char*> name = nullptr;
+			std::atomic<uint64_t> start = 0;
+			std::atomic<uint64_t> duration = 0;
+			std::atomic<uint32_t> threadId = 0;
+		};
+
+		// Ring of events written only by the thread that owns it
+		struct ThreadBuffer {
+			std::array<Slot, EVENTS_PER_THREAD> slots;
+			std::atomic<uint64_t> started = 0;
+			std::atomic<uint64_t> written = 0;
+			std::atomic<bool> inUse = false;
+			uint32_t threadId = 0;
+		};
+
+		// Buffers are never freed, a thread that exits hands its buffer to the next thread that records
+		static std::mutex s_buffersMutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+		static std::atomic<uint32_t> s_nextThreadId = 1;
+		static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+		struct ThreadBufferHandle {
+			ThreadBuffer* buffer = nullptr;
+			~ThreadBufferHandle() { if (buffer) { buffer->inUse.store(false, std::memory_order_release); } }
+		};
+		static thread_local ThreadBufferHandle t_handle;
+
+		static ThreadBuffer* AcquireBuffer() {
+			std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+			ThreadBuffer* buffer = nullptr;
+			for (const auto& existing : s_buffers) {
+				bool expected = false;
+				if (existing->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+					buffer = existing.get();
+					break;
+				}
+			}
+			if (!buffer) {
+				s_buffers.push_back(std::make_unique<ThreadBuffer>());
+				buffer = s_buffers.back().get();
+				buffer->inUse.store(true, std::memory_order_relaxed);
+			}
+
+			buffer->threadId = s_nextThreadId++;
+			return buffer;
+		}
+
+		uint64_t Now() noexcept {
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+		}
+
+		void Record(const char* name, uint64_t start, uint64_t end) noexcept {
+			ThreadBuffer* buffer = t_handle.buffer;
+			if (!buffer) {
+				// Registering is the only time a lock is taken, if it fails the event is dropped
+				try { buffer = t_handle.buffer = AcquireBuffer(); }
+				catch (...) { return; }
+			}
+
+			// Announce the slot is being overwritten before touching it so readers can tell their copy may be torn
+			uint64_t index = buffer->written.load(std::memory_order_relaxed);
+			buffer->started.store(index + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			Slot& slot = buffer->slots[index % EVENTS_PER_THREAD];
+			slot.name.store(name, std::memory_order_relaxed);
+			slot.start.store(start, std::memory_order_relaxed);
+			slot.duration.store(end - start, std::memory_order_relaxed);
+			slot.threadId.store(buffer->threadId, std::memory_order_relaxed);
+
+			buffer->written.store(index + 1, std::memory_order_release);
+		}
+
+		std::vector<Event> Collect(uint64_t since) {
+			std::vector<Event> events;
+			std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+			for (const auto& buffer : s_buffers) {
+				uint64_t written = buffer->written.load(std::memory_order_acquire);
+				uint64_t first = (written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0);
+
+				size_t copiedFrom = events.size();
+				for (uint64_t i = first; i < written; i++) {
+					const Slot& slot = buffer->slots[i % EVENTS_PER_THREAD];
+					events.push_back(Event{
+						.name = slot.name.load(std::memory_order_relaxed),
+						.start = slot.start.load(std::memory_order_relaxed),
+						.duration = slot.duration.load(std::memory_order_relaxed),
+						.threadId = slot.threadId.load(std::memory_order_relaxed)
+					});
+				}
+
+				// Drop anything the owning thread started overwriting while it was copied
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint64_t started = buffer->started.load(std::memory_order_relaxed);
+				uint64_t overwritten = (started > EVENTS_PER_THREAD ? started - EVENTS_PER_THREAD : 0);
+				if (overwritten > first) {
+					size_t torn = (size_t)std::min(overwritten - first, written - first);
+					events.erase(events.begin() + copiedFrom, events.begin() + copiedFrom + torn);
+				}
+			}
+
+			std::erase_if(events, [since](const Event& event) { return event.start < since; });
+			std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+			return events;
+		}
+
+		static void AppendEscaped(std::string& output, const char* value) {
+			for (const char* c = value; *c; c++) {
+				if (*c == '"' || *c == '\\') { output += '\\'; }
+				output += *c;
+			}
+		}
+
+		std::string ToChromeTraceJSON(const std::vector<Event>& events) {
+			std::string json = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+			// Complete events with times in microseconds
+			char times[128];
+			for (size_t i = 0; i < events.size(); i++) {
+				json += (i == 0 ? "\n" : ",\n");
+				json += "{\"name\": \"";
+				AppendEscaped(json, events[i].name);
+				snprintf(times, sizeof(times), "\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", events[i].threadId, events[i].start / 1000.0, events[i].duration / 1000.0);
+				json += times;
+			}
+
+			json += "\n]}\n";
+			return json;
+		}
+
+		void WriteChromeTrace(const std::filesystem::path& path) {
+			std::ofstream file(path, std::ios::binary);
+			file << ToChromeTraceJSON(Collect());
+			if (!file) { throw new std::runtime_error("Error: Could not write trace"); }
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+
+namespace ImageLibrary {
+	namespace Trace {
+		// Completed scope with times in nanoseconds since the process started
+		struct Event {
+			const char* name;
+			uint64_t start;
+			uint64_t duration;
+			uint32_t threadId;
+		};
+
+		// Events recorded by each thread before the oldest are overwritten
+		inline constexpr size_t EVENTS_PER_THREAD = 4096;
+
+		// Recording is off until enabled so a disabled scope only costs a relaxed load
+		inline std::atomic<bool> s_enabled = false;
+		inline void SetEnabled(bool enabled) noexcept { s_enabled.store(enabled, std::memory_order_relaxed); }
+		inline bool IsEnabled() noexcept { return s_enabled.load(std::memory_order_relaxed); }
+
+		uint64_t Now() noexcept;
+		void Record(const char* name, uint64_t start, uint64_t end) noexcept;
+
+		// Copy the events every thread has recorded ordered by start time, optionally only those starting after a time
+		std::vector<Event> Collect(uint64_t since = 0);
+
+		// Chrome trace event format that can be opened in chrome://tracing or Perfetto
+		std::string ToChromeTraceJSON(const std::vector<Event>& events);
+		void WriteChromeTrace(const std::filesystem::path& path);
+
+		// Records the time from construction to destruction, name must be a string literal as only the pointer is kept
+		class Scope
+		{
+		public:
+			Scope(const char* name) noexcept : m_name(name), m_recording(IsEnabled()) { if (m_recording) { m_start = Now(); } };
+			~Scope() noexcept { if (m_recording) { Record(m_name, m_start, Now()); } };
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			const char* m_name;
+			bool m_recording;
+			uint64_t m_start = 0;
+		};
+	}
+}
+
+// Time the rest of the enclosing block, compiled out unless IL_TRACING is defined
+#define IL_TRACE_CONCAT_INNER(a, b) a##b
+#define IL_TRACE_CONCAT(a, b) IL_TRACE_CONCAT_INNER(a, b)
+#ifdef IL_TRACING
+#define IL_TRACE_SCOPE(name) ::ImageLibrary::Trace::Scope IL_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define IL_TRACE_SCOPE(name)
+#endif
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include <cctype>
+#include <algorithm>
+
+#include "Utils.h"
+
+namespace ImageLibrary {
+	namespace Utils {
+		FileFormat GetFileFormat(const std::string& filePath) {
+			size_t dot = filePath.find_last_of("./\\");
+			if (dot == std::string::npos || filePath[dot] != '.') { return FileFormat::UNKNOWN; }
+
+			std::string extension = filePath.substr(dot + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+			if (extension == "png") { return FileFormat::PNG; }
+			if (extension == "jpg" || extension == "jpeg" || extension == "jpe" || extension == "jfif") { return FileFormat::JPEG; }
+			return FileFormat::UNKNOWN;
+		}
+
+		int GetPixelFormatByteSize(PixelFormat pixelFormat) {
+			return GetChannelByteSize(pixelFormat) * (HasAlphaChannel(pixelFormat) ? 4 : 3);
+		}
+
+		int GetChannelByteSize(PixelFormat pixelFormat) {
+			switch (pixelFormat) {
+			case RGB8:
+				[[fallthrough]];
+			case RGBA8:
+				return 1;
+			case RGB16:
+				[[fallthrough]];
+			case RGBA16:
+				return 2;
+			default:
+				return 0;
+			}
+		}
+
+		bool HasAlphaChannel(PixelFormat pixelFormat) {
+			switch (pixelFormat) {
+			case RGBA8:
+				[[fallthrough]];
+			case RGBA16:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		PixelFormat GetAlphaPixelFormat(PixelFormat pixelFormat) {
+			switch (pixelFormat) {
+			case RGB8:
+				return RGBA8;
+			case RGB16:
+				return RGBA16;
+			default:
+				return pixelFormat;
+			}
+		}
+
+		int GetBlockByteSize(BlockFormat blockFormat) {
+			switch (blockFormat) {
+			case BC1:
+				[[fallthrough]];
+			case BC4:
+				return 8;
+			case BC7:
+				return 16;
+			default:
+				return 0;
+			}
+		}
+
+		size_t GetBlockBufferSize(BlockFormat blockFormat, uint32_t width, uint32_t height) {
+			return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockByteSize(blockFormat);
+		}
+
+		int GetTargetFormatByteSize(TargetFormat targetFormat) {
+			switch (targetFormat) {
+			case TargetFormat::R8:
+				return 1;
+			case TargetFormat::R16:
+				return 2;
+			case TargetFormat::RGB8:
+				[[fallthrough]];
+			case TargetFormat::BGR8:
+				return 3;
+			case TargetFormat::RGBA8:
+				[[fallthrough]];
+			case TargetFormat::BGRA8:
+				return 4;
+			case TargetFormat::RGB16:
+				return 6;
+			case TargetFormat::RGBA16:
+				return 8;
+			default:
+				return 0;
+			}
+		}
+
+		// Change a channel between depths, 16 to 8 bits rounds to the nearest so 8 bit values widened and narrowed again are unchanged
+		template <int SourceSize, int TargetSize>
+		static uint32_t ChangeDepth(uint32_t value) {
+			if constexpr (SourceSize == TargetSize) { return value; }
+			else if constexpr (TargetSize == 2) { return value * 257; }
+			else { return (value + 128) / 257; }
+		}
+
+		// Every combination is its own loop so the channel layouts are known when compiled
+		template <int SourceChannels, int SourceSize, TargetFormat Target>
+		static void ConvertPixels(const uint8_t* source, uint8_t* dest, size_t destStep, size_t count) {
+			constexpr int targetSize = (Target == TargetFormat::R16 || Target == TargetFormat::RGB16 || Target == TargetFormat::RGBA16 ? 2 : 1);
+			constexpr bool targetAlpha = (Target == TargetFormat::RGBA8 || Target == TargetFormat::BGRA8 || Target == TargetFormat::RGBA16);
+			constexpr bool swapRedBlue = (Target == TargetFormat::BGR8 || Target == TargetFormat::BGRA8);
+			constexpr uint32_t opaque = (SourceSize == 2 ? UINT16_MAX : UINT8_MAX);
+
+			auto read = [](const uint8_t* pixel, int channel) -> uint32_t {
+				if constexpr (SourceSize == 2) { return pixel[channel * 2] | (pixel[channel * 2 + 1] << 8); }
+				else { return pixel[channel]; }
+			};
+			auto write = [](uint8_t* pixel, int channel, uint32_t value) {
+				value = ChangeDepth<SourceSize, targetSize>(value);
+				pixel[channel * targetSize] = (uint8_t)value;
+				if constexpr (targetSize == 2) { pixel[channel * targetSize + 1] = (uint8_t)(value >> 8); }
+			};
+
+			for (size_t i = 0; i < count; i++, source += SourceChannels * SourceSize, dest += destStep) {
+				uint32_t red = read(source, 0);
+				uint32_t green = read(source, 1);
+				uint32_t blue = read(source, 2);
+
+				// Weights out of 256 so grey pixels keep their value exactly
+				if constexpr (Target == TargetFormat::R8 || Target == TargetFormat::R16) {
+					write(dest, 0, (red * 54 + green * 183 + blue * 19 + 128) >> 8);
+					continue;
+				}
+
+				write(dest, 0, swapRedBlue ? blue : red);
+				write(dest, 1, green);
+				write(dest, 2, swapRedBlue ? red : blue);
+				if constexpr (targetAlpha) { write(dest, 3, SourceChannels == 4 ? read(source, 3) : opaque); }
+			}
+		}
+
+		template <int SourceChannels, int SourceSize>
+		static void ConvertPixels(const uint8_t* source, uint8_t* dest, size_t destStep, TargetFormat targetFormat, size_t count) {
+			switch (targetFormat) {
+			case TargetFormat::R8:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::R8>(source, dest, destStep, count);
+			case TargetFormat::R16:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::R16>(source, dest, destStep, count);
+			case TargetFormat::RGB8:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::RGB8>(source, dest, destStep, count);
+			case TargetFormat::BGR8:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::BGR8>(source, dest, destStep, count);
+			case TargetFormat::RGBA8:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::RGBA8>(source, dest, destStep, count);
+			case TargetFormat::BGRA8:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::BGRA8>(source, dest, destStep, count);
+			case TargetFormat::RGB16:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::RGB16>(source, dest, destStep, count);
+			case TargetFormat::RGBA16:
+				return ConvertPixels<SourceChannels, SourceSize, TargetFormat::RGBA16>(source, dest, destStep, count);
+			}
+		}
+
+		void ConvertPixels(const uint8_t* source, PixelFormat pixelFormat, uint8_t* dest, size_t destStep, TargetFormat targetFormat, size_t count) {
+			// A target laid out the same as the source is a copy
+			size_t bytesPerPixel = GetPixelFormatByteSize(pixelFormat);
+			bool sameLayout = (pixelFormat == RGB8 && targetFormat == TargetFormat::RGB8) || (pixelFormat == RGBA8 && targetFormat == TargetFormat::RGBA8) ||
+				(pixelFormat == RGB16 && targetFormat == TargetFormat::RGB16) || (pixelFormat == RGBA16 && targetFormat == TargetFormat::RGBA16);
+			if (sameLayout && destStep == bytesPerPixel) {
+				std::copy(source, source + count * bytesPerPixel, dest);
+				return;
+			}
+
+			switch (pixelFormat) {
+			case RGB8:
+				return ConvertPixels<3, 1>(source, dest, destStep, targetFormat, count);
+			case RGB16:
+				return ConvertPixels<3, 2>(source, dest, destStep, targetFormat, count);
+			case RGBA8:
+				return ConvertPixels<4, 1>(source, dest, destStep, targetFormat, count);
+			case RGBA16:
+				return ConvertPixels<4, 2>(source, dest, destStep, targetFormat, count);
+			default:
+				throw new std::runtime_error("Error: Invalid pixel format");
+			}
+		}
+
+		Rect UnionRect(const Rect& a, const Rect& b) {
+			if (a.IsEmpty()) { return b; }
+			if (b.IsEmpty()) { return a; }
+
+			uint32_t x = std::min(a.x, b.x);
+			uint32_t y = std::min(a.y, b.y);
+			uint32_t right = std::max(a.x + a.width, b.x + b.width);
+			uint32_t bottom = std::max(a.y + a.height, b.y + b.height);
+
+			return Rect{ .x = x, .y = y, .width = right - x, .height = bottom - y };
+		}
+
+		Orientation Orientation::Then(const Orientation& next) const noexcept {
+			// Mirroring reverses the direction of any turn made before it
+			int turns = (next.flipped ? next.quarterTurns - quarterTurns : next.quarterTurns + quarterTurns);
+			return Orientation{ .quarterTurns = (uint8_t)(((turns % 4) + 4) % 4), .flipped = flipped != next.flipped };
+		}
+
+		Orientation Orientation::Inverse() const noexcept {
+			// Every flipped orientation is a reflection so undoes itself
+			if (flipped) { return *this; }
+			return Orientation{ .quarterTurns = (uint8_t)((4 - quarterTurns) % 4) };
+		}
+
+		Orientation::SourceMapping Orientation::GetSourceMapping() const noexcept {
+			SourceMapping mapping;
+			switch (quarterTurns % 4) {
+			case 1:
+				mapping = SourceMapping{ .swapAxes = true, .reverseY = true };
+				break;
+			case 2:
+				mapping = SourceMapping{ .reverseX = true, .reverseY = true };
+				break;
+			case 3:
+				mapping = SourceMapping{ .swapAxes = true, .reverseX = true };
+				break;
+			}
+
+			// Mirroring first means the column is read from the other side
+			if (flipped) { mapping.reverseX = !mapping.reverseX; }
+			return mapping;
+		}
+
+		Orientation Orientation::FromEXIF(uint16_t value) noexcept {
+			switch (value) {
+			case 2: return Orientation{ .flipped = true };
+			case 3: return Orientation{ .quarterTurns = 2 };
+			case 4: return Orientation{ .quarterTurns = 2, .flipped = true };
+			case 5: return Orientation{ .quarterTurns = 3, .flipped = true };
+			case 6: return Orientation{ .quarterTurns = 1 };
+			case 7: return Orientation{ .quarterTurns = 1, .flipped = true };
+			case 8: return Orientation{ .quarterTurns = 3 };
+			default: return Orientation();
+			}
+		}
+
+		namespace PNG {
+			ChunkIdentifier StringToFormat(std::string string) {
+				// Convert string specifier to know chunk enum
+				// TODO: Decide which ancilliary chunks will be treated as unknown
+				// Built once as every chunk of every file is looked up
+				static const std::unordered_map<std::string, ChunkIdentifier> table{
+					{"IHDR", IHDR}, {"PLTE", PLTE}, {"IDAT", IDAT}, {"IEND", IEND},
+					{"cHRM", cHRM}, {"cICP", cICP}, {"gAMA", gAMA}, {"iCCP", iCCP}, {"sRGB", sRGB},
+					{"acTL", acTL}, {"fcTL", fcTL}, {"fdAT", fdAT}
+				};
+				auto it = table.find(string);
+				ChunkIdentifier chunkSpecifier = INVALID;
+
+				if (it != table.end()) {
+					chunkSpecifier = it->second;
+				}
+				// If chunk is ancilliary or private it does not matter that it can't be identified
+				else if (!isupper(string[0]) || !isupper(string[1])) {
+					chunkSpecifier = UNKOWN;
+				}
+
+				return chunkSpecifier;
+			}
+		}
+	}
+}
\ No newline at end of file
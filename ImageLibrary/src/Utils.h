@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <concepts>
+#include <type_traits>
+#include <unordered_map>
+#include <array>
+#include <vector>
+#include <optional>
+#include <stdexcept>
+
+namespace ImageLibrary {
+	namespace Utils {
+		// The max PNG size would be far too large for this application to handle so create an arbitrary limit
+		inline constexpr uint32_t PNG_SPEC_MAX_DIMENSION = 2147483647;
+		inline constexpr uint32_t PNG_APP_MAX_DIMENSION = 16384;
+
+		// Signatures of different image formats
+		enum FormatSignatures {
+			PNG_SIGNATURE = 0xC7
+		};
+
+		// Formats images can be decoded from, told apart by a file's extension
+		enum class FileFormat {
+			PNG,
+			JPEG,
+			UNKNOWN
+		};
+
+		FileFormat GetFileFormat(const std::string& filePath);
+
+		// Pixel format types
+		enum PixelFormat {
+			RGB8,
+			RGB16,
+			RGBA8,
+			RGBA16,
+			INVALID
+		};
+
+		int GetPixelFormatByteSize(PixelFormat pixelFormat);
+		int GetChannelByteSize(PixelFormat pixelFormat);
+		bool HasAlphaChannel(PixelFormat pixelFormat);
+		PixelFormat GetAlphaPixelFormat(PixelFormat pixelFormat);
+
+		// GPU block compressed formats, each block covers 4x4 pixels
+		enum BlockFormat {
+			BC1,
+			BC4,
+			BC7,
+			INVALID_BLOCK_FORMAT
+		};
+
+		int GetBlockByteSize(BlockFormat blockFormat);
+
+		// Size of a whole image in blocks, partial blocks at the right and bottom edges are padded to a full block
+		size_t GetBlockBufferSize(BlockFormat blockFormat, uint32_t width, uint32_t height);
+
+		// Layouts pixels can be converted to for a buffer owned by someone else, channels in the order named and 16 bit channels little endian
+		// R8 and R16 hold the Rec. 709 luma of colour pixels, alpha is dropped or made opaque when only one side has it
+		enum class TargetFormat {
+			R8,
+			R16,
+			RGB8,
+			BGR8,
+			RGBA8,
+			BGRA8,
+			RGB16,
+			RGBA16
+		};
+
+		int GetTargetFormatByteSize(TargetFormat targetFormat);
+
+		// Convert a row of tightly packed pixels to a target format, each pixel written destStep bytes after the last
+		void ConvertPixels(const uint8_t* source, PixelFormat pixelFormat, uint8_t* dest, size_t destStep, TargetFormat targetFormat, size_t count);
+
+		// Rectangular region of an image in pixels
+		struct Rect {
+			uint32_t x = 0, y = 0, width = 0, height = 0;
+
+			bool IsEmpty() const noexcept { return width == 0 || height == 0; }
+		};
+
+		Rect UnionRect(const Rect& a, const Rect& b);
+
+		// One of the eight ways to show an image by mirroring and turning it, the same eight EXIF orientations describe
+		// The image is mirrored left to right first if flipped, then turned clockwise by the quarter turns
+		struct Orientation {
+			uint8_t quarterTurns = 0;
+			bool flipped = false;
+
+			// Where a pixel of the oriented image is found in the original, the axes are swapped first then either is reversed
+			struct SourceMapping {
+				bool swapAxes = false;
+				bool reverseX = false;
+				bool reverseY = false;
+			};
+
+			// This orientation followed by another
+			Orientation Then(const Orientation& next) const noexcept;
+			Orientation Rotated(int clockwiseQuarterTurns) const noexcept { return Then(Orientation{ .quarterTurns = (uint8_t)(((clockwiseQuarterTurns % 4) + 4) % 4) }); }
+			Orientation FlippedHorizontally() const noexcept { return Then(Orientation{ .flipped = true }); }
+			Orientation FlippedVertically() const noexcept { return Then(Orientation{ .quarterTurns = 2, .flipped = true }); }
+			Orientation Inverse() const noexcept;
+
+			SourceMapping GetSourceMapping() const noexcept;
+			bool SwapsDimensions() const noexcept { return quarterTurns % 2 == 1; }
+			bool IsIdentity() const noexcept { return quarterTurns == 0 && !flipped; }
+
+			// Value of an EXIF orientation tag from 1 to 8, anything else is taken as 1
+			static Orientation FromEXIF(uint16_t value) noexcept;
+
+			bool operator==(const Orientation&) const = default;
+		};
+
+		// Pixel struct large enough to hold any pixel value
+		struct Pixel { uint16_t R = 0, G = 0, B = 0, A = 0; };
+
+		template <typename T>
+		concept IntegerType = std::is_integral<T>::value && !std::same_as<T, bool>;
+
+		template <IntegerType T>
+		void ExtractBigEndianBytes(T& dest, const uint8_t* src, int number) {
+			if (sizeof(dest) < number) { throw new std::invalid_argument("Error: Destination cannot hold number of bytes"); }
+			dest = 0;
+			for (int i = 0; i < number; i++) {
+				dest |= ((T)src[i] << (8 * (number - 1 - i)));
+			}
+		}
+
+		template <typename T>
+		concept EvenSizeIntegerType = IntegerType<T> && (sizeof(T) % 2 == 0);
+
+		template <EvenSizeIntegerType T>
+		void FlipEndian(T& dest, T& src) {
+			T temp = src;
+			dest = 0;
+			for (int i = 0; i < sizeof(T) / 2; i++) {
+				int shiftAmount = sizeof(T) * 8 - (i + 1) * 8;
+				dest |= (temp << shiftAmount & 0xff << shiftAmount) | (temp >> shiftAmount & (0xff << (sizeof(T) - 1) * 8) >> shiftAmount);
+			}
+		}
+
+		namespace PNG {
+			// TODO: Decide which ancilliary chunks will be treated as unknown
+			enum ChunkIdentifier {
+				IHDR = 100,
+				PLTE = 101,
+				IDAT = 102,
+				IEND = 103,
+				cHRM = 200,
+				cICP = 201,
+				gAMA = 202,
+				iCCP = 203,
+				mDCv = 204,
+				cLLi = 205,
+				sBIT = 206,
+				sRGB = 207,
+				bKGD = 208,
+				hIST = 209,
+				tRNS = 210,
+				eXIf = 211,
+				pHYs = 212,
+				sPLT = 213,
+				tIME = 214,
+				iTXt = 215,
+				tEXt = 216,
+				zTXt = 217,
+				acTL = 218,
+				fcTL = 219,
+				fdAT = 220,
+				UNKOWN = 0,
+				INVALID = -1
+			};
+
+			struct Chunk {
+				ChunkIdentifier identifier;
+				int position;
+			};
+
+			// APNG frame disposal and blending operations
+			enum DisposeOp {
+				DISPOSE_OP_NONE = 0,
+				DISPOSE_OP_BACKGROUND = 1,
+				DISPOSE_OP_PREVIOUS = 2
+			};
+
+			enum BlendOp {
+				BLEND_OP_SOURCE = 0,
+				BLEND_OP_OVER = 1
+			};
+
+			// Contents of an APNG fcTL chunk
+			struct FrameControl {
+				uint32_t sequenceNumber;
+				uint32_t width;
+				uint32_t height;
+				uint32_t xOffset;
+				uint32_t yOffset;
+				uint16_t delayNumerator;
+				uint16_t delayDenominator;
+				DisposeOp disposeOp;
+				BlendOp blendOp;
+			};
+
+			// Contents of a tEXt, zTXt or iTXt chunk converted to UTF-8, the language and translated keyword are only in iTXt
+			struct TextEntry {
+				std::string keyword;
+				std::string text;
+				std::string languageTag;
+				std::string translatedKeyword;
+			};
+
+			// Contents of a tIME chunk, the last modification time in UTC
+			struct Time {
+				uint16_t year;
+				uint8_t month;
+				uint8_t day;
+				uint8_t hour;
+				uint8_t minute;
+				uint8_t second;
+			};
+
+			// Contents of a pHYs chunk, a unit of 1 is the metre otherwise only the pixel aspect ratio is known
+			struct PhysicalDimensions {
+				uint32_t pixelsPerUnitX;
+				uint32_t pixelsPerUnitY;
+				uint8_t unit;
+			};
+
+			// Colour chunks as they were found, gamma and chromaticities are scaled by 100000 as stored
+			struct ColourChunks {
+				std::optional<std::array<uint8_t, 4>> cicp;
+				std::vector<uint8_t> iccProfile;
+				bool sRGB = false;
+				std::optional<uint32_t> gamma;
+				std::optional<std::array<uint32_t, 8>> chromaticities;
+			};
+
+			// Time in seconds spent in each stage of the last decode
+			struct StageTimings {
+				double parseChunks = 0.0;
+				double checkCRC = 0.0;
+				double decompressData = 0.0;
+				double unfilterData = 0.0;
+				double unpackData = 0.0;
+				double deinterlaceData = 0.0;
+				double parsePixels = 0.0;
+			};
+
+			ChunkIdentifier StringToFormat(std::string string);
+		}
+	}
+}
\ No newline at end of file
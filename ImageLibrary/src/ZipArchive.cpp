@@ -0,0 +1,140 @@
+#include <algorithm>
+
+#include "../vendor/zlib/zlib.h"
+
+#include "ZipArchive.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	// Signatures and fixed sizes of the ZIP records used, every field is little endian
+	static constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+	static constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014B50;
+	static constexpr uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054B50;
+	static constexpr size_t LOCAL_HEADER_SIZE = 30;
+	static constexpr size_t CENTRAL_HEADER_SIZE = 46;
+	static constexpr size_t END_OF_DIRECTORY_SIZE = 22;
+	static constexpr size_t MAX_COMMENT_SIZE = 65535;
+
+	// Deflate cannot expand data by more than this, so a larger uncompressed size is not trusted with an allocation
+	static constexpr uint64_t MAX_DEFLATE_RATIO = 1032;
+
+	static uint16_t Read16(const uint8_t* data) { return (uint16_t)(data[0] | (data[1] << 8)); }
+	static uint32_t Read32(const uint8_t* data) { return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24); }
+
+	ZipArchive::ZipArchive(std::filesystem::path path) : m_path(path) {
+		IL_TRACE_SCOPE("ZipArchive::ZipArchive");
+
+		// A file too small for the end of central directory record cannot be an archive, and an empty one cannot be mapped
+		std::error_code error;
+		uintmax_t size = std::filesystem::file_size(m_path, error);
+		if (error) { throw new std::runtime_error("Error: File could not be opened"); }
+		if (size < END_OF_DIRECTORY_SIZE) { throw new std::runtime_error("Error: File is not a ZIP archive"); }
+
+		m_file = std::make_unique<MappedFile>(m_path);
+		ReadCentralDirectory();
+	}
+
+	void ZipArchive::ReadCentralDirectory() {
+		const uint8_t* data = m_file->GetData();
+		size_t size = m_file->GetSize();
+
+		// The end of central directory record is last in the file, followed only by a comment of up to 65535 bytes
+		size_t searchStart = (size > END_OF_DIRECTORY_SIZE + MAX_COMMENT_SIZE ? size - END_OF_DIRECTORY_SIZE - MAX_COMMENT_SIZE : 0);
+		std::optional<size_t> endOffset;
+		for (size_t offset = size - END_OF_DIRECTORY_SIZE + 1; offset-- > searchStart;) {
+			if (Read32(data + offset) == END_OF_DIRECTORY_SIGNATURE) {
+				endOffset = offset;
+				break;
+			}
+		}
+		if (!endOffset) { throw new std::runtime_error("Error: File is not a ZIP archive"); }
+
+		const uint8_t* record = data + *endOffset;
+		uint16_t memberCount = Read16(record + 10);
+		uint32_t directorySize = Read32(record + 12);
+		uint32_t directoryOffset = Read32(record + 16);
+		if (memberCount == UINT16_MAX || directorySize == UINT32_MAX || directoryOffset == UINT32_MAX) { throw new std::runtime_error("Error: ZIP64 archives are not supported"); }
+		if ((uint64_t)directoryOffset + directorySize > *endOffset) { throw new std::runtime_error("Error: ZIP central directory is outside the archive"); }
+
+		// Only the central directory is read here, each member's local header is read when the member is
+		m_members.reserve(memberCount);
+		m_names.reserve(memberCount);
+		const uint8_t* entry = data + directoryOffset;
+		const uint8_t* directoryEnd = entry + directorySize;
+		for (uint16_t i = 0; i < memberCount; i++) {
+			if ((size_t)(directoryEnd - entry) < CENTRAL_HEADER_SIZE || Read32(entry) != CENTRAL_HEADER_SIGNATURE) { throw new std::runtime_error("Error: ZIP central directory is invalid"); }
+
+			uint16_t nameLength = Read16(entry + 28);
+			size_t entrySize = CENTRAL_HEADER_SIZE + nameLength + Read16(entry + 30) + Read16(entry + 32);
+			if ((size_t)(directoryEnd - entry) < entrySize) { throw new std::runtime_error("Error: ZIP central directory is invalid"); }
+
+			Member member{
+				.name = std::string(reinterpret_cast<const char*>(entry + CENTRAL_HEADER_SIZE), nameLength),
+				.localHeaderOffset = Read32(entry + 42),
+				.compressedSize = Read32(entry + 20),
+				.uncompressedSize = Read32(entry + 24),
+				.crc = Read32(entry + 16),
+				.method = Read16(entry + 10),
+				.flags = Read16(entry + 8)
+			};
+			if (member.compressedSize == UINT32_MAX || member.uncompressedSize == UINT32_MAX || member.localHeaderOffset == UINT32_MAX) { throw new std::runtime_error("Error: ZIP64 archives are not supported"); }
+
+			// A later member with the same name replaces an earlier one, as when a file is added to an archive again
+			m_names[member.name] = m_members.size();
+			m_members.push_back(std::move(member));
+			entry += entrySize;
+		}
+	}
+
+	std::optional<size_t> ZipArchive::Find(const std::string& name) const {
+		auto it = m_names.find(name);
+		if (it == m_names.end()) { return std::nullopt; }
+		return it->second;
+	}
+
+	std::expected<std::span<const uint8_t>, DecodeError> ZipArchive::ReadMember(size_t index, Memory::Buffer& buffer) const {
+		IL_TRACE_SCOPE("ZipArchive::ReadMember");
+
+		// Errors are reported at the member's local header
+		const Member& member = m_members.at(index);
+		auto fail = [&member](DecodeErrorKind kind, const char* message) { return std::unexpected(DecodeError{ .kind = kind, .message = message, .offset = member.localHeaderOffset }); };
+
+		if (member.flags & 1) { return fail(DecodeErrorKind::UNSUPPORTED, "Error: Encrypted ZIP members are not supported"); }
+		if (member.method != METHOD_STORED && member.method != METHOD_DEFLATED) { return fail(DecodeErrorKind::UNSUPPORTED, "Error: ZIP member compression method is not supported"); }
+
+		// The local header repeats the name and can have a different extra field to the central directory
+		const uint8_t* data = m_file->GetData();
+		size_t size = m_file->GetSize();
+		if (member.localHeaderOffset + LOCAL_HEADER_SIZE > size || Read32(data + member.localHeaderOffset) != LOCAL_HEADER_SIGNATURE) {
+			return fail(DecodeErrorKind::FILE_UNREADABLE, "Error: ZIP local header is invalid");
+		}
+		uint64_t dataOffset = member.localHeaderOffset + LOCAL_HEADER_SIZE + Read16(data + member.localHeaderOffset + 26) + Read16(data + member.localHeaderOffset + 28);
+		if (dataOffset + member.compressedSize > size) { return fail(DecodeErrorKind::TRUNCATED, "Error: ZIP member is truncated"); }
+		std::span<const uint8_t> compressed(data + dataOffset, member.compressedSize);
+
+		// Stored members are usually PNGs with their own CRCs so are not read an extra time to check the member's
+		if (member.method == METHOD_STORED) {
+			if (member.compressedSize != member.uncompressedSize) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: ZIP member sizes do not match"); }
+			return compressed;
+		}
+
+		if (member.uncompressedSize / MAX_DEFLATE_RATIO > member.compressedSize) { return fail(DecodeErrorKind::INVALID_CHUNK, "Error: ZIP member sizes do not match"); }
+		buffer.resize(member.uncompressedSize);
+		if (buffer.empty()) { return std::span<const uint8_t>(); }
+
+		// The whole member is inflated in one call as both sizes are known
+		z_stream stream{};
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: Decompression of data failed"); }
+		stream.next_in = const_cast<Bytef*>(compressed.data());
+		stream.avail_in = (uInt)compressed.size();
+		stream.next_out = buffer.data();
+		stream.avail_out = (uInt)buffer.size();
+		int err = inflate(&stream, Z_FINISH);
+		bool complete = (err == Z_STREAM_END && stream.avail_out == 0);
+		inflateEnd(&stream);
+
+		if (!complete) { return fail(DecodeErrorKind::INVALID_IMAGE_DATA, "Error: ZIP member could not be inflated"); }
+		if (crc32(0, buffer.data(), (uInt)buffer.size()) != member.crc) { return fail(DecodeErrorKind::CRC_MISMATCH, "Error: ZIP member CRC mismatch"); }
+		return std::span<const uint8_t>(buffer);
+	}
+}
\ No newline at end of file
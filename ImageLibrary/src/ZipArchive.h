@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <optional>
+#include <expected>
+#include <filesystem>
+#include <unordered_map>
+
+#include "DecodeError.h"
+#include "DiskCache.h"
+#include "Memory.h"
+
+namespace ImageLibrary {
+	// ZIP archive such as a CBZ of scanned pages, mapped rather than read with its central directory indexed once when opened
+	// Stored members are read in place from the mapping and deflated members are inflated in memory, nothing is extracted to disk
+	// Encrypted members and ZIP64 archives over 4 GB or 65535 members are not supported
+	class ZipArchive
+	{
+	public:
+		// Member as listed in the central directory, its data follows a local header at the offset given
+		struct Member {
+			std::string name;
+			uint64_t localHeaderOffset;
+			uint64_t compressedSize;
+			uint64_t uncompressedSize;
+			uint32_t crc;
+			uint16_t method;
+			uint16_t flags;
+		};
+
+		static constexpr uint16_t METHOD_STORED = 0;
+		static constexpr uint16_t METHOD_DEFLATED = 8;
+
+		ZipArchive(std::filesystem::path path) noexcept(false);
+
+		ZipArchive(const ZipArchive&) = delete;
+		ZipArchive& operator=(const ZipArchive&) = delete;
+
+		const std::filesystem::path& GetPath() const noexcept { return m_path; }
+
+		// Members in the order of the central directory, directories included
+		const std::vector<Member>& GetMembers() const noexcept { return m_members; }
+
+		// Index of the member with exactly this name
+		std::optional<size_t> Find(const std::string& name) const;
+
+		// Bytes of a member, stored members point into the mapping while deflated members are inflated into the buffer and checked against their CRC
+		// Safe to call from any thread, the span is valid as long as both the archive and the buffer are
+		std::expected<std::span<const uint8_t>, DecodeError> ReadMember(size_t index, Memory::Buffer& buffer) const;
+
+	private:
+		void ReadCentralDirectory();
+
+	private:
+		std::filesystem::path m_path;
+		std::unique_ptr<MappedFile> m_file;
+		std::vector<Member> m_members;
+		std::unordered_map<std::string, size_t> m_names;
+	};
+}
\ No newline at end of file
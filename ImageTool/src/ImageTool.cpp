@@ -0,0 +1,834 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <expected>
+#include <optional>
+#include <cmath>
+
+#include "PNG.h"
+#include "JPEG.h"
+#include "PNGEncoder.h"
+#include "BlockEncoder.h"
+#include "PixelTransform.h"
+#include "Resampler.h"
+#include "ZipArchive.h"
+#include "DuplicateFinder.h"
+#include "ImageCompare.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+// Format written for each decoded file
+enum class OutputFormat {
+	NONE,
+	RAW,
+	PNG
+};
+
+struct Options {
+	std::vector<fs::path> inputs;
+	fs::path outputDirectory;
+	fs::path tracePath;
+	OutputFormat outputFormat = OutputFormat::NONE;
+	int compressionLevel = 6;
+	unsigned int threadCount = 0;
+	bool json = false;
+	bool lowMemory = false;
+	bool colourManagement = true;
+	bool probe = false;
+	bool statistics = false;
+
+	// Applied to the decoded pixels before they are written or encoded to blocks
+	ImageLibrary::Utils::Orientation orientation;
+	std::optional<ImageLibrary::Utils::Rect> crop;
+	uint32_t resizeWidth = 0;
+	uint32_t resizeHeight = 0;
+	ImageLibrary::ResampleFilter filter = ImageLibrary::ResampleFilter::LANCZOS3;
+
+	// Encode each decoded image to GPU blocks, an empty format picks one from the pixels
+	bool blocks = false;
+	std::optional<ImageLibrary::Utils::BlockFormat> blockFormat;
+	ImageLibrary::BlockQuality blockQuality = ImageLibrary::BlockQuality::NORMAL;
+
+	// Report groups of duplicate and similar images instead of decoding each file, hashes are kept in the index if one is given
+	bool duplicates = false;
+	int maxDistance = 6;
+	fs::path hashIndexPath;
+
+	// Compare two images pixel by pixel instead of decoding each file, counting pixels with a channel differing by more than the threshold
+	bool compare = false;
+	uint32_t threshold = 0;
+};
+
+// File to decode along with where its output goes relative to the output directory
+// Members of an archive are named by the archive's path followed by the member's name
+struct Job {
+	fs::path path;
+	fs::path relativePath;
+	std::shared_ptr<const ImageLibrary::ZipArchive> archive;
+	size_t memberIndex = 0;
+};
+
+struct Result {
+	uintmax_t fileSize = 0;
+	uint32_t width = 0, height = 0;
+	ImageLibrary::Utils::PixelFormat pixelFormat = ImageLibrary::Utils::INVALID;
+	uint32_t frameCount = 0;
+	double decodeSeconds = 0.0;
+	double writeSeconds = 0.0;
+	double transformSeconds = 0.0;
+	double resizeSeconds = 0.0;
+	int64_t peakBytes = 0;
+	size_t textCount = 0;
+	ImageLibrary::Utils::BlockFormat blockFormat = ImageLibrary::Utils::INVALID_BLOCK_FORMAT;
+	double encodeSeconds = 0.0;
+	double psnr = 0.0;
+	std::optional<ImageLibrary::ImageStatistics> statistics;
+	std::string error;
+};
+
+static void PrintUsage() {
+	printf(
+		"Usage: ImageTool [options] <file, directory or archive>...\n"
+		"       ImageTool --compare [--threshold <value>] [--json] <original> <changed>\n"
+		"Decodes every PNG and JPEG given, searching directories recursively and ZIP or CBZ archives, and reports timing and failures\n"
+		"\n"
+		"Options:\n"
+		"  --output <directory>  Write each decoded image to the directory keeping the input layout\n"
+		"  --format raw|png      Output as the raw pixel buffer or re-encoded as PNG (default raw)\n"
+		"  --level <0-9>         Compression level for PNG output (default 6)\n"
+		"  --threads <count>     Number of files decoded at once, 0 uses every core (default 0)\n"
+		"  --json                Print results as JSON\n"
+		"  --low-memory          Decode straight into the pixel buffer to keep peak memory down\n"
+		"  --no-colour-management  Output the stored values instead of converting them to sRGB\n"
+		"  --probe               Only read the header and metadata of each file without decoding it\n"
+		"  --rotate 90|180|270   Turn the image clockwise before writing or encoding it, after any --flip given before it\n"
+		"  --flip h|v            Mirror the image horizontally or vertically, after any --rotate given before it\n"
+		"  --crop <x,y,w,h>      Keep only a region of the image, taken before turning or mirroring it\n"
+		"  --resize <w>x<h>      Resample the image to a new size after any crop, turn or mirror\n"
+		"  --filter box|mitchell|lanczos3  Filter used by --resize (default lanczos3)\n"
+		"  --stats               Collect per channel minimum, maximum and mean while decoding\n"
+		"  --blocks auto|bc1|bc4|bc7  Encode each image to GPU blocks and report the time taken and PSNR\n"
+		"  --block-quality fast|normal|high  Quality of the block encode (default normal)\n"
+		"  --duplicates          List groups of identical and similar images instead of decoding each file\n"
+		"  --distance <bits>     Most perceptual hash bits similar images can differ by, up to 31 (default 6)\n"
+		"  --hash-index <file>   Keep image hashes in the file so unchanged images are not decoded again\n"
+		"  --compare             Report the largest difference, PSNR and changed region between two images of the same size\n"
+		"  --threshold <value>   Channel difference --compare allows before counting a pixel as changed (default 0)\n"
+		"  --trace <file>        Write the most recent decode stages of every thread as a Chrome trace\n"
+		"  --help                Show this message\n"
+		"\n"
+		"Exits with 1 if any file failed or --compare found changed pixels, and 2 if the arguments are invalid\n");
+}
+
+static const char* PixelFormatName(ImageLibrary::Utils::PixelFormat pixelFormat) {
+	switch (pixelFormat) {
+	case ImageLibrary::Utils::RGB8: return "RGB8";
+	case ImageLibrary::Utils::RGB16: return "RGB16";
+	case ImageLibrary::Utils::RGBA8: return "RGBA8";
+	case ImageLibrary::Utils::RGBA16: return "RGBA16";
+	default: return "INVALID";
+	}
+}
+
+static const char* BlockFormatName(ImageLibrary::Utils::BlockFormat blockFormat) {
+	switch (blockFormat) {
+	case ImageLibrary::Utils::BC1: return "BC1";
+	case ImageLibrary::Utils::BC4: return "BC4";
+	case ImageLibrary::Utils::BC7: return "BC7";
+	default: return "INVALID";
+	}
+}
+
+static bool ParseArguments(int argc, char** argv, Options& options) {
+	bool formatGiven = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+
+		// Options that take a value
+		if (argument == "--output" || argument == "--format" || argument == "--level" || argument == "--threads" || argument == "--trace" || argument == "--blocks" || argument == "--block-quality"
+			|| argument == "--rotate" || argument == "--flip" || argument == "--crop"
+			|| argument == "--resize" || argument == "--filter" || argument == "--distance" || argument == "--hash-index" || argument == "--threshold") {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Error: %s requires a value\n", argument.c_str());
+				return false;
+			}
+			std::string value = argv[++i];
+
+			if (argument == "--output") { options.outputDirectory = value; }
+			else if (argument == "--trace") { options.tracePath = value; }
+			else if (argument == "--hash-index") { options.hashIndexPath = value; }
+			else if (argument == "--blocks") {
+				if (value == "bc1") { options.blockFormat = ImageLibrary::Utils::BC1; }
+				else if (value == "bc4") { options.blockFormat = ImageLibrary::Utils::BC4; }
+				else if (value == "bc7") { options.blockFormat = ImageLibrary::Utils::BC7; }
+				else if (value != "auto") {
+					fprintf(stderr, "Error: Unknown block format %s\n", value.c_str());
+					return false;
+				}
+				options.blocks = true;
+			}
+			else if (argument == "--rotate") {
+				if (value != "90" && value != "180" && value != "270") {
+					fprintf(stderr, "Error: Rotation must be 90, 180 or 270\n");
+					return false;
+				}
+				options.orientation = options.orientation.Rotated(std::stoi(value) / 90);
+			}
+			else if (argument == "--flip") {
+				if (value == "h") { options.orientation = options.orientation.FlippedHorizontally(); }
+				else if (value == "v") { options.orientation = options.orientation.FlippedVertically(); }
+				else {
+					fprintf(stderr, "Error: Flip must be h or v\n");
+					return false;
+				}
+			}
+			else if (argument == "--crop") {
+				ImageLibrary::Utils::Rect crop;
+				char extra;
+				if (sscanf(value.c_str(), "%u,%u,%u,%u%c", &crop.x, &crop.y, &crop.width, &crop.height, &extra) != 4 || crop.IsEmpty()) {
+					fprintf(stderr, "Error: Crop must be x,y,width,height\n");
+					return false;
+				}
+				options.crop = crop;
+			}
+			else if (argument == "--resize") {
+				char extra;
+				if (sscanf(value.c_str(), "%ux%u%c", &options.resizeWidth, &options.resizeHeight, &extra) != 2 || options.resizeWidth == 0 || options.resizeHeight == 0) {
+					fprintf(stderr, "Error: Size must be <width>x<height>\n");
+					return false;
+				}
+			}
+			else if (argument == "--filter") {
+				if (value == "box") { options.filter = ImageLibrary::ResampleFilter::BOX; }
+				else if (value == "mitchell") { options.filter = ImageLibrary::ResampleFilter::MITCHELL; }
+				else if (value == "lanczos3") { options.filter = ImageLibrary::ResampleFilter::LANCZOS3; }
+				else {
+					fprintf(stderr, "Error: Filter must be box, mitchell or lanczos3\n");
+					return false;
+				}
+			}
+			else if (argument == "--block-quality") {
+				if (value == "fast") { options.blockQuality = ImageLibrary::BlockQuality::FAST; }
+				else if (value == "normal") { options.blockQuality = ImageLibrary::BlockQuality::NORMAL; }
+				else if (value == "high") { options.blockQuality = ImageLibrary::BlockQuality::HIGH; }
+				else {
+					fprintf(stderr, "Error: Unknown block quality %s\n", value.c_str());
+					return false;
+				}
+			}
+			else if (argument == "--format") {
+				if (value == "raw") { options.outputFormat = OutputFormat::RAW; }
+				else if (value == "png") { options.outputFormat = OutputFormat::PNG; }
+				else {
+					fprintf(stderr, "Error: Unknown output format %s\n", value.c_str());
+					return false;
+				}
+				formatGiven = true;
+			}
+			else {
+				char* end = nullptr;
+				long number = strtol(value.c_str(), &end, 10);
+				if (*end != '\0' || number < 0 || (argument == "--level" && number > 9) || (argument == "--distance" && number > 31) || (argument == "--threshold" && number > 65535)) {
+					fprintf(stderr, "Error: Invalid value for %s\n", argument.c_str());
+					return false;
+				}
+				if (argument == "--level") { options.compressionLevel = (int)number; }
+				else if (argument == "--distance") { options.maxDistance = (int)number; }
+				else if (argument == "--threshold") { options.threshold = (uint32_t)number; }
+				else { options.threadCount = (unsigned int)number; }
+			}
+		}
+		else if (argument == "--json") { options.json = true; }
+		else if (argument == "--low-memory") { options.lowMemory = true; }
+		else if (argument == "--no-colour-management") { options.colourManagement = false; }
+		else if (argument == "--probe") { options.probe = true; }
+		else if (argument == "--stats") { options.statistics = true; }
+		else if (argument == "--duplicates") { options.duplicates = true; }
+		else if (argument == "--compare") { options.compare = true; }
+		else if (argument == "--help") {
+			PrintUsage();
+			exit(0);
+		}
+		else if (argument.starts_with("--")) {
+			fprintf(stderr, "Error: Unknown option %s\n", argument.c_str());
+			return false;
+		}
+		else { options.inputs.push_back(argument); }
+	}
+
+	if (options.inputs.empty()) {
+		fprintf(stderr, "Error: No input files\n");
+		return false;
+	}
+
+	// Output is written raw unless asked otherwise, and a format without a directory has nowhere to go
+	if (!options.outputDirectory.empty() && options.outputFormat == OutputFormat::NONE) { options.outputFormat = OutputFormat::RAW; }
+	if (options.outputDirectory.empty() && formatGiven) {
+		fprintf(stderr, "Error: --format requires --output\n");
+		return false;
+	}
+
+	// Probing leaves nothing to write
+	if (options.probe && options.outputFormat != OutputFormat::NONE) {
+		fprintf(stderr, "Error: --probe cannot be used with --output\n");
+		return false;
+	}
+	if (options.probe && (options.blocks || options.statistics)) {
+		fprintf(stderr, "Error: --probe cannot be used with --blocks or --stats\n");
+		return false;
+	}
+
+	// Finding duplicates only hashes each file
+	bool transformed = options.crop || !options.orientation.IsIdentity() || options.resizeWidth != 0;
+	if (options.duplicates && (options.probe || options.outputFormat != OutputFormat::NONE || options.blocks || options.statistics || transformed)) {
+		fprintf(stderr, "Error: --duplicates cannot be used with --probe, --output, --blocks, --stats or transforms\n");
+		return false;
+	}
+	if (!options.duplicates && !options.hashIndexPath.empty()) {
+		fprintf(stderr, "Error: --hash-index requires --duplicates\n");
+		return false;
+	}
+
+	// Comparing takes exactly two files and writes nothing
+	if (options.compare && (options.inputs.size() != 2 || options.duplicates || options.probe || options.outputFormat != OutputFormat::NONE || options.blocks || transformed)) {
+		fprintf(stderr, "Error: --compare takes two files and cannot be used with --duplicates, --probe, --output, --blocks or transforms\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Lowercase extension of a path including the dot
+static std::string GetExtension(const fs::path& path) {
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+	return extension;
+}
+
+// Every PNG and JPEG in an archive in name order, decoded from the archive without extracting it
+static bool CollectArchiveJobs(const fs::path& input, std::vector<Job>& jobs) {
+	std::shared_ptr<const ImageLibrary::ZipArchive> archive;
+	try { archive = std::make_shared<const ImageLibrary::ZipArchive>(input); }
+	catch (std::runtime_error* e) {
+		fprintf(stderr, "Warning: Could not open %s: %s\n", input.string().c_str(), e->what());
+		delete e;
+		return false;
+	}
+
+	std::vector<Job> found;
+	const std::vector<ImageLibrary::ZipArchive::Member>& members = archive->GetMembers();
+	for (size_t i = 0; i < members.size(); i++) {
+		if (ImageLibrary::Utils::GetFileFormat(members[i].name) == ImageLibrary::Utils::FileFormat::UNKNOWN) { continue; }
+		fs::path memberPath = fs::path(members[i].name).relative_path();
+		found.push_back(Job{ .path = input / memberPath, .relativePath = input.stem() / memberPath, .archive = archive, .memberIndex = i });
+	}
+
+	std::sort(found.begin(), found.end(), [](const Job& a, const Job& b) { return a.path < b.path; });
+	jobs.insert(jobs.end(), found.begin(), found.end());
+	return true;
+}
+
+static std::vector<Job> CollectJobs(const std::vector<fs::path>& inputs) {
+	std::vector<Job> jobs;
+
+	for (const fs::path& input : inputs) {
+		std::error_code error;
+		std::string inputExtension = GetExtension(input);
+		if ((inputExtension == ".zip" || inputExtension == ".cbz") && fs::is_regular_file(input, error) && CollectArchiveJobs(input, jobs)) { continue; }
+
+		if (!fs::is_directory(input, error)) {
+			// Files are always attempted so a missing or unreadable file is reported as a failure
+			jobs.push_back(Job{ .path = input, .relativePath = input.filename() });
+			continue;
+		}
+
+		// Search directories for PNG and JPEG files in a stable order
+		std::vector<Job> found;
+		for (fs::recursive_directory_iterator it(input, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error)) {
+			if (error) { break; }
+			if (!it->is_regular_file(error)) { continue; }
+
+			if (ImageLibrary::Utils::GetFileFormat(it->path().string()) == ImageLibrary::Utils::FileFormat::UNKNOWN) { continue; }
+
+			found.push_back(Job{ .path = it->path(), .relativePath = fs::relative(it->path(), input, error) });
+		}
+		if (error) { fprintf(stderr, "Warning: Could not search all of %s: %s\n", input.string().c_str(), error.message().c_str()); }
+
+		std::sort(found.begin(), found.end(), [](const Job& a, const Job& b) { return a.path < b.path; });
+		jobs.insert(jobs.end(), found.begin(), found.end());
+	}
+
+	return jobs;
+}
+
+static void WriteOutput(const Options& options, const Job& job, uint32_t width, uint32_t height, ImageLibrary::Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) {
+	fs::path outputPath = options.outputDirectory / job.relativePath;
+	outputPath.replace_extension(options.outputFormat == OutputFormat::PNG ? ".png" : ".raw");
+	fs::create_directories(outputPath.parent_path());
+
+	if (options.outputFormat == OutputFormat::PNG) {
+		// Files are already decoded in parallel so each is encoded on a single thread
+		ImageLibrary::PNGEncoderOptions encoderOptions;
+		encoderOptions.compressionLevel = options.compressionLevel;
+		encoderOptions.threadCount = 1;
+		ImageLibrary::PNGEncoder encoder(width, height, pixelFormat, pixels, encoderOptions);
+		encoder.WriteFile(outputPath.string());
+		return;
+	}
+
+	std::ofstream file(outputPath, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+	if (!file) { throw new std::runtime_error("Error: Could not write " + outputPath.string()); }
+}
+
+// Peak signal to noise ratio of decoded blocks against the pixels they were encoded from, alpha only counts if the image has it
+static double BlockPSNR(ImageLibrary::Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels, std::span<const uint8_t> decoded) {
+	int channelBytes = ImageLibrary::Utils::GetChannelByteSize(pixelFormat);
+	int channels = ImageLibrary::Utils::GetPixelFormatByteSize(pixelFormat) / channelBytes;
+	uint64_t pixelCount = pixels.size() / ImageLibrary::Utils::GetPixelFormatByteSize(pixelFormat);
+
+	double squaredError = 0.0;
+	for (uint64_t i = 0; i < pixelCount; i++) {
+		for (int c = 0; c < channels; c++) {
+			int value = (channelBytes == 2 ? (int)((reinterpret_cast<const uint16_t*>(pixels.data())[i * channels + c] * 255u + 32895u) >> 16) : pixels[i * channels + c]);
+			int difference = value - decoded[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)pixelCount * channels);
+	return (meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY);
+}
+
+static Result ProcessFile(const Options& options, const Job& job) {
+	using Clock = std::chrono::steady_clock;
+	Result result;
+
+	std::error_code sizeError;
+	result.fileSize = (job.archive ? job.archive->GetMembers()[job.memberIndex].uncompressedSize : fs::file_size(job.path, sizeError));
+	if (sizeError) { result.fileSize = 0; }
+
+	// Probing reports errors without throwing, it seeks through a file so archive members are not probed
+	if (options.probe && job.archive) {
+		result.error = "Error: Archive members cannot be probed";
+		return result;
+	}
+	bool jpeg = (ImageLibrary::Utils::GetFileFormat(job.path.string()) == ImageLibrary::Utils::FileFormat::JPEG);
+	if (options.probe && jpeg) {
+		Clock::time_point start = Clock::now();
+		std::expected<ImageLibrary::JPEGInfo, ImageLibrary::DecodeError> info = ImageLibrary::JPEG::Probe(job.path.string());
+		result.decodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (!info) {
+			result.error = info.error().message;
+			return result;
+		}
+		result.width = info->width;
+		result.height = info->height;
+		result.pixelFormat = info->pixelFormat;
+		return result;
+	}
+	if (options.probe) {
+		Clock::time_point start = Clock::now();
+		std::expected<ImageLibrary::PNGInfo, ImageLibrary::DecodeError> info = ImageLibrary::PNG::Probe(job.path.string());
+		result.decodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (!info) {
+			result.error = info.error().message;
+			return result;
+		}
+		result.width = info->width;
+		result.height = info->height;
+		result.pixelFormat = info->pixelFormat;
+		result.frameCount = info->frameCount;
+		result.textCount = info->text.size();
+		return result;
+	}
+
+	// The library reports errors by throwing pointers, anything else thrown is from the standard library
+	try {
+		Clock::time_point start = Clock::now();
+		ImageLibrary::ImageSource source = (job.archive ? ImageLibrary::ImageSource::FromArchive(job.archive, job.memberIndex) : ImageLibrary::ImageSource::FromFile(job.path.string()));
+		std::unique_ptr<ImageLibrary::Image> decodedImage;
+		if (jpeg) { decodedImage = std::make_unique<ImageLibrary::JPEG>(source); }
+		else { decodedImage = std::make_unique<ImageLibrary::PNG>(source); }
+		ImageLibrary::Image& image = *decodedImage;
+		std::span<const uint8_t> pixels = image.GetPixelBuffer();
+
+		// Only PNGs can be animated
+		ImageLibrary::PNG* png = dynamic_cast<ImageLibrary::PNG*>(decodedImage.get());
+		uint32_t frameCount = (png ? png->GetFrameCount() : 0);
+		for (uint32_t i = 1; i < frameCount; i++) { png->DecodeFrame(i); }
+		Clock::time_point decoded = Clock::now();
+
+		result.width = image.GetWidth();
+		result.height = image.GetHeight();
+		result.pixelFormat = image.GetPixelFormat();
+		result.frameCount = frameCount;
+		result.decodeSeconds = std::chrono::duration<double>(decoded - start).count();
+		result.peakBytes = image.GetMemoryStats().peakBytes;
+
+		// Only the levels are reported so the histograms are not kept
+		if (options.statistics) {
+			result.statistics = image.GetStatistics();
+			for (std::vector<uint64_t>& histogram : result.statistics->histograms) { histogram = std::vector<uint64_t>(); }
+		}
+
+		// Files are already handled in parallel so each is transformed on a single thread
+		uint32_t width = image.GetWidth(), height = image.GetHeight();
+		std::optional<ImageLibrary::PixelTransform> transform;
+		if (options.crop || !options.orientation.IsIdentity()) {
+			ImageLibrary::PixelTransformOptions transformOptions;
+			transformOptions.orientation = options.orientation;
+			transformOptions.crop = options.crop;
+			transformOptions.threadCount = 1;
+
+			Clock::time_point transformStart = Clock::now();
+			transform.emplace(width, height, image.GetPixelFormat(), pixels, transformOptions);
+			result.transformSeconds = std::chrono::duration<double>(Clock::now() - transformStart).count();
+			width = transform->GetWidth();
+			height = transform->GetHeight();
+			pixels = transform->GetData();
+		}
+
+		std::optional<ImageLibrary::Resampler> resampler;
+		if (options.resizeWidth != 0) {
+			ImageLibrary::ResamplerOptions resamplerOptions;
+			resamplerOptions.filter = options.filter;
+			resamplerOptions.threadCount = 1;
+
+			Clock::time_point resizeStart = Clock::now();
+			resampler.emplace(width, height, image.GetPixelFormat(), pixels, options.resizeWidth, options.resizeHeight, resamplerOptions);
+			result.resizeSeconds = std::chrono::duration<double>(Clock::now() - resizeStart).count();
+			width = resampler->GetWidth();
+			height = resampler->GetHeight();
+			pixels = resampler->GetData();
+		}
+
+		if (options.outputFormat != OutputFormat::NONE) {
+			Clock::time_point writeStart = Clock::now();
+			WriteOutput(options, job, width, height, image.GetPixelFormat(), pixels);
+			result.writeSeconds = std::chrono::duration<double>(Clock::now() - writeStart).count();
+		}
+
+		// Files are already handled in parallel so each is encoded on a single thread
+		if (options.blocks) {
+			ImageLibrary::BlockEncoderOptions encoderOptions;
+			encoderOptions.format = options.blockFormat;
+			encoderOptions.quality = options.blockQuality;
+			encoderOptions.threadCount = 1;
+
+			Clock::time_point encodeStart = Clock::now();
+			ImageLibrary::BlockEncoder encoder(width, height, image.GetPixelFormat(), pixels, encoderOptions);
+			result.encodeSeconds = std::chrono::duration<double>(Clock::now() - encodeStart).count();
+			result.blockFormat = encoder.GetFormat();
+			result.psnr = BlockPSNR(image.GetPixelFormat(), pixels, ImageLibrary::BlockEncoder::Decode(encoder.GetFormat(), encoder.GetWidth(), encoder.GetHeight(), encoder.GetData()));
+		}
+	}
+	catch (std::exception* e) {
+		result.error = e->what();
+		delete e;
+	}
+	catch (const std::exception& e) {
+		result.error = std::string("Error: ") + e.what();
+	}
+
+	return result;
+}
+
+static std::string EscapeJSON(const std::string& value) {
+	std::string output;
+	for (unsigned char c : value) {
+		if (c == '"' || c == '\\') {
+			output += '\\';
+			output += c;
+		}
+		else if (c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			output += escaped;
+		}
+		else { output += c; }
+	}
+	return output;
+}
+
+// Throughput in megabytes of file, megapixels decoded and files handled per second
+static double MegabytesPerSecond(uintmax_t bytes, double seconds) { return seconds > 0.0 ? bytes / 1e6 / seconds : 0.0; }
+static double MegapixelsPerSecond(uint64_t pixels, double seconds) { return seconds > 0.0 ? pixels / 1e6 / seconds : 0.0; }
+static double FilesPerSecond(size_t files, double seconds) { return seconds > 0.0 ? files / seconds : 0.0; }
+
+// Hash every file and print the groups of identical and similar images, archive members are skipped as they are hashed from their path
+static int FindDuplicates(const Options& options, const std::vector<Job>& jobs) {
+	std::vector<std::string> files;
+	for (const Job& job : jobs) {
+		if (job.archive) { fprintf(stderr, "Warning: Skipping %s, archive members cannot be hashed\n", job.path.string().c_str()); }
+		else { files.push_back(job.path.string()); }
+	}
+
+	ImageLibrary::DuplicateFinderOptions finderOptions;
+	finderOptions.maxDistance = options.maxDistance;
+	finderOptions.threadCount = options.threadCount;
+	std::optional<ImageLibrary::DuplicateFinder> finder;
+	try {
+		if (!options.hashIndexPath.empty()) { finderOptions.index = std::make_shared<ImageLibrary::HashIndex>(options.hashIndexPath); }
+		finder.emplace(std::move(files), finderOptions);
+		if (finderOptions.index) { finderOptions.index->Save(); }
+	}
+	catch (std::exception* e) {
+		fprintf(stderr, "%s\n", e->what());
+		delete e;
+		return 2;
+	}
+
+	const std::vector<std::string>& paths = finder->GetFiles();
+	const std::vector<ImageLibrary::DuplicateGroup>& groups = finder->GetGroups();
+	size_t failed = std::count_if(finder->GetErrors().begin(), finder->GetErrors().end(), [](const std::string& error) { return !error.empty(); });
+	unsigned int threadCount = (options.threadCount != 0 ? options.threadCount : std::max(std::thread::hardware_concurrency(), 1u));
+
+	if (options.json) {
+		printf("{\n  \"groups\": [");
+		for (size_t i = 0; i < groups.size(); i++) {
+			printf("%s\n    {\"identical\": %s, \"files\": [", (i == 0 ? "" : ","), (groups[i].identical ? "true" : "false"));
+			for (size_t j = 0; j < groups[i].files.size(); j++) { printf("%s\"%s\"", (j == 0 ? "" : ", "), EscapeJSON(paths[groups[i].files[j]]).c_str()); }
+			printf("]}");
+		}
+		printf("%s],\n  \"failed\": [", (groups.empty() ? "" : "\n  "));
+		bool first = true;
+		for (size_t i = 0; i < paths.size(); i++) {
+			if (finder->GetErrors()[i].empty()) { continue; }
+			printf("%s\n    {\"path\": \"%s\", \"error\": \"%s\"}", (first ? "" : ","), EscapeJSON(paths[i]).c_str(), EscapeJSON(finder->GetErrors()[i]).c_str());
+			first = false;
+		}
+		printf("%s],\n", (first ? "" : "\n  "));
+		printf("  \"summary\": {\"files\": %zu, \"failed\": %zu, \"groups\": %zu, \"fromIndex\": %zu, \"fullDecodes\": %zu, \"threads\": %u, \"wallSeconds\": %.3f, \"filesPerSecond\": %.0f}\n}\n",
+			paths.size(), failed, groups.size(), finder->GetIndexHitCount(), finder->GetFullDecodeCount(), threadCount, finder->GetSeconds(), FilesPerSecond(paths.size(), finder->GetSeconds()));
+	}
+	else {
+		for (const ImageLibrary::DuplicateGroup& group : groups) {
+			printf("%s  %zu files\n", (group.identical ? "identical" : "similar  "), group.files.size());
+			for (size_t file : group.files) { printf("    %s\n", paths[file].c_str()); }
+		}
+		for (size_t i = 0; i < paths.size(); i++) {
+			if (!finder->GetErrors()[i].empty()) { printf("FAILED %s  %s\n", paths[i].c_str(), finder->GetErrors()[i].c_str()); }
+		}
+		printf("\n%zu files, %zu failed, %zu groups, %zu from index, %zu decoded in full, %u threads, %.3f s wall, %.0f files/s\n",
+			paths.size(), failed, groups.size(), finder->GetIndexHitCount(), finder->GetFullDecodeCount(), threadCount, finder->GetSeconds(), FilesPerSecond(paths.size(), finder->GetSeconds()));
+	}
+
+	return (failed == 0 ? 0 : 1);
+}
+
+// Decode both images and print how they differ, using every core for the comparison
+static int CompareImages(const Options& options) {
+	ImageLibrary::ImageCompareOptions compareOptions;
+	compareOptions.threadCount = options.threadCount;
+
+	std::chrono::steady_clock::time_point start, compared;
+	std::optional<ImageLibrary::ImageCompare> compare;
+	ImageLibrary::ChangedPixels changed;
+	try {
+		std::unique_ptr<ImageLibrary::Image> images[2];
+		for (int i = 0; i < 2; i++) {
+			std::string path = options.inputs[i].string();
+			if (ImageLibrary::Utils::GetFileFormat(path) == ImageLibrary::Utils::FileFormat::JPEG) { images[i] = std::make_unique<ImageLibrary::JPEG>(path); }
+			else { images[i] = std::make_unique<ImageLibrary::PNG>(path); }
+			images[i]->GetPixelBuffer();
+		}
+
+		start = std::chrono::steady_clock::now();
+		compare.emplace(*images[0], *images[1], compareOptions);
+		changed = compare->ApplyThreshold(options.threshold);
+		compared = std::chrono::steady_clock::now();
+	}
+	catch (std::exception* e) {
+		fprintf(stderr, "%s\n", e->what());
+		delete e;
+		return 2;
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(compared - start).count();
+	double changedPercent = 100.0 * changed.count / std::max<uint64_t>(1, (uint64_t)compare->GetWidth() * compare->GetHeight());
+	const ImageLibrary::Utils::Rect& region = changed.region;
+
+	// Identical images have infinite PSNR which JSON cannot hold
+	if (options.json) {
+		printf("{\"original\": \"%s\", \"changed\": \"%s\", \"width\": %u, \"height\": %u, \"format\": \"%s\", \"maxError\": %u, \"mse\": %.6f, \"psnr\": ",
+			EscapeJSON(options.inputs[0].string()).c_str(), EscapeJSON(options.inputs[1].string()).c_str(), compare->GetWidth(), compare->GetHeight(), PixelFormatName(compare->GetPixelFormat()), compare->GetMaxError(), compare->GetMeanSquaredError());
+		if (std::isinf(compare->GetPSNR())) { printf("null"); }
+		else { printf("%.2f", compare->GetPSNR()); }
+		printf(", \"threshold\": %u, \"changedPixels\": %llu, \"changedPercent\": %.4f", options.threshold, (unsigned long long)changed.count, changedPercent);
+		if (changed.count != 0) { printf(", \"changedRegion\": {\"x\": %u, \"y\": %u, \"width\": %u, \"height\": %u}", region.x, region.y, region.width, region.height); }
+		printf(", \"compareMs\": %.3f}\n", milliseconds);
+	}
+	else {
+		printf("%u x %u compared as %s in %.3f ms\n", compare->GetWidth(), compare->GetHeight(), PixelFormatName(compare->GetPixelFormat()), milliseconds);
+		printf("max error %u of %u, MSE %.6f, PSNR ", compare->GetMaxError(), compare->GetChannelMaximum(), compare->GetMeanSquaredError());
+		if (std::isinf(compare->GetPSNR())) { printf("infinite\n"); }
+		else { printf("%.2f dB\n", compare->GetPSNR()); }
+		printf("%llu pixels (%.4f%%) differ by more than %u", (unsigned long long)changed.count, changedPercent, options.threshold);
+		if (changed.count != 0) { printf(" within %u,%u %u x %u", region.x, region.y, region.width, region.height); }
+		printf("\n");
+	}
+
+	return (changed.count == 0 ? 0 : 1);
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseArguments(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+
+	// Traces only contain stages if scoped timers were compiled in
+	if (!options.tracePath.empty()) {
+#ifndef IL_TRACING
+		fprintf(stderr, "Warning: Tracing was compiled out so the trace will be empty\n");
+#endif
+		ImageLibrary::Trace::SetEnabled(true);
+	}
+
+	ImageLibrary::Image::SetLowMemoryMode(options.lowMemory);
+	ImageLibrary::Image::SetColourManagement(options.colourManagement);
+	ImageLibrary::Image::SetCollectStatistics(options.statistics);
+
+	// Only two files are compared so each is decoded with every core
+	if (options.compare) { return CompareImages(options); }
+
+	// Files are already decoded in parallel so each JPEG is decoded on a single thread
+	ImageLibrary::JPEG::SetThreadCount(1);
+
+	std::vector<Job> jobs = CollectJobs(options.inputs);
+	if (options.duplicates) { return FindDuplicates(options, jobs); }
+	std::vector<Result> results(jobs.size());
+
+	// Files are handed out one at a time so large and small files balance across threads
+	unsigned int threadCount = (options.threadCount != 0 ? options.threadCount : std::max(std::thread::hardware_concurrency(), 1u));
+	threadCount = std::min<unsigned int>(threadCount, (unsigned int)std::max<size_t>(jobs.size(), 1));
+
+	std::atomic<size_t> nextJob = 0;
+	auto worker = [&]() {
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) { results[i] = ProcessFile(options, jobs[i]); }
+	};
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < threadCount; i++) { threads.emplace_back(worker); }
+	worker();
+	for (std::thread& thread : threads) { thread.join(); }
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Totals only count files that decoded
+	size_t failed = 0;
+	uintmax_t totalBytes = 0;
+	uint64_t totalPixels = 0;
+	double totalDecodeSeconds = 0.0;
+	for (const Result& result : results) {
+		if (!result.error.empty()) {
+			failed++;
+			continue;
+		}
+		totalBytes += result.fileSize;
+		totalPixels += (uint64_t)result.width * result.height;
+		totalDecodeSeconds += result.decodeSeconds;
+	}
+
+	if (options.json) {
+		printf("{\n  \"files\": [");
+		for (size_t i = 0; i < jobs.size(); i++) {
+			const Result& result = results[i];
+			uint64_t pixels = (uint64_t)result.width * result.height;
+			printf("%s\n    {\"path\": \"%s\", \"status\": \"%s\", \"bytes\": %ju", (i == 0 ? "" : ","), EscapeJSON(jobs[i].path.string()).c_str(), (result.error.empty() ? "ok" : "failed"), result.fileSize);
+			if (result.error.empty() && options.probe) {
+				printf(", \"width\": %u, \"height\": %u, \"format\": \"%s\", \"frames\": %u, \"textChunks\": %zu, \"probeMs\": %.3f}",
+					result.width, result.height, PixelFormatName(result.pixelFormat), result.frameCount, result.textCount, result.decodeSeconds * 1000.0);
+			}
+			else if (result.error.empty()) {
+				printf(", \"width\": %u, \"height\": %u, \"format\": \"%s\", \"frames\": %u, \"decodeMs\": %.3f, \"writeMs\": %.3f, \"peakBytes\": %lld, \"mbPerSecond\": %.2f, \"megapixelsPerSecond\": %.2f",
+					result.width, result.height, PixelFormatName(result.pixelFormat), result.frameCount, result.decodeSeconds * 1000.0, result.writeSeconds * 1000.0, (long long)result.peakBytes,
+					MegabytesPerSecond(result.fileSize, result.decodeSeconds), MegapixelsPerSecond(pixels, result.decodeSeconds));
+				if (result.statistics) {
+					const ImageLibrary::ImageStatistics& statistics = *result.statistics;
+					const char* names[3] = { "minimum", "maximum", "mean" };
+					printf(", \"statistics\": {");
+					for (int field = 0; field < 3; field++) {
+						printf("%s\"%s\": [", (field == 0 ? "" : ", "), names[field]);
+						for (int c = 0; c < statistics.channelCount; c++) {
+							if (field == 2) { printf("%s%.3f", (c == 0 ? "" : ", "), statistics.mean[c]); }
+							else { printf("%s%u", (c == 0 ? "" : ", "), (unsigned int)(field == 0 ? statistics.minimum[c] : statistics.maximum[c])); }
+						}
+						printf("]");
+					}
+					printf("}");
+				}
+				if (options.crop || !options.orientation.IsIdentity()) { printf(", \"transformMs\": %.3f", result.transformSeconds * 1000.0); }
+				if (options.resizeWidth != 0) { printf(", \"resizeMs\": %.3f", result.resizeSeconds * 1000.0); }
+
+				// A lossless encode has infinite PSNR which JSON cannot hold
+				if (options.blocks) {
+					printf(", \"blockFormat\": \"%s\", \"encodeMs\": %.3f, \"psnr\": ", BlockFormatName(result.blockFormat), result.encodeSeconds * 1000.0);
+					if (std::isinf(result.psnr)) { printf("null"); }
+					else { printf("%.2f", result.psnr); }
+				}
+				printf("}");
+			}
+			else { printf(", \"error\": \"%s\"}", EscapeJSON(result.error).c_str()); }
+		}
+		printf("%s],\n", (jobs.empty() ? "" : "\n  "));
+		printf("  \"summary\": {\"files\": %zu, \"failed\": %zu, \"threads\": %u, \"filesPerSecond\": %.0f, \"bytes\": %ju, \"megapixels\": %.3f, \"wallSeconds\": %.3f, \"decodeSeconds\": %.3f, \"mbPerSecond\": %.2f, \"megapixelsPerSecond\": %.2f}\n}\n",
+			jobs.size(), failed, threadCount, FilesPerSecond(jobs.size(), wallSeconds), totalBytes, totalPixels / 1e6, wallSeconds, totalDecodeSeconds,
+			MegabytesPerSecond(totalBytes, wallSeconds), MegapixelsPerSecond(totalPixels, wallSeconds));
+	}
+	else {
+		for (size_t i = 0; i < jobs.size(); i++) {
+			const Result& result = results[i];
+			if (result.error.empty() && options.probe) {
+				printf("ok     %s  %ux%u %s  %u frames  %zu text chunks  %.3f ms\n", jobs[i].path.string().c_str(), result.width, result.height, PixelFormatName(result.pixelFormat), result.frameCount,
+					result.textCount, result.decodeSeconds * 1000.0);
+			}
+			else if (result.error.empty()) {
+				printf("ok     %s  %ux%u %s  %ju bytes  %.2f ms  %.2f MB peak  %.2f MB/s  %.2f MP/s\n", jobs[i].path.string().c_str(), result.width, result.height, PixelFormatName(result.pixelFormat), result.fileSize,
+					result.decodeSeconds * 1000.0, result.peakBytes / 1e6, MegabytesPerSecond(result.fileSize, result.decodeSeconds), MegapixelsPerSecond((uint64_t)result.width * result.height, result.decodeSeconds));
+				if (result.statistics) {
+					const ImageLibrary::ImageStatistics& statistics = *result.statistics;
+					printf("     ");
+					for (int c = 0; c < statistics.channelCount; c++) { printf("  %c %u-%u mean %.2f", "RGBA"[c], statistics.minimum[c], statistics.maximum[c], statistics.mean[c]); }
+					printf("\n");
+				}
+				if (options.crop || !options.orientation.IsIdentity()) { printf("       transformed  %.2f ms\n", result.transformSeconds * 1000.0); }
+				if (options.resizeWidth != 0) { printf("       resized to %ux%u  %.2f ms\n", options.resizeWidth, options.resizeHeight, result.resizeSeconds * 1000.0); }
+				if (options.blocks) {
+					printf("       %s  %.2f ms  %.2f MP/s  %.2f dB PSNR\n", BlockFormatName(result.blockFormat), result.encodeSeconds * 1000.0,
+						MegapixelsPerSecond((uint64_t)result.width * result.height, result.encodeSeconds), result.psnr);
+				}
+			}
+			else { printf("FAILED %s  %s\n", jobs[i].path.string().c_str(), result.error.c_str()); }
+		}
+		// Nothing is decoded by a probe so only the rate files were handled at means anything
+		printf("\n%zu files, %zu failed, %u threads, %.3f s wall, %.0f files/s", jobs.size(), failed, threadCount, wallSeconds, FilesPerSecond(jobs.size(), wallSeconds));
+		if (!options.probe) { printf(", %.2f MB/s, %.2f MP/s", MegabytesPerSecond(totalBytes, wallSeconds), MegapixelsPerSecond(totalPixels, wallSeconds)); }
+		printf("\n");
+	}
+
+	if (!options.tracePath.empty()) {
+		try { ImageLibrary::Trace::WriteChromeTrace(options.tracePath); }
+		catch (std::exception* e) {
+			fprintf(stderr, "%s\n", e->what());
+			delete e;
+			return 2;
+		}
+	}
+
+	return (failed == 0 ? 0 : 1);
+}
\ No newline at end of file
@@ -15,12 +15,15 @@ project "PhotoViewer"
 
       "../Walnut/Walnut/src",
 
+      "../ImageLibrary/src",
+
       "%{IncludeDir.VulkanSDK}",
    }
 
    links
    {
-       "Walnut"
+       "Walnut",
+       "ImageLibrary"
    }
 
    targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
@@ -0,0 +1,199 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "CompareView.h"
+#include "PNG.h"
+#include "JPEG.h"
+
+namespace ImageLibrary {
+	// Images are decoded the way the viewer opens them, by their extension
+	static std::unique_ptr<Image> Decode(const std::string& path) {
+		ImageSource source = ImageSource::FromFile(path);
+		if (Utils::GetFileFormat(path) == Utils::FileFormat::JPEG) { return std::make_unique<JPEG>(source); }
+		return std::make_unique<PNG>(source);
+	}
+
+	std::optional<std::string> CompareView::Open(const std::string& originalPath, const std::string& changedPath) {
+		std::unique_ptr<ImageCompare> compare;
+		std::unique_ptr<Texture> original, changed, difference;
+		try {
+			std::unique_ptr<Image> originalImage = Decode(originalPath);
+			std::unique_ptr<Image> changedImage = Decode(changedPath);
+			compare = std::make_unique<ImageCompare>(*originalImage, *changedImage);
+
+			// The decoded pixels are only kept until they are on the GPU, the difference texture is filled by the first threshold
+			original = std::make_unique<Texture>(*originalImage);
+			changed = std::make_unique<Texture>(*changedImage);
+			difference = std::make_unique<Texture>(compare->GetWidth(), compare->GetHeight(), Utils::RGBA8);
+		}
+		catch (std::exception* e) {
+			std::string message = e->what();
+			delete e;
+			return message;
+		}
+
+		m_compare = std::move(compare);
+		m_original = std::move(original);
+		m_changed = std::move(changed);
+		m_difference = std::move(difference);
+		m_originalName = std::filesystem::path(originalPath).filename().string();
+		m_changedName = std::filesystem::path(changedPath).filename().string();
+		m_visualisation.assign((size_t)m_compare->GetWidth() * m_compare->GetHeight() * 4, 0);
+		m_appliedThreshold.reset();
+		m_threshold = std::min(m_threshold, (int)m_compare->GetChannelMaximum());
+		m_fitRequested = true;
+
+		UpdateDifference();
+		return std::nullopt;
+	}
+
+	void CompareView::Close() {
+		m_compare.reset();
+		m_original.reset();
+		m_changed.reset();
+		m_difference.reset();
+		m_visualisation = std::vector<uint8_t>();
+		m_uploadBuffer = std::vector<uint8_t>();
+		m_changedPixels = ChangedPixels();
+		m_appliedThreshold.reset();
+	}
+
+	void CompareView::Render() {
+		bool open = true;
+		ImGui::Begin("Compare", &open);
+
+		// Measurements first as they are what a comparison is for, PSNR is infinite for identical images
+		ImGui::Text("%s against %s, %u x %u", m_originalName.c_str(), m_changedName.c_str(), m_compare->GetWidth(), m_compare->GetHeight());
+		if (std::isinf(m_compare->GetPSNR())) { ImGui::Text("Identical"); }
+		else { ImGui::Text("Max error %u of %u  PSNR %.2f dB  MSE %.4f", m_compare->GetMaxError(), m_compare->GetChannelMaximum(), m_compare->GetPSNR(), m_compare->GetMeanSquaredError()); }
+
+		const Utils::Rect& region = m_changedPixels.region;
+		double changedPercent = 100.0 * m_changedPixels.count / ((double)m_compare->GetWidth() * m_compare->GetHeight());
+		if (m_changedPixels.count == 0) { ImGui::Text("No pixels differ by more than %d", m_threshold); }
+		else { ImGui::Text("%llu pixels (%.3f%%) differ by more than %d within %u,%u %u x %u", (unsigned long long)m_changedPixels.count, changedPercent, m_threshold, region.x, region.y, region.width, region.height); }
+
+		int mode = (int)m_mode;
+		if (ImGui::Combo("Mode", &mode, "Side by side\0Swipe\0Difference\0")) { m_mode = (Mode)mode; }
+		ImGui::SliderInt("Threshold", &m_threshold, 0, (int)m_compare->GetChannelMaximum());
+		if (m_mode == Mode::SWIPE) { ImGui::SliderFloat("Swipe", &m_swipe, 0.0f, 1.0f); }
+		if (m_mode == Mode::DIFFERENCE) { ImGui::Checkbox("Show original underneath", &m_showOriginal); }
+
+		if (ImGui::Button("Fit")) { m_fitRequested = true; }
+		ImGui::SameLine();
+		if (ImGui::Button("Actual size")) { m_zoom = 1.0f; }
+		ImGui::SameLine();
+		if (ImGui::Button("Show changes")) { ShowRegion(region, m_paneSize, true); }
+		ImGui::SameLine();
+		ImGui::Text("Zoom %.0f%%", m_zoom * 100.0f);
+
+		// Only the difference texture depends on the threshold
+		if (m_appliedThreshold != m_threshold) { UpdateDifference(); }
+
+		// Panes fill the rest of the window, side by side splits it in two
+		ImVec2 available = ImGui::GetContentRegionAvail();
+		float paneWidth = (m_mode == Mode::SIDE_BY_SIDE ? (available.x - ImGui::GetStyle().ItemSpacing.x) * 0.5f : available.x);
+		m_paneSize = ImVec2(std::max(1.0f, std::floor(paneWidth)), std::max(1.0f, available.y));
+		if (m_fitRequested) {
+			ShowRegion(Utils::Rect{ .width = m_compare->GetWidth(), .height = m_compare->GetHeight() }, m_paneSize, false);
+			m_fitRequested = false;
+		}
+
+		switch (m_mode) {
+		case Mode::SIDE_BY_SIDE:
+			DrawPane("##Original", m_paneSize, *m_original);
+			ImGui::SameLine();
+			DrawPane("##Changed", m_paneSize, *m_changed);
+			break;
+		case Mode::SWIPE:
+			DrawPane("##Swipe", m_paneSize, *m_original, m_changed.get(), m_swipe);
+			break;
+		case Mode::DIFFERENCE:
+			if (m_showOriginal) { DrawPane("##Difference", m_paneSize, *m_original, m_difference.get()); }
+			else { DrawPane("##Difference", m_paneSize, *m_difference); }
+			break;
+		}
+
+		ImGui::End();
+		if (!open) { Close(); }
+	}
+
+	void CompareView::DrawPane(const char* id, ImVec2 size, const Texture& texture, const Texture* over, std::optional<float> swipe) {
+		ImGuiIO& io = ImGui::GetIO();
+		ImGui::BeginChild(id, size, false, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		ImVec2 end(origin.x + size.x, origin.y + size.y);
+		ImVec2 paneCentre(origin.x + size.x * 0.5f, origin.y + size.y * 0.5f);
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, end, IM_COL32(20, 20, 20, 255));
+
+		// Every pane moves the one view, dragging pans with the mouse and the wheel zooms around the cursor
+		ImGui::InvisibleButton("##Input", size);
+		if (ImGui::IsItemActive()) {
+			m_centre.x -= io.MouseDelta.x / m_zoom;
+			m_centre.y -= io.MouseDelta.y / m_zoom;
+		}
+		if (ImGui::IsItemHovered() && io.MouseWheel != 0.0f) { ZoomAround(io.MousePos, paneCentre, m_zoom * std::pow(1.25f, io.MouseWheel)); }
+
+		// On a whole pixel so images drawn at actual size are not filtered
+		float width = m_compare->GetWidth() * m_zoom;
+		float height = m_compare->GetHeight() * m_zoom;
+		ImVec2 position(std::floor(paneCentre.x - m_centre.x * m_zoom), std::floor(paneCentre.y - m_centre.y * m_zoom));
+		ImGui::SetCursorScreenPos(position);
+		texture.Draw(width, height);
+
+		if (over) {
+			// Swiping shows the second texture right of the divider, otherwise it is drawn over the first with its transparency
+			float divider = origin.x + std::floor(size.x * swipe.value_or(0.0f));
+			if (swipe) { drawList->PushClipRect(ImVec2(divider, origin.y), end, true); }
+			ImGui::SetCursorScreenPos(position);
+			over->Draw(width, height);
+			if (swipe) {
+				drawList->PopClipRect();
+				drawList->AddLine(ImVec2(divider, origin.y), ImVec2(divider, end.y), IM_COL32(255, 255, 255, 200), 1.0f);
+			}
+		}
+
+		ImGui::EndChild();
+	}
+
+	void CompareView::ZoomAround(ImVec2 point, ImVec2 paneCentre, float zoom) noexcept {
+		// The pixel under the point is the centre plus the point's offset from the pane centre at the old zoom, and must be the same at the new one
+		zoom = std::clamp(zoom, MIN_ZOOM, MAX_ZOOM);
+		ImVec2 offset(point.x - paneCentre.x, point.y - paneCentre.y);
+		m_centre.x += offset.x / m_zoom - offset.x / zoom;
+		m_centre.y += offset.y / m_zoom - offset.y / zoom;
+		m_zoom = zoom;
+	}
+
+	void CompareView::ShowRegion(const Utils::Rect& region, ImVec2 paneSize, bool enlarge) noexcept {
+		if (region.IsEmpty() || paneSize.x <= 0.0f || paneSize.y <= 0.0f) { return; }
+
+		float zoom = std::min(paneSize.x / region.width, paneSize.y / region.height);
+		m_zoom = std::clamp(enlarge ? zoom : std::min(zoom, 1.0f), MIN_ZOOM, MAX_ZOOM);
+		m_centre = ImVec2(region.x + region.width * 0.5f, region.y + region.height * 0.5f);
+	}
+
+	void CompareView::UpdateDifference() {
+		uint32_t width = m_compare->GetWidth();
+		ChangedPixels changed = m_compare->ApplyThreshold((uint32_t)m_threshold, m_visualisation);
+
+		// Outside the old and new changed regions every pixel is transparent both before and after, the first upload has to fill the whole texture
+		Utils::Rect region = (m_appliedThreshold ? Utils::UnionRect(m_changedPixels.region, changed.region) : Utils::Rect{ .width = width, .height = m_compare->GetHeight() });
+		m_changedPixels = changed;
+		m_appliedThreshold = m_threshold;
+		if (region.IsEmpty()) { return; }
+
+		// Whole rows are already packed, otherwise the rows of the region are gathered first
+		std::span<const uint8_t> pixels(m_visualisation.data() + (size_t)region.y * width * 4, (size_t)region.height * width * 4);
+		if (region.width != width) {
+			m_uploadBuffer.resize((size_t)region.width * region.height * 4);
+			for (uint32_t y = 0; y < region.height; y++) {
+				memcpy(m_uploadBuffer.data() + (size_t)y * region.width * 4, m_visualisation.data() + ((size_t)(region.y + y) * width + region.x) * 4, (size_t)region.width * 4);
+			}
+			pixels = m_uploadBuffer;
+		}
+		m_difference->UploadRegion(region, pixels);
+	}
+}
\ No newline at end of file
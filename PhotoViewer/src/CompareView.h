@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "imgui.h"
+
+#include "ImageCompare.h"
+#include "Texture.h"
+
+namespace ImageLibrary {
+	// Window comparing an original image with a changed copy, side by side, as a swipe from one to the other, or as the original with its
+	// changed pixels drawn over it. Every pane shares one zoom and pan so the same pixels are always lined up
+	class CompareView
+	{
+	public:
+		enum class Mode {
+			SIDE_BY_SIDE,
+			SWIPE,
+			DIFFERENCE
+		};
+
+		// Decode and compare two images of the same size, returns why not if either cannot be decoded or they differ in size
+		std::optional<std::string> Open(const std::string& originalPath, const std::string& changedPath);
+		void Close();
+		bool IsOpen() const noexcept { return m_compare != nullptr; }
+
+		// Draw the compare window with its controls and measurements above the panes
+		void Render();
+
+	private:
+		static constexpr float MIN_ZOOM = 0.01f;
+		static constexpr float MAX_ZOOM = 32.0f;
+
+		// Draw the textures in a pane, the second only right of the swipe position when one is given
+		void DrawPane(const char* id, ImVec2 size, const Texture& texture, const Texture* over = nullptr, std::optional<float> swipe = std::nullopt);
+
+		// Zoom around a point of a pane so the pixel under it stays put
+		void ZoomAround(ImVec2 point, ImVec2 paneCentre, float zoom) noexcept;
+
+		// Show the whole of a region of the image in a pane, not enlarging it past actual size unless it is smaller than the pane
+		void ShowRegion(const Utils::Rect& region, ImVec2 paneSize, bool enlarge) noexcept;
+
+		// Apply the threshold and upload only the part of the difference texture that could have changed
+		void UpdateDifference();
+
+	private:
+		std::unique_ptr<ImageCompare> m_compare;
+		std::unique_ptr<Texture> m_original, m_changed, m_difference;
+		std::string m_originalName, m_changedName;
+
+		// Pixels over the threshold drawn as RGBA8, kept so only a region needs copying to the texture when the threshold moves
+		std::vector<uint8_t> m_visualisation;
+		std::vector<uint8_t> m_uploadBuffer;
+		ChangedPixels m_changedPixels;
+		int m_threshold = 0;
+		std::optional<int> m_appliedThreshold;
+
+		Mode m_mode = Mode::SIDE_BY_SIDE;
+		float m_swipe = 0.5f;
+		bool m_showOriginal = true;
+
+		// Zoom and the point of the image at the centre of each pane
+		float m_zoom = 1.0f;
+		ImVec2 m_centre;
+		bool m_fitRequested = true;
+		ImVec2 m_paneSize;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "GLFW/glfw3.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include "FramePacer.h"
+
+namespace ImageLibrary {
+	void FramePacer::WaitForNextFrame(GLFWwindow* window) {
+		Clock::time_point now = Clock::now();
+		m_lastWaitSeconds = 0.0;
+
+		// Input is queued by ImGui's GLFW callbacks during the poll just before this and only applied when the frame starts
+		bool inputQueued = (ImGui::GetCurrentContext()->InputEventsQueue.Size > 0);
+		if (CheckWindow(window) || inputQueued || m_wakeRequested.exchange(false)) { m_framesToDraw = std::max(m_framesToDraw, FRAMES_AFTER_EVENT); }
+
+		bool due = (m_framesToDraw > 0 || (m_redrawAt && *m_redrawAt <= now));
+		if (m_enabled && !due) {
+			double timeout = MAX_WAIT_SECONDS;
+			if (m_redrawAt) { timeout = std::min(timeout, std::chrono::duration<double>(*m_redrawAt - now).count()); }
+			glfwWaitEventsTimeout(timeout);
+
+			// Anything other than the time running out is an event, which a worker's wake is sent as too
+			Clock::time_point woken = Clock::now();
+			m_lastWaitSeconds = std::chrono::duration<double>(woken - now).count();
+			if (m_lastWaitSeconds < timeout || m_wakeRequested.exchange(false)) { m_framesToDraw = FRAMES_AFTER_EVENT; }
+			CheckWindow(window);
+			now = woken;
+		}
+
+		if (m_framesToDraw > 0) { m_framesToDraw--; }
+		if (m_redrawAt && *m_redrawAt <= now) { m_redrawAt.reset(); }
+
+		// Published once a second has passed, so the first frame after a long sleep shows how little was drawn
+		m_statsFrames++;
+		m_statsIdleSeconds += m_lastWaitSeconds;
+		double statsSeconds = std::chrono::duration<double>(now - m_statsStart).count();
+		if (statsSeconds >= STATS_SECONDS) {
+			m_framesPerSecond = (float)(m_statsFrames / statsSeconds);
+			m_idleFraction = (float)std::min(1.0, m_statsIdleSeconds / statsSeconds);
+			m_statsStart = now;
+			m_statsFrames = 0;
+			m_statsIdleSeconds = 0.0;
+		}
+	}
+
+	void FramePacer::RequestRedraw() noexcept {
+		m_framesToDraw = std::max(m_framesToDraw, 1);
+	}
+
+	void FramePacer::RequestRedrawIn(double seconds) noexcept {
+		if (seconds <= 0.0) {
+			RequestRedraw();
+			return;
+		}
+
+		Clock::time_point at = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+		if (!m_redrawAt || at < *m_redrawAt) { m_redrawAt = at; }
+	}
+
+	void FramePacer::Wake() noexcept {
+		// The flag covers a wake sent while the frame loop is polling rather than waiting, which would consume the empty event
+		m_wakeRequested = true;
+		glfwPostEmptyEvent();
+	}
+
+	bool FramePacer::CheckWindow(GLFWwindow* window) {
+		int width, height;
+		glfwGetFramebufferSize(window, &width, &height);
+		int focused = glfwGetWindowAttrib(window, GLFW_FOCUSED);
+		int iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+
+		bool changed = (width != m_framebufferWidth || height != m_framebufferHeight || focused != m_focused || iconified != m_iconified);
+		m_framebufferWidth = width;
+		m_framebufferHeight = height;
+		m_focused = focused;
+		m_iconified = iconified;
+		return changed;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+struct GLFWwindow;
+
+namespace ImageLibrary {
+	// Decides whether the viewer draws the next frame or sleeps until something changes, so a still image costs no CPU or GPU time
+	// A frame is drawn for queued input, a change to the window, a wake from another thread or a redraw asked for now or at a time,
+	// otherwise the frame loop blocks in GLFW until an event arrives
+	class FramePacer
+	{
+	public:
+		// Call at the start of a frame before ImGui starts it, blocks while nothing needs drawing
+		void WaitForNextFrame(GLFWwindow* window);
+
+		// Draw the next frame, or a frame once the time given has passed, the soonest request is kept until a frame is drawn
+		void RequestRedraw() noexcept;
+		void RequestRedrawIn(double seconds) noexcept;
+
+		// Draw a frame soon, safe to call from any thread such as a worker that has finished a load
+		void Wake() noexcept;
+
+		// Drawing every frame when disabled
+		void SetEnabled(bool enabled) noexcept { m_enabled = enabled; }
+		bool IsEnabled() const noexcept { return m_enabled; }
+
+		// Frames drawn each second and the share of time spent asleep, measured over about a second
+		float GetFramesPerSecond() const noexcept { return m_framesPerSecond; }
+		float GetIdleFraction() const noexcept { return m_idleFraction; }
+
+		// Time slept before the current frame, so frame times can leave it out
+		double GetLastWaitSeconds() const noexcept { return m_lastWaitSeconds; }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// ImGui settles hover and layout changes over the frames after an event
+		static constexpr int FRAMES_AFTER_EVENT = 3;
+
+		// Longest sleep even with nothing asked for, in case something that needs drawing did not ask
+		static constexpr double MAX_WAIT_SECONDS = 1.0;
+
+		// Frame pacing statistics are published this often
+		static constexpr double STATS_SECONDS = 1.0;
+
+		bool CheckWindow(GLFWwindow* window);
+
+	private:
+		bool m_enabled = true;
+		int m_framesToDraw = FRAMES_AFTER_EVENT;
+		std::optional<Clock::time_point> m_redrawAt;
+		std::atomic<bool> m_wakeRequested = false;
+
+		// Window state from the last frame, a change is drawn even if it came with no input
+		int m_framebufferWidth = 0, m_framebufferHeight = 0;
+		int m_focused = 0, m_iconified = 0;
+
+		Clock::time_point m_statsStart = Clock::now();
+		uint32_t m_statsFrames = 0;
+		double m_statsIdleSeconds = 0.0;
+		float m_framesPerSecond = 0.0f;
+		float m_idleFraction = 0.0f;
+		double m_lastWaitSeconds = 0.0;
+	};
+}
\ No newline at end of file
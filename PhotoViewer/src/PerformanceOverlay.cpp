@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "imgui.h"
+
+#include "PerformanceOverlay.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	void PerformanceOverlay::AddFrameTime(float seconds) {
+		m_frameTimes[m_frameCount % FRAME_HISTORY] = seconds * 1000.0f;
+		m_frameCount++;
+	}
+
+	void PerformanceOverlay::SetFramePacing(float framesPerSecond, float idleFraction) noexcept {
+		m_framesPerSecond = framesPerSecond;
+		m_idleFraction = idleFraction;
+	}
+
+	void PerformanceOverlay::SetResourceCounts(int64_t vulkanObjects, int64_t pendingFrees) noexcept {
+		m_vulkanObjects = vulkanObjects;
+		m_pendingFrees = pendingFrees;
+	}
+
+	void PerformanceOverlay::AddLoad(const char* scopeName) {
+#ifdef IL_TRACING
+		if (!Trace::IsEnabled()) { return; }
+		std::vector<Trace::Event> events = Trace::Collect();
+
+		// Names are compared by value as the same literal may have a different address in each translation unit
+		auto load = std::find_if(events.rbegin(), events.rend(), [scopeName](const Trace::Event& event) { return strcmp(event.name, scopeName) == 0; });
+		if (load == events.rend()) { return; }
+		uint64_t loadStart = load->start;
+		uint64_t loadEnd = load->start + load->duration;
+
+		// Anything that ran entirely within the load on any thread is part of it, kept in the order each scope first started
+		Load breakdown{ .milliseconds = load->duration / 1e6 };
+		for (const Trace::Event& event : events) {
+			if (event.start < loadStart || event.start + event.duration > loadEnd || &event == &*load) { continue; }
+
+			auto stage = std::find_if(breakdown.stages.begin(), breakdown.stages.end(), [&event](const StageTime& stage) { return strcmp(stage.name, event.name) == 0; });
+			if (stage == breakdown.stages.end()) {
+				breakdown.stages.push_back(StageTime{ .name = event.name, .milliseconds = 0.0, .count = 0 });
+				stage = breakdown.stages.end() - 1;
+			}
+			stage->milliseconds += event.duration / 1e6;
+			stage->count++;
+		}
+
+		m_loads.push_front(std::move(breakdown));
+		if (m_loads.size() > LOAD_HISTORY) { m_loads.pop_back(); }
+#endif
+	}
+
+	float PerformanceOverlay::GetFrameTimePercentile(double percentile) const {
+		size_t count = std::min(m_frameCount, FRAME_HISTORY);
+		if (count == 0) { return 0.0f; }
+
+		std::vector<float> sorted(m_frameTimes.begin(), m_frameTimes.begin() + count);
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[std::min(count - 1, (size_t)(percentile / 100.0 * count))];
+	}
+
+	void PerformanceOverlay::Render() {
+		ImGui::Begin("Performance");
+
+		// Frame times in the order they happened
+		size_t count = std::min(m_frameCount, FRAME_HISTORY);
+		ImGui::Text("Frame time  p50 %.2f ms  p90 %.2f ms  p99 %.2f ms  max %.2f ms", GetFrameTimePercentile(50.0), GetFrameTimePercentile(90.0), GetFrameTimePercentile(99.0), GetFrameTimePercentile(100.0));
+		ImGui::PlotLines("##FrameTimes", m_frameTimes.data(), (int)count, (int)(m_frameCount >= FRAME_HISTORY ? m_frameCount % FRAME_HISTORY : 0), nullptr, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+		ImGui::Text("Frames drawn %.1f/s  idle %.0f%%", m_framesPerSecond, m_idleFraction * 100.0f);
+		ImGui::Text("Vulkan objects %lld  waiting to be freed %lld", (long long)m_vulkanObjects, (long long)m_pendingFrees);
+
+		ImGui::Separator();
+
+#ifdef IL_TRACING
+		bool enabled = Trace::IsEnabled();
+		if (ImGui::Checkbox("Record trace", &enabled)) { Trace::SetEnabled(enabled); }
+
+		ImGui::SameLine();
+		if (ImGui::Button("Export Chrome trace")) {
+			std::filesystem::path path = std::filesystem::temp_directory_path() / "PhotoViewer" / "trace.json";
+			try {
+				std::filesystem::create_directories(path.parent_path());
+				Trace::WriteChromeTrace(path);
+				m_tracePath = path.string();
+			}
+			catch (std::exception* e) {
+				m_tracePath = e->what();
+				delete e;
+			}
+			catch (const std::exception& e) { m_tracePath = e.what(); }
+		}
+		if (!m_tracePath.empty()) { ImGui::TextWrapped("%s", m_tracePath.c_str()); }
+
+		// Most recent load first with each stage as a share of the whole load
+		for (size_t i = 0; i < m_loads.size(); i++) {
+			const Load& load = m_loads[i];
+			ImGui::PushID((int)i);
+
+			char header[64];
+			snprintf(header, sizeof(header), "Load %.2f ms###Load", load.milliseconds);
+			if (ImGui::CollapsingHeader(header) && ImGui::BeginTable("Stages", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("Scope");
+				ImGui::TableSetupColumn("Calls");
+				ImGui::TableSetupColumn("ms");
+				ImGui::TableSetupColumn("%");
+				ImGui::TableHeadersRow();
+
+				for (const StageTime& stage : load.stages) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextUnformatted(stage.name);
+					ImGui::TableNextColumn();
+					ImGui::Text("%u", stage.count);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", stage.milliseconds);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", load.milliseconds > 0.0 ? stage.milliseconds / load.milliseconds * 100.0 : 0.0);
+				}
+				ImGui::EndTable();
+			}
+
+			ImGui::PopID();
+		}
+#else
+		ImGui::TextDisabled("Tracing was compiled out of this build");
+#endif
+
+		ImGui::End();
+	}
+}
\ No newline at end of file
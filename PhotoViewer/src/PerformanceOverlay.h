@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ImageLibrary {
+	// ImGui panel showing frame time percentiles and where the time went in recent image loads
+	class PerformanceOverlay
+	{
+	public:
+		// Call once a frame with the time the previous frame took
+		void AddFrameTime(float seconds);
+
+		// Frames drawn each second and the share of time the frame loop slept while nothing changed
+		void SetFramePacing(float framesPerSecond, float idleFraction) noexcept;
+
+		// Vulkan objects held by textures and how many are waiting on a frame to be freed, which should stay level as images come and go
+		void SetResourceCounts(int64_t vulkanObjects, int64_t pendingFrees) noexcept;
+
+		// Break down the most recent traced scope with this name into the scopes that ran inside it on any thread
+		// Must be called after the scope has closed
+		void AddLoad(const char* scopeName);
+
+		void Render();
+
+	private:
+		// Time spent in every scope with the same name during a load
+		struct StageTime {
+			const char* name;
+			double milliseconds;
+			uint32_t count;
+		};
+
+		struct Load {
+			double milliseconds;
+			std::vector<StageTime> stages;
+		};
+
+		float GetFrameTimePercentile(double percentile) const;
+
+	private:
+		static constexpr size_t FRAME_HISTORY = 240;
+		static constexpr size_t LOAD_HISTORY = 8;
+
+		std::array<float, FRAME_HISTORY> m_frameTimes{};
+		size_t m_frameCount = 0;
+		float m_framesPerSecond = 0.0f;
+		float m_idleFraction = 0.0f;
+		int64_t m_vulkanObjects = 0, m_pendingFrees = 0;
+
+		std::deque<Load> m_loads;
+		std::string m_tracePath;
+	};
+}
\ No newline at end of file
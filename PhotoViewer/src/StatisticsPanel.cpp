@@ -0,0 +1,55 @@
+#include <cmath>
+#include <cfloat>
+
+#include "imgui.h"
+
+#include "StatisticsPanel.h"
+
+namespace ImageLibrary {
+	void StatisticsPanel::SetStatistics(const ImageStatistics& statistics) {
+		m_statistics = statistics;
+		UpdateDisplayHistograms();
+	}
+
+	void StatisticsPanel::UpdateDisplayHistograms() {
+		if (!m_statistics) { return; }
+
+		// 16 bit histograms are summed into groups of 256 values
+		for (int c = 0; c < m_statistics->channelCount; c++) {
+			const std::vector<uint64_t>& histogram = m_statistics->histograms[c];
+			size_t binWidth = histogram.size() / DISPLAY_BINS;
+
+			m_displayHistograms[c].assign(DISPLAY_BINS, 0.0f);
+			for (size_t value = 0; value < histogram.size(); value++) { m_displayHistograms[c][value / binWidth] += (float)histogram[value]; }
+
+			// A log scale keeps small counts visible next to a large peak
+			if (m_logarithmic) {
+				for (float& count : m_displayHistograms[c]) { count = std::log1p(count); }
+			}
+		}
+	}
+
+	void StatisticsPanel::Render() {
+		ImGui::Begin("Statistics");
+
+		if (!m_statistics) {
+			ImGui::TextDisabled("No image open");
+			ImGui::End();
+			return;
+		}
+
+		if (ImGui::Checkbox("Logarithmic", &m_logarithmic)) { UpdateDisplayHistograms(); }
+		ImGui::Text("%llu pixels", (unsigned long long)m_statistics->pixelCount);
+
+		static const char* channelNames[4] = { "Red", "Green", "Blue", "Alpha" };
+		for (int c = 0; c < m_statistics->channelCount; c++) {
+			ImGui::PushID(c);
+			ImGui::Separator();
+			ImGui::Text("%s  min %u  max %u  mean %.2f", channelNames[c], m_statistics->minimum[c], m_statistics->maximum[c], m_statistics->mean[c]);
+			ImGui::PlotHistogram("##Histogram", m_displayHistograms[c].data(), (int)DISPLAY_BINS, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+			ImGui::PopID();
+		}
+
+		ImGui::End();
+	}
+}
\ No newline at end of file
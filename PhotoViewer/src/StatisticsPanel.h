@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <optional>
+
+#include "Statistics.h"
+
+namespace ImageLibrary {
+	// ImGui panel showing the histogram and levels of each channel of the open image
+	class StatisticsPanel
+	{
+	public:
+		void SetStatistics(const ImageStatistics& statistics);
+		void Clear() noexcept { m_statistics.reset(); }
+
+		void Render();
+
+	private:
+		// Histograms are shown with 256 bins whatever the bit depth
+		static constexpr size_t DISPLAY_BINS = 256;
+
+		void UpdateDisplayHistograms();
+
+	private:
+		std::optional<ImageStatistics> m_statistics;
+		std::array<std::vector<float>, 4> m_displayHistograms;
+		bool m_logarithmic = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,547 @@
+#include <cstring>
+
+#include "imgui.h"
+#include "backends/imgui_impl_vulkan.h"
+
+#include "Texture.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	/*
+		Most code relating to Vulkan in this file was taken from Walnut created by Yan Chernovik
+		Accessible here: https://github.com/StudioCherno/Walnut
+	*/
+	void Texture::GenerateDescriptorSet() {
+		IL_TRACE_SCOPE("Texture::GenerateDescriptorSet");
+
+		// Get necessary information
+		VkDevice device = Walnut::Application::GetDevice();
+		VkResult err;
+		VkFormat imageFormat = GetVulkanisedImageFormat();
+
+		// Create the Image
+		{
+			// Create image information
+			VkImageCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			info.imageType = VK_IMAGE_TYPE_2D;
+			info.format = imageFormat;
+			info.extent.width = m_width;
+			info.extent.height = m_height;
+			info.extent.depth = 1;
+			info.mipLevels = 1;
+			info.arrayLayers = 1;
+			info.samples = VK_SAMPLE_COUNT_1_BIT;
+			info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			// Some implementations of Vulkan do not require format R8G8B8 so alpha must be added for images without an alpha channel
+			VkImageFormatProperties check;
+			err = vkGetPhysicalDeviceImageFormatProperties(Walnut::Application::GetPhysicalDevice(), imageFormat, info.imageType, info.tiling, info.usage, info.flags, &check);
+			if (err == VK_ERROR_FORMAT_NOT_SUPPORTED && m_blockFormat) { throw new std::runtime_error("Error: Block compressed format is not supported by the device"); }
+			if (err == VK_ERROR_FORMAT_NOT_SUPPORTED) {
+				AddAlphaChannel();
+				imageFormat = GetVulkanisedImageFormat();
+				info.format = imageFormat;
+			}
+			else { check_vk_result(err); }
+
+			// Create image
+			err = vkCreateImage(device, &info, nullptr, &m_image);
+			check_vk_result(err);
+			s_vulkanObjects++;
+
+			// Get memory requirements of the image
+			VkMemoryRequirements req;
+			vkGetImageMemoryRequirements(device, m_image, &req);
+
+			// Create allocation information
+			VkMemoryAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			alloc_info.allocationSize = req.size;
+			alloc_info.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits);
+
+			// Allocate memory for image
+			err = vkAllocateMemory(device, &alloc_info, nullptr, &m_memory);
+			check_vk_result(err);
+			s_vulkanObjects++;
+
+			// Bind image to allocated memory
+			err = vkBindImageMemory(device, m_image, m_memory, 0);
+			check_vk_result(err);
+		}
+
+		// Create image view
+		{
+			// Create image view information
+			VkImageViewCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			info.image = m_image;
+			info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			info.format = imageFormat;
+			info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			info.subresourceRange.levelCount = 1;
+			info.subresourceRange.layerCount = 1;
+
+			// BC4 only has a red channel so repeat it for green and blue
+			if (m_blockFormat == Utils::BC4) { info.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE }; }
+
+			// Create image view
+			err = vkCreateImageView(device, &info, nullptr, &m_imageView);
+			check_vk_result(err);
+			s_vulkanObjects++;
+		}
+
+		// Create sampler:
+		{
+			// Create sampler information
+			VkSamplerCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+			info.magFilter = VK_FILTER_LINEAR;
+			info.minFilter = VK_FILTER_LINEAR;
+			info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+			info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+			info.minLod = -1000;
+			info.maxLod = 1000;
+			info.maxAnisotropy = 1.0f;
+
+			// Create sampler
+			VkResult err = vkCreateSampler(device, &info, nullptr, &m_sampler);
+			check_vk_result(err);
+			s_vulkanObjects++;
+		}
+
+		// Create the descriptor set:
+		m_descriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(m_sampler, m_imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		s_vulkanObjects++;
+	}
+
+	void Texture::SetData(std::span<const uint8_t> data) {
+		IL_TRACE_SCOPE("Texture::SetData");
+
+		// Get necessary information
+		VkDevice device = Walnut::Application::GetDevice();
+		size_t upload_size = (m_blockFormat ? Utils::GetBlockBufferSize(*m_blockFormat, m_width, m_height) : (size_t)m_width * m_height * GetPixelFormatByteSize(m_pixelFormat));
+		VkResult err;
+
+		if (!m_stagingBuffer) { CreateStagingBuffer(upload_size); }
+
+		// Upload to Buffer
+		{
+			// Map device staging buffer memory so it is application addressable
+			char* map = NULL;
+			err = vkMapMemory(device, m_stagingBufferMemory, 0, m_alignedSize, 0, (void**)(&map));
+			check_vk_result(err);
+
+			// Copy image data into map
+			if (m_addedAlpha) { CopyAddingAlpha((uint8_t*)map, data.data(), (size_t)m_width * m_height); }
+			else { memcpy(map, data.data(), upload_size); }
+
+			// Create mapped memory information
+			VkMappedMemoryRange range[1] = {};
+			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range[0].memory = m_stagingBufferMemory;
+			range[0].size = m_alignedSize;
+
+			// Flush devide memory
+			err = vkFlushMappedMemoryRanges(device, 1, range);
+			check_vk_result(err);
+
+			// We no longer need access to memory so unmap it
+			vkUnmapMemory(device, m_stagingBufferMemory);
+		}
+
+
+		// Copy to Image
+		{
+			// Create information about the copy to be performed
+			VkBufferImageCopy region = {};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent.width = m_width;
+			region.imageExtent.height = m_height;
+			region.imageExtent.depth = 1;
+
+			// Previous contents are all overwritten so do not need to be kept
+			CopyStagingToImage(region, VK_IMAGE_LAYOUT_UNDEFINED);
+			m_hasContents = true;
+		}
+	}
+
+	void Texture::CreateStagingBuffer(size_t size) {
+		// Get necessary information
+		VkDevice device = Walnut::Application::GetDevice();
+		VkResult err;
+
+		// Create upload buffer information
+		VkBufferCreateInfo buffer_info = {};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = size;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		// Create upload buffer
+		err = vkCreateBuffer(device, &buffer_info, nullptr, &m_stagingBuffer);
+		check_vk_result(err);
+		s_vulkanObjects++;
+
+		// Get memory requirements for upload buffer
+		VkMemoryRequirements req;
+		vkGetBufferMemoryRequirements(device, m_stagingBuffer, &req);
+		m_alignedSize = req.size;
+
+		// Create allocation information
+		VkMemoryAllocateInfo alloc_info = {};
+		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		alloc_info.allocationSize = req.size;
+		alloc_info.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
+
+		// Allocate memory for staging buffer
+		err = vkAllocateMemory(device, &alloc_info, nullptr, &m_stagingBufferMemory);
+		check_vk_result(err);
+		s_vulkanObjects++;
+
+		// Bind memory for staging buffer
+		err = vkBindBufferMemory(device, m_stagingBuffer, m_stagingBufferMemory, 0);
+		check_vk_result(err);
+	}
+
+	void Texture::UpdateRegion(std::span<const uint8_t> data, const Utils::Rect& region) {
+		IL_TRACE_SCOPE("Texture::UpdateRegion");
+
+		// Get necessary information
+		VkDevice device = Walnut::Application::GetDevice();
+		size_t bytesPerPixel = Utils::GetPixelFormatByteSize(m_pixelFormat);
+		size_t srcBytesPerPixel = (m_addedAlpha ? bytesPerPixel / 4 * 3 : bytesPerPixel);
+		VkResult err;
+
+		if (m_blockFormat) { throw new std::runtime_error("Error: Compressed textures cannot be updated by region"); }
+		if (region.IsEmpty()) { return; }
+
+		// Upload region to Buffer
+		{
+			// Map device staging buffer memory so it is application addressable
+			char* map = NULL;
+			err = vkMapMemory(device, m_stagingBufferMemory, 0, m_alignedSize, 0, (void**)(&map));
+			check_vk_result(err);
+
+			// Copy only the rows of the region, keeping the same layout as the whole image
+			for (uint32_t y = region.y; y < region.y + region.height; y++) {
+				uint8_t* dest = (uint8_t*)map + ((size_t)y * m_width + region.x) * bytesPerPixel;
+				const uint8_t* src = data.data() + ((size_t)y * m_width + region.x) * srcBytesPerPixel;
+				if (m_addedAlpha) { CopyAddingAlpha(dest, src, region.width); }
+				else { memcpy(dest, src, region.width * bytesPerPixel); }
+			}
+
+			// Create mapped memory information
+			VkMappedMemoryRange range[1] = {};
+			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range[0].memory = m_stagingBufferMemory;
+			range[0].size = m_alignedSize;
+
+			// Flush devide memory
+			err = vkFlushMappedMemoryRanges(device, 1, range);
+			check_vk_result(err);
+
+			// We no longer need access to memory so unmap it
+			vkUnmapMemory(device, m_stagingBufferMemory);
+		}
+
+		// Copy region to Image
+		{
+			// Create information about the copy to be performed, reading the region out of the full size staging buffer
+			VkBufferImageCopy copy = {};
+			copy.bufferOffset = ((VkDeviceSize)region.y * m_width + region.x) * bytesPerPixel;
+			copy.bufferRowLength = m_width;
+			copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copy.imageSubresource.layerCount = 1;
+			copy.imageOffset.x = (int32_t)region.x;
+			copy.imageOffset.y = (int32_t)region.y;
+			copy.imageExtent.width = region.width;
+			copy.imageExtent.height = region.height;
+			copy.imageExtent.depth = 1;
+
+			// The rest of the image must be kept so transition from its current layout
+			CopyStagingToImage(copy, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+	}
+
+	void Texture::UploadRegion(const Utils::Rect& region, std::span<const uint8_t> pixels) {
+		IL_TRACE_SCOPE("Texture::UploadRegion");
+
+		// Get necessary information
+		VkDevice device = Walnut::Application::GetDevice();
+		size_t uploadSize = (size_t)region.width * region.height * Utils::GetPixelFormatByteSize(m_pixelFormat);
+		VkResult err;
+
+		if (m_blockFormat) { throw new std::runtime_error("Error: Compressed textures cannot be updated by region"); }
+		if ((uint64_t)region.x + region.width > m_width || (uint64_t)region.y + region.height > m_height) { throw new std::runtime_error("Error: Upload region is outside of the texture"); }
+		if (region.IsEmpty()) { return; }
+
+		// Replace the staging buffer once it is too small, the old one may still be in use by the device so is freed with the frame
+		if (m_alignedSize < uploadSize) {
+			if (m_stagingBuffer) {
+				SubmitFree(2, [stagingBuffer = m_stagingBuffer, stagingBufferMemory = m_stagingBufferMemory]() {
+					VkDevice device = Walnut::Application::GetDevice();
+					vkDestroyBuffer(device, stagingBuffer, nullptr);
+					vkFreeMemory(device, stagingBufferMemory, nullptr);
+				});
+			}
+			CreateStagingBuffer(uploadSize);
+		}
+
+		// Upload region to Buffer
+		{
+			// Map device staging buffer memory so it is application addressable
+			char* map = NULL;
+			err = vkMapMemory(device, m_stagingBufferMemory, 0, m_alignedSize, 0, (void**)(&map));
+			check_vk_result(err);
+
+			// Copy the region's pixels as they are, they are already packed
+			if (m_addedAlpha) { CopyAddingAlpha((uint8_t*)map, pixels.data(), (size_t)region.width * region.height); }
+			else { memcpy(map, pixels.data(), uploadSize); }
+
+			// Create mapped memory information
+			VkMappedMemoryRange range[1] = {};
+			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			range[0].memory = m_stagingBufferMemory;
+			range[0].size = m_alignedSize;
+
+			// Flush devide memory
+			err = vkFlushMappedMemoryRanges(device, 1, range);
+			check_vk_result(err);
+
+			// We no longer need access to memory so unmap it
+			vkUnmapMemory(device, m_stagingBufferMemory);
+		}
+
+		// Copy region to Image
+		{
+			// Create information about the copy to be performed
+			VkBufferImageCopy copy = {};
+			copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copy.imageSubresource.layerCount = 1;
+			copy.imageOffset.x = (int32_t)region.x;
+			copy.imageOffset.y = (int32_t)region.y;
+			copy.imageExtent.width = region.width;
+			copy.imageExtent.height = region.height;
+			copy.imageExtent.depth = 1;
+
+			// Nothing has to be kept before the first upload, after that the rest of the image is transitioned from its current layout
+			CopyStagingToImage(copy, m_hasContents ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED);
+			m_hasContents = true;
+		}
+	}
+
+	void Texture::CopyStagingToImage(const VkBufferImageCopy& region, VkImageLayout oldLayout) {
+		// Get necessary information
+		VkCommandBuffer command_buffer = Walnut::Application::GetCommandBuffer(true);
+		bool keepContents = (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		// Create copy barrier information
+		VkImageMemoryBarrier copy_barrier = {};
+		copy_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		copy_barrier.srcAccessMask = (keepContents ? VK_ACCESS_SHADER_READ_BIT : 0);
+		copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		copy_barrier.oldLayout = oldLayout;
+		copy_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		copy_barrier.image = m_image;
+		copy_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copy_barrier.subresourceRange.levelCount = 1;
+		copy_barrier.subresourceRange.layerCount = 1;
+
+		// Create copy barrier, waiting for any earlier sampling of the image if its contents are kept
+		VkPipelineStageFlags srcStage = (keepContents ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT : VK_PIPELINE_STAGE_HOST_BIT);
+		vkCmdPipelineBarrier(command_buffer, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &copy_barrier);
+
+		// Copy buffer to image
+		vkCmdCopyBufferToImage(command_buffer, m_stagingBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		// Create barrier information
+		VkImageMemoryBarrier use_barrier = {};
+		use_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		use_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		use_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		use_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		use_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		use_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		use_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		use_barrier.image = m_image;
+		use_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		use_barrier.subresourceRange.levelCount = 1;
+		use_barrier.subresourceRange.layerCount = 1;
+
+		// Create barrier
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &use_barrier);
+
+		// Flush command buffer, this waits for the device so is timed on its own
+		{
+			IL_TRACE_SCOPE("Application::FlushCommandBuffer");
+			Walnut::Application::FlushCommandBuffer(command_buffer);
+		}
+	}
+
+	void Texture::SetCrop(std::optional<Utils::Rect> crop) {
+		if (crop && (crop->IsEmpty() || (uint64_t)crop->x + crop->width > m_width || (uint64_t)crop->y + crop->height > m_height)) {
+			throw new std::runtime_error("Error: Crop region is outside of the texture");
+		}
+		m_crop = crop;
+	}
+
+	uint32_t Texture::GetDisplayWidth() const noexcept {
+		Utils::Rect crop = m_crop.value_or(Utils::Rect{ .width = m_width, .height = m_height });
+		return (m_orientation.SwapsDimensions() ? crop.height : crop.width);
+	}
+
+	uint32_t Texture::GetDisplayHeight() const noexcept {
+		Utils::Rect crop = m_crop.value_or(Utils::Rect{ .width = m_width, .height = m_height });
+		return (m_orientation.SwapsDimensions() ? crop.width : crop.height);
+	}
+
+	void Texture::Draw(float width, float height) const {
+		Utils::Rect crop = m_crop.value_or(Utils::Rect{ .width = m_width, .height = m_height });
+		Utils::Orientation::SourceMapping mapping = m_orientation.GetSourceMapping();
+
+		// Each corner of the drawn quad takes the texture coordinate the same orientation would move its pixel from
+		auto sourceCoordinate = [&](float x, float y) {
+			if (mapping.swapAxes) { std::swap(x, y); }
+			if (mapping.reverseX) { x = 1.0f - x; }
+			if (mapping.reverseY) { y = 1.0f - y; }
+			return ImVec2((crop.x + x * crop.width) / m_width, (crop.y + y * crop.height) / m_height);
+		};
+
+		ImVec2 position = ImGui::GetCursorScreenPos();
+		ImGui::GetWindowDrawList()->AddImageQuad((ImTextureID)m_descriptorSet,
+			position, ImVec2(position.x + width, position.y), ImVec2(position.x + width, position.y + height), ImVec2(position.x, position.y + height),
+			sourceCoordinate(0.0f, 0.0f), sourceCoordinate(1.0f, 0.0f), sourceCoordinate(1.0f, 1.0f), sourceCoordinate(0.0f, 1.0f));
+		ImGui::Dummy(ImVec2(width, height));
+	}
+
+	VkFormat Texture::GetVulkanisedImageFormat() {
+		if (m_blockFormat) { return GetVulkanisedBlockFormat(*m_blockFormat); }
+
+		switch (m_pixelFormat) {
+		case Utils::RGB8:
+			return s_sRGBSampling ? VK_FORMAT_R8G8B8_SRGB : VK_FORMAT_R8G8B8_UNORM;
+		case Utils::RGB16:
+			return VK_FORMAT_R16G16B16_UNORM;
+		case Utils::RGBA8:
+			return s_sRGBSampling ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		case Utils::RGBA16:
+			return VK_FORMAT_R16G16B16A16_UNORM;
+		}
+	}
+
+	VkFormat Texture::GetVulkanisedBlockFormat(Utils::BlockFormat blockFormat) {
+		// BC1 is created without alpha so blocks using black in three colour mode stay opaque
+		switch (blockFormat) {
+		case Utils::BC1:
+			return s_sRGBSampling ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case Utils::BC4:
+			return VK_FORMAT_BC4_UNORM_BLOCK;
+		default:
+			return s_sRGBSampling ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		}
+	}
+
+	bool Texture::IsBlockFormatSupported(Utils::BlockFormat blockFormat) {
+		if (blockFormat == Utils::BC4 && s_sRGBSampling) { return false; }
+
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(Walnut::Application::GetPhysicalDevice(), GetVulkanisedBlockFormat(blockFormat), &properties);
+		return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	}
+
+	void Texture::AddAlphaChannel() {
+		// Select new image format, the alpha channel is added to the data as it is copied
+		switch (m_pixelFormat) {
+		case Utils::RGB8:
+			m_pixelFormat = Utils::RGBA8;
+			break;
+		case Utils::RGB16:
+			m_pixelFormat = Utils::RGBA16;
+			break;
+		}
+
+		m_addedAlpha = true;
+	}
+
+	void Texture::CopyAddingAlpha(uint8_t* dest, const uint8_t* src, size_t pixelCount) {
+		// Copy each pixel and set an opaque alpha value after it
+		int channelDepth = Utils::GetChannelByteSize(m_pixelFormat);
+		int srcPixelSize = 3 * channelDepth;
+
+		for (size_t i = 0; i < pixelCount; i++) {
+			memcpy(dest, src, srcPixelSize);
+			memset(dest + srcPixelSize, 0xff, channelDepth);
+			dest += srcPixelSize + channelDepth;
+			src += srcPixelSize;
+		}
+	}
+
+	uint32_t Texture::GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits)
+	{
+		VkPhysicalDeviceMemoryProperties prop;
+		vkGetPhysicalDeviceMemoryProperties(Walnut::Application::GetPhysicalDevice(), &prop);
+		for (uint32_t i = 0; i < prop.memoryTypeCount; i++)
+		{
+			if ((prop.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
+			{
+				return i;
+			}
+		}
+
+		return 0xffffffff;
+	}
+
+	void Texture::Release()
+	{
+		// Only objects that were made are counted, a constructor that threw part way leaves the rest null
+		int64_t objectCount = 0;
+		for (bool made : { m_sampler != nullptr, m_imageView != nullptr, m_image != nullptr, m_memory != nullptr, m_stagingBuffer != nullptr, m_stagingBufferMemory != nullptr }) { objectCount += made; }
+
+		// Descriptor sets are only given back to ImGui's pool from 1.89.4, before that they stay counted as the leak they are
+#if IMGUI_VERSION_NUM >= 18940
+		objectCount += (m_descriptorSet != nullptr);
+#endif
+
+		SubmitFree(objectCount, [
+			sampler = m_sampler, imageView = m_imageView, image = m_image, memory = m_memory, 
+			stagingBuffer = m_stagingBuffer, stagingBufferMemory = m_stagingBufferMemory, descriptorSet = m_descriptorSet
+		](){
+			VkDevice device = Walnut::Application::GetDevice();
+#if IMGUI_VERSION_NUM >= 18940
+			if (descriptorSet) { ImGui_ImplVulkan_RemoveTexture(descriptorSet); }
+#endif
+			vkDestroySampler(device, sampler, nullptr);
+			vkDestroyImageView(device, imageView, nullptr);
+			vkDestroyImage(device, image, nullptr);
+			vkFreeMemory(device, memory, nullptr);
+			vkDestroyBuffer(device, stagingBuffer, nullptr);
+			vkFreeMemory(device, stagingBufferMemory, nullptr);
+		});
+
+		m_sampler = nullptr;
+		m_imageView = nullptr;
+		m_image = nullptr;
+		m_memory = nullptr;
+		m_stagingBuffer = nullptr;
+		m_stagingBufferMemory = nullptr;
+		m_descriptorSet = nullptr;
+	}
+
+	void Texture::SubmitFree(int64_t objectCount, std::function<void()>&& free) {
+		s_pendingFrees += objectCount;
+		Walnut::Application::SubmitResourceFree([objectCount, free = std::move(free)]() {
+			free();
+			s_vulkanObjects -= objectCount;
+			s_pendingFrees -= objectCount;
+		});
+	}
+}
\ No newline at end of file
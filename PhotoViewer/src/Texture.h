@@ -0,0 +1,118 @@
+#pragma once
+
+#include <span>
+#include <atomic>
+#include <functional>
+
+#include "vulkan/vulkan.h"
+#include "Walnut/Application.h"
+
+#include "Image.h"
+#include "BlockEncoder.h"
+
+namespace ImageLibrary {
+	// GPU copy of a decoded image that can be drawn with ImGui
+	class Texture
+	{
+	public:
+		Texture(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> data) noexcept(false)
+			: m_width(width), m_height(height), m_pixelFormat(pixelFormat) { GenerateDescriptorSet(); SetData(data); };
+		Texture(Image& image) noexcept(false) : Texture(image.GetWidth(), image.GetHeight(), image.GetPixelFormat(), image.GetPixelBuffer()) {};
+
+		// Texture with no contents until regions of it are uploaded, only what has been uploaded may be drawn
+		Texture(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat) noexcept(false)
+			: m_width(width), m_height(height), m_pixelFormat(pixelFormat) { GenerateDescriptorSet(); };
+
+		// Compressed texture made of BC1, BC4 or BC7 blocks, greyscale BC4 is swizzled so its one channel is shown as grey
+		Texture(uint32_t width, uint32_t height, Utils::BlockFormat blockFormat, std::span<const uint8_t> blocks) noexcept(false)
+			: m_width(width), m_height(height), m_pixelFormat(Utils::RGBA8), m_blockFormat(blockFormat) { GenerateDescriptorSet(); SetData(blocks); };
+		Texture(const BlockEncoder& encoder) noexcept(false) : Texture(encoder.GetWidth(), encoder.GetHeight(), encoder.GetFormat(), encoder.GetData()) {};
+		~Texture() noexcept { Release(); };
+
+		Texture(const Texture&) = delete;
+		Texture& operator=(const Texture&) = delete;
+
+		uint32_t GetWidth() const noexcept { return m_width; }
+		uint32_t GetHeight() const noexcept { return m_height; }
+		VkDescriptorSet GetDescriptorSet() const noexcept { return m_descriptorSet; }
+
+		// Orientation and crop used when drawing, applied to the texture coordinates so the uploaded pixels never move
+		void SetOrientation(Utils::Orientation orientation) noexcept { m_orientation = orientation; }
+		const Utils::Orientation& GetOrientation() const noexcept { return m_orientation; }
+		void SetCrop(std::optional<Utils::Rect> crop) noexcept(false);
+
+		// Size once cropped and oriented
+		uint32_t GetDisplayWidth() const noexcept;
+		uint32_t GetDisplayHeight() const noexcept;
+
+		// Draw at the ImGui cursor as an image of the given size
+		void Draw(float width, float height) const;
+
+		// Upload only a region of the image, data must be the whole image in the layout the texture was created from
+		// Not available for compressed textures
+		void UpdateRegion(std::span<const uint8_t> data, const Utils::Rect& region);
+
+		// Upload tightly packed pixels of just the region in the format the texture was created from, through a staging buffer only that size
+		// Not available for compressed textures
+		void UploadRegion(const Utils::Rect& region, std::span<const uint8_t> pixels);
+
+		// Whether the GPU can sample a block format, BC4 has no _SRGB format so is unsupported while sRGB sampling is on
+		static bool IsBlockFormatSupported(Utils::BlockFormat blockFormat);
+
+		// Create 8 bit textures with _SRGB formats so the sampler decodes to linear light and filtering happens there
+		// Only correct when the swapchain is also _SRGB, 16 bit textures stay UNORM, applies to textures created afterwards
+		static void SetSRGBSampling(bool enabled) noexcept { s_sRGBSampling = enabled; }
+
+		// Vulkan objects held by every texture and how many are waiting to be freed with a frame, both should stay level as images come and go
+		struct ResourceCounts {
+			int64_t vulkanObjects = 0;
+			int64_t pendingFrees = 0;
+		};
+		static ResourceCounts GetResourceCounts() noexcept { return { s_vulkanObjects, s_pendingFrees }; }
+
+	private:
+		// Internal Vulkan functions
+		void GenerateDescriptorSet();
+		void SetData(std::span<const uint8_t> data);
+		void CreateStagingBuffer(size_t size);
+		VkFormat GetVulkanisedImageFormat();
+		static VkFormat GetVulkanisedBlockFormat(Utils::BlockFormat blockFormat);
+		void AddAlphaChannel();
+		void CopyAddingAlpha(uint8_t* dest, const uint8_t* src, size_t pixelCount);
+		void CopyStagingToImage(const VkBufferImageCopy& region, VkImageLayout oldLayout);
+		uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits);
+		void Release();
+
+		// Free objects once the device is done with the frame, counting them until then
+		static void SubmitFree(int64_t objectCount, std::function<void()>&& free);
+
+	private:
+		// Image information
+		uint32_t m_width = 0, m_height = 0;
+		Utils::PixelFormat m_pixelFormat = Utils::INVALID;
+		bool m_addedAlpha = false;
+		std::optional<Utils::BlockFormat> m_blockFormat;
+
+		// How the texture is drawn
+		Utils::Orientation m_orientation;
+		std::optional<Utils::Rect> m_crop;
+
+		// Vulkan information
+		VkImage m_image = nullptr;
+		VkImageView m_imageView = nullptr;
+		VkDeviceMemory m_memory = nullptr;
+		VkSampler m_sampler = nullptr;
+
+		VkBuffer m_stagingBuffer = nullptr;
+		VkDeviceMemory m_stagingBufferMemory = nullptr;
+		size_t m_alignedSize = 0;
+
+		// Whether anything has been uploaded, the first upload does not need to keep the previous contents
+		bool m_hasContents = false;
+
+		VkDescriptorSet m_descriptorSet = nullptr;
+
+		inline static bool s_sRGBSampling = false;
+		inline static std::atomic<int64_t> s_vulkanObjects = 0, s_pendingFrees = 0;
+	};
+}
\ No newline at end of file
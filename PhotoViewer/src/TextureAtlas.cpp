@@ -0,0 +1,138 @@
+#include <cstring>
+
+#include "TextureAtlas.h"
+#include "Trace.h"
+
+namespace ImageLibrary {
+	TextureAtlas::TextureAtlas(uint32_t slotSize, uint32_t maxPages, uint32_t pageSize) : m_slotSize(slotSize), m_maxPages(maxPages) {
+		// Every slot is padded by a pixel on each side
+		m_slotsPerSide = (slotSize == 0 ? 0 : pageSize / (slotSize + 2));
+		if (m_slotsPerSide == 0 || maxPages == 0) { throw new std::runtime_error("Error: Texture atlas pages cannot hold a slot"); }
+		m_pageSize = m_slotsPerSide * (slotSize + 2);
+	}
+
+	std::optional<TextureAtlas::Handle> TextureAtlas::Add(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) {
+		IL_TRACE_SCOPE("TextureAtlas::Add");
+
+		if (width == 0 || height == 0 || width > m_slotSize || height > m_slotSize) { throw new std::runtime_error("Error: Image does not fit in a texture atlas slot"); }
+		if (pixels.size() < (size_t)width * height * Utils::GetPixelFormatByteSize(pixelFormat)) { throw new std::runtime_error("Error: Image data is smaller than its size"); }
+
+		std::optional<Handle> handle = FindSlot();
+		if (!handle) { return std::nullopt; }
+
+		// A slot that could not be filled goes back on the free list rather than being lost for the life of the page
+		Page& page = m_pages[handle->page];
+		try {
+			// Convert each row into the middle of the padded image then repeat its first and last pixel, the top and bottom rows are repeated whole
+			uint32_t paddedWidth = width + 2, paddedHeight = height + 2;
+			size_t paddedRowSize = (size_t)paddedWidth * 4;
+			size_t rowSize = (size_t)width * Utils::GetPixelFormatByteSize(pixelFormat);
+			m_padded.resize(paddedRowSize * paddedHeight);
+			for (uint32_t y = 0; y < height; y++) {
+				uint8_t* row = m_padded.data() + (y + 1) * paddedRowSize;
+				Utils::ConvertPixels(pixels.data() + y * rowSize, pixelFormat, row + 4, 4, Utils::TargetFormat::RGBA8, width);
+				memcpy(row, row + 4, 4);
+				memcpy(row + paddedRowSize - 4, row + paddedRowSize - 8, 4);
+			}
+			memcpy(m_padded.data(), m_padded.data() + paddedRowSize, paddedRowSize);
+			memcpy(m_padded.data() + (paddedHeight - 1) * paddedRowSize, m_padded.data() + height * paddedRowSize, paddedRowSize);
+
+			Utils::Rect rect = GetSlotRect(handle->slot);
+			page.texture->UploadRegion(Utils::Rect{ .x = rect.x, .y = rect.y, .width = paddedWidth, .height = paddedHeight }, m_padded);
+		}
+		catch (...) {
+			page.freeSlots.push_back(handle->slot);
+			throw;
+		}
+
+		Slot& slot = page.slots[handle->slot];
+		slot = Slot{ .generation = handle->generation, .lastUsed = m_frame, .width = width, .height = height, .used = true };
+		m_imageCount++;
+		return handle;
+	}
+
+	std::optional<TextureAtlas::Handle> TextureAtlas::FindSlot() {
+		// Fill the earliest pages first so later ones stay empty for as long as possible
+		for (uint32_t i = 0; i < m_pages.size(); i++) {
+			Page& page = m_pages[i];
+			if (page.freeSlots.empty()) { continue; }
+
+			uint32_t slot = page.freeSlots.back();
+			page.freeSlots.pop_back();
+			return Handle{ .page = i, .slot = slot, .generation = m_nextGeneration++ };
+		}
+
+		// Add a page while there is room for one, its slots are taken from the front
+		if (m_pages.size() < m_maxPages) {
+			std::unique_ptr<Texture> texture = std::make_unique<Texture>(m_pageSize, m_pageSize, Utils::RGBA8);
+			Page& page = m_pages.emplace_back();
+			page.texture = std::move(texture);
+			page.slots.resize(GetSlotsPerPage());
+			for (uint32_t slot = GetSlotsPerPage(); slot > 1; slot--) { page.freeSlots.push_back(slot - 1); }
+			return Handle{ .page = (uint32_t)m_pages.size() - 1, .slot = 0, .generation = m_nextGeneration++ };
+		}
+
+		// Otherwise evict the image used longest ago, as long as that was before this frame
+		std::optional<Handle> oldest;
+		uint64_t oldestFrame = m_frame;
+		for (uint32_t i = 0; i < m_pages.size(); i++) {
+			for (uint32_t slot = 0; slot < m_pages[i].slots.size(); slot++) {
+				const Slot& candidate = m_pages[i].slots[slot];
+				if (candidate.used && candidate.lastUsed < oldestFrame) {
+					oldest = Handle{ .page = i, .slot = slot };
+					oldestFrame = candidate.lastUsed;
+				}
+			}
+		}
+		if (!oldest) { return std::nullopt; }
+
+		m_pages[oldest->page].slots[oldest->slot].used = false;
+		m_imageCount--;
+		m_evictionCount++;
+		oldest->generation = m_nextGeneration++;
+		return oldest;
+	}
+
+	std::optional<TextureAtlas::Region> TextureAtlas::Use(const Handle& handle) {
+		Slot* slot = GetSlot(handle);
+		if (!slot) { return std::nullopt; }
+		slot->lastUsed = m_frame;
+
+		// Texture coordinates of the image inside its border
+		Utils::Rect rect = GetSlotRect(handle.slot);
+		float scale = 1.0f / m_pageSize;
+		return Region{
+			.descriptorSet = m_pages[handle.page].texture->GetDescriptorSet(),
+			.uv0 = ImVec2((rect.x + 1) * scale, (rect.y + 1) * scale),
+			.uv1 = ImVec2((rect.x + 1 + slot->width) * scale, (rect.y + 1 + slot->height) * scale),
+			.width = slot->width,
+			.height = slot->height
+		};
+	}
+
+	void TextureAtlas::Remove(const Handle& handle) {
+		Slot* slot = GetSlot(handle);
+		if (!slot) { return; }
+
+		slot->used = false;
+		m_pages[handle.page].freeSlots.push_back(handle.slot);
+		m_imageCount--;
+	}
+
+	void TextureAtlas::Clear() {
+		m_pages.clear();
+		m_imageCount = 0;
+	}
+
+	TextureAtlas::Slot* TextureAtlas::GetSlot(const Handle& handle) {
+		if (handle.page >= m_pages.size() || handle.slot >= m_pages[handle.page].slots.size()) { return nullptr; }
+
+		Slot& slot = m_pages[handle.page].slots[handle.slot];
+		return (slot.used && slot.generation == handle.generation ? &slot : nullptr);
+	}
+
+	Utils::Rect TextureAtlas::GetSlotRect(uint32_t slot) const noexcept {
+		uint32_t stride = m_slotSize + 2;
+		return Utils::Rect{ .x = (slot % m_slotsPerSide) * stride, .y = (slot / m_slotsPerSide) * stride, .width = stride, .height = stride };
+	}
+}
\ No newline at end of file
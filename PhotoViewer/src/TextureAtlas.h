@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "imgui.h"
+
+#include "Texture.h"
+
+namespace ImageLibrary {
+	// Small images packed into the square slots of a few large RGBA8 pages, so thousands of thumbnails need one texture, memory allocation
+	// and descriptor set per page rather than per image. ImGui's Vulkan backend samples one 2D image per descriptor set, so pages are
+	// separate 2D textures rather than layers of an array. Each slot has a one pixel border repeating the image's edges so filtering
+	// never reaches into a neighbouring slot
+	class TextureAtlas
+	{
+	public:
+		// Slot an image was added to, the generation tells whether the image is still there or was evicted for another
+		struct Handle {
+			uint32_t page = 0;
+			uint32_t slot = 0;
+			uint64_t generation = 0;
+		};
+
+		// Where to draw an image from
+		struct Region {
+			VkDescriptorSet descriptorSet = nullptr;
+			ImVec2 uv0, uv1;
+			uint32_t width = 0, height = 0;
+		};
+
+		// Slots hold images up to slotSize on each side and each page holds as many slots as fit within pageSize
+		// Once maxPages are full the image least recently used is evicted to make room
+		TextureAtlas(uint32_t slotSize, uint32_t maxPages, uint32_t pageSize = 2048) noexcept(false);
+
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+		// Copy an image into a free slot converting it to RGBA8, none if every slot was used this frame
+		std::optional<Handle> Add(uint32_t width, uint32_t height, Utils::PixelFormat pixelFormat, std::span<const uint8_t> pixels) noexcept(false);
+
+		// Region of an image still in the atlas, which counts as using it this frame
+		std::optional<Region> Use(const Handle& handle);
+
+		// Free an image's slot, nothing happens if it was already evicted
+		void Remove(const Handle& handle);
+
+		// Remove every image and release every page
+		void Clear();
+
+		// Images used in the same frame are never evicted for each other, as the frame may already draw from their slots
+		void NextFrame() noexcept { m_frame++; }
+
+		uint32_t GetSlotsPerPage() const noexcept { return m_slotsPerSide * m_slotsPerSide; }
+		uint32_t GetPageCount() const noexcept { return (uint32_t)m_pages.size(); }
+		size_t GetImageCount() const noexcept { return m_imageCount; }
+		size_t GetEvictionCount() const noexcept { return m_evictionCount; }
+
+	private:
+		struct Slot {
+			uint64_t generation = 0;
+			uint64_t lastUsed = 0;
+			uint32_t width = 0, height = 0;
+			bool used = false;
+		};
+
+		// Pages are created as they are needed and kept once emptied until the atlas is cleared
+		struct Page {
+			std::unique_ptr<Texture> texture;
+			std::vector<Slot> slots;
+			std::vector<uint32_t> freeSlots;
+		};
+
+		std::optional<Handle> FindSlot();
+		Slot* GetSlot(const Handle& handle);
+		Utils::Rect GetSlotRect(uint32_t slot) const noexcept;
+
+	private:
+		uint32_t m_slotSize;
+		uint32_t m_maxPages;
+		uint32_t m_slotsPerSide;
+		uint32_t m_pageSize;
+		std::vector<Page> m_pages;
+
+		// Generations are never reused so a handle from before a clear cannot match a new image
+		uint64_t m_nextGeneration = 1;
+		uint64_t m_frame = 1;
+		size_t m_imageCount = 0;
+		size_t m_evictionCount = 0;
+
+		// Image with its border converted to RGBA8 before it is uploaded, kept to avoid an allocation per image
+		std::vector<uint8_t> m_padded;
+	};
+}
\ No newline at end of file
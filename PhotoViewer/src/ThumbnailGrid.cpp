@@ -0,0 +1,268 @@
+#include <algorithm>
+
+#include "imgui.h"
+
+#include "ThumbnailGrid.h"
+
+namespace ImageLibrary {
+	ThumbnailGrid::ThumbnailGrid(std::shared_ptr<ThumbnailStore> store, std::filesystem::path indexDirectory, std::function<void()> onResult)
+		: m_store(store), m_indexDirectory(indexDirectory), m_onResult(std::move(onResult)), m_atlas(store->GetThumbnailSize(), MAX_ATLAS_PAGES) {
+		// Leave half the cores for the UI and the image being viewed
+		unsigned int workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+		for (unsigned int i = 0; i < workerCount; i++) { m_workers.emplace_back(&ThumbnailGrid::Worker, this); }
+	}
+
+	ThumbnailGrid::~ThumbnailGrid() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_jobAdded.notify_all();
+		for (auto& worker : m_workers) { worker.join(); }
+	}
+
+	void ThumbnailGrid::SetFolder(const std::filesystem::path& folder) {
+		// A folder that cannot be listed shows nothing, the index calls back whenever its files change so they are shown again
+		m_index.reset();
+		try {
+			FolderIndexOptions options;
+			options.onChange = m_onResult;
+			m_index = std::make_unique<FolderIndex>(folder, m_indexDirectory, options);
+		}
+		catch (std::runtime_error* e) { delete e; }
+		ShowEntries();
+	}
+
+	void ThumbnailGrid::ShowEntries() {
+		// The generation is taken first so a change made while the entries are fetched is shown next frame
+		m_indexGeneration = (m_index ? m_index->GetGeneration() : 0);
+		m_entries = (m_index ? m_index->GetEntries() : nullptr);
+
+		std::vector<std::string> files;
+		if (m_entries) {
+			files.reserve(m_entries->size());
+			for (const FolderEntry& entry : *m_entries) { files.push_back((m_index->GetFolder() / entry.name).string()); }
+		}
+
+		m_files = std::move(files);
+		m_states.assign(m_files.size(), State::NONE);
+		m_slots.clear();
+		m_atlas.Clear();
+		m_uploads.clear();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_generation++;
+		m_jobs.clear();
+		m_results.clear();
+		m_wantedFirst = 0;
+		m_wantedEnd = 0;
+	}
+
+	void ThumbnailGrid::Worker() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobAdded.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if (m_stopping) { return; }
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+
+				// Thumbnails scrolled out of view since they were queued are not made
+				if (job.generation != m_generation) { continue; }
+				if (job.index < m_wantedFirst || job.index >= m_wantedEnd) {
+					m_results.push_back(Result{ .generation = job.generation, .index = job.index, .thumbnail = std::nullopt, .dropped = true });
+					if (m_onResult) { m_onResult(); }
+					continue;
+				}
+			}
+
+			std::optional<Thumbnail> thumbnail;
+			try {
+				std::expected<Thumbnail, DecodeError> created = m_store->Create(job.path);
+				if (created) { thumbnail = std::move(*created); }
+			}
+			catch (std::exception* e) { delete e; }
+
+			bool idle;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_results.push_back(Result{ .generation = job.generation, .index = job.index, .thumbnail = std::move(thumbnail), .dropped = false });
+				idle = m_jobs.empty();
+			}
+			if (m_onResult) { m_onResult(); }
+
+			// Write new thumbnails to the pack once there is nothing left to make
+			if (idle) {
+				try { m_store->Flush(); }
+				catch (std::runtime_error* e) { delete e; }
+			}
+		}
+	}
+
+	void ThumbnailGrid::TakeResults() {
+		std::vector<Result> results;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::swap(results, m_results);
+		}
+
+		uint32_t generation;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			generation = m_generation;
+		}
+
+		for (Result& result : results) {
+			if (result.generation != generation) { continue; }
+			if (result.thumbnail) { m_uploads.emplace_back(result.index, std::move(*result.thumbnail)); }
+			else { m_states[result.index] = (result.dropped ? State::NONE : State::FAILED); }
+		}
+	}
+
+	bool ThumbnailGrid::Upload(size_t index, const Thumbnail& thumbnail) {
+		try {
+			std::optional<TextureAtlas::Handle> handle = m_atlas.Add(thumbnail.width, thumbnail.height, thumbnail.pixelFormat, thumbnail.pixels);
+			if (!handle) {
+				m_states[index] = State::NONE;
+				return false;
+			}
+			m_slots[index] = *handle;
+			m_states[index] = State::READY;
+		}
+		catch (std::runtime_error* e) {
+			delete e;
+			m_states[index] = State::FAILED;
+		}
+		return true;
+	}
+
+	std::optional<std::string> ThumbnailGrid::Render() {
+		std::optional<std::string> clicked;
+
+		ImGui::Begin("Thumbnails");
+		ImGui::SliderFloat("Size", &m_cellSize, 48.0f, (float)m_store->GetThumbnailSize(), "%.0f");
+		ImGui::Text("%zu images, %zu thumbnails in %u textures", m_files.size(), m_atlas.GetImageCount(), m_atlas.GetPageCount());
+		ImGui::BeginChild("Grid");
+
+		// Every thumbnail is looked up again when the folder changes, those of unchanged files are still in the store
+		if (m_index && m_index->GetGeneration() != m_indexGeneration) { ShowEntries(); }
+
+		m_atlas.NextFrame();
+		TakeResults();
+
+		size_t wantedFirst, wantedEnd;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			wantedFirst = m_wantedFirst;
+			wantedEnd = m_wantedEnd;
+		}
+
+		// Upload thumbnails the workers made first, anything scrolled away since is looked up again when it comes back
+		int uploads = 0;
+		while (!m_uploads.empty() && uploads < MAX_UPLOADS_PER_FRAME) {
+			auto [index, thumbnail] = std::move(m_uploads.front());
+			m_uploads.pop_front();
+			if (index >= wantedFirst && index < wantedEnd) {
+				if (Upload(index, thumbnail)) { uploads++; }
+			}
+			else { m_states[index] = State::NONE; }
+		}
+
+		// Only the rows on screen are laid out, each row is one cell high plus the spacing between items
+		ImVec2 spacing = ImGui::GetStyle().ItemSpacing;
+		size_t columns = std::max<size_t>(1, (size_t)((ImGui::GetContentRegionAvail().x + spacing.x) / (m_cellSize + spacing.x)));
+		size_t rows = (m_files.size() + columns - 1) / columns;
+		size_t firstRow = rows, endRow = 0;
+		std::vector<Job> jobs;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImGuiListClipper clipper;
+		clipper.Begin((int)rows, m_cellSize + spacing.y);
+		while (clipper.Step()) {
+			firstRow = std::min(firstRow, (size_t)clipper.DisplayStart);
+			endRow = std::max(endRow, (size_t)clipper.DisplayEnd);
+
+			for (size_t row = clipper.DisplayStart; row < (size_t)clipper.DisplayEnd; row++) {
+				for (size_t column = 0; column < columns && row * columns + column < m_files.size(); column++) {
+					size_t index = row * columns + column;
+					if (column > 0) { ImGui::SameLine(); }
+
+					ImVec2 cellMin = ImGui::GetCursorScreenPos();
+					ImVec2 cellMax(cellMin.x + m_cellSize, cellMin.y + m_cellSize);
+					ImGui::PushID((int)index);
+					if (ImGui::InvisibleButton("Thumbnail", ImVec2(m_cellSize, m_cellSize))) { clicked = m_files[index]; }
+					if (ImGui::IsItemHovered()) {
+						const FolderEntry& entry = (*m_entries)[index];
+						if (entry.probed) { ImGui::SetTooltip("%s\n%u x %u", entry.name.c_str(), entry.width, entry.height); }
+						else { ImGui::SetTooltip("%s", entry.name.c_str()); }
+					}
+					ImGui::PopID();
+
+					// Look in the store the first time a cell is seen and make the thumbnail if it is not there
+					if (m_states[index] == State::NONE && uploads < MAX_UPLOADS_PER_FRAME) {
+						if (std::optional<Thumbnail> thumbnail = m_store->Find(m_files[index])) {
+							if (Upload(index, *thumbnail)) { uploads++; }
+						}
+						else {
+							jobs.push_back(Job{ .generation = 0, .index = index, .path = m_files[index] });
+							m_states[index] = State::QUEUED;
+						}
+					}
+
+					// Thumbnails evicted from the atlas for others are looked up again next frame
+					std::optional<TextureAtlas::Region> region;
+					auto slot = m_slots.find(index);
+					if (slot != m_slots.end()) {
+						region = m_atlas.Use(slot->second);
+						if (!region) {
+							m_slots.erase(slot);
+							m_states[index] = State::NONE;
+						}
+					}
+
+					// Fit the thumbnail inside its cell keeping the aspect ratio
+					if (region) {
+						float scale = m_cellSize / std::max(region->width, region->height);
+						ImVec2 size(region->width * scale, region->height * scale);
+						ImVec2 imageMin(cellMin.x + (m_cellSize - size.x) * 0.5f, cellMin.y + (m_cellSize - size.y) * 0.5f);
+						drawList->AddImage((ImTextureID)region->descriptorSet, imageMin, ImVec2(imageMin.x + size.x, imageMin.y + size.y), region->uv0, region->uv1);
+					}
+					else { drawList->AddRectFilled(cellMin, cellMax, (m_states[index] == State::FAILED ? IM_COL32(96, 32, 32, 255) : IM_COL32(48, 48, 48, 255))); }
+				}
+			}
+		}
+		clipper.End();
+		m_needsRedraw = (!m_uploads.empty() || uploads >= MAX_UPLOADS_PER_FRAME);
+
+		// Keep a margin of rows either side so scrolling back a little does not upload again
+		if (endRow > firstRow) {
+			wantedFirst = (firstRow - std::min(firstRow, ROW_MARGIN)) * columns;
+			wantedEnd = std::min(m_files.size(), (endRow + ROW_MARGIN) * columns);
+		}
+		else { wantedFirst = wantedEnd = 0; }
+		for (auto it = m_slots.begin(); it != m_slots.end();) {
+			if (it->first >= wantedFirst && it->first < wantedEnd) { it++; continue; }
+			m_states[it->first] = State::NONE;
+			m_atlas.Remove(it->second);
+			it = m_slots.erase(it);
+		}
+
+		// Newly seen thumbnails go to the front of the queue so whatever is on screen now is made first
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_wantedFirst = wantedFirst;
+			m_wantedEnd = wantedEnd;
+			for (Job& job : jobs) {
+				job.generation = m_generation;
+				m_jobs.push_front(std::move(job));
+			}
+		}
+		if (!jobs.empty()) { m_jobAdded.notify_all(); }
+
+		ImGui::EndChild();
+		ImGui::End();
+		return clicked;
+	}
+}
\ No newline at end of file
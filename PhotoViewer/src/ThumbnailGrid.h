@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+#include <functional>
+
+#include "ThumbnailStore.h"
+#include "FolderIndex.h"
+#include "TextureAtlas.h"
+
+namespace ImageLibrary {
+	// ImGui window showing every PNG and JPEG in a folder as a grid of thumbnails, only the rows on screen are looked at each frame
+	// Files are listed from the folder's index, so a folder seen before is shown at once and files changing while it is shown are picked up
+	// Stored thumbnails are uploaded as they scroll into view, missing ones are made on worker threads and dropped once scrolled away
+	// Thumbnails share the pages of a texture atlas so the whole grid draws from a few textures
+	class ThumbnailGrid
+	{
+	public:
+		// Called from a worker thread each time it finishes with a thumbnail or the folder changes so the frame loop can wake to show it
+		// The index of each folder shown is kept in the index directory
+		ThumbnailGrid(std::shared_ptr<ThumbnailStore> store, std::filesystem::path indexDirectory, std::function<void()> onResult = nullptr) noexcept(false);
+		~ThumbnailGrid() noexcept;
+
+		ThumbnailGrid(const ThumbnailGrid&) = delete;
+		ThumbnailGrid& operator=(const ThumbnailGrid&) = delete;
+
+		void SetFolder(const std::filesystem::path& folder);
+
+		// Draw the window, returns the path of a thumbnail clicked this frame
+		std::optional<std::string> Render();
+
+		// Whether thumbnails were left to upload or look up because of the limit on uploads each frame
+		bool NeedsRedraw() const noexcept { return m_needsRedraw; }
+
+	private:
+		// Uploads per frame are limited so scrolling onto a page of thumbnails spreads the work over a few frames
+		static constexpr int MAX_UPLOADS_PER_FRAME = 16;
+
+		// Rows either side of those on screen that keep their textures and are still worth making thumbnails for
+		static constexpr size_t ROW_MARGIN = 2;
+
+		// Pages the atlas may use before evicting, 32 pages of 256 pixel thumbnails hold over 1500
+		static constexpr uint32_t MAX_ATLAS_PAGES = 32;
+
+		enum class State : uint8_t {
+			NONE,
+			QUEUED,
+			READY,
+			FAILED
+		};
+
+		struct Job {
+			uint32_t generation;
+			size_t index;
+			std::string path;
+		};
+
+		// A job that was dropped has no thumbnail and did not fail, so it is queued again if it comes back into view
+		struct Result {
+			uint32_t generation;
+			size_t index;
+			std::optional<Thumbnail> thumbnail;
+			bool dropped;
+		};
+
+		// Start again from the latest entries of the folder's index
+		void ShowEntries();
+
+		void Worker();
+		void TakeResults();
+		// Returns false if the atlas had no room, which leaves the thumbnail to be looked up again
+		bool Upload(size_t index, const Thumbnail& thumbnail);
+
+	private:
+		std::shared_ptr<ThumbnailStore> m_store;
+		std::filesystem::path m_indexDirectory;
+		std::unique_ptr<FolderIndex> m_index;
+		std::shared_ptr<const std::vector<FolderEntry>> m_entries;
+		uint64_t m_indexGeneration = 0;
+		std::vector<std::string> m_files;
+		float m_cellSize = 128.0f;
+		std::function<void()> m_onResult;
+
+		// Only used by the UI thread
+		std::vector<State> m_states;
+		TextureAtlas m_atlas;
+		std::unordered_map<size_t, TextureAtlas::Handle> m_slots;
+		std::deque<std::pair<size_t, Thumbnail>> m_uploads;
+		bool m_needsRedraw = false;
+
+		// Shared with the workers, a new folder starts a new generation so older jobs and results are ignored
+		std::deque<Job> m_jobs;
+		std::vector<Result> m_results;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAdded;
+		std::vector<std::thread> m_workers;
+		bool m_stopping = false;
+		uint32_t m_generation = 0;
+		size_t m_wantedFirst = 0;
+		size_t m_wantedEnd = 0;
+	};
+}
\ No newline at end of file
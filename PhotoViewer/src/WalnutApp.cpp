@@ -3,38 +3,336 @@
 
 #include "Walnut/Image.h"
 
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <algorithm>
+#include <cctype>
+
 #include "Image.h"
 #include "PNG.h"
+#include "JPEG.h"
+#include "Animation.h"
+#include "Texture.h"
+#include "BlockEncoder.h"
+#include "PerformanceOverlay.h"
+#include "StatisticsPanel.h"
+#include "ZoomView.h"
+#include "CompareView.h"
+#include "ThumbnailGrid.h"
+#include "ZipArchive.h"
+#include "FramePacer.h"
+#include "Trace.h"
+#include "Soak.h"
+
+// Images to open one a frame and where the report goes, from --soak on the command line
+struct SoakSettings {
+	std::filesystem::path folder;
+	size_t loads = 1000;
+	std::filesystem::path outputPath;
+};
 
 class ExampleLayer : public Walnut::Layer
 {
 public:
+	ExampleLayer(std::optional<SoakSettings> soak = std::nullopt) : m_soak(std::move(soak))
+	{
+		if (!m_soak) { return; }
+
+		// Every PNG and JPEG in the folder in name order, opened in turn until the soak has done enough loads
+		std::error_code error;
+		for (std::filesystem::directory_iterator entry(m_soak->folder, error), end; !error && entry != end; entry.increment(error)) {
+			if (entry->is_regular_file(error) && ImageLibrary::Utils::GetFileFormat(entry->path().string()) != ImageLibrary::Utils::FileFormat::UNKNOWN) { m_soakFiles.push_back(entry->path()); }
+		}
+		std::sort(m_soakFiles.begin(), m_soakFiles.end());
+		if (m_soakFiles.empty()) { fprintf(stderr, "Error: No images to soak in %s\n", m_soak->folder.string().c_str()); }
+
+		m_soakRecorder = std::make_unique<ImageLibrary::SoakRecorder>(ImageLibrary::SoakOptions(), []() {
+			ImageLibrary::Texture::ResourceCounts counts = ImageLibrary::Texture::GetResourceCounts();
+			return std::vector<std::pair<std::string, int64_t>>{ { "vulkanObjects", counts.vulkanObjects }, { "pendingFrees", counts.pendingFrees } };
+		});
+	}
+
+	virtual void OnUpdate(float timeStep) override
+	{
+		// Sleep here, before the frame starts, until something needs drawing
+		m_framePacer.WaitForNextFrame(Walnut::Application::Get().GetWindowHandle());
+	}
+
 	virtual void OnUIRender() override
 	{
+		// Time asleep before the frame is not part of drawing it
+		m_performanceOverlay.AddFrameTime(std::max(0.0f, ImGui::GetIO().DeltaTime - (float)m_framePacer.GetLastWaitSeconds()));
+		m_performanceOverlay.SetFramePacing(m_framePacer.GetFramesPerSecond(), m_framePacer.GetIdleFraction());
+		ImageLibrary::Texture::ResourceCounts counts = ImageLibrary::Texture::GetResourceCounts();
+		m_performanceOverlay.SetResourceCounts(counts.vulkanObjects, counts.pendingFrees);
+		if (m_soak) { SoakStep(); }
+
 		ImGui::Begin("Control Panel");
-		if (ImGui::Button("Open")) {
-			m_loadedImage = std::make_unique<ImageLibrary::PNG>("C:\\Users\\johnr\\source\\repos\\photo-viewer\\PhotoViewer\\test\\basn0g01.png");
+		if (ImGui::Button("Open")) { Open(ImageLibrary::ImageSource::FromFile("C:\\Users\\johnr\\source\\repos\\photo-viewer\\PhotoViewer\\test\\basn0g01.png")); }
+
+		// Every PNG and JPEG in the folder is shown in the thumbnails window and kept up to date as files change, clicking one opens it
+		ImGui::InputText("Folder", m_folder, sizeof(m_folder));
+		if (ImGui::Button("Show folder")) { m_thumbnailGrid.SetFolder(m_folder); }
+
+		// Pages of a ZIP or CBZ archive are decoded from it without extracting anything, the arrow keys turn the pages
+		ImGui::InputText("Archive", m_archivePath, sizeof(m_archivePath));
+		if (ImGui::Button("Open archive")) { OpenArchive(m_archivePath); }
+		if (m_archive && !m_pages.empty()) {
+			bool typing = ImGui::IsAnyItemActive();
+			if ((ImGui::Button("Previous page") || (!typing && ImGui::IsKeyPressed(ImGuiKey_LeftArrow))) && m_page > 0) { ShowPage(m_page - 1); }
+			ImGui::SameLine();
+			if ((ImGui::Button("Next page") || (!typing && ImGui::IsKeyPressed(ImGuiKey_RightArrow))) && m_page + 1 < m_pages.size()) { ShowPage(m_page + 1); }
+			ImGui::SameLine();
+			ImGui::Text("Page %zu of %zu", m_page + 1, m_pages.size());
 		}
+		ImGui::Checkbox("Compress textures", &m_compressTextures);
+
+		// Frames are only drawn after input, window changes, finished loads and animation ticks
+		bool redrawWhenNeeded = m_framePacer.IsEnabled();
+		if (ImGui::Checkbox("Redraw only when needed", &redrawWhenNeeded)) { m_framePacer.SetEnabled(redrawWhenNeeded); }
+
+		// Turning and mirroring only change how the texture is drawn so are instant at any image size
+		ImGui::Separator();
+		Orient("Rotate left", m_orientation.Rotated(-1));
+		ImGui::SameLine();
+		Orient("Rotate right", m_orientation.Rotated(1));
+		Orient("Flip horizontal", m_orientation.FlippedHorizontally());
+		ImGui::SameLine();
+		Orient("Flip vertical", m_orientation.FlippedVertically());
+		Orient("Reset orientation", ImageLibrary::Utils::Orientation());
+
+		ImGui::Separator();
+		if (ImGui::Button("Zoom in")) { m_zoomView.ZoomBy(1.25f); }
+		ImGui::SameLine();
+		if (ImGui::Button("Zoom out")) { m_zoomView.ZoomBy(0.8f); }
+		if (ImGui::Button("Fit to window")) { m_zoomView.FitToWindow(); }
+		ImGui::SameLine();
+		if (ImGui::Button("Actual size")) { m_zoomView.SetZoom(1.0f); }
+		ImGui::Text("Zoom %.0f%%", m_zoomView.GetZoom() * 100.0f);
+
+		int filter = (int)m_zoomView.GetFilter();
+		if (ImGui::Combo("Filter", &filter, "Box\0Mitchell\0Lanczos3\0")) { m_zoomView.SetFilter((ImageLibrary::ResampleFilter)filter); }
+
+		// An original and a changed copy of it, such as a re-encode, are opened together in the compare window
+		ImGui::Separator();
+		ImGui::InputText("Original", m_comparePaths[0], sizeof(m_comparePaths[0]));
+		ImGui::InputText("Changed", m_comparePaths[1], sizeof(m_comparePaths[1]));
+		if (ImGui::Button("Compare")) { m_compareError = m_compareView.Open(m_comparePaths[0], m_comparePaths[1]).value_or(""); }
+		if (!m_compareError.empty()) { ImGui::TextWrapped("%s", m_compareError.c_str()); }
 		ImGui::End();
 
-		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
-		ImGui::Begin("Viewport");
+		if (m_animation) { UpdateAnimation(); }
 
-		// Use later when adding zoom
-		/*
-		m_ViewportWidth = ImGui::GetContentRegionAvail().x;
-		m_ViewportHeight = ImGui::GetContentRegionAvail().y;
-		*/
+		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
+		// The mouse wheel zooms rather than scrolls, large images can still be scrolled with the scroll bars
+		ImGui::Begin("Viewport", nullptr, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
 
 		if (m_loadedImage)
-			ImGui::Image(m_loadedImage->GetDescriptorSet(), { (float)m_loadedImage->GetWidth(), (float)m_loadedImage->GetHeight() });
+			m_zoomView.Render(*m_loadedImage);
 
 		ImGui::End();
 		ImGui::PopStyleVar();
+
+		if (m_compareView.IsOpen()) { m_compareView.Render(); }
+		m_performanceOverlay.Render();
+		m_statisticsPanel.Render();
+		if (std::optional<std::string> clicked = m_thumbnailGrid.Render()) { Open(ImageLibrary::ImageSource::FromFile(*clicked)); }
+
+		if (std::optional<double> delay = m_zoomView.GetRedrawDelay()) { m_framePacer.RequestRedrawIn(*delay); }
+		if (m_thumbnailGrid.NeedsRedraw()) { m_framePacer.RequestRedraw(); }
 	}
 
 private:
-	std::unique_ptr<ImageLibrary::Image> m_loadedImage;
+	void Open(const ImageLibrary::ImageSource& source)
+	{
+		// Time the whole load so its stages can be shown in the performance overlay
+		{
+			IL_TRACE_SCOPE("PhotoViewer::Open");
+
+			// A file that fails to decode leaves the current image open
+			std::unique_ptr<ImageLibrary::Image> image;
+			std::unique_ptr<ImageLibrary::Animation> animation;
+			ImageLibrary::ImageStatistics statistics;
+			try {
+				if (ImageLibrary::Utils::GetFileFormat(source.GetName()) == ImageLibrary::Utils::FileFormat::JPEG) { image = std::make_unique<ImageLibrary::JPEG>(source); }
+				else { image = std::make_unique<ImageLibrary::PNG>(source); }
+
+				// Taken first as an animation's worker decodes into the image from the moment it starts
+				statistics = image->GetStatistics();
+
+				// Animated images, which are only ever PNGs, are played from a canvas that is updated in place
+				// The first frame is decoded here so one that fails also leaves the current image open
+				ImageLibrary::PNG* png = dynamic_cast<ImageLibrary::PNG*>(image.get());
+				if (png && png->IsAnimated()) {
+					image.release();
+					animation = std::make_unique<ImageLibrary::Animation>(std::unique_ptr<ImageLibrary::PNG>(png));
+				}
+			}
+			catch (std::runtime_error* e) {
+				delete e;
+				return;
+			}
+			m_statisticsPanel.SetStatistics(statistics);
+
+			m_animation = std::move(animation);
+			if (m_animation) {
+				m_loadedImage = std::make_unique<ImageLibrary::Texture>(m_animation->GetWidth(), m_animation->GetHeight(), m_animation->GetPixelFormat(), m_animation->GetCanvas());
+				m_frameTime = 0.0;
+				m_zoomView.SetSource(nullptr);
+			}
+			else {
+				// Compressed textures use a quarter to an eighth of the video memory, the blocks are kept in the disk cache
+				ImageLibrary::BlockEncoderOptions options;
+				if (m_compressTextures) { options.format = ImageLibrary::BlockEncoder::ChooseFormat(image->GetPixelFormat(), image->GetPixelBuffer(), options.quality); }
+
+				if (options.format && ImageLibrary::Texture::IsBlockFormatSupported(*options.format)) {
+					m_loadedImage = std::make_unique<ImageLibrary::Texture>(ImageLibrary::BlockEncoder(*image, options));
+				}
+				else {
+					m_loadedImage = std::make_unique<ImageLibrary::Texture>(*image);
+				}
+
+				// Kept so the viewport can resample it to the size it is drawn at
+				m_zoomView.SetSource(std::move(image));
+			}
+		}
+		m_orientation = ImageLibrary::Utils::Orientation();
+		m_performanceOverlay.AddLoad("PhotoViewer::Open");
+	}
+
+	void OpenArchive(const std::string& path)
+	{
+		// The central directory is read once here, each page is then found by its index
+		std::shared_ptr<const ImageLibrary::ZipArchive> archive;
+		try { archive = std::make_shared<const ImageLibrary::ZipArchive>(path); }
+		catch (std::runtime_error* e) {
+			delete e;
+			return;
+		}
+
+		// Pages are every PNG and JPEG in the archive in name order
+		const std::vector<ImageLibrary::ZipArchive::Member>& members = archive->GetMembers();
+		std::vector<size_t> pages;
+		for (size_t i = 0; i < members.size(); i++) {
+			if (ImageLibrary::Utils::GetFileFormat(members[i].name) != ImageLibrary::Utils::FileFormat::UNKNOWN) { pages.push_back(i); }
+		}
+		std::sort(pages.begin(), pages.end(), [&members](size_t a, size_t b) { return members[a].name < members[b].name; });
+
+		m_archive = archive;
+		m_pages = std::move(pages);
+		if (!m_pages.empty()) { ShowPage(0); }
+	}
+
+	void ShowPage(size_t page)
+	{
+		m_page = page;
+		Open(ImageLibrary::ImageSource::FromArchive(m_archive, m_pages[m_page]));
+	}
+
+	void Orient(const char* label, ImageLibrary::Utils::Orientation orientation)
+	{
+		if (!ImGui::Button(label)) { return; }
+
+		m_orientation = orientation;
+		if (m_loadedImage) { m_loadedImage->SetOrientation(m_orientation); }
+	}
+
+	// Open the next image each frame, so textures are made and freed with frames in flight as they are while browsing
+	void SoakStep()
+	{
+		if (m_soakFinished) { return; }
+		if (!m_soakFiles.empty() && m_soakRecorder->GetLoadCount() < m_soak->loads) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			Open(ImageLibrary::ImageSource::FromFile(m_soakFiles[m_soakRecorder->GetLoadCount() % m_soakFiles.size()].string()));
+			m_soakRecorder->AddLoad(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			m_framePacer.RequestRedraw();
+			return;
+		}
+
+		// The report goes to standard output unless a file was given, the verdict always goes to the error stream
+		std::vector<std::string> failures = m_soakRecorder->Judge();
+		std::string json = m_soakRecorder->ToJSON();
+		if (m_soak->outputPath.empty()) { fputs(json.c_str(), stdout); }
+		else {
+			std::ofstream output(m_soak->outputPath, std::ios::binary);
+			output << json;
+			if (!output) { fprintf(stderr, "Error: Could not write %s\n", m_soak->outputPath.string().c_str()); }
+		}
+		for (const std::string& failure : failures) { fprintf(stderr, "Error: %s\n", failure.c_str()); }
+		fprintf(stderr, "Soak %s after %zu loads\n", failures.empty() ? "passed" : "failed", m_soakRecorder->GetLoadCount());
+
+		m_soakFinished = true;
+		Walnut::Application::Get().Close();
+	}
+
+	void UpdateAnimation()
+	{
+		m_frameTime += ImGui::GetIO().DeltaTime;
+
+		// Catch up on any frames that are due but only upload the combined changed region once
+		ImageLibrary::Utils::Rect dirtyRegion;
+		while (!m_animation->IsFinished() && m_frameTime >= m_animation->GetFrameDelay()) {
+			double delay = m_animation->GetFrameDelay();
+
+			// Stop if the worker has not decoded the next frame yet, it will be shown next time
+			// A frame that fails to decode finishes the animation on the last one shown
+			ImageLibrary::Utils::Rect frameRegion;
+			try {
+				if (!m_animation->Advance(frameRegion)) { break; }
+			}
+			catch (std::runtime_error* e) {
+				delete e;
+				break;
+			}
+
+			m_frameTime -= delay;
+			dirtyRegion = ImageLibrary::Utils::UnionRect(dirtyRegion, frameRegion);
+		}
+
+		m_loadedImage->UpdateRegion(m_animation->GetCanvas(), dirtyRegion);
+
+		// Wake for the next frame when it is due, or keep checking if the worker is behind
+		if (m_animation->IsFinished()) { return; }
+		if (m_frameTime >= m_animation->GetFrameDelay()) { m_framePacer.RequestRedraw(); }
+		else { m_framePacer.RequestRedrawIn(m_animation->GetFrameDelay() - m_frameTime); }
+	}
+
+private:
+	// Declared first so it outlives the workers that wake it
+	ImageLibrary::FramePacer m_framePacer;
+
+	std::unique_ptr<ImageLibrary::Texture> m_loadedImage;
+	std::unique_ptr<ImageLibrary::Animation> m_animation;
+	double m_frameTime = 0.0;
+	bool m_compressTextures = false;
+	ImageLibrary::Utils::Orientation m_orientation;
+
+	ImageLibrary::PerformanceOverlay m_performanceOverlay;
+	ImageLibrary::StatisticsPanel m_statisticsPanel;
+	ImageLibrary::ZoomView m_zoomView{ [this]() { m_framePacer.Wake(); } };
+
+	// Thumbnails are kept next to the decode cache in a single pack file, with the index of each folder shown alongside
+	ImageLibrary::ThumbnailGrid m_thumbnailGrid{ std::make_shared<ImageLibrary::ThumbnailStore>(std::filesystem::temp_directory_path() / "PhotoViewer" / "Thumbnails.pack"),
+		std::filesystem::temp_directory_path() / "PhotoViewer" / "Folders", [this]() { m_framePacer.Wake(); } };
+	char m_folder[1024] = "";
+
+	// Archive being paged through and the members that are its pages
+	std::shared_ptr<const ImageLibrary::ZipArchive> m_archive;
+	std::vector<size_t> m_pages;
+	size_t m_page = 0;
+	char m_archivePath[1024] = "";
+
+	ImageLibrary::CompareView m_compareView;
+	char m_comparePaths[2][1024] = { "", "" };
+	std::string m_compareError;
+
+	// Load and unload soak run instead of waiting for input
+	std::optional<SoakSettings> m_soak;
+	std::vector<std::filesystem::path> m_soakFiles;
+	std::unique_ptr<ImageLibrary::SoakRecorder> m_soakRecorder;
+	bool m_soakFinished = false;
 };
 
 Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
@@ -42,8 +340,28 @@ Walnut::Application* Walnut::CreateApplication(int argc, char** argv)
 	Walnut::ApplicationSpecification spec;
 	spec.Name = "Photo Viewer";
 
+	// Keep decoded images on disk so reopening them skips decoding
+	ImageLibrary::Image::SetDiskCache(std::make_shared<ImageLibrary::DiskCache>(std::filesystem::temp_directory_path() / "PhotoViewer" / "DecodeCache", 2ull * 1024 * 1024 * 1024));
+
+	// Histograms for the statistics panel are built as images decode
+	ImageLibrary::Image::SetCollectStatistics(true);
+
+	// Record loads so the performance overlay can break them down
+#ifdef IL_TRACING
+	ImageLibrary::Trace::SetEnabled(true);
+#endif
+
+	// --soak <folder> [--loads <count>] [--output <file>] opens every image in the folder in turn and reports whether latency, memory or GPU objects kept growing
+	std::optional<SoakSettings> soak;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--soak" && i + 1 < argc) { soak.emplace().folder = argv[++i]; }
+		else if (argument == "--loads" && i + 1 < argc && soak) { soak->loads = std::max(1ull, strtoull(argv[++i], nullptr, 10)); }
+		else if (argument == "--output" && i + 1 < argc && soak) { soak->outputPath = argv[++i]; }
+	}
+
 	Walnut::Application* app = new Walnut::Application(spec);
-	app->PushLayer<ExampleLayer>();
+	app->PushLayer(std::make_shared<ExampleLayer>(soak));
 	app->SetMenubarCallback([app]()
 	{
 		if (ImGui::BeginMenu("File"))
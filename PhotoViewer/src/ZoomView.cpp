@@ -0,0 +1,118 @@
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+#include "imgui.h"
+
+#include "ZoomView.h"
+
+namespace ImageLibrary {
+	void ZoomView::SetSource(std::shared_ptr<Image> image) {
+		m_source = std::move(image);
+		m_resampled.reset();
+		m_resampleFailed = false;
+		m_generation++;
+		m_fitRequested = true;
+	}
+
+	void ZoomView::ZoomBy(float factor) noexcept {
+		SetZoom(m_targetZoom * factor);
+	}
+
+	void ZoomView::SetZoom(float zoom) noexcept {
+		m_targetZoom = std::clamp(zoom, MIN_ZOOM, MAX_ZOOM);
+		m_fitRequested = false;
+	}
+
+	void ZoomView::SetFilter(ResampleFilter filter) noexcept {
+		if (filter == m_filter) { return; }
+
+		m_filter = filter;
+		m_resampled.reset();
+		m_resampleFailed = false;
+		m_generation++;
+	}
+
+	void ZoomView::Render(const Texture& texture) {
+		ImGuiIO& io = ImGui::GetIO();
+		ImVec2 available = ImGui::GetContentRegionAvail();
+		float displayWidth = (float)texture.GetDisplayWidth();
+		float displayHeight = (float)texture.GetDisplayHeight();
+
+		// Fitting only shrinks so small images are not blown up
+		if (m_fitRequested && available.x > 0.0f && available.y > 0.0f) {
+			m_targetZoom = std::clamp(std::min({ available.x / displayWidth, available.y / displayHeight, 1.0f }), MIN_ZOOM, MAX_ZOOM);
+			m_fitRequested = false;
+		}
+		if (ImGui::IsWindowHovered() && io.MouseWheel != 0.0f) { ZoomBy(std::pow(1.25f, io.MouseWheel)); }
+
+		// Ease towards the target, snapping to it once the difference is too small to see
+		if (m_zoom != m_targetZoom) {
+			m_zoom += (m_targetZoom - m_zoom) * (1.0f - std::exp(-ZOOM_SPEED * io.DeltaTime));
+			if (std::abs(m_zoom / m_targetZoom - 1.0f) < 0.001f) { m_zoom = m_targetZoom; }
+			m_settledSeconds = 0.0f;
+			m_resampleFailed = false;
+		}
+		else { m_settledSeconds += io.DeltaTime; }
+
+		// Size in the texture's own orientation so a copy stays valid when the image is turned
+		uint32_t width = std::max(1u, (uint32_t)std::lround(texture.GetWidth() * m_zoom));
+		uint32_t height = std::max(1u, (uint32_t)std::lround(texture.GetHeight() * m_zoom));
+		UpdateResampled(texture, width, height);
+
+		// Centre the image while it is smaller than the window, on a whole pixel so a resampled copy is not filtered again
+		float drawWidth = displayWidth * m_zoom;
+		float drawHeight = displayHeight * m_zoom;
+		ImVec2 cursor = ImGui::GetCursorPos();
+		ImGui::SetCursorPos(ImVec2(std::floor(cursor.x + std::max(0.0f, (available.x - drawWidth) * 0.5f)), std::floor(cursor.y + std::max(0.0f, (available.y - drawHeight) * 0.5f))));
+
+		if (m_resampled && m_resampled->GetWidth() == width && m_resampled->GetHeight() == height) {
+			m_resampled->SetOrientation(texture.GetOrientation());
+			m_resampled->Draw((float)m_resampled->GetDisplayWidth(), (float)m_resampled->GetDisplayHeight());
+		}
+		else { texture.Draw(drawWidth, drawHeight); }
+	}
+
+	std::optional<double> ZoomView::GetRedrawDelay() const noexcept {
+		if (m_zoom != m_targetZoom) { return 0.0; }
+		if (m_resampleWanted && !m_pending.valid()) { return std::max(0.0, (double)(SETTLE_SECONDS - m_settledSeconds)); }
+		return std::nullopt;
+	}
+
+	void ZoomView::UpdateResampled(const Texture& texture, uint32_t width, uint32_t height) {
+		// Upload a finished copy here as only this thread uses Vulkan
+		if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			try {
+				std::unique_ptr<Resampler> resampler = m_pending.get();
+				if (m_pendingGeneration == m_generation) {
+					m_resampled = std::make_unique<Texture>(resampler->GetWidth(), resampler->GetHeight(), resampler->GetPixelFormat(), resampler->GetData());
+				}
+			}
+			catch (std::exception* e) {
+				// Keep showing the GPU filtered texture rather than trying again every frame
+				m_resampleFailed = (m_pendingGeneration == m_generation);
+				delete e;
+			}
+		}
+
+		// Enlarging is left to the GPU, a copy larger than the image would only cost memory
+		m_resampleWanted = m_source && !m_resampleFailed && m_zoom < 1.0f && !(m_resampled && m_resampled->GetWidth() == width && m_resampled->GetHeight() == height)
+			&& m_source->GetWidth() == texture.GetWidth() && m_source->GetHeight() == texture.GetHeight();
+		if (!m_resampleWanted || m_pending.valid() || m_settledSeconds < SETTLE_SECONDS) { return; }
+
+		// The task keeps its own reference to the image so opening another while it runs is safe
+		std::span<const uint8_t> pixels = m_source->GetPixelBuffer();
+		ResamplerOptions options;
+		options.filter = m_filter;
+		m_pendingGeneration = m_generation;
+		std::promise<std::unique_ptr<Resampler>> promise;
+		m_pending = promise.get_future();
+		m_task = std::async(std::launch::async, [promise = std::move(promise), source = m_source, pixels, width, height, options, onResampled = m_onResampled]() mutable {
+			try { promise.set_value(std::make_unique<Resampler>(source->GetWidth(), source->GetHeight(), source->GetPixelFormat(), pixels, width, height, options)); }
+			catch (...) { promise.set_exception(std::current_exception()); }
+
+			// Only wake once the copy can be taken, otherwise the frames drawn after the wake could all find it not ready yet
+			if (onResampled) { onResampled(); }
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <future>
+#include <functional>
+#include <optional>
+
+#include "Image.h"
+#include "Resampler.h"
+#include "Texture.h"
+
+namespace ImageLibrary {
+	// Draws the open texture at a zoom level that eases towards its target, the GPU filters the texture while the zoom moves
+	// Once it settles below actual size a copy resampled on another thread to exactly the drawn size is shown instead
+	class ZoomView
+	{
+	public:
+		// Called from the resampling thread as a copy finishes so the frame loop can wake to show it
+		ZoomView(std::function<void()> onResampled = nullptr) : m_onResampled(std::move(onResampled)) {}
+
+		// Image the resampled copies are made from, none for animations as their canvas keeps changing
+		void SetSource(std::shared_ptr<Image> image);
+
+		void ZoomBy(float factor) noexcept;
+		void SetZoom(float zoom) noexcept;
+		void FitToWindow() noexcept { m_fitRequested = true; }
+		float GetZoom() const noexcept { return m_targetZoom; }
+
+		void SetFilter(ResampleFilter filter) noexcept;
+		ResampleFilter GetFilter() const noexcept { return m_filter; }
+
+		// Draw inside the current window, zooming with the mouse wheel while it is hovered
+		void Render(const Texture& texture);
+
+		// Seconds until the view changes without any input, 0 while the zoom eases and none once it has settled and any copy has been started
+		std::optional<double> GetRedrawDelay() const noexcept;
+
+	private:
+		static constexpr float MIN_ZOOM = 0.01f;
+		static constexpr float MAX_ZOOM = 32.0f;
+
+		// Rate the zoom closes on its target each second and how long it must stay there before resampling
+		static constexpr float ZOOM_SPEED = 15.0f;
+		static constexpr float SETTLE_SECONDS = 0.15f;
+
+		void UpdateResampled(const Texture& texture, uint32_t width, uint32_t height);
+
+	private:
+		std::shared_ptr<Image> m_source;
+		ResampleFilter m_filter = ResampleFilter::LANCZOS3;
+
+		float m_zoom = 1.0f;
+		float m_targetZoom = 1.0f;
+		float m_settledSeconds = 0.0f;
+		bool m_fitRequested = true;
+		bool m_resampleFailed = false;
+		bool m_resampleWanted = false;
+
+		// Copies from an older source or filter are dropped when they finish as a running resample cannot be stopped
+		uint32_t m_generation = 0;
+		uint32_t m_pendingGeneration = 0;
+		std::future<std::unique_ptr<Resampler>> m_pending;
+
+		// The task setting the pending copy, kept so it is waited for rather than left running once the view is gone
+		std::future<void> m_task;
+		std::unique_ptr<Texture> m_resampled;
+		std::function<void()> m_onResampled;
+	};
+}
\ No newline at end of file
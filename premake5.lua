@@ -1,10 +1,36 @@
--- premake5.lua
+newoption {
+   trigger = "headless",
+   description = "Only generate the decoder library, for machines without Walnut and the Vulkan SDK"
+}
+
+newoption {
+   trigger = "no-tracing",
+   description = "Compile out the scoped timers used for trace export and the performance overlay"
+}
+
+newoption {
+   trigger = "libpng",
+   description = "Link the benchmark against an installed libpng to compare the decoder with it"
+}
+
 workspace "PhotoViewer"
    architecture "x64"
    configurations { "Debug", "Release", "Dist" }
    startproject "PhotoViewer"
 
+   filter "not options:no-tracing"
+      defines { "IL_TRACING" }
+
+   filter {}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
-include "Walnut/WalnutExternal.lua"
 
-include "PhotoViewer"
\ No newline at end of file
+include "ImageLibrary"
+include "ImageTool"
+include "Benchmark"
+
+if not _OPTIONS["headless"] then
+   include "Walnut/WalnutExternal.lua"
+
+   include "PhotoViewer"
+end
\ No newline at end of file
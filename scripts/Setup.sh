@@ -0,0 +1,6 @@
+#!/bin/bash
+
+# Pass --headless to only generate the decoder library when Walnut and the Vulkan SDK are unavailable
+pushd .. > /dev/null
+premake5 gmake2 "$@"
+popd > /dev/null
\ No newline at end of file